@@ -0,0 +1,106 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * alias_table.c -- Sampling from a weighted discrete distribution in constant
+ * time.
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "alias_table.h"
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+void
+alias_table_init( alias_table_t *t
+                , const double  *weights
+                , int            num_entries
+                )
+{
+	assert(num_entries > 0);
+	
+	t->num_entries = num_entries;
+	t->bins = malloc(num_entries * sizeof(alias_table_bin_t));
+	assert(t->bins != NULL);
+	
+	double total = 0.0;
+	for (int i = 0; i < num_entries; i++) {
+		assert(weights[i] >= 0.0);
+		total += weights[i];
+	}
+	assert(total > 0.0);
+	
+	// The probability of each entry scaled such that the average is one (i.e.
+	// the share of a bin it requires). Entries needing less than a whole bin
+	// (small) are topped up by an alias to an entry needing more (large) using
+	// Vose's method.
+	double *scaled = malloc(num_entries * sizeof(double));
+	int    *small  = malloc(num_entries * sizeof(int));
+	int    *large  = malloc(num_entries * sizeof(int));
+	assert(scaled != NULL && small != NULL && large != NULL);
+	int num_small = 0;
+	int num_large = 0;
+	for (int i = 0; i < num_entries; i++) {
+		scaled[i] = (weights[i] * num_entries) / total;
+		if (scaled[i] < 1.0)
+			small[num_small++] = i;
+		else
+			large[num_large++] = i;
+	}
+	
+	while (num_small > 0 && num_large > 0) {
+		int s = small[--num_small];
+		int l = large[num_large - 1];
+		
+		t->bins[s].threshold = (uint32_t)(scaled[s] * 4294967296.0);
+		t->bins[s].alias     = (uint32_t)l;
+		
+		// The large entry gives up the rest of the small entry's bin
+		scaled[l] -= 1.0 - scaled[s];
+		if (scaled[l] < 1.0) {
+			num_large--;
+			small[num_small++] = l;
+		}
+	}
+	
+	// The remaining entries fill their bins (any left in the small list are only
+	// there due to rounding errors). A full bin's alias is itself since a random
+	// number may exceed the threshold.
+	while (num_large > 0) {
+		int l = large[--num_large];
+		t->bins[l].threshold = UINT32_MAX;
+		t->bins[l].alias     = (uint32_t)l;
+	}
+	while (num_small > 0) {
+		int s = small[--num_small];
+		t->bins[s].threshold = UINT32_MAX;
+		t->bins[s].alias     = (uint32_t)s;
+	}
+	
+	free(scaled);
+	free(small);
+	free(large);
+}
+
+
+int
+alias_table_get_num_entries(const alias_table_t *t)
+{
+	return t->num_entries;
+}
+
+
+void
+alias_table_destroy(alias_table_t *t)
+{
+	free(t->bins);
+}
+
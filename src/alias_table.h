@@ -0,0 +1,74 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * alias_table.h -- Sampling from a fixed, weighted discrete distribution in
+ * constant time using Walker's alias method.
+ *
+ * A table of n entries is divided into n equally likely bins, each holding (a
+ * share of) at most two entries: the bin's own entry and an alias. A sample
+ * therefore takes a single random number: its high bits choose a bin and its
+ * low bits choose between the bin's two entries.
+ */
+
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "rng.h"
+
+/**
+ * An alias table.
+ */
+typedef struct alias_table alias_table_t;
+
+
+// Concrete definitions of the above types
+#include "alias_table_internal.h"
+
+
+/**
+ * Initialise an alias table from which entry i is sampled with probability
+ * weights[i]/sum(weights).
+ *
+ * @param weights An array of num_entries non-negative weights (which need not
+ *                be normalised) of which at least one must be positive. The
+ *                array is not referenced after the call.
+ * @param num_entries The number of entries (at least one).
+ */
+void alias_table_init( alias_table_t *table
+                     , const double  *weights
+                     , int            num_entries
+                     );
+
+
+/**
+ * The number of entries in the table.
+ */
+int alias_table_get_num_entries(const alias_table_t *table);
+
+
+/**
+ * Sample an entry index from the table using the given generator.
+ */
+static inline int
+alias_table_sample(const alias_table_t *table, rng_t *rng)
+{
+	uint64_t x = rng_next(rng);
+	uint32_t bin = (uint32_t)(((x >> 32) * (uint64_t)table->num_entries) >> 32);
+	if ((uint32_t)x < table->bins[bin].threshold)
+		return (int)bin;
+	else
+		return (int)table->bins[bin].alias;
+}
+
+
+/**
+ * Free the resources used by an alias table.
+ */
+void alias_table_destroy(alias_table_t *table);
+
+#endif
+
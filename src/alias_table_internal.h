@@ -0,0 +1,25 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * alias_table_internal.h -- Concrete definitions of internal datastrucutres.
+ * This is provided to allow the creation of these types. Users should not
+ * access the fields directly. This file should only be included by
+ * alias_table.h
+ */
+
+
+/**
+ * A bin of the table: the bin's own entry is chosen when the low 32 bits of the
+ * random number are below the threshold, otherwise the alias is chosen.
+ */
+typedef struct alias_table_bin {
+	uint32_t threshold;
+	uint32_t alias;
+} alias_table_bin_t;
+
+
+struct alias_table {
+	alias_table_bin_t *bins;
+	int                num_entries;
+};
+
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "config.h"
 
@@ -36,25 +37,9 @@ arbiter_tick(void *a_)
 {
 	arbiter_t *a = (arbiter_t *)a_;
 	
-	// Immediately stop if the output is blocked
-	if (buffer_is_full(a->output))
-		return;
-	
-	// Iterate over all the inputs
-	for (int i_ = 0; i_ < a->num_inputs; i_++) {
-		// Starting after the last one to be handled
-		int i = (i_+a->last_input+1)%a->num_inputs;
-		
-		if (!buffer_is_empty(a->inputs[i])) {
-			// There is a value ready at this input, set it to be forwarded during the
-			// tock phase.
-			a->last_input   = i;
-			a->handle_input = true;
-			return;
-		}
-	}
-	
-	// No inputs were ready, do nothing!
+	// No inputs were ready, do nothing until one is.
+	if (!arbiter_arbitrate(a))
+		scheduler_sleep(a->event);
 }
 
 /**
@@ -67,12 +52,7 @@ arbiter_tock(void *a_)
 {
 	arbiter_t *a = (arbiter_t *)a_;
 	
-	if (a->handle_input) {
-		void *value = buffer_pop(a->inputs[a->last_input]);
-		buffer_push(a->output, value);
-		
-		a->handle_input = false;
-	}
+	arbiter_forward(a);
 }
 
 
@@ -89,6 +69,28 @@ arbiter_init( arbiter_t   *a
             , buffer_t    *output
             )
 {
+	// Schedule the arbiter tick/tock functions to occur at the specified
+	// interval.
+	scheduler_event_t *event = scheduler_schedule( s, period
+	                                             , arbiter_tick, (void *)a
+	                                             , arbiter_tock, (void *)a
+	                                             );
+	
+	arbiter_init_unscheduled(a, s, event, inputs, num_inputs, output);
+}
+
+
+void
+arbiter_init_unscheduled( arbiter_t         *a
+                        , scheduler_t       *s
+                        , scheduler_event_t *event
+                        , buffer_t         **inputs
+                        , size_t             num_inputs
+                        , buffer_t          *output
+                        )
+{
+	assert(num_inputs <= ARBITER_MAX_INPUTS);
+	
 	// Copy the input array into a local copy
 	a->inputs = calloc(num_inputs, sizeof(buffer_t *));
 	assert(a->inputs != NULL);
@@ -105,12 +107,61 @@ arbiter_init( arbiter_t   *a
 	
 	a->handle_input = false;
 	
-	// Schedule the arbiter tick/tock functions to occur at the specified
-	// interval.
-	scheduler_schedule( s, period
-	                  , arbiter_tick, (void *)a
-	                  , arbiter_tock, (void *)a
-	                  );
+	a->event = event;
+	
+	// Wake the arbiter when a value arrives and track which inputs have values.
+	// When multi-threaded, inputs may be pushed into by other threads while the
+	// arbiter pops from its inputs.
+	a->nonempty_inputs = 0;
+	bool atomic = scheduler_get_num_threads(s) > 1;
+	for (int i = 0; i < num_inputs; i++) {
+		buffer_set_consumer(a->inputs[i], a->event);
+		buffer_set_nonempty_mask( a->inputs[i]
+		                        , &(a->nonempty_inputs), i
+		                        , atomic
+		                        );
+	}
+}
+
+
+bool
+arbiter_arbitrate(arbiter_t *a)
+{
+	// Immediately stop if the output is blocked
+	if (buffer_is_full(a->output))
+		return true;
+	
+	uint64_t nonempty = __atomic_load_n(&(a->nonempty_inputs), __ATOMIC_RELAXED);
+	if (nonempty == 0)
+		return false;
+	
+	// Select the first ready input after the last one to be handled, wrapping
+	// around to the first ready input if there are none after it.
+	size_t first = a->last_input + 1;
+	uint64_t after_last = (first < a->num_inputs) ? (nonempty & (~UINT64_C(0) << first))
+	                                              : 0;
+	a->last_input   = __builtin_ctzll(after_last != 0 ? after_last : nonempty);
+	a->handle_input = true;
+	return true;
+}
+
+
+void
+arbiter_forward(arbiter_t *a)
+{
+	if (a->handle_input) {
+		buffer_value_t value = buffer_pop(a->inputs[a->last_input]);
+		buffer_push(a->output, value);
+		
+		a->handle_input = false;
+	}
+}
+
+
+bool
+arbiter_has_input(arbiter_t *a)
+{
+	return __atomic_load_n(&(a->nonempty_inputs), __ATOMIC_RELAXED) != 0;
 }
 
 
@@ -4,18 +4,29 @@
  * arbiter.h -- A round-robbin arbiter which at a regular period attempts to
  * forward values from a set of input buffers into a single output buffer using
  * a round-robbin approach in the case of contention.
+ *
+ * The arbiter tracks which of its inputs are non-empty in a bit mask and so
+ * selects the next input in constant time regardless of the number of inputs.
  */
 
 #ifndef ARBITER_H
 #define ARBITER_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #include "config.h"
 
 #include "scheduler.h"
 #include "buffer.h"
 
+/**
+ * The largest number of inputs an arbiter may have.
+ */
+#define ARBITER_MAX_INPUTS 64
+
+
 /**
  * A data structure defining an arbiter.
  */
@@ -29,12 +40,15 @@ typedef struct arbiter arbiter_t;
 /**
  * Initialise a new arbiter. Adds itself to the scheduler with the requesteed period.
  *
- * @param scheduler The scheduler controling the simulation.
+ * @param scheduler The scheduler controling the simulation. Its number of
+ *                  threads must already have been set.
  * @param period The period at which the arbiter will attempt to forward one
  *               value.
  * @param inputs An array of input buffers to arbitrate between. This array will
  *               be copied.
- * @param num_inputs The length of the inputs array.
+ * @param num_inputs The length of the inputs array (at most
+ *                   ARBITER_MAX_INPUTS). The arbiter takes over the inputs'
+ *                   non-empty masks (see buffer_set_nonempty_mask).
  * @param output The output buffer into which values should be placed.
  */
 void arbiter_init( arbiter_t   *arbiter
@@ -46,6 +60,51 @@ void arbiter_init( arbiter_t   *arbiter
                  );
 
 
+/**
+ * Initialise a new arbiter without scheduling it, for use within a larger
+ * component whose own event calls arbiter_arbitrate() and arbiter_forward()
+ * from its tick and tock functions respectively.
+ *
+ * @param scheduler The scheduler controling the simulation. Its number of
+ *                  threads must already have been set.
+ * @param event The (already scheduled) event to wake when a value arrives at
+ *              any of the inputs.
+ * @param inputs An array of input buffers to arbitrate between. This array will
+ *               be copied.
+ * @param num_inputs The length of the inputs array (at most
+ *                   ARBITER_MAX_INPUTS).
+ * @param output The output buffer into which values should be placed.
+ */
+void arbiter_init_unscheduled( arbiter_t         *arbiter
+                             , scheduler_t       *scheduler
+                             , scheduler_event_t *event
+                             , buffer_t         **inputs
+                             , size_t             num_inputs
+                             , buffer_t          *output
+                             );
+
+
+/**
+ * The work of the arbiter's tick: choose the input (if any) whose value will be
+ * forwarded by arbiter_forward(). Returns false if every input is empty (and
+ * so the arbiter has nothing to do until a value arrives).
+ */
+bool arbiter_arbitrate(arbiter_t *arbiter);
+
+
+/**
+ * The work of the arbiter's tock: forward the value chosen by
+ * arbiter_arbitrate(), if any.
+ */
+void arbiter_forward(arbiter_t *arbiter);
+
+
+/**
+ * Does any of the arbiter's inputs hold a value?
+ */
+bool arbiter_has_input(arbiter_t *arbiter);
+
+
 /**
  * Free the resources from an arbiter. Note that the scheduler this was
  * registered with must also be freed as it will be left holding a reference to
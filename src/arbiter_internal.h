@@ -15,14 +15,22 @@
  * whether a value from the input is to be forwarded by the tock function. If it
  * is true, the input indicated by last_input will have its value forwarded to
  * the output.
+ *
+ * Bit i of nonempty_inputs is set while input i is non-empty (it is maintained
+ * by the input buffers, see buffer_set_nonempty_mask).
  */
 struct arbiter {
 	buffer_t **inputs;
 	size_t     num_inputs;
 	buffer_t  *output;
 	
+	uint64_t nonempty_inputs;
+	
 	size_t last_input;
 	
 	bool handle_input;
+	
+	// The arbiter's scheduler event (which sleeps while all inputs are empty)
+	scheduler_event_t *event;
 };
 
@@ -0,0 +1,263 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * async_file.c -- An output file written by a background thread.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "async_file.h"
+
+
+/******************************************************************************
+ * Private functions.
+ ******************************************************************************/
+
+/**
+ * Internal function.
+ *
+ * The writer thread: writes out each buffer handed over until the file is
+ * closed.
+ */
+static void *
+writer_thread(void *file_)
+{
+	async_file_t *file = (async_file_t *)file_;
+	
+	pthread_mutex_lock(&(file->lock));
+	while (true) {
+		while (file->pending_len == 0 && !file->closing)
+			pthread_cond_wait(&(file->cond), &(file->lock));
+		
+		// Only finish once everything handed over has been written
+		if (file->pending_len == 0)
+			break;
+		
+		const char *buffer = file->pending;
+		size_t      len    = file->pending_len;
+		pthread_mutex_unlock(&(file->lock));
+		
+		if (file->format != NULL)
+			file->format(file, buffer, len, file->format_data);
+		else
+			async_file_output(file, buffer, len);
+		
+		// Make the data visible to anyone reading the (uncompressed) file. Flushing
+		// a compressed stream would harm the compression so this is left to zlib.
+#ifdef HAVE_LIBZ
+		if (file->gz_stream == NULL)
+#endif
+			if (fflush(file->stream) != 0)
+				file->error = true;
+		
+		pthread_mutex_lock(&(file->lock));
+		file->pending_len = 0;
+		pthread_cond_signal(&(file->cond));
+	}
+	pthread_mutex_unlock(&(file->lock));
+	
+	return NULL;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Hand the active buffer to the writer thread (first waiting for it to finish
+ * with the other buffer) and start appending to the other buffer.
+ */
+static void
+swap_buffers(async_file_t *file)
+{
+	if (file->num_used == 0)
+		return;
+	
+	pthread_mutex_lock(&(file->lock));
+	while (file->pending_len != 0)
+		pthread_cond_wait(&(file->cond), &(file->lock));
+	file->pending     = file->buffers[file->active];
+	file->pending_len = file->num_used;
+	pthread_cond_signal(&(file->cond));
+	pthread_mutex_unlock(&(file->lock));
+	
+	file->active   = !file->active;
+	file->num_used = 0;
+}
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+bool
+async_file_can_compress(void)
+{
+#ifdef HAVE_LIBZ
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+void
+async_file_init( async_file_t        *file
+               , FILE                *stream
+               , size_t               buffer_size
+               , bool                 compress
+               , async_file_format_t  format
+               , void                *format_data
+               )
+{
+	file->stream = stream;
+#ifdef HAVE_LIBZ
+	file->gz_stream = NULL;
+	if (compress) {
+		// The zlib stream gets its own descriptor so that it may be closed
+		// independently of the stdio stream.
+		int fd = dup(fileno(stream));
+		assert(fd >= 0);
+		file->gz_stream = gzdopen(fd, "wb");
+		assert(file->gz_stream != NULL);
+	}
+#else
+	assert(!compress);
+#endif
+	
+	file->format      = format;
+	file->format_data = format_data;
+	
+	file->buffer_size = buffer_size;
+	for (int i = 0; i < 2; i++) {
+		file->buffers[i] = malloc(buffer_size);
+		assert(file->buffers[i] != NULL);
+	}
+	file->active   = 0;
+	file->num_used = 0;
+	
+	pthread_mutex_init(&(file->lock), NULL);
+	pthread_cond_init(&(file->cond), NULL);
+	file->pending     = NULL;
+	file->pending_len = 0;
+	file->closing     = false;
+	file->error       = false;
+	
+	int error = pthread_create(&(file->thread), NULL, writer_thread, file);
+	assert(error == 0);
+}
+
+
+void *
+async_file_reserve(async_file_t *file, size_t len)
+{
+	assert(len <= file->buffer_size);
+	
+	if (file->num_used + len > file->buffer_size)
+		swap_buffers(file);
+	
+	void *space = file->buffers[file->active] + file->num_used;
+	file->num_used += len;
+	return space;
+}
+
+
+void
+async_file_write(async_file_t *file, const void *data, size_t len)
+{
+	memcpy(async_file_reserve(file, len), data, len);
+}
+
+
+void
+async_file_printf(async_file_t *file, const char *format, ...)
+{
+	va_list args;
+	
+	// Try formatting into the space remaining in the active buffer, falling back
+	// on an empty buffer if it doesn't fit.
+	for (int attempt = 0; attempt < 2; attempt++) {
+		size_t space = file->buffer_size - file->num_used;
+		
+		va_start(args, format);
+		int len = vsnprintf(file->buffers[file->active] + file->num_used, space, format, args);
+		va_end(args);
+		assert(len >= 0);
+		
+		// NB: vsnprintf requires space for a terminating null
+		if ((size_t)len < space) {
+			file->num_used += len;
+			return;
+		}
+		
+		swap_buffers(file);
+	}
+	
+	// The string is larger than a whole buffer
+	assert(0);
+}
+
+
+void
+async_file_flush(async_file_t *file)
+{
+	swap_buffers(file);
+}
+
+
+void
+async_file_output(async_file_t *file, const void *data, size_t len)
+{
+	if (len == 0)
+		return;
+	
+#ifdef HAVE_LIBZ
+	if (file->gz_stream != NULL) {
+		if (gzwrite(file->gz_stream, data, len) != (int)len)
+			file->error = true;
+		return;
+	}
+#endif
+	
+	if (fwrite(data, 1, len, file->stream) != len)
+		file->error = true;
+}
+
+
+bool
+async_file_destroy(async_file_t *file)
+{
+	swap_buffers(file);
+	
+	pthread_mutex_lock(&(file->lock));
+	file->closing = true;
+	pthread_cond_signal(&(file->cond));
+	pthread_mutex_unlock(&(file->lock));
+	
+	pthread_join(file->thread, NULL);
+	
+	bool success = !file->error;
+#ifdef HAVE_LIBZ
+	if (file->gz_stream != NULL)
+		if (gzclose(file->gz_stream) != Z_OK)
+			success = false;
+#endif
+	if (fclose(file->stream) != 0)
+		success = false;
+	
+	pthread_mutex_destroy(&(file->lock));
+	pthread_cond_destroy(&(file->cond));
+	free(file->buffers[0]);
+	free(file->buffers[1]);
+	
+	return success;
+}
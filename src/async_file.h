@@ -0,0 +1,122 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * async_file.h -- An output file written by a background thread.
+ *
+ * Data is appended to one of two in-memory buffers. When a buffer fills (or is
+ * flushed) it is handed to a writer thread which formats, (optionally)
+ * compresses and writes it to the file while data continues to be appended to
+ * the other buffer. Appending is a plain memory copy: the writing thread only
+ * waits if the writer thread is still busy with the previous buffer.
+ *
+ * Data may be written verbatim or, given a format function, passed through
+ * that function on the writer thread. This allows compact binary records to be
+ * appended while the (comparatively slow) conversion to text happens in the
+ * background.
+ *
+ * Only one thread may append to a file at any one time.
+ */
+
+#ifndef ASYNC_FILE_H
+#define ASYNC_FILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "config.h"
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+/**
+ * An asynchronously written file.
+ */
+typedef struct async_file async_file_t;
+
+/**
+ * A function called on the writer thread with the contents of a buffer (len
+ * bytes) which writes its output using async_file_output. A buffer only ever
+ * contains whole reservations (see async_file_reserve). The data argument is
+ * the one given to async_file_init.
+ */
+typedef void (*async_file_format_t)(async_file_t *file, const void *buffer, size_t len, void *data);
+
+
+// Concrete definitions of the above types
+#include "async_file_internal.h"
+
+
+/**
+ * Is compression supported (i.e. was the simulator built with zlib)?
+ */
+bool async_file_can_compress(void);
+
+
+/**
+ * Initialise an asynchronous file and start its writer thread.
+ *
+ * @param stream The (open) file to write to which is closed by
+ *               async_file_destroy.
+ * @param buffer_size The size of each of the two buffers. No single
+ *                    reservation or printf may be larger than this.
+ * @param compress Should the output be gzip compressed? Must only be true when
+ *                 async_file_can_compress().
+ * @param format The function used to produce the output from the data
+ *               appended or NULL to write it verbatim.
+ * @param format_data Data passed to the format function.
+ */
+void async_file_init( async_file_t        *file
+                    , FILE                *stream
+                    , size_t               buffer_size
+                    , bool                 compress
+                    , async_file_format_t  format
+                    , void                *format_data
+                    );
+
+
+/**
+ * Reserve len contiguous bytes at the end of the file's buffer which the caller
+ * must fill before the next call to any other async_file function. Returns a
+ * pointer to the reserved space.
+ */
+void *async_file_reserve(async_file_t *file, size_t len);
+
+
+/**
+ * Append len bytes to the file.
+ */
+void async_file_write(async_file_t *file, const void *data, size_t len);
+
+
+/**
+ * Append a printf-formatted string (without its terminating null) to the file.
+ */
+void async_file_printf(async_file_t *file, const char *format, ...);
+
+
+/**
+ * Hand everything appended so far to the writer thread. The data is written
+ * (and the underlying file flushed) shortly afterwards in the background.
+ */
+void async_file_flush(async_file_t *file);
+
+
+/**
+ * For use by format functions only (i.e. on the writer thread): write len bytes
+ * of output to the underlying file.
+ */
+void async_file_output(async_file_t *file, const void *data, size_t len);
+
+
+/**
+ * Write out anything remaining, stop the writer thread, close the underlying
+ * file and free the resources used. Returns false if any data could not be
+ * written or the file could not be closed.
+ */
+bool async_file_destroy(async_file_t *file);
+
+#endif
+
@@ -0,0 +1,45 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * async_file_internal.h -- Concrete definitions of internal datastrucutres.
+ * This is provided to allow the creation of these types. Users should not
+ * access the fields directly. This file should only be included by
+ * async_file.h
+ */
+
+struct async_file {
+	// The underlying file and, if compressing, the zlib stream writing to it
+	FILE   *stream;
+#ifdef HAVE_LIBZ
+	gzFile  gz_stream;
+#endif
+	
+	// The function (and its argument) which produces the output from the data
+	// appended (NULL to write the data verbatim)
+	async_file_format_t  format;
+	void                *format_data;
+	
+	// The two buffers. The appending thread owns buffers[active] of which the
+	// first num_used bytes are used.
+	char   *buffers[2];
+	size_t  buffer_size;
+	int     active;
+	size_t  num_used;
+	
+	// The fields below are protected by the lock. The appending thread hands a
+	// buffer to the writer thread by setting pending_len (non-zero) and waits for
+	// the writer to reset it before handing over another. The condition is
+	// signalled whenever either changes the state.
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	const char     *pending;
+	size_t          pending_len;
+	bool            closing;
+	
+	// Has any write failed? (Only accessed by the writer thread until it exits.)
+	bool error;
+	
+	// The writer thread
+	pthread_t thread;
+};
+
@@ -2,6 +2,9 @@
  * TickySim -- A timing based interconnection network simulator.
  *
  * buffer.h -- A generic buffer implementation.
+ *
+ * These buffers are not clocked in any way. They can push and pop an arbitary
+ * number of packets per cycle.
  */
 
 #ifndef BUFFER_H
@@ -9,52 +12,75 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "config.h"
 
-/**
- * An instance of a buffer.
- */
-typedef struct buffer buffer_t;
+#include "scheduler.h"
 
-// Concrete definitions of the above types
+// The buffer implementation is defined inline in buffer_internal.h
 #include "buffer_internal.h"
 
 /**
- * Initialise a buffer of the specified length.
- */
-void buffer_init(buffer_t *buffer, size_t size);
-
-/**
- * Free the buffer from memory.
- */
-void buffer_destroy(buffer_t *buffer);
-
-/**
- * Test whether the buffer is full.
- */
-bool buffer_is_full(buffer_t *buffer);
-
-/**
- * Test whether the buffer is empty.
- */
-bool buffer_is_empty(buffer_t *buffer);
-
-/**
- * Insert a value into the buffer.
+ * The type of value held by a buffer_t. This is normally a pointer but when
+ * configured with --enable-packet-handles it is a 32-bit handle (an index into
+ * a packet pool, see spinn_packet_handle_t) halving the size of every buffer.
  */
-void buffer_push(buffer_t *buffer, void *value);
-
-/**
- * Retreive a value from the buffer.
- */
-void *buffer_pop(buffer_t *buffer);
+#ifdef USE_PACKET_HANDLES
+typedef uint32_t buffer_value_t;
+#else
+typedef void *buffer_value_t;
+#endif
 
 /**
- * Get the value of the item which will be popped next. If the buffer_is_empty()
- * is true, the behaviour is undefined.
+ * An instance of a buffer of buffer_value_t along with the following functions.
+ *
+ * void buffer_init(buffer_t *buffer, size_t size);
+ *   Initialise a buffer of the specified length.
+ *
+ * void buffer_init_from(buffer_t *buffer, size_t size, buffer_value_t *storage);
+ *   Initialise a buffer of the specified length whose values are held in
+ *   storage supplied by the caller. The storage must be (at least)
+ *   buffer_storage_size(size) values long and must outlive the buffer.
+ *   It is not freed by buffer_destroy. This allows many buffers to be packed
+ *   into a single allocation.
+ *
+ * void buffer_destroy(buffer_t *buffer);
+ *   Free the buffer from memory (except storage given to buffer_init_from).
+ *
+ * void buffer_set_consumer(buffer_t *buffer, scheduler_event_t *consumer);
+ *   Set the scheduler event which consumes values from the buffer. The event is
+ *   woken whenever a value is pushed into the buffer. May be NULL (the default)
+ *   if the consumer never sleeps.
+ *
+ * void buffer_set_nonempty_mask(buffer_t *buffer, uint64_t *mask,
+ *                               unsigned int bit, bool atomic);
+ *   Keep bit number bit (0-63) of *mask set exactly while the buffer is non-empty
+ *   (setting or clearing it immediately to match the buffer's current state).
+ *   This allows a consumer of many buffers to find the non-empty ones without
+ *   testing each in turn. If atomic is true, the mask is updated atomically and
+ *   so may be shared by buffers whose ends are used by different threads.
+ *
+ * bool buffer_is_full(buffer_t *buffer);
+ *   Test whether the buffer is full.
+ *
+ * bool buffer_is_empty(buffer_t *buffer);
+ *   Test whether the buffer is empty.
+ *
+ * unsigned int buffer_get_count(buffer_t *buffer);
+ *   Get the number of values in the buffer.
+ *
+ * void buffer_push(buffer_t *buffer, buffer_value_t value);
+ *   Insert a value into the buffer.
+ *
+ * buffer_value_t buffer_pop(buffer_t *buffer);
+ *   Retreive a value from the buffer.
+ *
+ * buffer_value_t buffer_peek(buffer_t *buffer);
+ *   Get the value of the item which will be popped next. If the
+ *   buffer_is_empty() is true, the behaviour is undefined.
  */
-void *buffer_peek(buffer_t *buffer);
+BUFFER_DEFINE(buffer, buffer_value_t)
 
 
 #endif
@@ -1,45 +1,215 @@
 /**
  * TickySim -- A timing based interconnection network simulator.
  *
- * buffer_internal.h -- Concrete definitions of internal datastrucutres. This is
- * provided to allow the creation of these types. Users should not access the
- * fields directly. This file should only be included by buffer.h
+ * buffer_internal.h -- Concrete definitions of internal datastrucutres and the
+ * (inline) implementation of buffers. This is provided to allow the creation of
+ * these types and to allow the compiler to inline buffer operations into their
+ * callers. Users should not access the fields directly. This file should only
+ * be included by buffer.h
  */
 
+#include <assert.h>
+
+
+/**
+ * The number of values a buffer of the given size actually stores, i.e. the
+ * size rounded up to the next power of two. This is the length of storage which
+ * must be supplied to buffer_init_from.
+ */
+static inline unsigned int
+buffer_storage_size(size_t size)
+{
+	unsigned int storage_size = 1;
+	while (storage_size < size)
+		storage_size <<= 1;
+	return storage_size;
+}
+
+
+/**
+ * Set or clear the given bit of a buffer's non-empty mask, atomically if the
+ * mask may be updated by several threads at once.
+ */
+static inline void
+buffer_nonempty_mask_set(uint64_t *mask, unsigned int bit, bool atomic)
+{
+	if (atomic)
+		__atomic_fetch_or(mask, UINT64_C(1) << bit, __ATOMIC_SEQ_CST);
+	else
+		*mask |= UINT64_C(1) << bit;
+}
+
+static inline void
+buffer_nonempty_mask_clear(uint64_t *mask, unsigned int bit, bool atomic)
+{
+	if (atomic)
+		__atomic_fetch_and(mask, ~(UINT64_C(1) << bit), __ATOMIC_SEQ_CST);
+	else
+		*mask &= ~(UINT64_C(1) << bit);
+}
+
+
 /**
  * *** Do not access these fields directly. ***
  *
- * A structure defining a particular instance of a buffer.
+ * Define a buffer type, name_t, holding values of the given type along with
+ * the functions name_init, name_init_from, name_destroy, name_set_consumer,
+ * name_is_full, name_is_empty, name_get_count, name_push, name_pop and
+ * name_peek which behave as documented for buffer_t in buffer.h.
  *
- * Contains an array of values size+1 in length with pointers to the head and
- * tail of values in the buffer. The head points to the next empty space and the
- * tail points to the next value to be retreived from the buffer.
+ * The values are stored in an array whose length is size rounded up to a power
+ * of two. The head and tail are free-running counts of the values pushed and
+ * popped which are masked to index the array. The number of values in the
+ * buffer is therefore simply head-tail (even once the counts overflow).
  *
- * Empty: (pointers overlapping)
- *   ,-----------------,
- *   |  |  |  |  |  |  |
- *   '-----------------'
+ * Empty: (head == tail)
+ *   ,-----------------------,
+ *   |  |  |  |  |  |  |  |  |
+ *   '-----------------------'
  *     |
  *    tail+head
  *
- * Part-filled: (pointers not overlapping or adjacent)
- *   ,-----------------,
- *   |##|##|##|  |  |  |
- *   '-----------------'
- *     |        |
- *    tail     head
- *
- * Full: (pointers adjacent)
- *   ,-----------------,
- *   |##|##|##|##|##|  |
- *   '-----------------'
+ * Full: (head - tail == size)
+ *   ,-----------------------,
+ *   |##|##|##|##|##|  |  |  |
+ *   '-----------------------'
  *     |              |
  *    tail          head
+ *
+ * The occupancy is derived from the head and tail rather than kept in a
+ * separate count so that the producer only ever writes the head and the
+ * consumer only ever writes the tail. This allows the two ends of a buffer to
+ * be used by different threads within the same phase. The head and tail are
+ * therefore only written atomically and, except by the end which writes them,
+ * only read atomically (the values themselves are only handed between threads
+ * across phases and need no further ordering).
+ *
+ * The values array is freed on destruction only if it was allocated by
+ * name_init (i.e. owns_values is true) and not supplied to name_init_from.
+ *
+ * The consumer is an (optional) scheduler event to wake on each push.
+ *
+ * The nonempty_mask is an (optional) word in which bit nonempty_bit is kept set
+ * while the buffer holds values. Since the ends of a buffer may be used by
+ * different threads (and several buffers may share a mask word), the mask may
+ * be updated atomically (nonempty_atomic). In that case, when the last value is
+ * popped the bit is cleared and the head re-read: if a value was pushed
+ * meanwhile the bit is set again, so a concurrent push can never leave a
+ * non-empty buffer with its bit clear.
  */
-struct buffer {
-	void   **values;
-	size_t   size;
-	int      head;
-	int      tail;
-};
-
+#define BUFFER_DEFINE(name, type) \
+	typedef struct name { \
+		type              *values; \
+		unsigned int       size; \
+		unsigned int       mask; \
+		unsigned int       head; \
+		unsigned int       tail; \
+		bool               owns_values; \
+		bool               nonempty_atomic; \
+		uint8_t            nonempty_bit; \
+		scheduler_event_t *consumer; \
+		uint64_t          *nonempty_mask; \
+	} name##_t; \
+	\
+	static inline void \
+	name##_init_from(name##_t *b, size_t size, type *storage) \
+	{ \
+		b->values = storage; \
+		b->size = size; \
+		b->mask = buffer_storage_size(size) - 1; \
+		b->head = 0; \
+		b->tail = 0; \
+		b->owns_values = false; \
+		b->consumer = NULL; \
+		b->nonempty_mask = NULL; \
+		b->nonempty_bit = 0; \
+		b->nonempty_atomic = false; \
+	} \
+	\
+	static inline void \
+	name##_init(name##_t *b, size_t size) \
+	{ \
+		type *storage = calloc(buffer_storage_size(size), sizeof(type)); \
+		assert(storage != NULL); \
+		name##_init_from(b, size, storage); \
+		b->owns_values = true; \
+	} \
+	\
+	static inline void \
+	name##_destroy(name##_t *b) \
+	{ \
+		if (b->owns_values) \
+			free(b->values); \
+	} \
+	\
+	static inline void \
+	name##_set_consumer(name##_t *b, scheduler_event_t *consumer) \
+	{ \
+		b->consumer = consumer; \
+	} \
+	\
+	static inline void \
+	name##_set_nonempty_mask(name##_t *b, uint64_t *mask, unsigned int bit, bool atomic) \
+	{ \
+		assert(bit < 64); \
+		b->nonempty_mask = mask; \
+		b->nonempty_bit = (uint8_t)bit; \
+		b->nonempty_atomic = atomic; \
+		if (b->head != b->tail) \
+			buffer_nonempty_mask_set(mask, bit, atomic); \
+		else \
+			buffer_nonempty_mask_clear(mask, bit, atomic); \
+	} \
+	\
+	static inline unsigned int \
+	name##_get_count(name##_t *b) \
+	{ \
+		return __atomic_load_n(&(b->head), __ATOMIC_RELAXED) \
+		       - __atomic_load_n(&(b->tail), __ATOMIC_RELAXED); \
+	} \
+	\
+	static inline bool \
+	name##_is_full(name##_t *b) \
+	{ \
+		return name##_get_count(b) == b->size; \
+	} \
+	\
+	static inline bool \
+	name##_is_empty(name##_t *b) \
+	{ \
+		return name##_get_count(b) == 0; \
+	} \
+	\
+	static inline void \
+	name##_push(name##_t *b, type value) \
+	{ \
+		assert(!name##_is_full(b)); \
+		b->values[b->head & b->mask] = value; \
+		__atomic_store_n(&(b->head), b->head + 1, __ATOMIC_RELEASE); \
+		if (b->nonempty_mask != NULL) \
+			buffer_nonempty_mask_set(b->nonempty_mask, b->nonempty_bit, b->nonempty_atomic); \
+		if (b->consumer != NULL) \
+			scheduler_wake(b->consumer); \
+	} \
+	\
+	static inline type \
+	name##_pop(name##_t *b) \
+	{ \
+		assert(!name##_is_empty(b)); \
+		type value = b->values[b->tail & b->mask]; \
+		__atomic_store_n(&(b->tail), b->tail + 1, __ATOMIC_RELEASE); \
+		if (b->nonempty_mask != NULL \
+		    && __atomic_load_n(&(b->head), __ATOMIC_ACQUIRE) == b->tail) { \
+			buffer_nonempty_mask_clear(b->nonempty_mask, b->nonempty_bit, b->nonempty_atomic); \
+			if (b->nonempty_atomic && __atomic_load_n(&(b->head), __ATOMIC_SEQ_CST) != b->tail) \
+				buffer_nonempty_mask_set(b->nonempty_mask, b->nonempty_bit, true); \
+		} \
+		return value; \
+	} \
+	\
+	static inline type \
+	name##_peek(name##_t *b) \
+	{ \
+		assert(!name##_is_empty(b)); \
+		return b->values[b->tail & b->mask]; \
+	}
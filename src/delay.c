@@ -27,7 +27,8 @@
  * Internal function.
  *
  * Check to see if a value is available for forwarding and forwarding is
- * allowed/possible.
+ * allowed/possible. When a value starts waiting, the delay sleeps until it is
+ * due to be forwarded.
  */
 void
 delay_tick(void *d_)
@@ -36,16 +37,43 @@ delay_tick(void *d_)
 	
 	d->forward = false;
 	
-	// The input and output buffers are both ready!
-	if (!buffer_is_empty(d->input) && !buffer_is_full(d->output)) {
-		if (d->current_delay > 0)
-			d->current_delay--;
-		
-		// If the value has been waiting long enough forward it.
-		if (d->current_delay == 0) {
+	ticks_t now = scheduler_get_ticks(d->scheduler);
+	
+	if (d->waiting) {
+		if (now < d->release_time) {
+			// Woken (or called) early, keep sleeping until the value is due
+			scheduler_sleep(d->event);
+		} else if (!buffer_is_full(d->output)) {
+			// The output can only be full if something else has pushed into it
 			d->forward = true;
+			d->waiting = false;
 			d->current_delay = d->delay;
+		} else {
+			d->counters.blocked++;
 		}
+		return;
+	}
+	
+	// Nothing to do until a value arrives
+	if (buffer_is_empty(d->input)) {
+		scheduler_sleep(d->event);
+		return;
+	}
+	
+	// The input and output buffers are both ready! Forward the value after
+	// current_delay periods (counting this one).
+	if (!buffer_is_full(d->output)) {
+		if (d->current_delay <= 1) {
+			d->forward = true;
+			d->current_delay = d->delay;
+		} else {
+			d->waiting = true;
+			d->release_time = now + ((d->current_delay - 1) * d->period);
+			scheduler_sleep_until(d->scheduler, d->event, d->release_time);
+		}
+	} else {
+		// Blocked: keep trying every period until the output has space
+		d->counters.blocked++;
 	}
 }
 
@@ -61,8 +89,10 @@ delay_tock(void *d_)
 {
 	delay_t *d = (delay_t *)d_;
 	
-	if (d->forward)
+	if (d->forward) {
 		buffer_push(d->output, buffer_pop(d->input));
+		d->counters.forwarded++;
+	}
 }
 
 
@@ -85,13 +115,22 @@ delay_init( delay_t     *d
 	
 	d->delay         = delay;
 	d->current_delay = delay;
+	d->waiting       = false;
+	
+	d->scheduler = s;
+	d->period    = period;
+	
+	delay_reset_counters(d);
 	
 	// Schedule the arbiter tick/tock functions to occur at the specified
 	// interval.
-	scheduler_schedule( s, period
-	                  , delay_tick, (void *)d
-	                  , delay_tock, (void *)d
-	                  );
+	d->event = scheduler_schedule( s, period
+	                             , delay_tick, (void *)d
+	                             , delay_tock, (void *)d
+	                             );
+	
+	// Wake the delay when a value arrives
+	buffer_set_consumer(input, d->event);
 }
 
 
@@ -102,6 +141,21 @@ delay_set_delay(delay_t *d, int delay)
 }
 
 
+delay_counters_t
+delay_get_counters(delay_t *d)
+{
+	return d->counters;
+}
+
+
+void
+delay_reset_counters(delay_t *d)
+{
+	d->counters.forwarded = 0;
+	d->counters.blocked   = 0;
+}
+
+
 void
 delay_destroy( delay_t *d)
 {
@@ -4,6 +4,12 @@
  * delay.h -- A block which connects two buffers and will forward a single value
  * to a second buffer after it has been waiting in the first buffer for a given
  * number of cycles.
+ *
+ * The delay must be the only block which pushes values into its output buffer
+ * and the only one which pops values from its input buffer. Once a value starts
+ * waiting it therefore cannot be blocked and so the time it will be forwarded
+ * is known in advance. Rather than counting down every period, the delay
+ * sleeps until this time.
  */
 
 #ifndef DELAY_H
@@ -21,6 +27,18 @@
  */
 typedef struct delay delay_t;
 
+/**
+ * Counts of the use of the link a delay models.
+ */
+typedef struct delay_counters {
+	// Values forwarded to the output buffer
+	int forwarded;
+	
+	// Periods in which a value was ready to be forwarded (or to start waiting)
+	// but the output buffer was full
+	int blocked;
+} delay_counters_t;
+
 
 // Concrete definitions of the above types
 #include "delay_internal.h"
@@ -52,6 +70,17 @@ void delay_init( delay_t     *d
 void delay_set_delay(delay_t *d, int delay);
 
 
+/**
+ * Get the counters of a delay.
+ */
+delay_counters_t delay_get_counters(delay_t *d);
+
+
+/**
+ * Reset the counters of a delay to zero.
+ */
+void delay_reset_counters(delay_t *d);
+
 
 /**
  * Free the resources from an delay. Note that the scheduler this was registered
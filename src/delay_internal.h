@@ -15,11 +15,26 @@ struct delay {
 	// forwarded to the next buffer.
 	int delay;
 	
-	// The number of periods the first buffer has contained a value which hasn't
-	// been forwarded.
+	// The number of periods the value at the head of the input buffer must wait
+	// before being forwarded once the output is free.
 	int current_delay;
 	
+	// Is a value waiting to be forwarded and if so, at what time?
+	bool    waiting;
+	ticks_t release_time;
+	
+	// The scheduler the delay is registered with and the period with which it is
+	// scheduled.
+	scheduler_t *scheduler;
+	ticks_t      period;
+	
 	// Should the value in the first buffer be popped and placed in the next
 	// buffer? (Set in the tick phase and read in the tock phase).
 	bool forward;
+	
+	// Counters of values forwarded and periods spent blocked by a full output
+	delay_counters_t counters;
+	
+	// The delay's scheduler event (which sleeps while the input is empty)
+	scheduler_event_t *event;
 };
@@ -0,0 +1,154 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * histogram.c -- A histogram with logarithmically sized buckets.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "histogram.h"
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+void
+histogram_init(histogram_t *histogram, int precision_bits)
+{
+	assert(precision_bits >= 1 && precision_bits <= 16);
+	
+	histogram->precision_bits = precision_bits;
+	histogram->buckets        = NULL;
+	histogram->num_buckets    = 0;
+	
+	histogram_reset(histogram);
+}
+
+
+void
+histogram_reset(histogram_t *histogram)
+{
+	if (histogram->buckets != NULL)
+		memset(histogram->buckets, 0, histogram->num_buckets * sizeof(uint64_t));
+	
+	histogram->count = 0;
+	histogram->sum   = 0;
+	histogram->min   = UINT32_MAX;
+	histogram->max   = 0;
+}
+
+
+void
+histogram_grow(histogram_t *histogram, int bucket)
+{
+	// Grow geometrically to avoid growing for every new maximum (but never
+	// beyond the bucket of the largest possible value)
+	int max_buckets = histogram_get_bucket(histogram, UINT32_MAX) + 1;
+	int num_buckets = histogram->num_buckets * 2;
+	if (num_buckets < bucket + 1)
+		num_buckets = bucket + 1;
+	if (num_buckets > max_buckets)
+		num_buckets = max_buckets;
+	
+	histogram->buckets = realloc(histogram->buckets, num_buckets * sizeof(uint64_t));
+	assert(histogram->buckets != NULL);
+	memset( histogram->buckets + histogram->num_buckets, 0
+	      , (num_buckets - histogram->num_buckets) * sizeof(uint64_t)
+	      );
+	histogram->num_buckets = num_buckets;
+}
+
+
+uint64_t
+histogram_get_count(const histogram_t *histogram)
+{
+	return histogram->count;
+}
+
+
+uint32_t
+histogram_get_min(const histogram_t *histogram)
+{
+	return histogram->min;
+}
+
+
+uint32_t
+histogram_get_max(const histogram_t *histogram)
+{
+	return histogram->max;
+}
+
+
+double
+histogram_get_mean(const histogram_t *histogram)
+{
+	return (double)histogram->sum / (double)histogram->count;
+}
+
+
+uint32_t
+histogram_get_percentile(const histogram_t *histogram, double percentile)
+{
+	// The number of values which must lie at or below the result
+	uint64_t target = (uint64_t)((percentile / 100.0) * (double)histogram->count);
+	if ((double)target < (percentile / 100.0) * (double)histogram->count)
+		target++;
+	if (target < 1)
+		target = 1;
+	
+	uint64_t total = 0;
+	for (int i = 0; i < histogram->num_buckets; i++) {
+		uint32_t lowest, highest;
+		total += histogram_get_bucket_count(histogram, i, &lowest, &highest);
+		if (total >= target)
+			return highest < histogram->max ? highest : histogram->max;
+	}
+	
+	return histogram->max;
+}
+
+
+int
+histogram_get_num_buckets(const histogram_t *histogram)
+{
+	return histogram->num_buckets;
+}
+
+
+uint64_t
+histogram_get_bucket_count( const histogram_t *histogram
+                          , int                bucket
+                          , uint32_t          *lowest
+                          , uint32_t          *highest
+                          )
+{
+	int bits = histogram->precision_bits;
+	
+	if (bucket < (1 << bits)) {
+		*lowest  = (uint32_t)bucket;
+		*highest = (uint32_t)bucket;
+	} else {
+		// The inverse of histogram_get_bucket
+		int shift = (bucket >> (bits - 1)) - 1;
+		*lowest  = (uint32_t)(bucket - (shift << (bits - 1))) << shift;
+		*highest = *lowest + ((1u << shift) - 1u);
+	}
+	
+	return histogram->buckets[bucket];
+}
+
+
+void
+histogram_destroy(histogram_t *histogram)
+{
+	free(histogram->buckets);
+}
@@ -0,0 +1,136 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * histogram.h -- A histogram of non-negative integer values with logarithmically
+ * sized buckets (in the style of HdrHistogram).
+ *
+ * A histogram has a number of bits of precision, b. Values below 2^b have a
+ * bucket each and so are recorded exactly. Above this, each power-of-two range
+ * [2^m, 2^(m+1)) is divided into 2^(b-1) equal buckets and so every value is
+ * recorded to within a relative error of 2^-(b-1). Counting a value takes a
+ * handful of instructions and memory for buckets is only allocated as far as
+ * the largest value counted.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * A histogram.
+ */
+typedef struct histogram histogram_t;
+
+
+// Concrete definitions of the above types
+#include "histogram_internal.h"
+
+
+/**
+ * Initialise an empty histogram with the given number of bits of precision (1
+ * to 16).
+ */
+void histogram_init(histogram_t *histogram, int precision_bits);
+
+
+/**
+ * Remove all values from the histogram.
+ */
+void histogram_reset(histogram_t *histogram);
+
+
+/**
+ * Internal function. Grow the bucket array of a histogram to include the given
+ * bucket.
+ */
+void histogram_grow(histogram_t *histogram, int bucket);
+
+
+/**
+ * The index of the bucket which counts the given value.
+ */
+static inline int
+histogram_get_bucket(const histogram_t *histogram, uint32_t value)
+{
+	int bits = histogram->precision_bits;
+	
+	if (value < (1u << bits))
+		return (int)value;
+	
+	// Values in [2^m, 2^(m+1)) are shifted so that bits significant bits remain
+	int shift = (31 - __builtin_clz(value)) - bits + 1;
+	return (shift << (bits - 1)) + (int)(value >> shift);
+}
+
+
+/**
+ * Count a value.
+ */
+static inline void
+histogram_add(histogram_t *histogram, uint32_t value)
+{
+	int bucket = histogram_get_bucket(histogram, value);
+	if (bucket >= histogram->num_buckets)
+		histogram_grow(histogram, bucket);
+	
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->sum += value;
+	if (value < histogram->min) histogram->min = value;
+	if (value > histogram->max) histogram->max = value;
+}
+
+
+/**
+ * The number of values counted.
+ */
+uint64_t histogram_get_count(const histogram_t *histogram);
+
+
+/**
+ * The smallest and largest values counted and their (exact) mean. Undefined if
+ * no values have been counted.
+ */
+uint32_t histogram_get_min(const histogram_t *histogram);
+uint32_t histogram_get_max(const histogram_t *histogram);
+double histogram_get_mean(const histogram_t *histogram);
+
+
+/**
+ * The value below which (at least) the given percentage (0.0 to 100.0) of
+ * values lie. This is the largest value in the bucket containing that
+ * percentile (but no larger than the largest value counted) and so is exact for
+ * values below 2^precision_bits. Undefined if no values have been counted.
+ */
+uint32_t histogram_get_percentile(const histogram_t *histogram, double percentile);
+
+
+/**
+ * The number of buckets which may be non-empty. Buckets are numbered from 0 in
+ * order of the values they contain.
+ */
+int histogram_get_num_buckets(const histogram_t *histogram);
+
+
+/**
+ * The number of values counted in a bucket and the range of values it covers
+ * (inclusive).
+ */
+uint64_t histogram_get_bucket_count( const histogram_t *histogram
+                                   , int                bucket
+                                   , uint32_t          *lowest
+                                   , uint32_t          *highest
+                                   );
+
+
+/**
+ * Free the resources used by a histogram.
+ */
+void histogram_destroy(histogram_t *histogram);
+
+#endif
+
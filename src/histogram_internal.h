@@ -0,0 +1,23 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * histogram_internal.h -- Concrete definitions of internal datastrucutres. This
+ * is provided to allow the creation of these types. Users should not access the
+ * fields directly. This file should only be included by histogram.h
+ */
+
+struct histogram {
+	int precision_bits;
+	
+	// The count of each bucket (see histogram_get_bucket), allocated up to the
+	// highest bucket used so far
+	uint64_t *buckets;
+	int       num_buckets;
+	
+	// Summary of the values counted
+	uint64_t count;
+	uint64_t sum;
+	uint32_t min;
+	uint32_t max;
+};
+
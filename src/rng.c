@@ -0,0 +1,52 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * rng.c -- A small, fast pseudo-random number generator.
+ */
+
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "rng.h"
+
+
+/******************************************************************************
+ * Private functions.
+ ******************************************************************************/
+
+/**
+ * Internal function.
+ *
+ * The SplitMix64 generator: advances *x and returns the next value. Its output
+ * is well mixed even for similar starting values (e.g. consecutive stream
+ * numbers) making it suitable for filling the generator's state.
+ */
+static uint64_t
+splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9E3779B97F4A7C15u);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+	return z ^ (z >> 31);
+}
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+void
+rng_init(rng_t *rng, uint64_t seed, uint64_t stream)
+{
+	// Mix the stream number before combining it with the seed so that nearby
+	// seeds and streams do not give overlapping SplitMix64 sequences
+	uint64_t x = stream;
+	x = seed ^ splitmix64(&x);
+	
+	// SplitMix64 never produces four consecutive zeros
+	for (int i = 0; i < 4; i++)
+		rng->state[i] = splitmix64(&x);
+}
+
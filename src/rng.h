@@ -0,0 +1,93 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * rng.h -- A small, fast pseudo-random number generator (xoshiro256**) of
+ * which each random component of a simulation holds its own instance.
+ *
+ * Each generator is initialised from a seed and a stream number which
+ * identifies the component using it. Since no generator is shared, the numbers
+ * each component draws (and so the results of a simulation) do not depend on
+ * the order in which components are evaluated or on the number of threads.
+ * Generators are not thread-safe: each must be used by one thread at a time.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * A pseudo-random number generator.
+ */
+typedef struct rng rng_t;
+
+
+// Concrete definitions of the above types
+#include "rng_internal.h"
+
+
+/**
+ * Initialise a generator. Generators initialised with the same seed and stream
+ * produce the same sequence of numbers while those with different seeds or
+ * streams produce (for practical purposes) independent sequences.
+ */
+void rng_init(rng_t *rng, uint64_t seed, uint64_t stream);
+
+
+/**
+ * A uniformly distributed 64-bit number.
+ */
+static inline uint64_t
+rng_next(rng_t *rng)
+{
+	uint64_t *s = rng->state;
+	uint64_t result = RNG_ROTL(s[1] * 5u, 7) * 9u;
+	uint64_t t = s[1] << 17;
+	
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = RNG_ROTL(s[3], 45);
+	
+	return result;
+}
+
+
+/**
+ * A uniformly distributed double in the range [0.0, 1.0).
+ */
+static inline double
+rng_uniform(rng_t *rng)
+{
+	return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/**
+ * A uniformly distributed integer in the range [0, n) where n > 0. (The bias
+ * towards some values is at most n/2^32 and so is negligible for the small
+ * ranges used in the simulator.)
+ */
+static inline uint32_t
+rng_below(rng_t *rng, uint32_t n)
+{
+	return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+
+/**
+ * A fair coin flip.
+ */
+static inline bool
+rng_bool(rng_t *rng)
+{
+	return (rng_next(rng) >> 63) != 0u;
+}
+
+#endif
+
@@ -0,0 +1,17 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * rng_internal.h -- Concrete definitions of internal datastrucutres. This is
+ * provided to allow the creation of these types. Users should not access the
+ * fields directly. This file should only be included by rng.h
+ */
+
+struct rng {
+	// The xoshiro256** state (never all zero)
+	uint64_t state[4];
+};
+
+
+// Rotate a 64-bit value left by k bits (0 < k < 64)
+#define RNG_ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+
@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <sched.h>
 
 #include "config.h"
 
@@ -56,6 +57,390 @@ get_schedule(scheduler_t *s, ticks_t period)
 }
 
 
+/**
+ * Internal function.
+ *
+ * Greatest common divisor of two periods.
+ */
+static ticks_t
+gcd(ticks_t a, ticks_t b)
+{
+	while (b != 0) {
+		ticks_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+
+/**
+ * Internal function.
+ *
+ * The thread which will run a given event or -1 if it must be run serially.
+ * Partitions are divided between threads in contiguous blocks.
+ */
+static int
+get_event_thread(scheduler_t *s, event_t *event, int num_partitions)
+{
+	if (s->num_threads == 1 || event->partition == SCHEDULER_PARTITION_SERIAL)
+		return -1;
+	else
+		return (int)(((long long)event->partition * s->num_threads) / num_partitions);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Copy the non-NULL tick (or tock) callbacks of the events in a schedule run by
+ * the given thread (or -1 for serial events) into a newly allocated array,
+ * returning the number of callbacks copied.
+ */
+static int
+compile_calls( scheduler_t *s
+             , schedule_t *schedule
+             , bool tock
+             , int thread
+             , int num_partitions
+             , compiled_call_t **calls
+             )
+{
+	int num_calls = 0;
+	event_t *event;
+	
+	for (event = schedule->events; event != NULL; event = event->next_event)
+		if ((tock ? event->tock : event->tick) != NULL &&
+		    get_event_thread(s, event, num_partitions) == thread)
+			num_calls++;
+	
+	*calls = malloc(sizeof(compiled_call_t) * num_calls);
+	assert(num_calls == 0 || *calls != NULL);
+	
+	int i = 0;
+	for (event = schedule->events; event != NULL; event = event->next_event) {
+		if (get_event_thread(s, event, num_partitions) != thread)
+			continue;
+		
+		bool *awake = s->activity_tracking ? event->awake : NULL;
+		if (tock && event->tock != NULL)
+			(*calls)[i++] = (compiled_call_t){event->tock, event->tock_data, awake};
+		else if (!tock && event->tick != NULL)
+			(*calls)[i++] = (compiled_call_t){event->tick, event->tick_data, awake};
+	}
+	
+	return num_calls;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Move the awake flags of all events into a single array, grouped by the
+ * thread which runs them and then in the order they are run. This keeps the
+ * flags tested in each phase close together in memory.
+ */
+static void
+pack_awake_flags(scheduler_t *s, int num_partitions)
+{
+	int num_events = 0;
+	for (schedule_t *schedule = s->schedules; schedule != NULL; schedule = schedule->next_schedule)
+		for (event_t *event = schedule->events; event != NULL; event = event->next_event)
+			num_events++;
+	
+	s->awake_flags = malloc(sizeof(bool) * num_events);
+	assert(num_events == 0 || s->awake_flags != NULL);
+	
+	int i = 0;
+	for (int thread = -1; thread < s->num_threads; thread++) {
+		for (schedule_t *schedule = s->schedules; schedule != NULL; schedule = schedule->next_schedule) {
+			for (event_t *event = schedule->events; event != NULL; event = event->next_event) {
+				if (get_event_thread(s, event, num_partitions) != thread)
+					continue;
+				
+				s->awake_flags[i] = *(event->awake);
+				event->awake = &(s->awake_flags[i++]);
+			}
+		}
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Add a timer to a timing wheel.
+ */
+static void
+add_timer(scheduler_wheel_t *wheel, scheduler_timer_t timer)
+{
+	int slot = timer.time & (SCHEDULER_WHEEL_SLOTS - 1);
+	
+	if (wheel->slots[slot].num_timers == wheel->slots[slot].max_timers) {
+		wheel->slots[slot].max_timers = (wheel->slots[slot].max_timers * 2) + 1;
+		wheel->slots[slot].timers = realloc( wheel->slots[slot].timers
+		                                   , sizeof(scheduler_timer_t) * wheel->slots[slot].max_timers
+		                                   );
+		assert(wheel->slots[slot].timers != NULL);
+	}
+	
+	wheel->slots[slot].timers[wheel->slots[slot].num_timers++] = timer;
+	wheel->num_timers++;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Wake the events whose timers in the given wheel are due now.
+ */
+static void
+run_timers(scheduler_t *s, scheduler_wheel_t *wheel)
+{
+	if (wheel->num_timers == 0)
+		return;
+	
+	int slot = s->ticks & (SCHEDULER_WHEEL_SLOTS - 1);
+	scheduler_timer_t *timers = wheel->slots[slot].timers;
+	
+	// Wake the due events, keeping the timers due in later revolutions
+	int num_kept = 0;
+	for (int i = 0; i < wheel->slots[slot].num_timers; i++) {
+		if (timers[i].time == s->ticks) {
+			scheduler_wake(timers[i].event);
+			wheel->num_timers--;
+		} else {
+			timers[num_kept++] = timers[i];
+		}
+	}
+	wheel->slots[slot].num_timers = num_kept;
+}
+
+
+/**
+ * Internal function.
+ *
+ * The time of the earliest timer in the given wheel (or SCHEDULER_NEVER).
+ */
+static ticks_t
+get_next_timer(scheduler_t *s, scheduler_wheel_t *wheel)
+{
+	if (wheel->num_timers == 0)
+		return SCHEDULER_NEVER;
+	
+	// Look for the first due timer during the next revolution of the wheel
+	for (ticks_t time = s->ticks; time != s->ticks + SCHEDULER_WHEEL_SLOTS; time++) {
+		int slot = time & (SCHEDULER_WHEEL_SLOTS - 1);
+		for (int i = 0; i < wheel->slots[slot].num_timers; i++)
+			if (wheel->slots[slot].timers[i].time == time)
+				return time;
+	}
+	
+	// All timers are further away, search them all
+	ticks_t next = SCHEDULER_NEVER;
+	for (int slot = 0; slot < SCHEDULER_WHEEL_SLOTS; slot++)
+		for (int i = 0; i < wheel->slots[slot].num_timers; i++)
+			if (wheel->slots[slot].timers[i].time < next)
+				next = wheel->slots[slot].timers[i].time;
+	return next;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Free the timers in a wheel.
+ */
+static void
+destroy_wheel(scheduler_wheel_t *wheel)
+{
+	for (int slot = 0; slot < SCHEDULER_WHEEL_SLOTS; slot++)
+		free(wheel->slots[slot].timers);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Give the serial events and each thread their own context (so that threads do
+ * not contend for a single busy count or timing wheel). The busy events are
+ * recounted and any timers moved to the wheel of the thread running their
+ * event.
+ */
+static void
+split_contexts(scheduler_t *s, int num_partitions)
+{
+	scheduler_context_t *old_context = s->contexts;
+	
+	s->num_contexts = 1 + ((s->num_threads > 1) ? s->num_threads : 0);
+	s->contexts = calloc(s->num_contexts, sizeof(scheduler_context_t));
+	assert(s->contexts != NULL);
+	
+	for (schedule_t *schedule = s->schedules; schedule != NULL; schedule = schedule->next_schedule) {
+		for (event_t *event = schedule->events; event != NULL; event = event->next_event) {
+			// Serial events use context 0, threads use the contexts which follow
+			int thread = get_event_thread(s, event, num_partitions);
+			event->wheel = &(s->contexts[thread + 1].wheel);
+			
+			if (event->next_activity != NULL)
+				continue;
+			event->busy_count = &(s->contexts[thread + 1].busy_count);
+			if (*(event->awake))
+				(*(event->busy_count))++;
+		}
+	}
+	
+	for (int slot = 0; slot < SCHEDULER_WHEEL_SLOTS; slot++)
+		for (int i = 0; i < old_context->wheel.slots[slot].num_timers; i++)
+			add_timer( old_context->wheel.slots[slot].timers[i].event->wheel
+			         , old_context->wheel.slots[slot].timers[i]
+			         );
+	
+	destroy_wheel(&(old_context->wheel));
+	free(old_context);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Run the tick or tock callbacks of each of the given compiled schedules. If
+ * thread is -1 the serial callbacks are run, otherwise those for the given
+ * thread. Callbacks of sleeping events are skipped.
+ */
+static void
+run_compiled(compiled_schedule_t **schedules, int num_schedules, bool tock, int thread)
+{
+	for (int i = 0; i < num_schedules; i++) {
+		compiled_calls_t *compiled_calls = (thread < 0) ? &(schedules[i]->serial)
+		                                                : &(schedules[i]->parallel[thread]);
+		compiled_call_t *calls = tock ? compiled_calls->tocks : compiled_calls->ticks;
+		int          num_calls = tock ? compiled_calls->num_tocks : compiled_calls->num_ticks;
+		
+		for (int j = 0; j < num_calls; j++)
+			if (calls[j].awake == NULL || __atomic_load_n(calls[j].awake, __ATOMIC_RELAXED))
+				calls[j].fn(calls[j].data);
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Wait until all threads of the schedule have reached the barrier. This is a
+ * sense-reversing spin barrier since phases are typically too short to make it
+ * worth sleeping.
+ */
+static void
+barrier_wait(scheduler_barrier_t *barrier, scheduler_thread_t *thread)
+{
+	int sense = !thread->barrier_sense;
+	thread->barrier_sense = sense;
+	
+	if (__atomic_add_fetch(&(barrier->count), 1, __ATOMIC_ACQ_REL) == barrier->num_threads) {
+		// Last to arrive, release the others
+		__atomic_store_n(&(barrier->count), 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&(barrier->sense), sense, __ATOMIC_RELEASE);
+	} else {
+		int spins = 0;
+		while (__atomic_load_n(&(barrier->sense), __ATOMIC_ACQUIRE) != sense) {
+			// Don't starve other threads if the machine is oversubscribed
+			if (++spins >= SCHEDULER_BARRIER_SPINS) {
+				sched_yield();
+				spins = 0;
+			}
+		}
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * The main loop of the threads (other than thread zero) running a compiled
+ * schedule. Each iteration runs the thread's share of a single tick.
+ */
+static void *
+thread_main(void *thread_)
+{
+	scheduler_thread_t *thread = (scheduler_thread_t *)thread_;
+	scheduler_t *s = thread->scheduler;
+	
+	while (true) {
+		// Wait for the tick to start
+		barrier_wait(&(s->barrier), thread);
+		if (s->stop_threads)
+			break;
+		
+		run_timers(s, &(s->contexts[thread->thread_num + 1].wheel));
+		run_compiled(s->cur_firing, s->num_cur_firing, false, thread->thread_num);
+		barrier_wait(&(s->barrier), thread);
+		
+		run_compiled(s->cur_firing, s->num_cur_firing, true, thread->thread_num);
+		barrier_wait(&(s->barrier), thread);
+	}
+	
+	return NULL;
+}
+
+
+/**
+ * Internal function.
+ *
+ * A version of scheduler_tick_tock for compiled schedules.
+ */
+static void
+compiled_tick_tock(scheduler_t *s)
+{
+	// Work out which schedules are to be run
+	if (s->hyperperiod != 0) {
+		// Look up the schedules to run at this point in the hyperperiod
+		s->cur_firing     = s->firing + s->firing_start[s->phase];
+		s->num_cur_firing = s->firing_start[s->phase + 1] - s->firing_start[s->phase];
+		
+		if (++(s->phase) == s->hyperperiod)
+			s->phase = 0;
+	} else {
+		// The hyperperiod was too long to tabulate, work out which schedules to
+		// run the hard way.
+		s->cur_firing     = s->fallback_firing;
+		s->num_cur_firing = 0;
+		for (int i = 0; i < s->num_compiled_schedules; i++)
+			if (s->ticks % s->compiled_schedules[i].period == 0)
+				s->cur_firing[s->num_cur_firing++] = &(s->compiled_schedules[i]);
+	}
+	
+	if (s->num_threads == 1) {
+		run_timers(s, &(s->contexts[0].wheel));
+		run_compiled(s->cur_firing, s->num_cur_firing, false, -1);
+		run_compiled(s->cur_firing, s->num_cur_firing, true, -1);
+	} else {
+		scheduler_thread_t *thread = &(s->threads[0]);
+		
+		// Start the other threads
+		barrier_wait(&(s->barrier), thread);
+		
+		run_timers(s, &(s->contexts[0].wheel));
+		run_timers(s, &(s->contexts[1].wheel));
+		
+		// Serial ticks may run alongside the parallel ones since ticks do not
+		// modify any shared state.
+		run_compiled(s->cur_firing, s->num_cur_firing, false, -1);
+		run_compiled(s->cur_firing, s->num_cur_firing, false, 0);
+		barrier_wait(&(s->barrier), thread);
+		
+		run_compiled(s->cur_firing, s->num_cur_firing, true, 0);
+		barrier_wait(&(s->barrier), thread);
+		
+		// Serial tocks are run once all other threads have finished
+		run_compiled(s->cur_firing, s->num_cur_firing, true, -1);
+	}
+	
+	// Advance time
+	s->ticks ++;
+}
+
+
 /******************************************************************************
  * Publicly accessible functions.
  ******************************************************************************/
@@ -67,12 +452,47 @@ scheduler_init(scheduler_t *s)
 	// Initialise the structure
 	s->ticks     = 0;
 	s->schedules = NULL;
+	
+	s->compiled               = false;
+	s->compiled_schedules     = NULL;
+	s->num_compiled_schedules = 0;
+	s->hyperperiod            = 0;
+	s->phase                  = 0;
+	s->firing                 = NULL;
+	s->firing_start           = NULL;
+	s->cur_firing             = NULL;
+	s->num_cur_firing         = 0;
+	s->fallback_firing        = NULL;
+	
+	s->partition    = SCHEDULER_PARTITION_SERIAL;
+	s->num_threads  = 1;
+	s->threads      = NULL;
+	s->stop_threads = false;
+	
+	s->activity_tracking = false;
+	s->awake_flags       = NULL;
+	
+	s->contexts = calloc(1, sizeof(scheduler_context_t));
+	assert(s->contexts != NULL);
+	s->num_contexts = 1;
+	
+	s->next_activity_events     = NULL;
+	s->num_next_activity_events = 0;
 }
 
 
 void
 scheduler_destroy(scheduler_t *s)
 {
+	// Stop any threads
+	if (s->threads != NULL) {
+		s->stop_threads = true;
+		barrier_wait(&(s->barrier), &(s->threads[0]));
+		for (int i = 1; i < s->num_threads; i++)
+			pthread_join(s->threads[i].thread, NULL);
+		free(s->threads);
+	}
+	
 	// Free the schedule/event structures within.
 	schedule_t *schedule = s->schedules;
 	schedule_t *next_schedule;
@@ -89,10 +509,33 @@ scheduler_destroy(scheduler_t *s)
 		free(schedule);
 		schedule = next_schedule;
 	}
+	
+	// Free the compiled schedule (if any)
+	for (int i = 0; i < s->num_compiled_schedules; i++) {
+		compiled_schedule_t *compiled = &(s->compiled_schedules[i]);
+		free(compiled->serial.ticks);
+		free(compiled->serial.tocks);
+		if (compiled->parallel != NULL) {
+			for (int j = 0; j < s->num_threads; j++) {
+				free(compiled->parallel[j].ticks);
+				free(compiled->parallel[j].tocks);
+			}
+			free(compiled->parallel);
+		}
+	}
+	free(s->compiled_schedules);
+	free(s->firing);
+	free(s->firing_start);
+	free(s->fallback_firing);
+	free(s->awake_flags);
+	for (int i = 0; i < s->num_contexts; i++)
+		destroy_wheel(&(s->contexts[i].wheel));
+	free(s->contexts);
+	free(s->next_activity_events);
 }
 
 
-void
+scheduler_event_t *
 scheduler_schedule( scheduler_t *s
                   , ticks_t period
                   , void (*tick)(void *)
@@ -102,6 +545,7 @@ scheduler_schedule( scheduler_t *s
                   )
 {
 	assert(period > 0);
+	assert(!s->compiled);
 	
 	// Get the schedule for this period
 	schedule_t *schedule = get_schedule(s, period);
@@ -114,9 +558,262 @@ scheduler_schedule( scheduler_t *s
 	new_event->tick_data  = tick_data;
 	new_event->tock       = tock;
 	new_event->tock_data  = tock_data;
+	new_event->partition  = s->partition;
+	new_event->awake_flag = true;
+	new_event->awake      = &(new_event->awake_flag);
 	new_event->next_event = schedule->events;
 	
+	// Events are busy until told otherwise
+	new_event->next_activity      = NULL;
+	new_event->next_activity_data = NULL;
+	new_event->busy_count         = &(s->contexts[0].busy_count);
+	s->contexts[0].busy_count++;
+	
+	new_event->wheel = &(s->contexts[0].wheel);
+	
 	schedule->events = new_event;
+	
+	return new_event;
+}
+
+
+void
+scheduler_set_partition(scheduler_t *s, int partition)
+{
+	assert(partition >= 0 || partition == SCHEDULER_PARTITION_SERIAL);
+	s->partition = partition;
+}
+
+
+void
+scheduler_set_num_threads(scheduler_t *s, int num_threads)
+{
+	assert(num_threads >= 1);
+	assert(!s->compiled);
+	s->num_threads = num_threads;
+}
+
+
+int
+scheduler_get_num_threads(scheduler_t *s)
+{
+	return s->num_threads;
+}
+
+
+void
+scheduler_set_activity_tracking(scheduler_t *s, bool activity_tracking)
+{
+	assert(!s->compiled);
+	s->activity_tracking = activity_tracking;
+}
+
+
+void
+scheduler_compile(scheduler_t *s)
+{
+	assert(!s->compiled);
+	
+	// Count the schedules and partitions
+	int num_partitions = 0;
+	s->num_compiled_schedules = 0;
+	for (schedule_t *schedule = s->schedules; schedule != NULL; schedule = schedule->next_schedule) {
+		s->num_compiled_schedules++;
+		for (event_t *event = schedule->events; event != NULL; event = event->next_event)
+			if (event->partition >= num_partitions)
+				num_partitions = event->partition + 1;
+	}
+	
+	if (s->activity_tracking)
+		pack_awake_flags(s, num_partitions);
+	split_contexts(s, num_partitions);
+	
+	// Flatten each schedule, keeping the original order
+	s->compiled_schedules = malloc(sizeof(compiled_schedule_t) * s->num_compiled_schedules);
+	assert(s->num_compiled_schedules == 0 || s->compiled_schedules != NULL);
+	
+	int i = 0;
+	s->hyperperiod = 1;
+	for (schedule_t *schedule = s->schedules; schedule != NULL; schedule = schedule->next_schedule) {
+		compiled_schedule_t *compiled = &(s->compiled_schedules[i++]);
+		compiled->period = schedule->period;
+		compiled->serial.num_ticks = compile_calls( s, schedule, false, -1, num_partitions
+		                                          , &(compiled->serial.ticks));
+		compiled->serial.num_tocks = compile_calls( s, schedule, true, -1, num_partitions
+		                                          , &(compiled->serial.tocks));
+		
+		compiled->parallel = NULL;
+		if (s->num_threads > 1) {
+			compiled->parallel = malloc(sizeof(compiled_calls_t) * s->num_threads);
+			assert(compiled->parallel != NULL);
+			for (int thread = 0; thread < s->num_threads; thread++) {
+				compiled_calls_t *calls = &(compiled->parallel[thread]);
+				calls->num_ticks = compile_calls( s, schedule, false, thread, num_partitions
+				                                , &(calls->ticks));
+				calls->num_tocks = compile_calls( s, schedule, true, thread, num_partitions
+				                                , &(calls->tocks));
+			}
+		}
+		
+		// Accumulate the LCM of the periods, giving up once it gets too large.
+		if (s->hyperperiod != 0) {
+			unsigned long long lcm = ((unsigned long long)s->hyperperiod / gcd(s->hyperperiod, schedule->period))
+			                         * schedule->period;
+			s->hyperperiod = (lcm <= SCHEDULER_MAX_HYPERPERIOD) ? lcm : 0;
+		}
+	}
+	
+	// Tabulate the schedules which fire in each phase of the hyperperiod
+	if (s->hyperperiod != 0) {
+		s->phase = s->ticks % s->hyperperiod;
+		
+		int num_firing = 0;
+		for (i = 0; i < s->num_compiled_schedules; i++)
+			num_firing += s->hyperperiod / s->compiled_schedules[i].period;
+		
+		s->firing       = malloc(sizeof(compiled_schedule_t *) * num_firing);
+		s->firing_start = malloc(sizeof(int) * (s->hyperperiod + 1));
+		assert(num_firing == 0 || s->firing != NULL);
+		assert(s->firing_start != NULL);
+		
+		int n = 0;
+		for (ticks_t phase = 0; phase < s->hyperperiod; phase++) {
+			s->firing_start[phase] = n;
+			for (i = 0; i < s->num_compiled_schedules; i++)
+				if (phase % s->compiled_schedules[i].period == 0)
+					s->firing[n++] = &(s->compiled_schedules[i]);
+		}
+		s->firing_start[s->hyperperiod] = n;
+	} else {
+		s->fallback_firing = malloc(sizeof(compiled_schedule_t *) * s->num_compiled_schedules);
+		assert(s->fallback_firing != NULL);
+	}
+	
+	s->compiled = true;
+	
+	// Start the threads (thread zero is the caller of scheduler_tick_tock)
+	if (s->num_threads > 1) {
+		s->barrier.num_threads = s->num_threads;
+		s->barrier.count       = 0;
+		s->barrier.sense       = 0;
+		
+		s->threads = malloc(sizeof(scheduler_thread_t) * s->num_threads);
+		assert(s->threads != NULL);
+		for (int thread = 0; thread < s->num_threads; thread++) {
+			s->threads[thread].scheduler     = s;
+			s->threads[thread].thread_num    = thread;
+			s->threads[thread].barrier_sense = 0;
+			if (thread > 0) {
+				int error = pthread_create( &(s->threads[thread].thread), NULL
+				                          , thread_main, &(s->threads[thread])
+				                          );
+				assert(error == 0);
+			}
+		}
+	}
+}
+
+
+void
+scheduler_sleep(scheduler_event_t *event)
+{
+	// Only the event itself may put itself to sleep so there is no need to guard
+	// against concurrent calls.
+	if (__atomic_load_n(event->awake, __ATOMIC_RELAXED)) {
+		__atomic_store_n(event->awake, false, __ATOMIC_RELAXED);
+		if (event->busy_count != NULL)
+			__atomic_sub_fetch(event->busy_count, 1, __ATOMIC_RELAXED);
+	}
+}
+
+
+void
+scheduler_wake(scheduler_event_t *event)
+{
+	// Avoid writing (and so stealing the cache line of) flags of events which
+	// are already awake as this is the common case. Several threads may wake an
+	// event at once but only the first to do so counts it as busy.
+	if (!__atomic_load_n(event->awake, __ATOMIC_RELAXED) &&
+	    !__atomic_exchange_n(event->awake, true, __ATOMIC_RELAXED) &&
+	    event->busy_count != NULL)
+		__atomic_add_fetch(event->busy_count, 1, __ATOMIC_RELAXED);
+}
+
+
+void
+scheduler_sleep_until(scheduler_t *s, scheduler_event_t *event, ticks_t time)
+{
+	assert(time > s->ticks);
+	
+	scheduler_sleep(event);
+	add_timer(event->wheel, (scheduler_timer_t){time, event});
+}
+
+
+void
+scheduler_set_next_activity( scheduler_t *s
+                           , scheduler_event_t *event
+                           , ticks_t (*next_activity)(void *)
+                           , void *next_activity_data
+                           )
+{
+	assert(!s->compiled);
+	assert(event->next_activity == NULL);
+	
+	event->next_activity      = next_activity;
+	event->next_activity_data = next_activity_data;
+	
+	// The event is no longer counted as busy
+	if (*(event->awake))
+		(*(event->busy_count))--;
+	event->busy_count = NULL;
+	
+	s->next_activity_events = realloc( s->next_activity_events
+	                                 , sizeof(event_t *) * (s->num_next_activity_events + 1)
+	                                 );
+	assert(s->next_activity_events != NULL);
+	s->next_activity_events[s->num_next_activity_events++] = event;
+}
+
+
+ticks_t
+scheduler_fast_forward(scheduler_t *s, ticks_t limit)
+{
+	// Nothing can be skipped while any event is busy
+	for (int i = 0; i < s->num_contexts; i++)
+		if (__atomic_load_n(&(s->contexts[i].busy_count), __ATOMIC_RELAXED) != 0)
+			return 0;
+	
+	// Sleeping events may be woken by timers
+	ticks_t next = limit;
+	for (int i = 0; i < s->num_contexts; i++) {
+		ticks_t timer_next = get_next_timer(s, &(s->contexts[i].wheel));
+		if (timer_next < next)
+			next = timer_next;
+	}
+	
+	// Find the earliest activity of any awake event
+	for (int i = 0; i < s->num_next_activity_events; i++) {
+		event_t *event = s->next_activity_events[i];
+		if (!*(event->awake))
+			continue;
+		
+		ticks_t event_next = event->next_activity(event->next_activity_data);
+		if (event_next <= s->ticks)
+			return 0;
+		else if (event_next < next)
+			next = event_next;
+	}
+	
+	if (next <= s->ticks)
+		return 0;
+	
+	ticks_t skipped = next - s->ticks;
+	s->ticks = next;
+	if (s->compiled && s->hyperperiod != 0)
+		s->phase = s->ticks % s->hyperperiod;
+	
+	return skipped;
 }
 
 
@@ -133,6 +830,13 @@ scheduler_tick_tock(scheduler_t *s)
 	schedule_t *next_schedule;
 	event_t    *next_event;
 	
+	if (s->compiled) {
+		compiled_tick_tock(s);
+		return;
+	}
+	
+	run_timers(s, &(s->contexts[0].wheel));
+	
 	// Tick
 	next_schedule = s->schedules;
 	while (next_schedule != NULL) {
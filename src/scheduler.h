@@ -10,26 +10,86 @@
  * It is suggested that tick/tock pairs correspond to read and write phases of a
  * periodic process to ensure deterministic behaviour no-matter what order the
  * scheduler calls the events.
+ *
+ * Once all events have been scheduled, the schedule may optionally be
+ * "compiled" which freezes it into flat tables which are faster to execute.
+ *
+ * A compiled schedule may also be executed by several threads. Events are
+ * placed into numbered partitions and each partition is assigned to a thread.
+ * Within a phase, the events of each thread are run in parallel and all threads
+ * wait for each other before the next phase starts. Events in the special
+ * "serial" partition are always run by the calling thread in the order they
+ * would be run by a single-threaded schedule, after (for tocks) or alongside
+ * (for ticks) the parallel events. For results to be unaffected by the number
+ * of threads, events in different partitions must only communicate via state
+ * read in the tick phase and written in the tock phase, such as the two ends of
+ * a buffer. Anything else shared (e.g. the C library's random number generator)
+ * should only be used by events in the serial partition.
+ *
+ * A compiled schedule may also track which events are "awake". An event's tick
+ * function may put the event to sleep when it has nothing to do after which
+ * neither its tick nor tock will be called until something (typically a buffer
+ * being pushed into) wakes it. An event should only sleep if its tock (and
+ * future ticks) would do nothing until it is woken, in which case the
+ * simulation is unaffected. Uncompiled schedules ignore sleeping events.
+ * Events may also sleep until a given time, using a timing wheel to wake them.
+ *
+ * Events which remain awake but only act at known times (e.g. a periodic
+ * packet generator) may instead report the time of their next activity. When
+ * every event is either asleep or not due to act until some future time, the
+ * simulation time may be advanced straight to that time using
+ * scheduler_fast_forward() without changing the outcome of the simulation.
  */
 
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include <stdbool.h>
+#include <pthread.h>
+
 #include "config.h"
 
 
+/**
+ * The largest hyperperiod (the lowest common multiple of all periods in a
+ * schedule) for which a compiled schedule will precompute which periods fire
+ * on every tick. Schedules with longer hyperperiods are still compiled but
+ * fall back to testing each period on every tick.
+ */
+#define SCHEDULER_MAX_HYPERPERIOD 4096
+
+
+/**
+ * The partition of events which must be run by the thread calling
+ * scheduler_tick_tock() in their original order.
+ */
+#define SCHEDULER_PARTITION_SERIAL (-1)
+
+
 /**
  * The type of a time in ticks as used in the simulator.
  */
 typedef unsigned int ticks_t;
 
 
+/**
+ * A time which never arrives, for use as a next activity time.
+ */
+#define SCHEDULER_NEVER ((ticks_t)-1)
+
+
 /**
  * A structure which defines a particular instance of a scheduler.
  */
 typedef struct scheduler scheduler_t;
 
 
+/**
+ * A handle for an event added to a scheduler.
+ */
+typedef struct event scheduler_event_t;
+
+
 // Concrete definitions of the above types
 #include "scheduler_internal.h"
 
@@ -59,8 +119,10 @@ void scheduler_destroy(scheduler_t *scheduler);
  * @param tock A function to be called with tock_data at the specified period.
  *             May be NULL to disable.
  * @param tock_data A void pointer to pass to tock. May be NULL.
+ * @return A handle for the event which may be used to put it to sleep and wake
+ *         it.
  */
-void scheduler_schedule( scheduler_t *scheduler
+scheduler_event_t *scheduler_schedule( scheduler_t *scheduler
                        , ticks_t period
                        , void (*tick)(void *)
                        , void *tick_data
@@ -68,6 +130,97 @@ void scheduler_schedule( scheduler_t *scheduler
                        , void *tock_data
                        );
 
+/**
+ * Set the partition into which subsequently scheduled events are placed.
+ * Partitions are numbered from zero and events in the same partition are
+ * always run by the same thread. Events are placed in the
+ * SCHEDULER_PARTITION_SERIAL partition until this is called.
+ */
+void scheduler_set_partition(scheduler_t *scheduler, int partition);
+
+/**
+ * Set the number of threads which will execute the schedule once it has been
+ * compiled. Partitions are divided between threads in contiguous blocks. Must
+ * be called before scheduler_compile(). Defaults to one.
+ */
+void scheduler_set_num_threads(scheduler_t *scheduler, int num_threads);
+
+/**
+ * Get the number of threads which will execute the schedule.
+ */
+int scheduler_get_num_threads(scheduler_t *scheduler);
+
+/**
+ * Enable or disable skipping sleeping events when the schedule is compiled.
+ * Must be called before scheduler_compile(). Defaults to disabled.
+ */
+void scheduler_set_activity_tracking(scheduler_t *scheduler, bool activity_tracking);
+
+/**
+ * Freeze the schedule into a set of flat arrays of functions, one per period,
+ * along with a table of which periods fire on each tick of the hyperperiod.
+ * This removes the pointer chasing and modulo operations from
+ * scheduler_tick_tock() while calling the functions in exactly the same order.
+ *
+ * If more than one thread has been requested, the threads are started here and
+ * are stopped by scheduler_destroy().
+ *
+ * No further events may be scheduled once the schedule has been compiled.
+ */
+void scheduler_compile(scheduler_t *scheduler);
+
+/**
+ * Put an event to sleep. Should only be called by the event's own tick
+ * function. Events start awake.
+ */
+void scheduler_sleep(scheduler_event_t *event);
+
+/**
+ * Wake an event such that it will be called from the next time it is due. May
+ * be called from any tock function.
+ */
+void scheduler_wake(scheduler_event_t *event);
+
+/**
+ * Put an event to sleep until the given (future) time at which it will be woken
+ * as if by scheduler_wake(). Should only be called by the event's own tick
+ * function. The event may still be woken earlier by scheduler_wake(), in which
+ * case it will be woken again at the given time.
+ */
+void scheduler_sleep_until( scheduler_t *scheduler
+                          , scheduler_event_t *event
+                          , ticks_t time
+                          );
+
+/**
+ * Set a function which reports the earliest time at which an event may next do
+ * anything, assuming it is not woken. Until (but not including) this time, the
+ * event's tick and tock must do nothing. Times in the past (or now) indicate
+ * that the event is busy. SCHEDULER_NEVER indicates that the event does nothing
+ * until woken.
+ *
+ * Awake events without such a function are always considered busy.
+ *
+ * @param scheduler A pointer to the scheduler datastructure.
+ * @param event The event to set the function for.
+ * @param next_activity The function, called with next_activity_data.
+ * @param next_activity_data A void pointer to pass to next_activity.
+ */
+void scheduler_set_next_activity( scheduler_t *scheduler
+                                , scheduler_event_t *event
+                                , ticks_t (*next_activity)(void *)
+                                , void *next_activity_data
+                                );
+
+/**
+ * If no event is busy, advance the simulation time to the earliest time any
+ * event may next do anything (but not beyond the given limit). Must not be
+ * called while the schedule is running (e.g. from a tick or tock function).
+ *
+ * @return The number of ticks skipped (zero if any event is busy).
+ */
+ticks_t scheduler_fast_forward(scheduler_t *scheduler, ticks_t limit);
+
 /**
  * Get the current simulation time.
  */
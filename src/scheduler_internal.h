@@ -6,6 +6,12 @@
  * fields directly. This file should only be included by scheduler.h
  */
 
+/**
+ * The number of slots in a timing wheel. Must be a power of two.
+ */
+#define SCHEDULER_WHEEL_SLOTS 256
+
+
 /**
  * Internal datastructure.
  *
@@ -26,6 +32,27 @@ typedef struct event {
 	void (*tock)(void *data);
 	void *tock_data;
 	
+	/* The partition the event belongs to (see scheduler_set_partition) */
+	int partition;
+	
+	/* Is the event awake? Points at awake_flag until the schedule is compiled
+	 * with activity tracking enabled after which it points into the scheduler's
+	 * packed array of flags. */
+	bool *awake;
+	bool  awake_flag;
+	
+	/* Reports the earliest time the event may next do anything (or NULL if not
+	 * known). */
+	ticks_t (*next_activity)(void *data);
+	void *next_activity_data;
+	
+	/* The count of busy events to which this event contributes while awake or
+	 * NULL if it has a next_activity function. */
+	int *busy_count;
+	
+	/* The timing wheel used to wake the event (see scheduler_sleep_until). */
+	struct scheduler_wheel *wheel;
+	
 	struct event *next_event;
 } event_t;
 
@@ -43,6 +70,144 @@ typedef struct schedule {
 } schedule_t;
 
 
+/**
+ * Internal datastructure.
+ *
+ * A function/argument pair to be called by a compiled schedule.
+ */
+typedef struct compiled_call {
+	void (*fn)(void *data);
+	void *data;
+	
+	/* The event's awake flag or NULL if activity is not being tracked. */
+	bool *awake;
+} compiled_call_t;
+
+
+/**
+ * Internal datastructure.
+ *
+ * Arrays of tick and tock callbacks to be called in order by a compiled
+ * schedule with NULL functions omitted.
+ */
+typedef struct compiled_calls {
+	compiled_call_t *ticks;
+	int              num_ticks;
+	
+	compiled_call_t *tocks;
+	int              num_tocks;
+} compiled_calls_t;
+
+
+/**
+ * Internal datastructure.
+ *
+ * A frozen copy of a schedule_t produced by scheduler_compile(). The callbacks
+ * of events which must run on the main thread are kept (in the same order as
+ * the linked list) in serial. When multiple threads are in use, the callbacks
+ * of events in all other partitions are split between the threads in parallel.
+ */
+typedef struct compiled_schedule {
+	ticks_t period;
+	
+	compiled_calls_t  serial;
+	compiled_calls_t *parallel;
+} compiled_schedule_t;
+
+
+/**
+ * The size of a cache line in bytes.
+ */
+#define SCHEDULER_CACHE_LINE_BYTES 64
+
+
+/**
+ * Internal datastructure.
+ *
+ * A request to wake an event at a given time.
+ */
+typedef struct scheduler_timer {
+	ticks_t  time;
+	event_t *event;
+} scheduler_timer_t;
+
+
+/**
+ * Internal datastructure.
+ *
+ * A timing wheel of timers. Timers are placed in the slot given by their time
+ * modulo the number of slots and each slot is an array of timers which grows
+ * as required. Timers more than one revolution of the wheel into the future
+ * simply remain in their slot until they are due.
+ */
+typedef struct scheduler_wheel {
+	struct {
+		scheduler_timer_t *timers;
+		int                num_timers;
+		int                max_timers;
+	} slots[SCHEDULER_WHEEL_SLOTS];
+	
+	/* The total number of timers in all slots */
+	int num_timers;
+} scheduler_wheel_t;
+
+
+/**
+ * Internal datastructure.
+ *
+ * State belonging either to the serial events or to the events of a single
+ * thread.
+ */
+typedef struct scheduler_context {
+	/* The number of awake events without a next_activity function (which are
+	 * therefore busy). */
+	int busy_count;
+	
+	/* The busy count may be changed by any thread, the wheel is only used by its
+	 * own thread. Keep them in separate cache lines. */
+	char padding[SCHEDULER_CACHE_LINE_BYTES - sizeof(int)];
+	
+	/* Timers for the events (see scheduler_sleep_until) */
+	scheduler_wheel_t wheel;
+} scheduler_context_t;
+
+
+/**
+ * The number of times a thread spins waiting at a barrier before yielding the
+ * CPU.
+ */
+#define SCHEDULER_BARRIER_SPINS 10000
+
+
+/**
+ * Internal datastructure.
+ *
+ * A barrier used to synchronise the threads of a multi-threaded schedule
+ * between each phase.
+ */
+typedef struct scheduler_barrier {
+	int num_threads;
+	int count;
+	int sense;
+} scheduler_barrier_t;
+
+
+/**
+ * Internal datastructure.
+ *
+ * A thread executing a multi-threaded schedule. Thread zero is the thread
+ * which calls scheduler_tick_tock().
+ */
+typedef struct scheduler_thread {
+	struct scheduler *scheduler;
+	int               thread_num;
+	pthread_t         thread;
+	
+	/* The barrier sense last waited for by this thread */
+	int barrier_sense;
+} scheduler_thread_t;
+
+
 /**
  * The "main" data-structure of a scheduler.
  */
@@ -52,5 +217,59 @@ struct scheduler {
 	
 	/* The current simulation time */
 	ticks_t ticks;
+	
+	/* The partition newly scheduled events are placed in. */
+	int partition;
+	
+	/* Has the schedule been compiled (see scheduler_compile)? */
+	bool compiled;
+	
+	/* An array of the compiled schedules (in the same order as schedules). */
+	compiled_schedule_t *compiled_schedules;
+	int                  num_compiled_schedules;
+	
+	/* The lowest common multiple of all periods in the schedule or zero if this
+	 * exceeds SCHEDULER_MAX_HYPERPERIOD in which case the firing table is not
+	 * used. */
+	ticks_t hyperperiod;
+	
+	/* The current time modulo the hyperperiod. */
+	ticks_t phase;
+	
+	/* The compiled schedules which fire at each phase of the hyperperiod. The
+	 * schedules for phase p are firing[firing_start[p]] up to (but not
+	 * including) firing[firing_start[p+1]]. */
+	compiled_schedule_t **firing;
+	int                  *firing_start;
+	
+	/* The compiled schedules firing in the current tick. When the firing table
+	 * is not in use, these are listed in fallback_firing. */
+	compiled_schedule_t **cur_firing;
+	int                   num_cur_firing;
+	compiled_schedule_t **fallback_firing;
+	
+	/* The threads which execute a compiled schedule. */
+	int                 num_threads;
+	scheduler_thread_t *threads;
+	scheduler_barrier_t barrier;
+	
+	/* Set to signal the threads to exit. */
+	bool stop_threads;
+	
+	/* Should sleeping events be skipped by the compiled schedule? */
+	bool activity_tracking;
+	
+	/* The awake flags of all events, packed together in the order they are run
+	 * by the compiled schedule when activity tracking is enabled. */
+	bool *awake_flags;
+	
+	/* Counts of busy events and timing wheels. Until the schedule is compiled a
+	 * single context is used. Afterwards there is one context for the serial
+	 * events followed by one for each thread (when there is more than one). */
+	scheduler_context_t *contexts;
+	int                  num_contexts;
+	
+	/* The events which have a next_activity function. */
+	event_t **next_activity_events;
+	int       num_next_activity_events;
 };
-
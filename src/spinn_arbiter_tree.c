@@ -0,0 +1,175 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_arbiter_tree.c -- The tree of arbiters which merges the inputs of a
+ * SpiNNaker node into the router's single input.
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+#include "scheduler.h"
+#include "buffer.h"
+#include "arbiter.h"
+
+#include "spinn.h"
+#include "spinn_arbiter_tree.h"
+
+
+/******************************************************************************
+ * Private functions.
+ ******************************************************************************/
+
+/**
+ * Internal function.
+ *
+ * Greatest common divisor.
+ */
+static ticks_t
+gcd(ticks_t a, ticks_t b)
+{
+	while (b != 0) {
+		ticks_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Arbiter tree "tick" callback. Runs the tick of every arbiter due at this
+ * time.
+ */
+void
+spinn_arbiter_tree_tick(void *t_)
+{
+	spinn_arbiter_tree_t *t = (spinn_arbiter_tree_t *)t_;
+	
+	ticks_t now = scheduler_get_ticks(t->scheduler);
+	
+	bool idle = true;
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS; i++) {
+		if (now % t->periods[i] == 0) {
+			if (arbiter_arbitrate(&(t->arbiters[i])))
+				idle = false;
+		} else if (arbiter_has_input(&(t->arbiters[i]))) {
+			idle = false;
+		}
+	}
+	
+	// No arbiter has any input, do nothing until one does.
+	if (idle)
+		scheduler_sleep(t->event);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Arbiter tree "tock" callback. Forwards the values chosen by the arbiters.
+ */
+void
+spinn_arbiter_tree_tock(void *t_)
+{
+	spinn_arbiter_tree_t *t = (spinn_arbiter_tree_t *)t_;
+	
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS; i++)
+		arbiter_forward(&(t->arbiters[i]));
+}
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+size_t
+spinn_arbiter_tree_storage_size( size_t lvl1_buffer_length
+                               , size_t lvl2_buffer_length
+                               )
+{
+	return (2 * buffer_storage_size(lvl1_buffer_length))
+	       + (3 * buffer_storage_size(lvl2_buffer_length));
+}
+
+
+void
+spinn_arbiter_tree_init( spinn_arbiter_tree_t *t
+                       , scheduler_t          *s
+                       , buffer_t            **inputs
+                       , buffer_t             *output
+                       , ticks_t               root_period
+                       , ticks_t               lvl1_period
+                       , ticks_t               lvl2_period
+                       , size_t                lvl1_buffer_length
+                       , size_t                lvl2_buffer_length
+                       , buffer_value_t       *storage
+                       )
+{
+	t->scheduler = s;
+	
+	t->periods[SPINN_ARBITER_TREE_E_S]      = lvl2_period;
+	t->periods[SPINN_ARBITER_TREE_NE_N]     = lvl2_period;
+	t->periods[SPINN_ARBITER_TREE_W_SW]     = lvl2_period;
+	t->periods[SPINN_ARBITER_TREE_E_S_NE_N] = lvl1_period;
+	t->periods[SPINN_ARBITER_TREE_W_SW_L]   = lvl1_period;
+	t->periods[SPINN_ARBITER_TREE_ROOT]     = root_period;
+	
+	// Create the buffers between the levels
+	for (int i = SPINN_ARBITER_TREE_E_S; i <= SPINN_ARBITER_TREE_W_SW; i++) {
+		buffer_init_from(&(t->buffers[i]), lvl2_buffer_length, storage);
+		storage += buffer_storage_size(lvl2_buffer_length);
+	}
+	for (int i = SPINN_ARBITER_TREE_E_S_NE_N; i <= SPINN_ARBITER_TREE_W_SW_L; i++) {
+		buffer_init_from(&(t->buffers[i]), lvl1_buffer_length, storage);
+		storage += buffer_storage_size(lvl1_buffer_length);
+	}
+	
+	// A single event runs every arbiter at (a divisor of) its period
+	t->event = scheduler_schedule( s, gcd(gcd(root_period, lvl1_period), lvl2_period)
+	                             , spinn_arbiter_tree_tick, (void *)t
+	                             , spinn_arbiter_tree_tock, (void *)t
+	                             );
+	
+	buffer_t *arbiter_inputs[SPINN_ARBITER_TREE_NUM_ARBITERS][2] = {
+		[SPINN_ARBITER_TREE_E_S]      = { inputs[SPINN_EAST], inputs[SPINN_SOUTH] },
+		[SPINN_ARBITER_TREE_NE_N]     = { inputs[SPINN_NORTH_EAST], inputs[SPINN_NORTH] },
+		[SPINN_ARBITER_TREE_W_SW]     = { inputs[SPINN_WEST], inputs[SPINN_SOUTH_WEST] },
+		[SPINN_ARBITER_TREE_E_S_NE_N] = { &(t->buffers[SPINN_ARBITER_TREE_E_S])
+		                               , &(t->buffers[SPINN_ARBITER_TREE_NE_N])
+		                               },
+		[SPINN_ARBITER_TREE_W_SW_L]   = { &(t->buffers[SPINN_ARBITER_TREE_W_SW])
+		                               , inputs[SPINN_LOCAL]
+		                               },
+		[SPINN_ARBITER_TREE_ROOT]     = { &(t->buffers[SPINN_ARBITER_TREE_E_S_NE_N])
+		                               , &(t->buffers[SPINN_ARBITER_TREE_W_SW_L])
+		                               },
+	};
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS; i++)
+		arbiter_init_unscheduled( &(t->arbiters[i])
+		                        , s, t->event
+		                        , arbiter_inputs[i], 2
+		                        , (i == SPINN_ARBITER_TREE_ROOT) ? output : &(t->buffers[i])
+		                        );
+	
+	// The tree never sleeps while its internal buffers hold values and so need not
+	// be woken by them
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS - 1; i++)
+		buffer_set_consumer(&(t->buffers[i]), NULL);
+}
+
+
+void
+spinn_arbiter_tree_destroy(spinn_arbiter_tree_t *t)
+{
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS; i++)
+		arbiter_destroy(&(t->arbiters[i]));
+	for (int i = 0; i < SPINN_ARBITER_TREE_NUM_ARBITERS - 1; i++)
+		buffer_destroy(&(t->buffers[i]));
+}
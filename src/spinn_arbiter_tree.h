@@ -0,0 +1,109 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_arbiter_tree.h -- The tree of arbiters which merges the six link inputs
+ * and the local input of a SpiNNaker node into the router's single input.
+ *
+ * The tree looks like this (with the levels indicated below):
+ *
+ *        |\                                         ,------ KEY --------,
+ *     E--| |_,--,_                                  |                   |
+ *     S--| | '--' |    |\                           |             |\    |
+ *        |/       `----| |_,--,_                    | Merger:  ---| |__ |
+ *                 ,----| | '--' |                   |          ---| |   |
+ *        |\       |    |/       |   |\              |             |/    |
+ *    NE--| |_,--,_|             '---| |_,--,___     |                   |
+ *     N--| | '--'               ,---| | '--'        | Buffer:  __,--,__ |
+ *        |/            |\       |   |/              |            '--'   |
+ *                 ,----| |_,--,_|                   '-------------------'
+ *        |\       | ,--| | '--'
+ *     W--| |_,--,_| |  |/
+ *    SW--| | '--'   |
+ *        |/         |
+ *                   |
+ *     L-------------'
+ *
+ *      `----v----'   `----v----'    `----v----'
+ *         Lvl2           Lvl1           Root
+ *
+ * Each merger is an arbiter_t with the period of its level. Rather than
+ * scheduling six separate arbiters, the whole tree is evaluated by a single
+ * event (whose period is the greatest common divisor of the level periods)
+ * which runs each arbiter only at the times it would have been run by its own
+ * event. The timing of the tree is therefore identical to that of six separate
+ * arbiters. The buffers between the levels are held within the tree while the
+ * root's output buffer is supplied by the user.
+ */
+
+#ifndef SPINN_ARBITER_TREE_H
+#define SPINN_ARBITER_TREE_H
+
+#include <stdlib.h>
+
+#include "config.h"
+
+#include "scheduler.h"
+#include "buffer.h"
+#include "arbiter.h"
+
+#include "spinn.h"
+
+/**
+ * A node's arbiter tree.
+ */
+typedef struct spinn_arbiter_tree spinn_arbiter_tree_t;
+
+
+// Concrete definitions of the above types
+#include "spinn_arbiter_tree_internal.h"
+
+
+/**
+ * The number of buffer values which must be supplied to spinn_arbiter_tree_init
+ * to hold the tree's internal buffers.
+ */
+size_t spinn_arbiter_tree_storage_size( size_t lvl1_buffer_length
+                                      , size_t lvl2_buffer_length
+                                      );
+
+
+/**
+ * Initialise a new arbiter tree. Adds itself to the scheduler.
+ *
+ * @param scheduler The scheduler controling the simulation. Its number of
+ *                  threads must already have been set.
+ * @param inputs The seven input buffers indexed by spinn_direction_t (the
+ *               SPINN_LOCAL input being the local input).
+ * @param output The buffer into which the root of the tree places values.
+ * @param root_period The period of the root arbiter.
+ * @param lvl1_period The period of the level 1 arbiters.
+ * @param lvl2_period The period of the level 2 arbiters.
+ * @param lvl1_buffer_length The length of the buffers after the level 1
+ *                           arbiters.
+ * @param lvl2_buffer_length The length of the buffers after the level 2
+ *                           arbiters.
+ * @param storage Storage for the tree's internal buffers of (at least)
+ *                spinn_arbiter_tree_storage_size values which must outlive the
+ *                tree (see buffer_init_from).
+ */
+void spinn_arbiter_tree_init( spinn_arbiter_tree_t *tree
+                            , scheduler_t          *scheduler
+                            , buffer_t            **inputs
+                            , buffer_t             *output
+                            , ticks_t               root_period
+                            , ticks_t               lvl1_period
+                            , ticks_t               lvl2_period
+                            , size_t                lvl1_buffer_length
+                            , size_t                lvl2_buffer_length
+                            , buffer_value_t       *storage
+                            );
+
+
+/**
+ * Free the resources from an arbiter tree. Note that the scheduler this was
+ * registered with must also be freed as it will be left holding a reference to
+ * invalid tick/tock functions.
+ */
+void spinn_arbiter_tree_destroy(spinn_arbiter_tree_t *tree);
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_arbiter_tree_internal.h -- Concrete definitions of internal
+ * datastrucutres. This is provided to allow the creation of these types. Users
+ * should not access the fields directly. This file should only be included by
+ * spinn_arbiter_tree.h
+ */
+
+
+/**
+ * Indices of the arbiters (and the buffers they output into) within a tree.
+ */
+typedef enum spinn_arbiter_tree_arbiter {
+	// Lvl2
+	SPINN_ARBITER_TREE_E_S,
+	SPINN_ARBITER_TREE_NE_N,
+	SPINN_ARBITER_TREE_W_SW,
+	
+	// Lvl1
+	SPINN_ARBITER_TREE_E_S_NE_N,
+	SPINN_ARBITER_TREE_W_SW_L,
+	
+	// Root (whose output buffer is not part of the tree)
+	SPINN_ARBITER_TREE_ROOT,
+	
+	SPINN_ARBITER_TREE_NUM_ARBITERS,
+} spinn_arbiter_tree_arbiter_t;
+
+
+struct spinn_arbiter_tree {
+	// The arbiters, their periods and the buffers between them (indexed by
+	// spinn_arbiter_tree_arbiter_t)
+	arbiter_t arbiters[SPINN_ARBITER_TREE_NUM_ARBITERS];
+	ticks_t   periods[SPINN_ARBITER_TREE_NUM_ARBITERS];
+	buffer_t  buffers[SPINN_ARBITER_TREE_NUM_ARBITERS - 1];
+	
+	// The scheduler the tree is registered with
+	scheduler_t *scheduler;
+	
+	// The tree's scheduler event, run at the greatest common divisor of the
+	// arbiters' periods (and which sleeps while every input is empty)
+	scheduler_event_t *event;
+};
+
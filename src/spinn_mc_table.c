@@ -0,0 +1,201 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_mc_table.c -- A SpiNNaker multicast routing table.
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "spinn_mc_table.h"
+
+
+/******************************************************************************
+ * Private functions.
+ ******************************************************************************/
+
+/**
+ * Internal function.
+ *
+ * Hash a (masked) key to a slot index. Multiplicative (Fibonacci) hashing: the
+ * high bits of the product depend on all bits of the key, whichever bits the
+ * mask leaves.
+ */
+static inline unsigned int
+hash_key(uint32_t key, unsigned int num_slots_mask)
+{
+	return (unsigned int)(((uint32_t)(key * 2654435769u)) >> 16) & num_slots_mask;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Insert an entry into a group's hash table (which must have a free slot)
+ * unless an entry with the same key is already present.
+ */
+static void
+group_insert(const spinn_mc_table_t *t, spinn_mc_table_group_t *g, int entry)
+{
+	uint32_t key = t->entries[entry].key;
+	
+	unsigned int i = hash_key(key, g->num_slots_mask);
+	while (g->slots[i] >= 0) {
+		// An earlier entry with the same key always takes priority
+		if (t->entries[g->slots[i]].key == key)
+			return;
+		i = (i + 1) & g->num_slots_mask;
+	}
+	
+	g->slots[i] = entry;
+	g->num_used++;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Allocate a group's hash table with the given (power of two) number of slots
+ * and insert every entry of the table with the group's mask.
+ */
+static void
+group_build(const spinn_mc_table_t *t, spinn_mc_table_group_t *g, unsigned int num_slots)
+{
+	g->slots = malloc(num_slots * sizeof(int));
+	assert(g->slots != NULL);
+	for (unsigned int i = 0; i < num_slots; i++)
+		g->slots[i] = -1;
+	g->num_slots_mask = num_slots - 1;
+	g->num_used       = 0;
+	
+	for (int e = g->first_entry; e < t->num_entries; e++)
+		if (t->entries[e].mask == g->mask && (t->entries[e].key & ~g->mask) == 0u)
+			group_insert(t, g, e);
+}
+
+
+/******************************************************************************
+ * Public functions.
+ ******************************************************************************/
+
+void
+spinn_mc_table_init(spinn_mc_table_t *t)
+{
+	t->entries     = NULL;
+	t->num_entries = 0;
+	t->max_entries = 0;
+	
+	t->groups     = NULL;
+	t->num_groups = 0;
+	t->max_groups = 0;
+}
+
+
+void
+spinn_mc_table_add( spinn_mc_table_t *t
+                  , uint32_t          key
+                  , uint32_t          mask
+                  , unsigned int      route
+                  )
+{
+	// Append the entry
+	if (t->num_entries == t->max_entries) {
+		t->max_entries = (t->max_entries * 2) + 1;
+		t->entries = realloc(t->entries, t->max_entries * sizeof(spinn_mc_table_entry_t));
+		assert(t->entries != NULL);
+	}
+	int entry = t->num_entries++;
+	t->entries[entry].key   = key;
+	t->entries[entry].mask  = mask;
+	t->entries[entry].route = route;
+	
+	// Entries which can never match need not be found
+	if ((key & ~mask) != 0u)
+		return;
+	
+	// Find the group with this mask, creating it if necessary
+	spinn_mc_table_group_t *g = NULL;
+	for (int i = 0; i < t->num_groups; i++) {
+		if (t->groups[i].mask == mask) {
+			g = &(t->groups[i]);
+			break;
+		}
+	}
+	if (g == NULL) {
+		if (t->num_groups == t->max_groups) {
+			t->max_groups = (t->max_groups * 2) + 1;
+			t->groups = realloc(t->groups, t->max_groups * sizeof(spinn_mc_table_group_t));
+			assert(t->groups != NULL);
+		}
+		g = &(t->groups[t->num_groups++]);
+		g->mask        = mask;
+		g->first_entry = entry;
+		group_build(t, g, 4);
+		return;
+	}
+	
+	// Keep the hash table at most half full, rebuilding it at double the size
+	// when required
+	if ((g->num_used + 1) * 2 > g->num_slots_mask + 1) {
+		free(g->slots);
+		group_build(t, g, (g->num_slots_mask + 1) * 2);
+	} else {
+		group_insert(t, g, entry);
+	}
+}
+
+
+int
+spinn_mc_table_get_num_entries(const spinn_mc_table_t *t)
+{
+	return t->num_entries;
+}
+
+
+bool
+spinn_mc_table_lookup( const spinn_mc_table_t *t
+                     , uint32_t                key
+                     , unsigned int           *route
+                     )
+{
+	// The first matching entry found so far (num_entries if none). Since groups
+	// are sorted by their first entry, once a match is found, only groups which
+	// begin before it need be searched.
+	int best = t->num_entries;
+	
+	for (int i = 0; i < t->num_groups && t->groups[i].first_entry < best; i++) {
+		const spinn_mc_table_group_t *g = &(t->groups[i]);
+		uint32_t masked_key = key & g->mask;
+		
+		unsigned int s = hash_key(masked_key, g->num_slots_mask);
+		while (g->slots[s] >= 0) {
+			if (t->entries[g->slots[s]].key == masked_key) {
+				if (g->slots[s] < best)
+					best = g->slots[s];
+				break;
+			}
+			s = (s + 1) & g->num_slots_mask;
+		}
+	}
+	
+	if (best == t->num_entries)
+		return false;
+	
+	*route = t->entries[best].route;
+	return true;
+}
+
+
+void
+spinn_mc_table_destroy(spinn_mc_table_t *t)
+{
+	for (int i = 0; i < t->num_groups; i++)
+		free(t->groups[i].slots);
+	free(t->groups);
+	free(t->entries);
+}
@@ -0,0 +1,82 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_mc_table.h -- A SpiNNaker multicast routing table.
+ *
+ * A table is an ordered list of key/mask/route entries. A 32-bit routing key
+ * matches an entry when (key & mask) == entry key and the route of the first
+ * (i.e. highest priority) matching entry is used, just as in the TCAM of a
+ * SpiNNaker router. Routes are bit masks with bit i set if a packet should be
+ * sent in spinn_direction_t i (SPINN_LOCAL being delivered to the local node).
+ *
+ * Rather than comparing a key against every entry in turn, entries are grouped
+ * by mask and each group is a hash table of its masked keys. Real tables have
+ * few distinct masks and so a lookup takes one probe per mask rather than one
+ * comparison per entry.
+ */
+
+#ifndef SPINN_MC_TABLE_H
+#define SPINN_MC_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * A multicast routing table.
+ */
+typedef struct spinn_mc_table spinn_mc_table_t;
+
+
+// Concrete definitions of the above types
+#include "spinn_mc_table_internal.h"
+
+
+/**
+ * Initialise an empty routing table.
+ */
+void spinn_mc_table_init(spinn_mc_table_t *table);
+
+
+/**
+ * Add an entry to the end of the table (i.e. with a lower priority than all
+ * entries already present). Entries whose key has bits set outside the mask can
+ * never match and are ignored by lookups (as in SpiNNaker).
+ *
+ * @param key The key bits to match.
+ * @param mask Which bits of the key are compared.
+ * @param route A mask of directions to send matching packets, bit i
+ *              corresponding to spinn_direction_t i.
+ */
+void spinn_mc_table_add( spinn_mc_table_t *table
+                       , uint32_t          key
+                       , uint32_t          mask
+                       , unsigned int      route
+                       );
+
+
+/**
+ * The number of entries in the table.
+ */
+int spinn_mc_table_get_num_entries(const spinn_mc_table_t *table);
+
+
+/**
+ * Look up the route for a key. Returns true and sets *route to the route of the
+ * first matching entry if there is one, otherwise returns false (and leaves
+ * *route unchanged).
+ */
+bool spinn_mc_table_lookup( const spinn_mc_table_t *table
+                          , uint32_t                key
+                          , unsigned int           *route
+                          );
+
+
+/**
+ * Free the resources used by a routing table.
+ */
+void spinn_mc_table_destroy(spinn_mc_table_t *table);
+
+#endif
+
@@ -0,0 +1,53 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * spinn_mc_table_internal.h -- Concrete definitions of internal datastrucutres.
+ * This is provided to allow the creation of these types. Users should not
+ * access the fields directly. This file should only be included by
+ * spinn_mc_table.h
+ */
+
+
+/**
+ * A single routing table entry.
+ */
+typedef struct spinn_mc_table_entry {
+	uint32_t     key;
+	uint32_t     mask;
+	unsigned int route;
+} spinn_mc_table_entry_t;
+
+
+/**
+ * The entries of a table which share a mask. The slots are an open-addressed
+ * (linear probing) hash table of entry indices keyed by the entries' keys.
+ * Where several entries in the group have the same key, only the first is
+ * present as the others can never be selected.
+ */
+typedef struct spinn_mc_table_group {
+	uint32_t mask;
+	
+	// Index of the first entry in this group. Groups are created in the order of
+	// their first entries and so are sorted by this field.
+	int first_entry;
+	
+	// The hash table slots (-1 when empty) of which there are num_slots_mask+1
+	// (a power of two). At most half of the slots are used.
+	int          *slots;
+	unsigned int  num_slots_mask;
+	unsigned int  num_used;
+} spinn_mc_table_group_t;
+
+
+struct spinn_mc_table {
+	// All entries, in priority order
+	spinn_mc_table_entry_t *entries;
+	int                     num_entries;
+	int                     max_entries;
+	
+	// The entries grouped by mask, in order of their highest priority entry
+	spinn_mc_table_group_t *groups;
+	int                     num_groups;
+	int                     max_groups;
+};
+
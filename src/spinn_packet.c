@@ -10,9 +10,17 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "scheduler.h"
 #include "buffer.h"
+#include "rng.h"
+#include "alias_table.h"
 
 #include "spinn.h"
 #include "spinn_packet.h"
@@ -29,16 +37,11 @@ spinn_packet_init_dor( spinn_packet_t *p
                      , spinn_coord_t   destination
                      , spinn_coord_t   system_size
                      , bool            use_wrap_around_links
-                     , void           *payload
+                     , rng_t          *rng
                      )
 {
 	// Set the trivial fields
-	p->source       = source;
-	p->destination  = destination;
-	p->emg_state    = SPINN_EMG_NORMAL;
-	p->payload      = payload;
-	p->num_hops     = 0;
-	p->num_emg_hops = 0;
+	spinn_packet_init(p, source, destination);
 	
 	// Calculate the vector to travel along
 	spinn_full_coord_t v;
@@ -48,86 +51,374 @@ spinn_packet_init_dor( spinn_packet_t *p
 		
 		// Randomize the direction to travel if reversing the direction of travel
 		// doesn't increase the distance
-		if (system_size.x%2 == 0 && v.x == system_size.x/2 && random() < (RAND_MAX/2)) v.x *= -1;
-		if (system_size.y%2 == 0 && v.y == system_size.y/2 && random() < (RAND_MAX/2)) v.y *= -1;
+		if (system_size.x%2 == 0 && v.x == system_size.x/2 && rng_bool(rng)) v.x *= -1;
+		if (system_size.y%2 == 0 && v.y == system_size.y/2 && rng_bool(rng)) v.y *= -1;
 		// XXX: Only randomize the z axis on square systems
 		if (system_size.x == system_size.y)
-			if (system_size.x%2 == 0 && v.z == system_size.x/2 && random() < (RAND_MAX/2)) v.z *= -1;
+			if (system_size.x%2 == 0 && v.z == system_size.x/2 && rng_bool(rng)) v.z *= -1;
 	} else {
 		v = (spinn_full_coord_t){ destination.x - source.x
 		                        , destination.y - source.y
 		                        , 0
 		                        };
 		v = spinn_full_coord_minimise(v);
-
+	
 	}
 	
 	// The starting direction is simply the direction the vector is pointing
-	     if (v.x < 0) p->direction = SPINN_WEST;
-	else if (v.x > 0) p->direction = SPINN_EAST;
-	else if (v.y < 0) p->direction = SPINN_SOUTH;
-	else if (v.y > 0) p->direction = SPINN_NORTH;
-	else if (v.z < 0) p->direction = SPINN_NORTH_EAST;
-	else if (v.z > 0) p->direction = SPINN_SOUTH_WEST;
-	else              p->direction = SPINN_LOCAL;
+	spinn_direction_t direction;
+	     if (v.x < 0) direction = SPINN_WEST;
+	else if (v.x > 0) direction = SPINN_EAST;
+	else if (v.y < 0) direction = SPINN_SOUTH;
+	else if (v.y > 0) direction = SPINN_NORTH;
+	else if (v.z < 0) direction = SPINN_NORTH_EAST;
+	else if (v.z > 0) direction = SPINN_SOUTH_WEST;
+	else              direction = SPINN_LOCAL;
+	spinn_packet_set_direction(p, direction);
 	
 	
 	// Find out on which axis the inflection point is along
+	spinn_coord_t     inflection_point;
+	spinn_direction_t inflection_direction;
 	if (v.x != 0) {
-		p->inflection_point.x = ((source.x + v.x) + system_size.x) % system_size.x;
-		p->inflection_point.y = source.y;
-		     if (v.y < 0) p->inflection_direction = SPINN_SOUTH;
-		else if (v.y > 0) p->inflection_direction = SPINN_NORTH;
-		else if (v.z < 0) p->inflection_direction = SPINN_NORTH_EAST;
-		else if (v.z > 0) p->inflection_direction = SPINN_SOUTH_WEST;
-		else              p->inflection_direction = SPINN_LOCAL;
+		inflection_point.x = ((source.x + v.x) + system_size.x) % system_size.x;
+		inflection_point.y = source.y;
+		     if (v.y < 0) inflection_direction = SPINN_SOUTH;
+		else if (v.y > 0) inflection_direction = SPINN_NORTH;
+		else if (v.z < 0) inflection_direction = SPINN_NORTH_EAST;
+		else if (v.z > 0) inflection_direction = SPINN_SOUTH_WEST;
+		else              inflection_direction = SPINN_LOCAL;
 	
 	} else if (v.y != 0) {
-		p->inflection_point.x = source.x;
-		p->inflection_point.y = ((source.y + v.y) + system_size.y) % system_size.y;
-		     if (v.z < 0) p->inflection_direction = SPINN_NORTH_EAST;
-		else if (v.z > 0) p->inflection_direction = SPINN_SOUTH_WEST;
-		else              p->inflection_direction = SPINN_LOCAL;
+		inflection_point.x = source.x;
+		inflection_point.y = ((source.y + v.y) + system_size.y) % system_size.y;
+		     if (v.z < 0) inflection_direction = SPINN_NORTH_EAST;
+		else if (v.z > 0) inflection_direction = SPINN_SOUTH_WEST;
+		else              inflection_direction = SPINN_LOCAL;
 	
 	} else {
-		p->inflection_point     = destination;
-		p->inflection_direction = SPINN_LOCAL;
+		inflection_point     = destination;
+		inflection_direction = SPINN_LOCAL;
 	}
+	spinn_packet_set_inflection_point(p, inflection_point);
+	spinn_packet_set_inflection_direction(p, inflection_direction);
+}
+
+
+void
+spinn_packet_init( spinn_packet_t *p
+                 , spinn_coord_t   source
+                 , spinn_coord_t   destination
+                 )
+{
+	spinn_packet_set_type(p, SPINN_PACKET_P2P);
+	spinn_packet_set_source(p, source);
+	spinn_packet_set_destination(p, destination);
+	spinn_packet_set_inflection_point(p, destination);
+	
+	// Packets from the pool are uninitialised so clear the packed state fields
+	// before setting them
+	p->state = 0u;
+	spinn_packet_set_direction(p, SPINN_LOCAL);
+	spinn_packet_set_inflection_direction(p, SPINN_LOCAL);
+	spinn_packet_set_emg_state(p, SPINN_EMG_NORMAL);
+	
+	p->num_hops     = 0;
+	p->num_emg_hops = 0;
+}
+
+
+void
+spinn_packet_init_mc( spinn_packet_t *p
+                    , spinn_coord_t   source
+                    , uint32_t        key
+                    )
+{
+	spinn_packet_init(p, source, source);
+	spinn_packet_set_type(p, SPINN_PACKET_MC);
+	spinn_packet_set_key(p, key);
 }
 
 /******************************************************************************
  * Packet Pool
  ******************************************************************************/
 
+/**
+ * Internal function.
+ *
+ * Allocate zeroed memory for the given number of packets. If requested, huge
+ * pages are used where available: explicitly reserved huge pages are tried
+ * first, then (transparent) huge-page-aligned memory. Sets *mapped if the memory
+ * must be freed with munmap rather than free (see free_packet_memory).
+ */
+static spinn_packet_t *
+alloc_packet_memory(size_t num_packets, bool use_huge_pages, bool *mapped)
+{
+	size_t num_bytes = num_packets * sizeof(spinn_packet_t);
+	*mapped = false;
+	
+	if (use_huge_pages) {
+		// Round up to a whole number of huge pages
+		size_t num_huge_bytes = ((num_bytes + SPINN_PACKET_POOL_HUGE_PAGE_BYTES - 1)
+		                         / SPINN_PACKET_POOL_HUGE_PAGE_BYTES)
+		                        * SPINN_PACKET_POOL_HUGE_PAGE_BYTES;
+
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB)
+		void *packets = mmap( NULL, num_huge_bytes
+		                    , PROT_READ | PROT_WRITE
+		                    , MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+		                    , -1, 0
+		                    );
+		if (packets != MAP_FAILED) {
+			*mapped = true;
+			return (spinn_packet_t *)packets;
+		}
+#endif
+		
+		void *aligned_packets;
+		int error = posix_memalign( &aligned_packets
+		                          , SPINN_PACKET_POOL_HUGE_PAGE_BYTES
+		                          , num_huge_bytes
+		                          );
+		assert(error == 0);
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+		madvise(aligned_packets, num_huge_bytes, MADV_HUGEPAGE);
+#endif
+		memset(aligned_packets, 0, num_huge_bytes);
+		return (spinn_packet_t *)aligned_packets;
+	}
+	
+	spinn_packet_t *packets = calloc(num_packets, sizeof(spinn_packet_t));
+	assert(packets != NULL);
+	return packets;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Free memory allocated by alloc_packet_memory.
+ */
+static void
+free_packet_memory(spinn_packet_t *packets, size_t num_packets, bool mapped)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB)
+	if (mapped) {
+		size_t num_bytes = num_packets * sizeof(spinn_packet_t);
+		munmap( packets
+		      , ((num_bytes + SPINN_PACKET_POOL_HUGE_PAGE_BYTES - 1)
+		         / SPINN_PACKET_POOL_HUGE_PAGE_BYTES)
+		        * SPINN_PACKET_POOL_HUGE_PAGE_BYTES
+		      );
+		return;
+	}
+#endif
+	free(packets);
+}
+
+
+/**
+ * Internal function.
+ *
+ * The number of packets on a pool's free packet stack.
+ */
+static inline size_t
+num_free_packets(spinn_packet_pool_t *pool)
+{
+	if (pool->free_packets_head == NULL)
+		return 0;
+	else
+		return (size_t)((pool->free_packets_head + 1) - pool->free_packets);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Add the given number of packets to the pool, pushing them onto the free
+ * packet stack.
+ */
+static void
+grow_pool(spinn_packet_pool_t *pool, size_t num_new_packets)
+{
+#ifdef USE_PACKET_HANDLES
+	// Add chunks until the new packets fit. Existing chunks are left in place
+	// since other threads may be using their packets.
+	while (pool->capacity < pool->num_packets + num_new_packets) {
+		int chunk = pool->num_chunks;
+		assert(chunk < SPINN_PACKET_POOL_MAX_CHUNKS);
+		size_t chunk_size = (size_t)1 << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + chunk);
+		
+		// Small chunks are not worth a whole huge page
+		pool->chunks[chunk] = alloc_packet_memory( chunk_size
+		                                         , pool->use_huge_pages
+		                                           && (chunk_size * sizeof(spinn_packet_t)
+		                                               >= SPINN_PACKET_POOL_HUGE_PAGE_BYTES)
+		                                         , &(pool->chunks_mapped[chunk])
+		                                         );
+		pool->capacity += chunk_size;
+		__atomic_store_n(&(pool->num_chunks), chunk + 1, __ATOMIC_RELEASE);
+	}
+#else
+	spinn_packet_sub_pool_t *sub_pool = malloc(sizeof(spinn_packet_sub_pool_t));
+	assert(sub_pool != NULL);
+	sub_pool->packets = alloc_packet_memory( num_new_packets
+	                                       , pool->use_huge_pages
+	                                       , &(sub_pool->mapped)
+	                                       );
+	sub_pool->num_packets = num_new_packets;
+	sub_pool->next = pool->sub_pools;
+	pool->sub_pools = sub_pool;
+	spinn_packet_t *new_packets = sub_pool->packets;
+#endif
+	
+	// Enlarge the free packet stack (so that it can hold every packet) and add
+	// the new packets to it
+	size_t num_free = num_free_packets(pool);
+	pool->free_packets = realloc( pool->free_packets
+	                            , (pool->num_packets + num_new_packets)
+	                              * sizeof(spinn_packet_handle_t)
+	                            );
+	assert(pool->free_packets != NULL);
+	pool->free_packets_head = pool->free_packets + num_free - 1;
+	pool->free_packets_end  = pool->free_packets + pool->num_packets + num_new_packets;
+	for (size_t i = 0; i < num_new_packets; i++) {
+#ifdef USE_PACKET_HANDLES
+		*(++pool->free_packets_head) = (spinn_packet_handle_t)(pool->num_packets + i);
+#else
+		*(++pool->free_packets_head) = spinn_packet_pool_get_handle(pool, &new_packets[i]);
+#endif
+	}
+	
+	pool->num_packets += num_new_packets;
+	pool->num_growths++;
+}
+
+
 void
 spinn_packet_pool_init(spinn_packet_pool_t *pool)
 {
+	pool->owner      = pool;
+	pool->batch_size = 0;
+	pthread_mutex_init(&(pool->lock), NULL);
+	
 	// Initially start with an empty pool
+#ifdef USE_PACKET_HANDLES
+	for (int i = 0; i < SPINN_PACKET_POOL_MAX_CHUNKS; i++) {
+		pool->chunks[i] = NULL;
+		pool->chunks_mapped[i] = false;
+	}
+	pool->num_chunks = 0;
+	pool->capacity   = 0;
+#else
 	pool->sub_pools = NULL;
+#endif
 	
 	// Create an empty initial stack
 	pool->free_packets = NULL;
 	pool->free_packets_head = NULL;
+	pool->free_packets_end = NULL;
 	
 	pool->num_packets = 0;
+	pool->num_growths = 0;
+	
+	pool->num_pallocs = 0;
+	pool->num_pfrees  = 0;
+	
+	pool->max_packets   = 0;
+	pool->num_exhausted = 0;
+	
+	pool->use_huge_pages = false;
+}
+
+
+void
+spinn_packet_pool_init_local( spinn_packet_pool_t *pool
+                            , spinn_packet_pool_t *owner
+                            , size_t               batch_size
+                            )
+{
+	assert(owner->owner == owner);
+	assert(batch_size > 0);
+	
+	spinn_packet_pool_init(pool);
+	pool->owner      = owner;
+	pool->batch_size = batch_size;
+	
+	// The local stack holds up to two batches
+	pool->free_packets = malloc(2 * batch_size * sizeof(spinn_packet_handle_t));
+	assert(pool->free_packets != NULL);
+	pool->free_packets_head = pool->free_packets - 1;
+	pool->free_packets_end  = pool->free_packets + (2 * batch_size);
+}
+
+
+void
+spinn_packet_pool_set_use_huge_pages( spinn_packet_pool_t *pool
+                                    , bool                 use_huge_pages
+                                    )
+{
+	pool->use_huge_pages = use_huge_pages;
+}
+
+
+void
+spinn_packet_pool_reserve( spinn_packet_pool_t *pool
+                         , size_t               num_packets
+                         )
+{
+	if (num_packets > pool->num_packets)
+		grow_pool(pool, num_packets - pool->num_packets);
+}
+
+
+void
+spinn_packet_pool_set_max_packets( spinn_packet_pool_t *pool
+                                 , size_t               max_packets
+                                 )
+{
+	pool->max_packets = max_packets;
 }
 
 
 void
 spinn_packet_pool_destroy(spinn_packet_pool_t *pool)
 {
-	// Free the sub pools
+	// Local pools return their packets to their owner
+	if (pool->owner != pool) {
+		spinn_packet_pool_t *owner = pool->owner;
+		pthread_mutex_lock(&(owner->lock));
+		while (num_free_packets(pool) > 0)
+			*(++owner->free_packets_head) = *(pool->free_packets_head--);
+		pthread_mutex_unlock(&(owner->lock));
+		
+		free(pool->free_packets);
+		pthread_mutex_destroy(&(pool->lock));
+		return;
+	}
+	
+	// Free the packets
+#ifdef USE_PACKET_HANDLES
+	for (int i = 0; i < pool->num_chunks; i++)
+		free_packet_memory( pool->chunks[i]
+		                  , (size_t)1 << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + i)
+		                  , pool->chunks_mapped[i]
+		                  );
+#else
 	spinn_packet_sub_pool_t *sub_pool = pool->sub_pools;
 	while (sub_pool) {
 		spinn_packet_sub_pool_t *next_sub_pool = sub_pool->next;
-		free(sub_pool->packets);
+		free_packet_memory(sub_pool->packets, sub_pool->num_packets, sub_pool->mapped);
 		free(sub_pool);
 		sub_pool = next_sub_pool;
 	}
+#endif
 	
 	// Free the free packet stack
 	if (pool->free_packets != NULL)
 		free(pool->free_packets);
+	
+	pthread_mutex_destroy(&(pool->lock));
 }
 
 
@@ -138,36 +429,133 @@ spinn_packet_pool_get_num_packets(spinn_packet_pool_t *pool)
 }
 
 
+size_t
+spinn_packet_pool_get_num_bytes(spinn_packet_pool_t *pool)
+{
+	// The packets themselves plus the free packet stack
+	return pool->num_packets * (sizeof(spinn_packet_t) + sizeof(spinn_packet_handle_t));
+}
+
+
+int
+spinn_packet_pool_get_num_growths(spinn_packet_pool_t *pool)
+{
+	return pool->num_growths;
+}
+
+
+int
+spinn_packet_pool_get_num_exhausted(spinn_packet_pool_t *pool)
+{
+	return pool->num_exhausted;
+}
+
+
+int
+spinn_packet_pool_get_num_free(spinn_packet_pool_t *pool)
+{
+	return num_free_packets(pool);
+}
+
+
+int
+spinn_packet_pool_get_num_in_use(spinn_packet_pool_t *pool)
+{
+	return pool->num_pallocs - pool->num_pfrees;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Ensure a pool (which is not a local pool) has a free packet, creating some
+ * more packets (double+1 the current number of packets) without exceeding the
+ * maximum size if required. Returns false if the pool is exhausted.
+ */
+static bool
+refill_pool(spinn_packet_pool_t *pool)
+{
+	if (num_free_packets(pool) > 0)
+		return true;
+	
+	size_t num_new_packets = pool->num_packets + 1;
+	if (pool->max_packets != 0) {
+		if (pool->num_packets >= pool->max_packets) {
+			pool->num_exhausted++;
+			return false;
+		}
+		if (pool->num_packets + num_new_packets > pool->max_packets)
+			num_new_packets = pool->max_packets - pool->num_packets;
+	}
+	grow_pool(pool, num_new_packets);
+	return true;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Take up to a batch of packets from a local pool's owner. Returns false if
+ * the owner is exhausted.
+ */
+static bool
+refill_local_pool(spinn_packet_pool_t *pool)
+{
+	spinn_packet_pool_t *owner = pool->owner;
+	bool refilled;
+	
+	pthread_mutex_lock(&(owner->lock));
+	refilled = refill_pool(owner);
+	for (size_t i = 0; i < pool->batch_size && num_free_packets(owner) > 0; i++)
+		*(++pool->free_packets_head) = *(owner->free_packets_head--);
+	pthread_mutex_unlock(&(owner->lock));
+	
+	if (!refilled)
+		pool->num_exhausted++;
+	return refilled;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Return a batch of packets from a full local pool to its owner. The packets
+ * freed least recently are returned, keeping those most likely to be in the
+ * cache.
+ */
+static void
+spill_local_pool(spinn_packet_pool_t *pool)
+{
+	spinn_packet_pool_t *owner = pool->owner;
+	
+	pthread_mutex_lock(&(owner->lock));
+	for (size_t i = 0; i < pool->batch_size; i++)
+		*(++owner->free_packets_head) = pool->free_packets[i];
+	pthread_mutex_unlock(&(owner->lock));
+	
+	memmove( pool->free_packets
+	       , pool->free_packets + pool->batch_size
+	       , (num_free_packets(pool) - pool->batch_size) * sizeof(spinn_packet_handle_t)
+	       );
+	pool->free_packets_head -= pool->batch_size;
+}
+
+
 spinn_packet_t *
 spinn_packet_pool_palloc(spinn_packet_pool_t *pool)
 {
-	
-	// If the free packet stack is empty, create some more packets (double+1 the
-	// current number of packets)
+	// If the free packet stack is empty, get more packets from the pool's owner
+	// (for local pools) or by growing the pool.
 	if (pool->free_packets_head == NULL || pool->free_packets_head < pool->free_packets) {
-		spinn_packet_sub_pool_t *next_sub_pool = pool->sub_pools;
-		pool->sub_pools = malloc(sizeof(spinn_packet_sub_pool_t));
-		assert(pool->sub_pools != NULL);
-		pool->sub_pools->packets = calloc(pool->num_packets + 1, sizeof(spinn_packet_t));
-		assert(pool->sub_pools->packets != NULL);
-		pool->sub_pools->next = next_sub_pool;
-		
-		// Free the old free packet stack
-		if (pool->free_packets != NULL)
-			free(pool->free_packets);
-		
-		// Create a new, larger stack and add the new packets to the stack
-		pool->free_packets = calloc(pool->num_packets*2 + 1, sizeof(spinn_packet_t *));
-		assert(pool->free_packets != NULL);
-		pool->free_packets_head = pool->free_packets + pool->num_packets + 1 - 1;
-		for (size_t i = 0; i < pool->num_packets + 1; i++)
-			pool->free_packets[i] = &pool->sub_pools->packets[i];
-		
-		pool->num_packets = pool->num_packets*2 + 1;
+		bool refilled = (pool->owner != pool) ? refill_local_pool(pool)
+		                                      : refill_pool(pool);
+		if (!refilled)
+			return NULL;
 	}
 	
 	// Return a packet from the free-packet stack
-	return *(pool->free_packets_head--);
+	pool->num_pallocs++;
+	return spinn_packet_pool_get_packet(pool, *(pool->free_packets_head--));
 }
 
 
@@ -176,18 +564,85 @@ spinn_packet_pool_pfree( spinn_packet_pool_t *pool
                        , spinn_packet_t      *packet
                        )
 {
-	*(++pool->free_packets_head) = packet;
+	// Only local pools' stacks can fill up (others have room for every packet)
+	if (pool->free_packets_head + 1 == pool->free_packets_end)
+		spill_local_pool(pool);
+	
+	pool->num_pfrees++;
+	*(++pool->free_packets_head) = spinn_packet_pool_get_handle(pool, packet);
 }
 
 
 
+/******************************************************************************
+ * Periodic process helpers
+ ******************************************************************************/
+
+/**
+ * Internal function.
+ *
+ * The time of the first tick of a periodic process (scheduled with the given
+ * period) which occurs after the given interval has elapsed, starting from the
+ * next time it is called. An interval of one (or less) is the next call.
+ */
+static ticks_t
+get_first_periodic_time(scheduler_t *s, ticks_t period, int interval)
+{
+	ticks_t now = scheduler_get_ticks(s);
+	ticks_t next_call = ((now + period - 1) / period) * period;
+	
+	if (interval > 1)
+		return next_call + ((interval - 1) * period);
+	else
+		return next_call;
+}
+
+
+/**
+ * Internal function.
+ *
+ * A Bernoulli process (one trial per period) which is only evaluated at its
+ * successful trials: the number of periods from one success to the next is
+ * geometrically distributed and so is sampled once per success rather than
+ * running a trial every period. Returns the time of the first success at least
+ * one period from now (or from the next call when first is true).
+ * Draws from the given generator only when 0 < prob < 1.
+ */
+static ticks_t
+get_next_bernoulli_time( scheduler_t *s
+                       , rng_t       *rng
+                       , ticks_t      period
+                       , double       prob
+                       , double       log_1_minus_prob
+                       , bool         first
+                       )
+{
+	if (prob <= 0.0)
+		return SCHEDULER_NEVER;
+	
+	// The number of failed trials before the next success
+	double num_failures = 0.0;
+	if (prob < 1.0) {
+		double u = 1.0 - rng_uniform(rng);
+		num_failures = floor(log(u) / log_1_minus_prob);
+	}
+	
+	ticks_t next_trial = first ? get_first_periodic_time(s, period, 1)
+	                           : scheduler_get_ticks(s) + period;
+	if (num_failures * (double)period >= (double)(SCHEDULER_NEVER - next_trial))
+		return SCHEDULER_NEVER;
+	return next_trial + ((ticks_t)num_failures * period);
+}
+
+
 /******************************************************************************
  * Packet generators
  ******************************************************************************/
 
 /**
  * Tick function which decides whether to send a packet (based on the
- * availability of space in the output buffer and then the Bernoulli trial.
+ * availability of space in the output buffer and then the temporal
+ * distribution).
  */
 void
 spinn_packet_gen_tick(void *g_)
@@ -196,12 +651,11 @@ spinn_packet_gen_tick(void *g_)
 	
 	switch (g->temporal_dist) {
 		case SPINN_GT_DIST_BERNOULLI:
-			g->send_packet = (((double)rand())/((double)RAND_MAX+1.0)) <= g->temporal_dist_data.bernoulli.prob;
+			g->send_packet = scheduler_get_ticks(g->scheduler) >= g->temporal_dist_data.bernoulli.next_time;
 			break;
 		
 		case SPINN_GT_DIST_PERIODIC:
-			g->send_packet = g->temporal_dist_data.periodic.time_elapsed >= g->temporal_dist_data.periodic.interval - 1;
-			g->temporal_dist_data.periodic.time_elapsed++;
+			g->send_packet = scheduler_get_ticks(g->scheduler) >= g->temporal_dist_data.periodic.next_time;
 			break;
 		
 		default:
@@ -212,6 +666,86 @@ spinn_packet_gen_tick(void *g_)
 	g->output_blocked = buffer_is_full(g->buffer);
 }
 
+/**
+ * Next activity function which reports when the next packet will be generated
+ * (if known).
+ */
+ticks_t
+spinn_packet_gen_next_activity(void *g_)
+{
+	spinn_packet_gen_t *g = (spinn_packet_gen_t *)g_;
+	
+	switch (g->temporal_dist) {
+		case SPINN_GT_DIST_BERNOULLI:
+			return g->temporal_dist_data.bernoulli.next_time;
+		
+		case SPINN_GT_DIST_PERIODIC:
+			return g->temporal_dist_data.periodic.next_time;
+		
+		default:
+			return scheduler_get_ticks(g->scheduler);
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Schedule the next Bernoulli trial to succeed once a packet has been sent or
+ * refused (the distribution gives up immediately if the output is blocked).
+ */
+static void
+next_bernoulli_packet(spinn_packet_gen_t *g)
+{
+	if (g->temporal_dist == SPINN_GT_DIST_BERNOULLI)
+		g->temporal_dist_data.bernoulli.next_time
+			= get_next_bernoulli_time( g->scheduler, &(g->rng), g->period
+			                         , g->temporal_dist_data.bernoulli.prob
+			                         , g->temporal_dist_data.bernoulli.log_1_minus_prob
+			                         , false
+			                         );
+}
+
+/**
+ * Internal function.
+ *
+ * Timestamp and send a newly generated packet, running the packet generation
+ * callback.
+ */
+static void
+send_generated_packet(spinn_packet_gen_t *g, spinn_packet_t *p)
+{
+	p->sent_time = scheduler_get_ticks(g->scheduler);
+	
+	// Run the callback
+	if (g->on_packet_gen)
+		g->on_packet_gen(p, g->on_packet_gen_data);
+	
+	// Send the packet
+	buffer_push(g->buffer, spinn_packet_pool_get_handle(g->pool, p));
+	
+	// Reset the timer for the periodic temporal distribution as a packet has now
+	// been sent
+	if (g->temporal_dist == SPINN_GT_DIST_PERIODIC)
+		g->temporal_dist_data.periodic.next_time
+			= scheduler_get_ticks(g->scheduler)
+			  + (g->temporal_dist_data.periodic.interval * g->period);
+}
+
+
+/**
+ * Internal function.
+ *
+ * Run the packet generation callback for a packet which could not be sent.
+ */
+static void
+refuse_generated_packet(spinn_packet_gen_t *g)
+{
+	if (g->on_packet_gen)
+		g->on_packet_gen(NULL, g->on_packet_gen_data);
+}
+
+
 /**
  * Tock function actually generate and send a packet if required.
  */
@@ -224,15 +758,36 @@ spinn_packet_gen_tock(void *g_)
 	if (!g->send_packet)
 		return;
 	
+	// Whether or not the packet is actually sent, this trial is over
+	next_bernoulli_packet(g);
+	
 	// If the buffer is full, don't send but raise the callback with a NULL packet
 	if (g->output_blocked) {
-		if (g->on_packet_gen)
-			g->on_packet_gen(NULL, g->on_packet_gen_data);
+		refuse_generated_packet(g);
 		
 		g->send_packet = false;
 		return;
 	}
 	
+	// Multicast packets have no destination, just a key
+	if (g->spatial_dist == SPINN_GS_DIST_MULTICAST) {
+		spinn_packet_t *p = spinn_packet_pool_palloc(g->pool);
+		if (p == NULL) {
+			refuse_generated_packet(g);
+			return;
+		}
+		
+		spinn_packet_init_mc( p, g->position
+		                    , g->spatial_dist_data.multicast.base_key
+		                      + g->spatial_dist_data.multicast.next_key
+		                    );
+		g->spatial_dist_data.multicast.next_key
+			= (g->spatial_dist_data.multicast.next_key + 1u)
+			  % g->spatial_dist_data.multicast.num_keys;
+		send_generated_packet(g, p);
+		return;
+	}
+	
 	// Determine the packet destination based on the current distribution. If the
 	// filter rejects the packet, loop until a destination is chosen which
 	// satisfies it. If the destination picked was (-1,-1) then don't generate a
@@ -256,8 +811,17 @@ spinn_packet_gen_tock(void *g_)
 			
 			default:
 			case SPINN_GS_DIST_UNIFORM:
-				destination.x = (int)((((double)rand())/((double)RAND_MAX+1.0)) * g->system_size.x);
-				destination.y = (int)((((double)rand())/((double)RAND_MAX+1.0)) * g->system_size.y);
+				destination.x = (int)rng_below(&(g->rng), (uint32_t)g->system_size.x);
+				destination.y = (int)rng_below(&(g->rng), (uint32_t)g->system_size.y);
+				break;
+			
+			case SPINN_GS_DIST_TABLE:
+				destination = g->spatial_dist_data.table.destinations[
+					alias_table_sample(g->spatial_dist_data.table.table, &(g->rng))];
+				if (g->spatial_dist_data.table.relative) {
+					destination.x = (g->position.x + destination.x) % g->system_size.x;
+					destination.y = (g->position.y + destination.y) % g->system_size.y;
+				}
 				break;
 			
 			case SPINN_GS_DIST_P2P:
@@ -290,20 +854,18 @@ spinn_packet_gen_tock(void *g_)
 	
 	// Produce the packet
 	spinn_packet_t *p = spinn_packet_pool_palloc(g->pool);
-	spinn_packet_init_dor(p, g->position, destination, g->system_size, g->use_wrap_around_links, NULL);
-	p->sent_time = scheduler_get_ticks(g->scheduler);
-	
-	// Set up the payload and run the callback
-	if (g->on_packet_gen)
-		p->payload = g->on_packet_gen(p, g->on_packet_gen_data);
-	
-	// Send the packet
-	buffer_push(g->buffer, (void *)p);
+	if (p == NULL) {
+		refuse_generated_packet(g);
+		return;
+	}
 	
-	// Reset the timer for the periodic temporal distribution as a packet has now
-	// been sent
-	if (g->temporal_dist == SPINN_GT_DIST_PERIODIC)
-		g->temporal_dist_data.periodic.time_elapsed = 0;
+	if (g->dor_routing)
+		spinn_packet_init_dor( p, g->position, destination, g->system_size
+		                     , g->use_wrap_around_links, &(g->rng)
+		                     );
+	else
+		spinn_packet_init(p, g->position, destination);
+	send_generated_packet(g, p);
 }
 
 
@@ -318,7 +880,7 @@ spinn_packet_gen_init( spinn_packet_gen_t  *g
                      , bool                 use_wrap_around_links
                      , bool (*dest_filter)(const spinn_coord_t *proposed_destination, void *data)
                      , void *dest_filter_data
-                     , void *(*on_packet_gen)(spinn_packet_t *packet, void *data)
+                     , void (*on_packet_gen)(spinn_packet_t *packet, void *data)
                      , void *on_packet_gen_data
                      )
 {
@@ -329,16 +891,21 @@ spinn_packet_gen_init( spinn_packet_gen_t  *g
 	g->position              = position;
 	g->system_size           = system_size;
 	g->use_wrap_around_links = use_wrap_around_links;
+	g->dor_routing           = true;
 	g->dest_filter           = dest_filter;
 	g->dest_filter_data      = dest_filter_data;
 	g->on_packet_gen         = on_packet_gen;
 	g->on_packet_gen_data    = on_packet_gen_data;
+	g->period                = period;
+	
+	rng_init(&(g->rng), 0u, 0u);
 	
 	// Set up tick/tock functions
-	scheduler_schedule( s, period
-	                  , spinn_packet_gen_tick, (void *)g
-	                  , spinn_packet_gen_tock, (void *)g
-	                  );
+	scheduler_event_t *event = scheduler_schedule( s, period
+	                                             , spinn_packet_gen_tick, (void *)g
+	                                             , spinn_packet_gen_tock, (void *)g
+	                                             );
+	scheduler_set_next_activity(s, event, spinn_packet_gen_next_activity, (void *)g);
 	
 	// Initially leave distribution values undefined.
 }
@@ -351,6 +918,13 @@ spinn_packet_gen_set_temporal_dist_bernoulli( spinn_packet_gen_t *g
 {
 	g->temporal_dist = SPINN_GT_DIST_BERNOULLI;
 	g->temporal_dist_data.bernoulli.prob = bernoulli_prob;
+	g->temporal_dist_data.bernoulli.log_1_minus_prob = log1p(-bernoulli_prob);
+	g->temporal_dist_data.bernoulli.next_time
+		= get_next_bernoulli_time( g->scheduler, &(g->rng), g->period
+		                         , bernoulli_prob
+		                         , g->temporal_dist_data.bernoulli.log_1_minus_prob
+		                         , true
+		                         );
 }
 
 
@@ -361,7 +935,8 @@ spinn_packet_gen_set_temporal_dist_periodic( spinn_packet_gen_t *g
 {
 	g->temporal_dist = SPINN_GT_DIST_PERIODIC;
 	g->temporal_dist_data.periodic.interval = interval;
-	g->temporal_dist_data.periodic.time_elapsed = 0;
+	g->temporal_dist_data.periodic.next_time
+		= get_first_periodic_time(g->scheduler, g->period, interval);
 }
 
 
@@ -391,6 +966,34 @@ spinn_packet_gen_set_spatial_dist_cyclic(spinn_packet_gen_t *g)
 }
 
 
+void
+spinn_packet_gen_set_spatial_dist_table( spinn_packet_gen_t  *g
+                                       , const alias_table_t *table
+                                       , const spinn_coord_t *destinations
+                                       , bool                 relative
+                                       )
+{
+	g->spatial_dist = SPINN_GS_DIST_TABLE;
+	g->spatial_dist_data.table.table        = table;
+	g->spatial_dist_data.table.destinations = destinations;
+	g->spatial_dist_data.table.relative     = relative;
+}
+
+
+void
+spinn_packet_gen_set_spatial_dist_multicast( spinn_packet_gen_t *g
+                                           , uint32_t            base_key
+                                           , uint32_t            num_keys
+                                           )
+{
+	assert(num_keys > 0u);
+	g->spatial_dist = SPINN_GS_DIST_MULTICAST;
+	g->spatial_dist_data.multicast.base_key = base_key;
+	g->spatial_dist_data.multicast.num_keys = num_keys;
+	g->spatial_dist_data.multicast.next_key = 0u;
+}
+
+
 void
 spinn_packet_gen_set_spatial_dist_complement(spinn_packet_gen_t *g)
 {
@@ -412,6 +1015,25 @@ spinn_packet_gen_set_spatial_dist_tornado(spinn_packet_gen_t *g)
 }
 
 
+void
+spinn_packet_gen_set_dor_routing( spinn_packet_gen_t *g
+                                , bool                dor_routing
+                                )
+{
+	g->dor_routing = dor_routing;
+}
+
+
+void
+spinn_packet_gen_set_seed( spinn_packet_gen_t *g
+                         , uint64_t            seed
+                         , uint64_t            stream
+                         )
+{
+	rng_init(&(g->rng), seed, stream);
+}
+
+
 void
 spinn_packet_gen_destroy(spinn_packet_gen_t *g)
 {
@@ -425,7 +1047,7 @@ spinn_packet_gen_destroy(spinn_packet_gen_t *g)
 
 /**
  * Tick function which decides whether to consume a packet (based on the
- * availability of a packet in the buffer and then a Bernoulli trial.
+ * availability of a packet in the buffer and then the temporal distribution).
  */
 void
 spinn_packet_con_tick(void *c_)
@@ -434,12 +1056,22 @@ spinn_packet_con_tick(void *c_)
 	
 	switch (c->temporal_dist) {
 		case SPINN_CT_DIST_BERNOULLI:
-			c->consume_packet = (((double)rand())/((double)RAND_MAX+1.0)) <= c->temporal_dist_data.bernoulli.prob;
+			c->consume_packet = scheduler_get_ticks(c->scheduler) >= c->temporal_dist_data.bernoulli.next_time;
+			
+			// A successful trial is used up even if there is nothing to consume. The
+			// next trial is scheduled here (rather than in the tock) since the tock
+			// does nothing when the buffer is empty.
+			if (c->consume_packet)
+				c->temporal_dist_data.bernoulli.next_time
+					= get_next_bernoulli_time( c->scheduler, &(c->rng), c->period
+					                         , c->temporal_dist_data.bernoulli.prob
+					                         , c->temporal_dist_data.bernoulli.log_1_minus_prob
+					                         , false
+					                         );
 			break;
 		
 		case SPINN_CT_DIST_PERIODIC:
-			c->consume_packet = c->temporal_dist_data.periodic.time_elapsed >= c->temporal_dist_data.periodic.interval - 1;
-			c->temporal_dist_data.periodic.time_elapsed++;
+			c->consume_packet = scheduler_get_ticks(c->scheduler) >= c->temporal_dist_data.periodic.next_time;
 			break;
 		
 		default:
@@ -466,7 +1098,7 @@ spinn_packet_con_tock(void *c_)
 		return;
 	
 	// Consume the packet
-	spinn_packet_t *p = buffer_pop(c->buffer);
+	spinn_packet_t *p = spinn_packet_pool_get_packet(c->pool, buffer_pop(c->buffer));
 	
 	// Run the callback
 	if (c->on_packet_con)
@@ -478,7 +1110,35 @@ spinn_packet_con_tock(void *c_)
 	// Reset the timer for the periodic temporal distribution as a packet has now
 	// been sent
 	if (c->temporal_dist == SPINN_CT_DIST_PERIODIC)
-		c->temporal_dist_data.periodic.time_elapsed = 0;
+		c->temporal_dist_data.periodic.next_time
+			= scheduler_get_ticks(c->scheduler)
+			  + (c->temporal_dist_data.periodic.interval * c->period);
+}
+
+/**
+ * Next activity function which reports when the next packet will be consumed
+ * (if known).
+ */
+ticks_t
+spinn_packet_con_next_activity(void *c_)
+{
+	spinn_packet_con_t *c = (spinn_packet_con_t *)c_;
+	
+	switch (c->temporal_dist) {
+		// Successful trials use the random number generator even when the buffer is
+		// empty and so must not be skipped
+		case SPINN_CT_DIST_BERNOULLI:
+			return c->temporal_dist_data.bernoulli.next_time;
+		
+		case SPINN_CT_DIST_PERIODIC:
+			if (buffer_is_empty(c->buffer))
+				return SCHEDULER_NEVER;
+			else
+				return c->temporal_dist_data.periodic.next_time;
+		
+		default:
+			return scheduler_get_ticks(c->scheduler);
+	}
 }
 
 void
@@ -492,16 +1152,21 @@ spinn_packet_con_init( spinn_packet_con_t      *c
                      )
 {
 	// Set up data-structure fields
+	c->scheduler          = s;
+	c->period             = period;
 	c->buffer             = b;
 	c->pool               = pool;
 	c->on_packet_con      = on_packet_con;
 	c->on_packet_con_data = on_packet_con_data;
 	
+	rng_init(&(c->rng), 0u, 0u);
+	
 	// Set up tick/tock functions
-	scheduler_schedule( s, period
-	                  , spinn_packet_con_tick, (void *)c
-	                  , spinn_packet_con_tock, (void *)c
-	                  );
+	scheduler_event_t *event = scheduler_schedule( s, period
+	                                             , spinn_packet_con_tick, (void *)c
+	                                             , spinn_packet_con_tock, (void *)c
+	                                             );
+	scheduler_set_next_activity(s, event, spinn_packet_con_next_activity, (void *)c);
 	
 	// Initially leave the distribution parameters undefined.
 }
@@ -514,6 +1179,13 @@ spinn_packet_con_set_temporal_dist_bernoulli( spinn_packet_con_t *c
 {
 	c->temporal_dist = SPINN_GT_DIST_BERNOULLI;
 	c->temporal_dist_data.bernoulli.prob = bernoulli_prob;
+	c->temporal_dist_data.bernoulli.log_1_minus_prob = log1p(-bernoulli_prob);
+	c->temporal_dist_data.bernoulli.next_time
+		= get_next_bernoulli_time( c->scheduler, &(c->rng), c->period
+		                         , bernoulli_prob
+		                         , c->temporal_dist_data.bernoulli.log_1_minus_prob
+		                         , true
+		                         );
 }
 
 
@@ -524,7 +1196,18 @@ spinn_packet_con_set_temporal_dist_periodic( spinn_packet_con_t *c
 {
 	c->temporal_dist = SPINN_GT_DIST_PERIODIC;
 	c->temporal_dist_data.periodic.interval = interval;
-	c->temporal_dist_data.periodic.time_elapsed = 0;
+	c->temporal_dist_data.periodic.next_time
+		= get_first_periodic_time(c->scheduler, c->period, interval);
+}
+
+
+void
+spinn_packet_con_set_seed( spinn_packet_con_t *c
+                         , uint64_t            seed
+                         , uint64_t            stream
+                         )
+{
+	rng_init(&(c->rng), seed, stream);
 }
 
 
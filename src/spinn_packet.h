@@ -7,10 +7,17 @@
 #ifndef SPINN_PACKET_H
 #define SPINN_PACKET_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+
 #include "config.h"
 
 #include "scheduler.h"
 #include "buffer.h"
+#include "rng.h"
+#include "alias_table.h"
 
 #include "spinn.h"
 
@@ -18,39 +25,226 @@
  * SpiNNaker Packets
  ******************************************************************************/
 
+/**
+ * The type of a packet, which determines how it is routed.
+ */
+typedef enum spinn_packet_type {
+	// Point-to-point packets are routed to a single destination node
+	SPINN_PACKET_P2P,
+	
+	// Multicast packets are routed (and replicated) by looking up their key in
+	// the routing table of each router they visit (see spinn_mc_table.h)
+	SPINN_PACKET_MC,
+} spinn_packet_type_t;
+
+
+/**
+ * The largest coordinate (in either dimension) which can be stored in a packet.
+ */
+#define SPINN_PACKET_MAX_COORD 255
+
+
 /**
  * A SpiNNaker packet.
+ *
+ * Packets are packed into 16 bytes (four to a cache line) as the router spends
+ * most of its time moving them about. The fields which are stored narrower than
+ * their natural type (coordinates, directions, states and the type) should be
+ * accessed using the accessor functions below.
  */
 typedef struct spinn_packet {
-	// The intended inflection point of the packet's route
-	spinn_coord_t     inflection_point;
-	spinn_direction_t inflection_direction;
-	
-	// The the location where the packet was injected
-	spinn_coord_t source;
+	// Time at which the packet was sent
+	ticks_t sent_time;
 	
-	// The intended destination of the packet
-	spinn_coord_t destination;
+	// For point-to-point packets, the intended destination and the inflection
+	// point of the packet's route. For multicast packets, the routing key.
+	union {
+		struct {
+			uint8_t destination_x, destination_y;
+			uint8_t inflection_x,  inflection_y;
+		} p2p;
+		uint32_t key;
+	} route;
 	
-	// The direction the packet is currently heading (specifically, the last
-	// output port the packet was sent via.
-	spinn_direction_t direction;
+	// The the location where the packet was injected
+	uint8_t source_x, source_y;
 	
-	// Emergency-routing state of the packet
-	spinn_emg_state_t emg_state;
+	// Bits 0-2: the direction the packet is currently heading (specifically, the
+	//           last output port the packet was sent via).
+	// Bits 3-5: the direction to take at the inflection point.
+	// Bits 6-7: the emergency-routing state of the packet.
+	uint8_t state;
 	
-	// Time at which the packet was sent
-	ticks_t sent_time;
+	// A spinn_packet_type_t
+	uint8_t type;
 	
 	// Number of hops (of which are emergency legs)
-	ticks_t num_hops;
-	ticks_t num_emg_hops;
-	
-	// Packet payload
-	void *payload;
+	uint16_t num_hops;
+	uint16_t num_emg_hops;
 } spinn_packet_t;
 
 
+/******************************************************************************
+ * Packet field accessors
+ ******************************************************************************/
+
+#define SPINN_PACKET_DIRECTION_SHIFT            0
+#define SPINN_PACKET_INFLECTION_DIRECTION_SHIFT 3
+#define SPINN_PACKET_EMG_STATE_SHIFT            6
+
+#define SPINN_PACKET_DIRECTION_MASK            (0x7u << SPINN_PACKET_DIRECTION_SHIFT)
+#define SPINN_PACKET_INFLECTION_DIRECTION_MASK (0x7u << SPINN_PACKET_INFLECTION_DIRECTION_SHIFT)
+#define SPINN_PACKET_EMG_STATE_MASK            (0x3u << SPINN_PACKET_EMG_STATE_SHIFT)
+
+static inline spinn_packet_type_t
+spinn_packet_get_type(const spinn_packet_t *p)
+{
+	return (spinn_packet_type_t)p->type;
+}
+
+static inline void
+spinn_packet_set_type(spinn_packet_t *p, spinn_packet_type_t type)
+{
+	p->type = (uint8_t)type;
+}
+
+
+/**
+ * The routing key of a multicast packet.
+ */
+static inline uint32_t
+spinn_packet_get_key(const spinn_packet_t *p)
+{
+	return p->route.key;
+}
+
+static inline void
+spinn_packet_set_key(spinn_packet_t *p, uint32_t key)
+{
+	p->route.key = key;
+}
+
+
+static inline spinn_coord_t
+spinn_packet_get_source(const spinn_packet_t *p)
+{
+	return (spinn_coord_t){p->source_x, p->source_y};
+}
+
+static inline void
+spinn_packet_set_source(spinn_packet_t *p, spinn_coord_t source)
+{
+	assert(source.x >= 0 && source.x <= SPINN_PACKET_MAX_COORD);
+	assert(source.y >= 0 && source.y <= SPINN_PACKET_MAX_COORD);
+	p->source_x = (uint8_t)source.x;
+	p->source_y = (uint8_t)source.y;
+}
+
+
+/**
+ * The destination of a point-to-point packet. Multicast packets have no single
+ * destination and so their source is given.
+ */
+static inline spinn_coord_t
+spinn_packet_get_destination(const spinn_packet_t *p)
+{
+	if (p->type == SPINN_PACKET_MC)
+		return spinn_packet_get_source(p);
+	else
+		return (spinn_coord_t){p->route.p2p.destination_x, p->route.p2p.destination_y};
+}
+
+static inline void
+spinn_packet_set_destination(spinn_packet_t *p, spinn_coord_t destination)
+{
+	assert(destination.x >= 0 && destination.x <= SPINN_PACKET_MAX_COORD);
+	assert(destination.y >= 0 && destination.y <= SPINN_PACKET_MAX_COORD);
+	p->route.p2p.destination_x = (uint8_t)destination.x;
+	p->route.p2p.destination_y = (uint8_t)destination.y;
+}
+
+
+/**
+ * The intended inflection point of a point-to-point packet's route. As with
+ * the destination, the source is given for multicast packets.
+ */
+static inline spinn_coord_t
+spinn_packet_get_inflection_point(const spinn_packet_t *p)
+{
+	if (p->type == SPINN_PACKET_MC)
+		return spinn_packet_get_source(p);
+	else
+		return (spinn_coord_t){p->route.p2p.inflection_x, p->route.p2p.inflection_y};
+}
+
+static inline void
+spinn_packet_set_inflection_point(spinn_packet_t *p, spinn_coord_t inflection_point)
+{
+	assert(inflection_point.x >= 0 && inflection_point.x <= SPINN_PACKET_MAX_COORD);
+	assert(inflection_point.y >= 0 && inflection_point.y <= SPINN_PACKET_MAX_COORD);
+	p->route.p2p.inflection_x = (uint8_t)inflection_point.x;
+	p->route.p2p.inflection_y = (uint8_t)inflection_point.y;
+}
+
+
+/**
+ * The direction the packet is currently heading (specifically, the last output
+ * port the packet was sent via).
+ */
+static inline spinn_direction_t
+spinn_packet_get_direction(const spinn_packet_t *p)
+{
+	return (spinn_direction_t)((p->state & SPINN_PACKET_DIRECTION_MASK)
+	                           >> SPINN_PACKET_DIRECTION_SHIFT);
+}
+
+static inline void
+spinn_packet_set_direction(spinn_packet_t *p, spinn_direction_t direction)
+{
+	p->state = (uint8_t)( (p->state & ~SPINN_PACKET_DIRECTION_MASK)
+	                    | ((unsigned int)direction << SPINN_PACKET_DIRECTION_SHIFT)
+	                    );
+}
+
+
+/**
+ * The direction a point-to-point packet should take at its inflection point.
+ */
+static inline spinn_direction_t
+spinn_packet_get_inflection_direction(const spinn_packet_t *p)
+{
+	return (spinn_direction_t)((p->state & SPINN_PACKET_INFLECTION_DIRECTION_MASK)
+	                           >> SPINN_PACKET_INFLECTION_DIRECTION_SHIFT);
+}
+
+static inline void
+spinn_packet_set_inflection_direction(spinn_packet_t *p, spinn_direction_t direction)
+{
+	p->state = (uint8_t)( (p->state & ~SPINN_PACKET_INFLECTION_DIRECTION_MASK)
+	                    | ((unsigned int)direction << SPINN_PACKET_INFLECTION_DIRECTION_SHIFT)
+	                    );
+}
+
+
+/**
+ * The emergency-routing state of the packet.
+ */
+static inline spinn_emg_state_t
+spinn_packet_get_emg_state(const spinn_packet_t *p)
+{
+	return (spinn_emg_state_t)((p->state & SPINN_PACKET_EMG_STATE_MASK)
+	                           >> SPINN_PACKET_EMG_STATE_SHIFT);
+}
+
+static inline void
+spinn_packet_set_emg_state(spinn_packet_t *p, spinn_emg_state_t emg_state)
+{
+	p->state = (uint8_t)( (p->state & ~SPINN_PACKET_EMG_STATE_MASK)
+	                    | ((unsigned int)emg_state << SPINN_PACKET_EMG_STATE_SHIFT)
+	                    );
+}
+
+
 /**
  * Convenience function. Initialise a spinn_packet_t with the appropriate values
  * to cause it to be dimension-order routed from the source to destination locations
@@ -58,7 +252,8 @@ typedef struct spinn_packet {
  * expected of a new packet.
  *
  * The use_wrap_around_links is a bool which sets whether the wrap around links
- * should be used or not.
+ * should be used or not. Where several routes around a torus are equally short,
+ * one is chosen at random using the given generator.
  *
  * Note: Does not set the sent_time field.
  */
@@ -67,10 +262,39 @@ void spinn_packet_init_dor( spinn_packet_t *packet
                           , spinn_coord_t   destination
                           , spinn_coord_t   system_size
                           , bool            use_wrap_around_links
-                          , void           *payload
+                          , rng_t          *rng
                           );
 
 
+/**
+ * Convenience function. Initialise a spinn_packet_t to be sent from the source
+ * to the destination without computing a dimension-order route. Such packets
+ * may only be routed by routers with a routing table (see
+ * spinn_router_set_routing_table). Also resets all other fields to the values
+ * expected of a new packet.
+ *
+ * Note: Does not set the sent_time field.
+ */
+void spinn_packet_init( spinn_packet_t *packet
+                      , spinn_coord_t   source
+                      , spinn_coord_t   destination
+                      );
+
+
+/**
+ * Convenience function. Initialise a multicast spinn_packet_t with the given
+ * routing key sent from the source. The destination is set to the source (a
+ * multicast packet may arrive at any number of nodes). Also resets all other
+ * fields to the values expected of a new packet.
+ *
+ * Note: Does not set the sent_time field.
+ */
+void spinn_packet_init_mc( spinn_packet_t *packet
+                         , spinn_coord_t   source
+                         , uint32_t        key
+                         );
+
+
 
 /******************************************************************************
  * Utility function datatypes
@@ -82,6 +306,16 @@ void spinn_packet_init_dor( spinn_packet_t *packet
 typedef struct spinn_packet_pool spinn_packet_pool_t;
 
 
+/**
+ * A reference to a packet allocated from a spinn_packet_pool_t, as held in a
+ * buffer_t. Normally this is simply a pointer to the packet but when
+ * configured with --enable-packet-handles it is the packet's 32-bit index in
+ * its pool. Handles are converted to and from pointers using
+ * spinn_packet_pool_get_packet and spinn_packet_pool_get_handle.
+ */
+typedef buffer_value_t spinn_packet_handle_t;
+
+
 /**
  * The internal data-structure of a packet generator.
  */
@@ -103,11 +337,73 @@ typedef struct spinn_packet_con spinn_packet_con_t;
  ******************************************************************************/
 
 /**
- * Create a packet pool.
+ * The huge page size assumed when a packet pool is asked to use huge pages.
+ */
+#define SPINN_PACKET_POOL_HUGE_PAGE_BYTES (2*1024*1024)
+
+
+/**
+ * Create a packet pool. The pool is initially empty and grows (roughly
+ * doubling in size) whenever it runs out of packets.
  */
 void spinn_packet_pool_init(spinn_packet_pool_t *pool);
 
 
+/**
+ * Create a local packet pool for use by a single thread. A local pool keeps its
+ * own stack of free packets which it refills from (and, when it holds two
+ * batches, returns one batch to) its owner in batches of batch_size packets.
+ * The owner is only locked once per batch and so a thread may allocate and
+ * free packets without contention. Packets may be freed to a different local
+ * pool (i.e. in another thread) than the one they were allocated from. Note
+ * that the free packets cached by a local pool (up to two batches) are not
+ * available to other threads, which matters if the owner has a maximum size.
+ *
+ * Once local pools are in use, the owner should only be used via local pools
+ * (or while no local pool is in use). The owner may grow (under its lock) while
+ * other threads use its packets: when configured with --enable-packet-handles
+ * the owner adds chunks of packets, each twice the size of the last, and never
+ * moves existing ones and so every handle and pointer remains valid.
+ *
+ * Destroying a local pool returns its free packets to its owner, which must be
+ * destroyed after all of its local pools.
+ */
+void spinn_packet_pool_init_local( spinn_packet_pool_t *pool
+                                 , spinn_packet_pool_t *owner
+                                 , size_t               batch_size
+                                 );
+
+
+/**
+ * Place packets subsequently added to the pool (e.g. by
+ * spinn_packet_pool_reserve) in huge pages. Explicitly reserved huge pages are
+ * used if available, otherwise transparent huge pages are requested for
+ * huge-page-aligned memory.
+ */
+void spinn_packet_pool_set_use_huge_pages( spinn_packet_pool_t *pool
+                                         , bool                 use_huge_pages
+                                         );
+
+
+/**
+ * Grow the pool, in a single step, to hold at least num_packets packets. This
+ * avoids the pool having to grow repeatedly while a simulation runs.
+ */
+void spinn_packet_pool_reserve( spinn_packet_pool_t *pool
+                              , size_t               num_packets
+                              );
+
+
+/**
+ * Limit the size to which the pool may grow when it runs out of packets (0, the
+ * default, for no limit). Once the limit is reached, spinn_packet_pool_palloc
+ * returns NULL. Does not limit spinn_packet_pool_reserve.
+ */
+void spinn_packet_pool_set_max_packets( spinn_packet_pool_t *pool
+                                      , size_t               max_packets
+                                      );
+
+
 /**
  * Recover the memory used by a packet pool and the packets it created.
  */
@@ -115,13 +411,52 @@ void spinn_packet_pool_destroy(spinn_packet_pool_t *pool);
 
 
 /**
- * Get the current size of the packet pool in packets.
+ * Get the current size of the packet pool in packets (always zero for local
+ * pools which own no packets).
  */
 int spinn_packet_pool_get_num_packets(spinn_packet_pool_t *pool);
 
 
 /**
- * Get an uninitialised packet from the pool.
+ * Get the memory used by the packet pool in bytes (the packets and the stack
+ * of free packets).
+ */
+size_t spinn_packet_pool_get_num_bytes(spinn_packet_pool_t *pool);
+
+
+/**
+ * Get the number of times the packet pool has had to grow.
+ */
+int spinn_packet_pool_get_num_growths(spinn_packet_pool_t *pool);
+
+
+/**
+ * Get the number of allocations which failed because the pool had reached its
+ * maximum size.
+ */
+int spinn_packet_pool_get_num_exhausted(spinn_packet_pool_t *pool);
+
+
+/**
+ * Get the number of free packets held by the pool (for a local pool, the
+ * packets cached by its thread).
+ */
+int spinn_packet_pool_get_num_free(spinn_packet_pool_t *pool);
+
+
+/**
+ * Get the number of packets allocated from the pool less the number freed to
+ * it. For a pool used directly this is the number of packets in use. For local
+ * pools this is the net number of packets allocated by its thread and may be
+ * negative if the thread frees packets allocated by others.
+ */
+int spinn_packet_pool_get_num_in_use(spinn_packet_pool_t *pool);
+
+
+/**
+ * Get an uninitialised packet from the pool or NULL if the pool has reached
+ * its maximum size (see spinn_packet_pool_set_max_packets).
+
  */
 spinn_packet_t *spinn_packet_pool_palloc(spinn_packet_pool_t *pool);
 
@@ -131,6 +466,49 @@ spinn_packet_t *spinn_packet_pool_palloc(spinn_packet_pool_t *pool);
  */
 void spinn_packet_pool_pfree(spinn_packet_pool_t *pool, spinn_packet_t *packet);
 
+
+/**
+ * Get the handle of a packet allocated from the pool.
+ */
+static inline spinn_packet_handle_t
+spinn_packet_pool_get_handle(spinn_packet_pool_t *pool, spinn_packet_t *packet)
+{
+#ifdef USE_PACKET_HANDLES
+	// Find the chunk containing the packet, largest (and so most likely) first
+	spinn_packet_pool_t *owner = pool->owner;
+	int chunk = __atomic_load_n(&(owner->num_chunks), __ATOMIC_ACQUIRE) - 1;
+	for (; chunk > 0; chunk--) {
+		uintptr_t offset = (uintptr_t)packet - (uintptr_t)owner->chunks[chunk];
+		if (offset < (sizeof(spinn_packet_t) << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + chunk)))
+			break;
+	}
+	return (spinn_packet_handle_t)( (packet - owner->chunks[chunk])
+	                              + ((1u << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + chunk))
+	                                 - (1u << SPINN_PACKET_POOL_FIRST_CHUNK_BITS))
+	                              );
+#else
+	return (spinn_packet_handle_t)packet;
+#endif
+}
+
+
+/**
+ * Get the packet referred to by a handle.
+ */
+static inline spinn_packet_t *
+spinn_packet_pool_get_packet(spinn_packet_pool_t *pool, spinn_packet_handle_t handle)
+{
+#ifdef USE_PACKET_HANDLES
+	// Offsetting the handle by the size of the first chunk makes its most
+	// significant bit select the chunk
+	uint32_t index = handle + (1u << SPINN_PACKET_POOL_FIRST_CHUNK_BITS);
+	int chunk = (31 - __builtin_clz(index)) - SPINN_PACKET_POOL_FIRST_CHUNK_BITS;
+	return &(pool->owner->chunks[chunk][index - (1u << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + chunk))]);
+#else
+	return (spinn_packet_t *)handle;
+#endif
+}
+
 /******************************************************************************
  * Packet generators
  ******************************************************************************/
@@ -156,11 +534,10 @@ void spinn_packet_pool_pfree(spinn_packet_pool_t *pool, spinn_packet_t *packet);
  * @param dest_filter_data A pointed to be passed to dest_filter.
  *
  * @param on_packet_gen Is a function called during the tock phase just after
- *                      packet creation but before it is sent. The value
- *                      returned is set as the packet payload. If NULL, the
- *                      callback is disabled. If the output is blocked but a
- *                      packet would have been generated if it wasnt, the value
- *                      of packet is NULL.
+ *                      packet creation but before it is sent. If NULL, the
+ *                      callback is disabled. If the output is blocked (or the
+ *                      packet pool is exhausted) but a packet would have been
+ *                      generated if it wasnt, the value of packet is NULL.
  * @param on_packet_gen_data A pointer passed to the on_packet_gen function.
  */
 void spinn_packet_gen_init( spinn_packet_gen_t  *gen
@@ -173,7 +550,7 @@ void spinn_packet_gen_init( spinn_packet_gen_t  *gen
                           , bool                 use_wrap_around_links
                           , bool (*dest_filter)(const spinn_coord_t *proposed_destination, void *data)
                           , void *dest_filter_data
-                          , void *(*on_packet_gen)(spinn_packet_t *packet, void *data)
+                          , void (*on_packet_gen)(spinn_packet_t *packet, void *data)
                           , void *on_packet_gen_data
                           );
 
@@ -182,6 +559,12 @@ void spinn_packet_gen_init( spinn_packet_gen_t  *gen
  * Set up the packet generator to use the given Bernoulli distribution to decide
  * when to generate packets.
  *
+ * Rather than a trial being made every period, the number of periods until the
+ * next success is drawn from the equivalent geometric distribution each time a
+ * packet is generated. The generator is idle (and reports its next injection
+ * time to the scheduler) in between. A trial whose packet could not be sent
+ * because the output was full is still used up.
+ *
  * This should be called outside of the simulation tick/tock phases for
  * deterministic behaviour.
  */
@@ -264,6 +647,70 @@ void spinn_packet_gen_set_spatial_dist_tornado(spinn_packet_gen_t *packet_gen);
  */
 void spinn_packet_gen_set_spatial_dist_cyclic(spinn_packet_gen_t *packet_gen);
 
+
+/**
+ * Set up the packet generator to pick destinations from a weighted list, e.g.
+ * of only those nodes which may receive packets or with some nodes (hotspots)
+ * favoured. Destination i is picked with the probability of entry i in the
+ * alias table in constant time. Destinations rejected by the destination
+ * filter are picked again.
+ *
+ * The table and destinations are not copied (and so may be shared by many
+ * generators) and must remain valid while the distribution is in use.
+ *
+ * @param table An alias table with one entry per destination.
+ * @param destinations The destination of each table entry.
+ * @param relative If true, destinations are offsets from the generator's
+ *                 position, wrapping around the edges of the system, e.g. to
+ *                 favour nearby nodes. Offsets must be non-negative.
+ *
+ * This should be called outside of the simulation tick/tock phases for
+ * deterministic behaviour.
+ */
+void spinn_packet_gen_set_spatial_dist_table( spinn_packet_gen_t  *packet_gen
+                                            , const alias_table_t *table
+                                            , const spinn_coord_t *destinations
+                                            , bool                 relative
+                                            );
+
+
+/**
+ * Set up the packet generator to send multicast packets rather than packets to
+ * a particular destination. The keys of successive packets cycle through
+ * base_key, base_key+1, ..., base_key+num_keys-1.
+ *
+ * This should be called outside of the simulation tick/tock phases for
+ * deterministic behaviour.
+ */
+void spinn_packet_gen_set_spatial_dist_multicast( spinn_packet_gen_t *packet_gen
+                                                , uint32_t            base_key
+                                                , uint32_t            num_keys
+                                                );
+
+
+/**
+ * Set whether the packet generator computes a dimension-order route for each
+ * packet it generates (the default). If disabled, packets are initialised with
+ * spinn_packet_init and must be routed by routers with a routing table.
+ *
+ * This should be called outside of the simulation tick/tock phases for
+ * deterministic behaviour.
+ */
+void spinn_packet_gen_set_dor_routing( spinn_packet_gen_t *packet_gen
+                                     , bool                dor_routing
+                                     );
+
+
+/**
+ * Seed the packet generator's random number generator (see rng_init). Unless
+ * set, every generator uses the same seed and stream. Should be called before
+ * setting the temporal distribution as this draws the time of the first packet.
+ */
+void spinn_packet_gen_set_seed( spinn_packet_gen_t *packet_gen
+                              , uint64_t            seed
+                              , uint64_t            stream
+                              );
+
 /**
  * Free the resources used by a packet generator.
  */
@@ -304,6 +751,10 @@ void spinn_packet_con_init( spinn_packet_con_t  *con
  * Set up the packet consumer to use the given Bernoulli distribution to decide
  * when to consume packets.
  *
+ * As for the generator, the number of periods until the next successful trial
+ * is drawn from a geometric distribution. A successful trial at an empty buffer
+ * is used up.
+ *
  * This should be called outside of the simulation tick/tock phases for
  * deterministic behaviour.
  */
@@ -326,6 +777,17 @@ void spinn_packet_con_set_temporal_dist_periodic( spinn_packet_con_t *packet_con
                                                 );
 
 
+/**
+ * Seed the packet consumer's random number generator (see rng_init). Unless
+ * set, every consumer uses the same seed and stream. Should be called before
+ * setting the temporal distribution as this draws the time of the first packet.
+ */
+void spinn_packet_con_set_seed( spinn_packet_con_t *packet_con
+                              , uint64_t            seed
+                              , uint64_t            stream
+                              );
+
+
 /**
  * Free the resources used by a packet consumer.
  */
@@ -8,28 +8,82 @@
  */
 
 
+/**
+ * When configured with --enable-packet-handles, packets are held in chunks
+ * which never move. Chunk k holds (1 << (SPINN_PACKET_POOL_FIRST_CHUNK_BITS + k))
+ * packets and handles number the packets consecutively through the chunks.
+ * Handles must fit in 32 bits which limits the number of chunks.
+ */
+#define SPINN_PACKET_POOL_FIRST_CHUNK_BITS 6
+#define SPINN_PACKET_POOL_MAX_CHUNKS (32 - SPINN_PACKET_POOL_FIRST_CHUNK_BITS)
+
+
 /**
  * A linked list of pools of packets.
  */
 typedef struct spinn_packet_sub_pool {
 	spinn_packet_t               *packets;
+	size_t                        num_packets;
+	bool                          mapped;
 	struct spinn_packet_sub_pool *next;
 } spinn_packet_sub_pool_t;
 
 
 struct spinn_packet_pool {
+	// The pool which owns the packets: this pool unless it is a local pool (see
+	// spinn_packet_pool_init_local) in which case packets are taken from and
+	// returned to the owner in batches of batch_size.
+	spinn_packet_pool_t *owner;
+	size_t               batch_size;
+	
+	// Protects a pool used by local pools in several threads
+	pthread_mutex_t lock;
+
+#ifdef USE_PACKET_HANDLES
+	// The chunks of packets allocated so far (see
+	// SPINN_PACKET_POOL_FIRST_CHUNK_BITS). Chunks are never moved so threads may
+	// use their packets while the pool grows. num_chunks is published
+	// atomically since it is read without the lock by
+	// spinn_packet_pool_get_handle.
+	spinn_packet_t *chunks[SPINN_PACKET_POOL_MAX_CHUNKS];
+	bool            chunks_mapped[SPINN_PACKET_POOL_MAX_CHUNKS];
+	int             num_chunks;
+	
+	// The number of packets the allocated chunks can hold (which may exceed
+	// num_packets, the remainder being added by later growth)
+	size_t capacity;
+#else
 	// A linked list of pointers to arrays of packets. Only used to free all
 	// memory.
 	spinn_packet_sub_pool_t *sub_pools;
+#endif
 	
-	// A stack of pointers to free packets.
-	spinn_packet_t **free_packets;
+	// A stack of handles of free packets.
+	spinn_packet_handle_t *free_packets;
 	
-	// A pointer to top-most packet pointer in the free packet stack
-	spinn_packet_t **free_packets_head;
+	// A pointer to top-most packet handle in the free packet stack
+	spinn_packet_handle_t *free_packets_head;
 	
-	// The size of the free packet stack (also the total number of packets in the pool)
+	// The end of the space allocated for the free packet stack
+	spinn_packet_handle_t *free_packets_end;
+	
+	// The total number of packets in the pool (zero for local pools)
 	size_t num_packets;
+	
+	// The number of packets allocated and freed via this pool
+	int num_pallocs;
+	int num_pfrees;
+	
+	// The number of times the pool has been grown
+	int num_growths;
+	
+	// The size the pool may grow to on demand (0 if unlimited) and the number of
+	// allocations refused as a result.
+	size_t max_packets;
+	int    num_exhausted;
+	
+	// Should new packets be placed in huge pages (where available)?
+	bool use_huge_pages;
 };
 
 
@@ -40,6 +94,8 @@ typedef enum spinn_packet_gen_spatial_dist {
 	SPINN_GS_DIST_COMPLEMENT,
 	SPINN_GS_DIST_TRANSPOSE,
 	SPINN_GS_DIST_TORNADO,
+	SPINN_GS_DIST_MULTICAST,
+	SPINN_GS_DIST_TABLE,
 } spinn_packet_gen_spatial_dist_t;
 
 
@@ -67,12 +123,23 @@ struct spinn_packet_gen {
 	// Should wrap-around links be used?
 	bool use_wrap_around_links;
 	
+	// Should a dimension-order route be computed for each packet? If not, the
+	// packets must be routed by routers with routing tables.
+	bool dor_routing;
+	
+	// The period with which the generator is scheduled
+	ticks_t period;
+	
 	// Should a packet be sent during the tock phase?
 	bool send_packet;
 	
 	// Is the output buffer full (i.e. should sending a packet fail?)?
 	bool output_blocked;
 	
+	// The generator's own source of randomness (for the temporal and uniform
+	// spatial distributions and for tie-breaking dimension-order routes)
+	rng_t rng;
+	
 	// Callback to filter packet destinations
 	bool (*dest_filter)(const spinn_coord_t *proposed_destination, void *data);
 	void *dest_filter_data;
@@ -97,6 +164,21 @@ struct spinn_packet_gen {
 			spinn_coord_t target;
 		} p2p;
 		
+		// Multicast packet generator data (the key of the next packet is
+		// base_key+next_key)
+		struct {
+			uint32_t base_key;
+			uint32_t num_keys;
+			uint32_t next_key;
+		} multicast;
+		
+		// Weighted destination table data (shared with other generators)
+		struct {
+			const alias_table_t *table;
+			const spinn_coord_t *destinations;
+			bool                 relative;
+		} table;
+	
 	} spatial_dist_data;
 	
 	// The temporal distribution to use when generating packets.
@@ -108,18 +190,26 @@ struct spinn_packet_gen {
 		// Bernoulli distribution
 		struct {
 			double prob;
+			
+			// log(1-prob) for sampling the gap between successful trials
+			double log_1_minus_prob;
+			
+			// The time (in ticks) of the next successful trial
+			ticks_t next_time;
 		} bernoulli;
 		
 		// Periodic distribution
 		struct {
 			int interval;
-			int time_elapsed;
+			
+			// The time (in ticks) from which the next packet is due
+			ticks_t next_time;
 		} periodic;
-		
+	
 	} temporal_dist_data;
 	
 	// Callback on packet create/send
-	void *(*on_packet_gen)(spinn_packet_t *packet, void *data);
+	void (*on_packet_gen)(spinn_packet_t *packet, void *data);
 	void *on_packet_gen_data;
 };
 
@@ -132,6 +222,12 @@ typedef enum spinn_packet_con_temporal_dist {
 
 
 struct spinn_packet_con {
+	// The scheduler which drives the packet consumer
+	scheduler_t *scheduler;
+	
+	// The period with which the consumer is scheduled
+	ticks_t period;
+	
 	// The buffer from which packets will be consumed
 	buffer_t *buffer;
 	
@@ -141,6 +237,9 @@ struct spinn_packet_con {
 	// Should a packet be consumed during the tock phase?
 	bool consume_packet;
 	
+	// The consumer's own source of randomness
+	rng_t rng;
+	
 	// The temporal distribution to use when generating packets.
 	spinn_packet_con_temporal_dist_t temporal_dist;
 	
@@ -150,14 +249,22 @@ struct spinn_packet_con {
 		// Bernoulli distribution
 		struct {
 			double prob;
+			
+			// log(1-prob) for sampling the gap between successful trials
+			double log_1_minus_prob;
+			
+			// The time (in ticks) of the next successful trial
+			ticks_t next_time;
 		} bernoulli;
 		
 		// Periodic distribution
 		struct {
 			int interval;
-			int time_elapsed;
+			
+			// The time (in ticks) from which the next packet is due
+			ticks_t next_time;
 		} periodic;
-		
+	
 	} temporal_dist_data;
 	
 	// Callback on packet consumption
@@ -31,75 +31,281 @@
 
 /**
  * Work out which port the packet should be sent from, assuming that it is being
- * routed normally.
+ * routed normally. A packet returning to its route after an emergency detour
+ * (i.e. in SPINN_EMG_SECOND_LEG) is at the node it would have reached without
+ * the detour so when using a routing table it is simply routed normally.
  */
 spinn_direction_t
 get_packet_output_direction(spinn_router_t *r, spinn_packet_t *p)
 {
+	spinn_coord_t destination = spinn_packet_get_destination(p);
+	
+	// Look up the direction in the routing table, if present
+	if (r->routing_table != NULL)
+		return (spinn_direction_t)r->routing_table[ (destination.y * r->routing_table_width)
+		                                            + destination.x];
+	
 	// Except at the inflection point and endpoint, just keep moving in the same
 	// direction
-	if ( r->position.x == p->destination.x &&
-	     r->position.y == p->destination.y)
+	spinn_coord_t inflection_point = spinn_packet_get_inflection_point(p);
+	if ( r->position.x == destination.x &&
+	     r->position.y == destination.y)
 		return SPINN_LOCAL;
-	else if ( r->position.x == p->inflection_point.x &&
-	          r->position.y == p->inflection_point.y)
-		return p->inflection_direction;
-	else if (p->emg_state == SPINN_EMG_SECOND_LEG)
-		return spinn_next_cw(p->direction);
+	else if ( r->position.x == inflection_point.x &&
+	          r->position.y == inflection_point.y)
+		return spinn_packet_get_inflection_direction(p);
+	else if (spinn_packet_get_emg_state(p) == SPINN_EMG_SECOND_LEG)
+		return spinn_next_cw(spinn_packet_get_direction(p));
 	else
-		return p->direction;
+		return spinn_packet_get_direction(p);
 }
 
 
-void
-spinn_router_tick(void *r_)
+/**
+ * Internal function.
+ *
+ * The multicast equivalent of route_packet. Sets the outputs the packet will be
+ * sent to and whether it should be forwarded or dropped (or neither, if it must
+ * wait) in the next tock. The packet is counted as a table hit or as default
+ * routed only the first time it is considered (i.e. when time_elapsed is zero).
+ */
+static void
+route_mc_packet( spinn_router_t *r
+               , spinn_packet_t *p
+               , int             time_elapsed
+               , unsigned int   *selected_mc_route
+               , bool           *forward_packet
+               , bool           *drop_packet
+               )
 {
-	spinn_router_t *r = (spinn_router_t *)r_;
+	unsigned int route;
+	spinn_direction_t direction = spinn_packet_get_direction(p);
+	if (spinn_mc_table_lookup(r->mc_table, spinn_packet_get_key(p), &route)) {
+		if (time_elapsed == 0)
+			r->mc_counters.table_hits++;
+	} else if (direction != SPINN_LOCAL) {
+		// Default route: continue in the same direction
+		route = 1u << direction;
+		if (time_elapsed == 0)
+			r->mc_counters.default_routed++;
+	} else {
+		// Locally injected packets which match nothing cannot be routed
+		route = 0u;
+	}
+	*selected_mc_route = route;
 	
-	// If there is packet to route or drop, do so
-	if (r->pipeline[r->num_pipeline_stages-1].valid) {
-		spinn_packet_t *p = r->pipeline[r->num_pipeline_stages-1].data;
+	// All outputs must be able to accept the packet
+	bool blocked = false;
+	for (int i = 0; i < 7; i++)
+		if ((route & (1u << i)) && buffer_is_full(r->outputs[i])) {
+			blocked = true;
+			r->stall_counters.output_full[i]++;
+		}
+	
+	*forward_packet = route != 0u && !blocked;
+	*drop_packet    = route == 0u || (blocked && time_elapsed >= r->first_timeout);
+	
+	if (!*forward_packet && !*drop_packet)
+		r->stall_counters.stalled++;
+}
+
+
+/**
+ * Internal function.
+ *
+ * Decide what to do with the packet at the end of a router's pipeline which
+ * has been waiting for time_elapsed router periods. Sets the direction and
+ * emergency routing state the packet will be forwarded with and whether it
+ * should be forwarded or dropped (or neither, if it must wait) in the next
+ * tock.
+ */
+static void
+route_packet( spinn_router_t    *r
+            , spinn_packet_t    *p
+            , int                time_elapsed
+            , spinn_direction_t *selected_output_direction
+            , unsigned int      *selected_mc_route
+            , spinn_emg_state_t *cur_packet_emg_state
+            , bool              *forward_packet
+            , bool              *drop_packet
+            )
+{
+	if (r->mc_table != NULL && spinn_packet_get_type(p) == SPINN_PACKET_MC) {
+		*cur_packet_emg_state = SPINN_EMG_NORMAL;
+		route_mc_packet( r, p, time_elapsed
+		               , selected_mc_route
+		               , forward_packet
+		               , drop_packet
+		               );
+		return;
+	}
+	*selected_mc_route = 0u;
+	
+	// Find out the intended direction and emergency mode of the packet
+	spinn_emg_state_t emg_state = spinn_packet_get_emg_state(p);
+	switch (emg_state) {
+		case SPINN_EMG_NORMAL:
+		case SPINN_EMG_SECOND_LEG:
+			*selected_output_direction = get_packet_output_direction(r, p);
+			if (r->use_emg_routing && time_elapsed >= r->first_timeout) {
+				*cur_packet_emg_state      = SPINN_EMG_FIRST_LEG;
+				*selected_output_direction = spinn_next_cw(*selected_output_direction);
+			} else {
+				*cur_packet_emg_state = SPINN_EMG_NORMAL;
+			}
+			break;
 		
-		// Find out the intended direction and emergency mode of the packet
-		switch (p->emg_state) {
-			case SPINN_EMG_NORMAL:
-			case SPINN_EMG_SECOND_LEG:
-				r->selected_output_direction = get_packet_output_direction(r, p);
-				if (r->use_emg_routing && r->time_elapsed >= r->first_timeout) {
-					r->cur_packet_emg_state      = SPINN_EMG_FIRST_LEG;
-					r->selected_output_direction = spinn_next_cw(r->selected_output_direction);
-				} else {
-					r->cur_packet_emg_state = SPINN_EMG_NORMAL;
+		case SPINN_EMG_FIRST_LEG:
+			*cur_packet_emg_state = SPINN_EMG_SECOND_LEG;
+			*selected_output_direction = spinn_next_cw(spinn_opposite(spinn_packet_get_direction(p)));
+			break;
+	}
+	
+	*forward_packet = false;
+	*drop_packet    = false;
+	
+	if (!buffer_is_full(r->outputs[*selected_output_direction])) {
+		// Is the output available? Forward the packet to this port!
+		*forward_packet = true;
+	} else if (!r->use_emg_routing &&
+	           emg_state != SPINN_EMG_FIRST_LEG &&
+	           time_elapsed >= r->first_timeout) {
+		// Drop the packet as emergency routing is disabled and it has timed out
+		*drop_packet = true;
+	} else if ( (emg_state == SPINN_EMG_FIRST_LEG &&
+	             time_elapsed > r->first_timeout) ||
+	           time_elapsed >= r->first_timeout + r->final_timeout){
+		// TODO: Drop the timed-out emergency routed packet
+		*drop_packet = true;
+	}
+	
+	if (!*forward_packet) {
+		r->stall_counters.output_full[*selected_output_direction]++;
+		if (!*drop_packet)
+			r->stall_counters.stalled++;
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Forward or drop a packet removed from the end of a router's pipeline as
+ * decided by route_packet.
+ */
+static void
+send_packet( spinn_router_t        *r
+           , spinn_packet_handle_t  handle
+           , spinn_direction_t      selected_output_direction
+           , unsigned int           selected_mc_route
+           , spinn_emg_state_t      cur_packet_emg_state
+           , bool                   forward_packet
+           , bool                   drop_packet
+           )
+{
+	spinn_packet_t *p = spinn_packet_pool_get_packet(r->pool, handle);
+	
+	if (forward_packet && selected_mc_route != 0u) {
+		// Send a multicast packet to every selected output, sending copies to all
+		// but the last
+		for (int i = 0; i < 7; i++) {
+			if (!(selected_mc_route & (1u << i)))
+				continue;
+			selected_mc_route &= ~(1u << i);
+			
+			spinn_packet_t *copy = p;
+			if (selected_mc_route != 0u) {
+				// If the pool is exhausted, this output is not sent a copy
+				copy = spinn_packet_pool_palloc(r->pool);
+				if (copy == NULL) {
+					r->mc_counters.copies_lost++;
+					continue;
 				}
-				break;
+				
+				*copy = *p;
+				r->mc_counters.copies++;
+			}
 			
-			case SPINN_EMG_FIRST_LEG:
-				r->cur_packet_emg_state = SPINN_EMG_SECOND_LEG;
-				r->selected_output_direction = spinn_next_cw(spinn_opposite(p->direction));
-				break;
+			spinn_packet_set_direction(copy, (spinn_direction_t)i);
+			copy->num_hops++;
+			buffer_push(r->outputs[i], spinn_packet_pool_get_handle(r->pool, copy));
+			
+			if (r->on_forward != NULL)
+				r->on_forward(r, copy, r->on_forward_data);
 		}
+	} else if (forward_packet) {
+		// Set the packet flags
+		spinn_packet_set_direction(p, selected_output_direction);
+		spinn_packet_set_emg_state(p, cur_packet_emg_state);
 		
-		r->forward_packet = false;
-		r->drop_packet    = false;
-		
-		if (!buffer_is_full(r->outputs[r->selected_output_direction])) {
-			// Is the output available? Forward the packet to this port!
-			r->forward_packet = true;
-		} else if (!r->use_emg_routing &&
-		           p->emg_state != SPINN_EMG_FIRST_LEG &&
-		           r->time_elapsed >= r->first_timeout) {
-			// Drop the packet as emergency routing is disabled and it has timed out
-			r->drop_packet = true;
-		} else if ( (p->emg_state == SPINN_EMG_FIRST_LEG &&
-		             r->time_elapsed > r->first_timeout) ||
-		           r->time_elapsed >= r->first_timeout + r->final_timeout){
-			// TODO: Drop the timed-out emergency routed packet
-			r->drop_packet = true;
+		// Update the counters
+		p->num_hops++;
+		if (cur_packet_emg_state == SPINN_EMG_FIRST_LEG) {
+			p->num_emg_hops++;
+			r->stall_counters.emg_routed++;
 		}
+		
+		// Forward the current packet to the output
+		buffer_push(r->outputs[selected_output_direction], handle);
+		
+		// Raise the forwarding callback
+		if (r->on_forward != NULL)
+			r->on_forward(r, p, r->on_forward_data);
+	} else if (drop_packet && r->on_drop != NULL) {
+		// Drop the packet (just call the callback)
+		r->on_drop(r, p, r->on_drop_data);
 	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Advance a pipeline given the mask of its occupied stages, returning the new
+ * mask. Each packet moves forward one stage if the stage ahead of it is empty
+ * or is itself moving forward. That is, every stage below the last empty stage
+ * moves forward one stage and those after it (which are all occupied) stay put.
+ * Since packets never overtake each other, the packets themselves need not be
+ * moved.
+ */
+static inline unsigned int
+advance_pipeline(unsigned int valid, int num_pipeline_stages)
+{
+	// The stages (other than the first) which are empty
+	unsigned int empty = ~valid & (((1u << (num_pipeline_stages-1)) - 1u) << 1);
+	if (empty == 0u)
+		return valid;
+	
+	// Shift every stage below the last empty stage forward by one
+	int last_empty = (sizeof(unsigned int) * 8) - 1 - __builtin_clz(empty);
+	unsigned int moving = (1u << last_empty) - 1u;
+	return (valid & ~((moving << 1) | 1u)) | ((valid & moving) << 1);
+}
+
+
+void
+spinn_router_tick(void *r_)
+{
+	spinn_router_t *r = (spinn_router_t *)r_;
+	
+	// If there is packet to route or drop, do so
+	if (r->pipeline_valid & (1u << (r->num_pipeline_stages-1)))
+		route_packet( r, spinn_packet_pool_get_packet(r->pool, buffer_peek(&(r->pipeline)))
+		            , r->time_elapsed
+		            , &(r->selected_output_direction)
+		            , &(r->selected_mc_route)
+		            , &(r->cur_packet_emg_state)
+		            , &(r->forward_packet)
+		            , &(r->drop_packet)
+		            );
 	
 	// If a packet is available it may be possible to add it to the pipeline
 	r->accept_packet = !buffer_is_empty(r->input);
+	
+	// If there are no packets in the pipeline or waiting to enter it, there is
+	// nothing to do until one arrives.
+	if (!r->accept_packet && r->pipeline_valid == 0u)
+		scheduler_sleep(r->event);
 }
 
 
@@ -108,8 +314,10 @@ spinn_router_tock(void *r_)
 {
 	spinn_router_t *r = (spinn_router_t *)r_;
 	
+	unsigned int last_stage = 1u << (r->num_pipeline_stages-1);
+	
 	// Deal with sending of packets
-	if (!r->pipeline[r->num_pipeline_stages-1].valid) {
+	if (!(r->pipeline_valid & last_stage)) {
 		// No packet at the end of the pipeline: do nothing
 	} else if (!r->forward_packet && !r->drop_packet) {
 		// If no forwarding/dropping to do, just advance the clock
@@ -117,50 +325,177 @@ spinn_router_tock(void *r_)
 	} else {
 		// Grab the packet from the end of the pipeline (and invalidate the value
 		// there to allow the pipeline to advance)
-		spinn_packet_t *p = r->pipeline[r->num_pipeline_stages-1].data;
-		r->pipeline[r->num_pipeline_stages-1].valid = false;
+		spinn_packet_handle_t handle = buffer_pop(&(r->pipeline));
+		r->pipeline_valid &= ~last_stage;
 		
-		if (r->forward_packet) {
-			// Set the packet flags
-			p->direction = r->selected_output_direction;
-			p->emg_state = r->cur_packet_emg_state;
-			
-			// Update the counters
-			p->num_hops++;
-			if (p->emg_state == SPINN_EMG_FIRST_LEG)
-				p->num_emg_hops++;
-			
-			// Forward the current packet to the output
-			buffer_push(r->outputs[r->selected_output_direction], p);
-			
-			// Raise the forwarding callback
-			if (r->on_forward != NULL)
-				r->on_forward(r, p, r->on_forward_data);
-		} else if (r->drop_packet && r->on_drop != NULL) {
-			// Drop the packet (just call the callback)
-			r->on_drop(r, p, r->on_drop_data);
-		}
+		send_packet( r, handle
+		           , r->selected_output_direction
+		           , r->selected_mc_route
+		           , r->cur_packet_emg_state
+		           , r->forward_packet
+		           , r->drop_packet
+		           );
 		
 		// Reset router state ready for next packet
 		r->time_elapsed = 0;
 	}
 	
 	// Advance the pipeline
-	for (int i = r->num_pipeline_stages-1; i >= 1; i--) {
-		if (!r->pipeline[i].valid) {
-			r->pipeline[i] = r->pipeline[i-1];
-			r->pipeline[i-1].valid = false;
+	r->pipeline_valid = advance_pipeline(r->pipeline_valid, r->num_pipeline_stages);
+	
+	// Attempt to accept a packet if possible
+	if (r->accept_packet && !(r->pipeline_valid & 1u)) {
+		r->pipeline_valid |= 1u;
+		buffer_push(&(r->pipeline), buffer_pop(r->input));
+	}
+}
+
+
+/**
+ * The tick of a spinn_router_array_t: the equivalent of spinn_router_tick for
+ * every router in the array.
+ */
+void
+spinn_router_array_tick(void *a_)
+{
+	spinn_router_array_t *a = (spinn_router_array_t *)a_;
+	
+	unsigned int last_stage = 1u << (a->num_pipeline_stages-1);
+	
+	// Decide what to do with any packets at the ends of the pipelines
+	bool busy = false;
+	for (int i = 0; i < a->num_routers; i++) {
+		spinn_router_t *r = a->routers[i];
+		
+		if (a->pipeline_valid[i] & last_stage)
+			route_packet( r, spinn_packet_pool_get_packet(r->pool, buffer_peek(&(r->pipeline)))
+			            , a->time_elapsed[i]
+			            , &(a->selected_output_direction[i])
+			            , &(a->selected_mc_route[i])
+			            , &(a->cur_packet_emg_state[i])
+			            , &(a->forward_packet[i])
+			            , &(a->drop_packet[i])
+			            );
+		
+		a->accept_packet[i] = !buffer_is_empty(r->input);
+		
+		// Sleep only when no router has a packet in its pipeline or waiting to
+		// enter it.
+		busy |= a->accept_packet[i] || a->pipeline_valid[i] != 0u;
+	}
+	
+	if (!busy)
+		scheduler_sleep(a->event);
+}
+
+
+/**
+ * The tock of a spinn_router_array_t: the equivalent of spinn_router_tock for
+ * every router in the array.
+ */
+void
+spinn_router_array_tock(void *a_)
+{
+	spinn_router_array_t *a = (spinn_router_array_t *)a_;
+	int num_routers = a->num_routers;
+	
+	unsigned int last_stage = 1u << (a->num_pipeline_stages-1);
+	
+	// Advance the timeouts of packets which must keep waiting and reset those
+	// of packets about to leave
+	unsigned int *restrict pipeline_valid = a->pipeline_valid;
+	int          *restrict time_elapsed   = a->time_elapsed;
+	bool         *restrict forward_packet = a->forward_packet;
+	bool         *restrict drop_packet    = a->drop_packet;
+	for (int i = 0; i < num_routers; i++) {
+		bool waiting = (pipeline_valid[i] & last_stage) != 0u;
+		bool sending = waiting & (forward_packet[i] | drop_packet[i]);
+		time_elapsed[i] = sending ? 0 : time_elapsed[i] + waiting;
+	}
+	
+	// Forward or drop packets. The routers are visited in the order the
+	// scheduler would call a set of individually scheduled routers (most
+	// recently added first) so that the callbacks are made in the same order.
+	for (int i = num_routers-1; i >= 0; i--) {
+		if ((pipeline_valid[i] & last_stage) && (forward_packet[i] || drop_packet[i])) {
+			pipeline_valid[i] &= ~last_stage;
+			send_packet( a->routers[i], buffer_pop(&(a->routers[i]->pipeline))
+			           , a->selected_output_direction[i]
+			           , a->selected_mc_route[i]
+			           , a->cur_packet_emg_state[i]
+			           , forward_packet[i]
+			           , drop_packet[i]
+			           );
 		}
 	}
 	
-	// Attempt to accept a packet if possible
-	if (r->accept_packet && !r->pipeline[0].valid) {
-		r->pipeline[0].valid = true;
-		r->pipeline[0].data  = buffer_pop(r->input);
+	// Advance the pipelines
+	for (int i = 0; i < num_routers; i++)
+		pipeline_valid[i] = advance_pipeline(pipeline_valid[i], a->num_pipeline_stages);
+	
+	// Accept packets where possible
+	for (int i = 0; i < num_routers; i++) {
+		if (a->accept_packet[i] && !(pipeline_valid[i] & 1u)) {
+			pipeline_valid[i] |= 1u;
+			buffer_push(&(a->routers[i]->pipeline), buffer_pop(a->routers[i]->input));
+		}
 	}
 }
 
 
+/**
+ * Internal function.
+ *
+ * Copy the configuration of a router (common to spinn_router_init and
+ * spinn_router_array_add) into the router.
+ */
+static void
+set_router_config( spinn_router_t      *r
+                 , buffer_t            *input
+                 , buffer_t            *outputs[7]
+                 , spinn_packet_pool_t *pool
+                 , spinn_coord_t        position
+                 , bool            use_emg_routing
+                 , int             first_timeout
+                 , int             final_timeout
+                 , void            (*on_forward)( spinn_router_t    *router
+                                                , spinn_packet_t    *packet
+                                                , void              *data
+                                                )
+                 , void            *on_forward_data
+                 , void            (*on_drop)( spinn_router_t *router
+                                             , spinn_packet_t *packet
+                                             , void           *data
+                                             )
+                 , void            *on_drop_data
+                 )
+{
+	// Copy fields from parameters
+	r->input = input;
+	memcpy(r->outputs, outputs, sizeof(buffer_t *) * 7);
+	r->pool = pool;
+	
+	r->position    = position;
+	
+	r->routing_table       = NULL;
+	r->routing_table_width = 0;
+	
+	r->mc_table = NULL;
+	spinn_router_reset_mc_counters(r);
+	spinn_router_reset_stall_counters(r);
+	
+	r->use_emg_routing = use_emg_routing;
+	r->first_timeout   = first_timeout;
+	r->final_timeout   = final_timeout;
+	
+	r->on_forward      = on_forward;
+	r->on_forward_data = on_forward_data;
+	
+	r->on_drop      = on_drop;
+	r->on_drop_data = on_drop_data;
+}
+
+
 /******************************************************************************
  * Public functions.
  ******************************************************************************/
@@ -172,6 +507,7 @@ spinn_router_init( spinn_router_t *r
                  , int             num_pipeline_stages
                  , buffer_t       *input
                  , buffer_t       *outputs[7]
+                 , spinn_packet_pool_t *pool
                  , spinn_coord_t   position
                  , bool            use_emg_routing
                  , int             first_timeout
@@ -191,42 +527,196 @@ spinn_router_init( spinn_router_t *r
 	// Initialise internal fields
 	r->time_elapsed              = 0;
 	
-	// Set up the pipeline
+	// Set up the (empty) pipeline
+	assert(num_pipeline_stages >= 1);
+	assert(num_pipeline_stages <= (int)(sizeof(unsigned int) * 8));
 	r->num_pipeline_stages = num_pipeline_stages;
-	r->pipeline = calloc(r->num_pipeline_stages, sizeof(spinn_router_pipeline_t));
-	assert(r->pipeline != NULL);
-	for (int i = 0; i < r->num_pipeline_stages; i++)
-		r->pipeline[i].valid = false;
+	r->pipeline_valid      = 0u;
+	buffer_init(&(r->pipeline), num_pipeline_stages);
 	
-	// Copy fields from parameters
-	r->input = input;
-	memcpy(r->outputs, outputs, sizeof(buffer_t *) * 7);
+	set_router_config( r, input, outputs, pool, position
+	                 , use_emg_routing, first_timeout, final_timeout
+	                 , on_forward, on_forward_data
+	                 , on_drop, on_drop_data
+	                 );
 	
-	r->position    = position;
+	// Set up tick/tock callbacks in the scheduler
+	r->event = scheduler_schedule( s, period
+	                             , spinn_router_tick, (void *)r
+	                             , spinn_router_tock, (void *)r
+	                             );
 	
-	r->use_emg_routing = use_emg_routing;
-	r->first_timeout   = first_timeout;
-	r->final_timeout   = final_timeout;
+	// Wake the router when a packet arrives
+	buffer_set_consumer(input, r->event);
+}
+
+
+void
+spinn_router_destroy(spinn_router_t *r)
+{
+	buffer_destroy(&(r->pipeline));
+}
+
+
+void
+spinn_router_set_routing_table( spinn_router_t *r
+                              , const uint8_t  *routing_table
+                              , int             system_width
+                              )
+{
+	r->routing_table       = routing_table;
+	r->routing_table_width = system_width;
+}
+
+
+void
+spinn_router_set_mc_table( spinn_router_t         *r
+                         , const spinn_mc_table_t *mc_table
+                         )
+{
+	r->mc_table = mc_table;
+}
+
+
+spinn_router_mc_counters_t
+spinn_router_get_mc_counters(spinn_router_t *r)
+{
+	return r->mc_counters;
+}
+
+
+void
+spinn_router_reset_mc_counters(spinn_router_t *r)
+{
+	r->mc_counters.table_hits     = 0;
+	r->mc_counters.default_routed = 0;
+	r->mc_counters.copies         = 0;
+	r->mc_counters.copies_lost    = 0;
+}
+
+
+spinn_router_stall_counters_t
+spinn_router_get_stall_counters(spinn_router_t *r)
+{
+	return r->stall_counters;
+}
+
+
+void
+spinn_router_reset_stall_counters(spinn_router_t *r)
+{
+	r->stall_counters.stalled    = 0;
+	r->stall_counters.emg_routed = 0;
+	for (int i = 0; i < 7; i++)
+		r->stall_counters.output_full[i] = 0;
+}
+
+
+void
+spinn_router_array_init( spinn_router_array_t *a
+                       , scheduler_t          *s
+                       , ticks_t               period
+                       , int                   num_pipeline_stages
+                       , int                   max_routers
+                       )
+{
+	a->num_routers         = 0;
+	a->max_routers         = max_routers;
+	a->num_pipeline_stages = num_pipeline_stages;
 	
-	r->on_forward      = on_forward;
-	r->on_forward_data = on_forward_data;
+	a->routers = calloc(max_routers, sizeof(spinn_router_t *));
+	assert(a->routers != NULL);
 	
-	r->on_drop      = on_drop;
-	r->on_drop_data = on_drop_data;
+	assert(num_pipeline_stages >= 1);
+	assert(num_pipeline_stages <= (int)(sizeof(unsigned int) * 8));
+	a->pipeline_valid = calloc(max_routers, sizeof(unsigned int));
+	assert(a->pipeline_valid != NULL);
+	a->pipeline_storage = calloc( max_routers * buffer_storage_size(num_pipeline_stages)
+	                            , sizeof(buffer_value_t)
+	                            );
+	assert(a->pipeline_storage != NULL);
 	
-	// Set up tick/tock callbacks in the scheduler
-	scheduler_schedule( s, period
-	                  , spinn_router_tick, (void *)r
-	                  , spinn_router_tock, (void *)r
-	                  );
+	a->time_elapsed = calloc(max_routers, sizeof(int));
+	assert(a->time_elapsed != NULL);
+	a->selected_output_direction = calloc(max_routers, sizeof(spinn_direction_t));
+	assert(a->selected_output_direction != NULL);
+	a->selected_mc_route = calloc(max_routers, sizeof(unsigned int));
+	assert(a->selected_mc_route != NULL);
+	a->cur_packet_emg_state = calloc(max_routers, sizeof(spinn_emg_state_t));
+	assert(a->cur_packet_emg_state != NULL);
+	
+	a->accept_packet = calloc(max_routers, sizeof(bool));
+	assert(a->accept_packet != NULL);
+	a->forward_packet = calloc(max_routers, sizeof(bool));
+	assert(a->forward_packet != NULL);
+	a->drop_packet = calloc(max_routers, sizeof(bool));
+	assert(a->drop_packet != NULL);
+	
+	// A single pair of tick/tock callbacks runs every router
+	a->event = scheduler_schedule( s, period
+	                             , spinn_router_array_tick, (void *)a
+	                             , spinn_router_array_tock, (void *)a
+	                             );
 }
 
 
 void
-spinn_router_destroy(spinn_router_t *r)
+spinn_router_array_add( spinn_router_array_t *a
+                      , spinn_router_t       *r
+                      , buffer_t             *input
+                      , buffer_t             *outputs[7]
+                      , spinn_packet_pool_t  *pool
+                      , spinn_coord_t         position
+                      , bool                  use_emg_routing
+                      , int                   first_timeout
+                      , int                   final_timeout
+                      , void                  (*on_forward)( spinn_router_t    *router
+                                                           , spinn_packet_t    *packet
+                                                           , void              *data
+                                                           )
+                      , void                  *on_forward_data
+                      , void                  (*on_drop)( spinn_router_t *router
+                                                        , spinn_packet_t *packet
+                                                        , void           *data
+                                                        )
+                      , void                  *on_drop_data
+                      )
 {
-	free(r->pipeline);
+	assert(a->num_routers < a->max_routers);
+	
+	set_router_config( r, input, outputs, pool, position
+	                 , use_emg_routing, first_timeout, final_timeout
+	                 , on_forward, on_forward_data
+	                 , on_drop, on_drop_data
+	                 );
+	
+	// The router's state is held by the array, not the router, except for the
+	// packets in its pipeline whose storage is allocated by the array
+	r->num_pipeline_stages = a->num_pipeline_stages;
+	buffer_init_from( &(r->pipeline), a->num_pipeline_stages
+	                , a->pipeline_storage
+	                  + (a->num_routers * buffer_storage_size(a->num_pipeline_stages))
+	                );
+	r->event = a->event;
+	
+	a->routers[a->num_routers++] = r;
+	
+	// Wake the array when a packet arrives
+	buffer_set_consumer(input, a->event);
 }
 
 
-
+void
+spinn_router_array_destroy(spinn_router_array_t *a)
+{
+	free(a->routers);
+	free(a->pipeline_valid);
+	free(a->pipeline_storage);
+	free(a->time_elapsed);
+	free(a->selected_output_direction);
+	free(a->selected_mc_route);
+	free(a->cur_packet_emg_state);
+	free(a->accept_packet);
+	free(a->forward_packet);
+	free(a->drop_packet);
+}
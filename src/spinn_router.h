@@ -8,6 +8,7 @@
 #define SPINN_ROUTER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "config.h"
 
@@ -16,12 +17,52 @@
 
 #include "spinn.h"
 #include "spinn_packet.h"
+#include "spinn_mc_table.h"
 
 /**
  * A model of a SpiNNaker router.
  */
 typedef struct spinn_router spinn_router_t;
 
+/**
+ * A group of SpiNNaker routers simulated together.
+ */
+typedef struct spinn_router_array spinn_router_array_t;
+
+/**
+ * Counts of how multicast packets forwarded by a router were routed.
+ */
+typedef struct spinn_router_mc_counters {
+	// Packets routed by an entry in the routing table
+	int table_hits;
+	
+	// Packets which matched no entry and were routed straight through the router
+	int default_routed;
+	
+	// Additional copies of packets created to send them to several outputs
+	int copies;
+	
+	// Copies which could not be created (and so were not sent) because the
+	// packet pool was exhausted
+	int copies_lost;
+} spinn_router_mc_counters_t;
+
+/**
+ * Counts of how packets forwarded by a router were held up.
+ */
+typedef struct spinn_router_stall_counters {
+	// Router periods in which the packet at the end of the pipeline could be
+	// neither forwarded nor dropped
+	int stalled;
+	
+	// Packets sent on the first leg of an emergency route
+	int emg_routed;
+	
+	// Router periods in which the packet at the end of the pipeline found the
+	// output in each direction (indexed by spinn_direction_t) full
+	int output_full[7];
+} spinn_router_stall_counters_t;
+
 
 // Concrete definitions of the above types
 #include "spinn_router_internal.h"
@@ -38,6 +79,11 @@ typedef struct spinn_router spinn_router_t;
  * @param input A single buffer containing a merged stream of packets from
  *              multiple inputs.
  * @param outputs An set of 7 output buffers, one per output direction.
+ * @param pool The pool the packets in the buffers were allocated from. Copies
+ *             of multicast packets are also allocated from this pool which
+ *             must therefore be the node's local pool (see
+ *             spinn_packet_pool_init_local) or otherwise only used by the
+ *             router's own thread.
  *
  * @param position The coordinates of the router in the system's overall mesh.
  *
@@ -73,6 +119,7 @@ void spinn_router_init( spinn_router_t *router
                       , int             num_pipeline_stages
                       , buffer_t       *input
                       , buffer_t       *outputs[7]
+                      , spinn_packet_pool_t *pool
                       , spinn_coord_t   position
                       , bool            use_emg_routing
                       , int             first_timeout
@@ -97,4 +144,132 @@ void spinn_router_init( spinn_router_t *router
  */
 void spinn_router_destroy(spinn_router_t *router);
 
+
+/**
+ * Route packets using a routing table rather than the dimension-order route
+ * carried by each packet (the default). May be called after spinn_router_init
+ * or spinn_router_array_add.
+ *
+ * @param routing_table A table giving the (spinn_direction_t) output direction
+ *                      for packets destined for each node, indexed by
+ *                      (destination.y * system_width) + destination.x. The
+ *                      table is not copied and must outlive the router. Packets
+ *                      whose destination is the router's position must be
+ *                      routed to SPINN_LOCAL. If NULL, packets are dimension
+ *                      order routed.
+ * @param system_width The width of the system (i.e. the table's row length).
+ */
+void spinn_router_set_routing_table( spinn_router_t *router
+                                   , const uint8_t  *routing_table
+                                   , int             system_width
+                                   );
+
+
+/**
+ * Route multicast packets using the given routing table (see spinn_mc_table.h).
+ * May be called after spinn_router_init or spinn_router_array_add. Until this is
+ * called, every packet is treated as a point-to-point packet.
+ *
+ * A multicast packet whose key matches an entry is sent to every output in the
+ * entry's route at once: it waits until all of those outputs have space and is
+ * dropped if it is still waiting after first_timeout periods (multicast packets
+ * are never emergency routed). A packet which matches no entry is default
+ * routed: it leaves by the link opposite the one it arrived on, or, if it was
+ * injected at this node, it is dropped immediately. Packets sent to more than
+ * one output are copied, the copies being allocated from the router's pool (an
+ * output is not sent a copy if the pool is exhausted, which is counted by the
+ * copies_lost multicast counter).
+ *
+ * @param mc_table The multicast routing table. The table is not copied and
+ *                 must outlive the router.
+ */
+void spinn_router_set_mc_table( spinn_router_t         *router
+                              , const spinn_mc_table_t *mc_table
+                              );
+
+
+/**
+ * Get the multicast routing counters of a router.
+ */
+spinn_router_mc_counters_t spinn_router_get_mc_counters(spinn_router_t *router);
+
+
+/**
+ * Reset the multicast routing counters of a router to zero.
+ */
+void spinn_router_reset_mc_counters(spinn_router_t *router);
+
+
+/**
+ * Get the stall counters of a router.
+ */
+spinn_router_stall_counters_t spinn_router_get_stall_counters(spinn_router_t *router);
+
+
+/**
+ * Reset the stall counters of a router to zero.
+ */
+void spinn_router_reset_stall_counters(spinn_router_t *router);
+
+
+/**
+ * An alternative to spinn_router_init for simulating a large number of
+ * identically clocked routers. Rather than each router being scheduled
+ * separately, the state of every router in the array is held in a structure of
+ * arrays and all routers are advanced together in a single pass by one
+ * scheduler event. The routers behave exactly as if they had been initialised
+ * with spinn_router_init and the callbacks of routers forwarding or dropping
+ * packets in the same tock are made in the same order as the scheduler would
+ * call individually scheduled routers (i.e. most recently added first).
+ *
+ * Since all routers are advanced by a single event, the array cannot be split
+ * between threads.
+ *
+ * @param scheduler The scheduler controling the simulation.
+ * @param period The period at which every router will attempt to route packets.
+ * @param num_pipeline_stages The pipeline length of every router.
+ * @param max_routers The maximum number of routers which will be added.
+ */
+void spinn_router_array_init( spinn_router_array_t *routers
+                            , scheduler_t          *scheduler
+                            , ticks_t               period
+                            , int                   num_pipeline_stages
+                            , int                   max_routers
+                            );
+
+
+/**
+ * Add a router to an array. The arguments are as for spinn_router_init. The
+ * spinn_router_t holds the router's configuration (and is passed to the
+ * callbacks) but its state is held by the array. The router must still be
+ * freed with spinn_router_destroy.
+ */
+void spinn_router_array_add( spinn_router_array_t *routers
+                           , spinn_router_t       *router
+                           , buffer_t             *input
+                           , buffer_t             *outputs[7]
+                           , spinn_packet_pool_t  *pool
+                           , spinn_coord_t         position
+                           , bool                  use_emg_routing
+                           , int                   first_timeout
+                           , int                   final_timeout
+                           , void                  (*on_forward)( spinn_router_t    *router
+                                                                , spinn_packet_t    *packet
+                                                                , void              *data
+                                                                )
+                           , void                  *on_forward_data
+                           , void                  (*on_drop)( spinn_router_t *router
+                                                             , spinn_packet_t *packet
+                                                             , void           *data
+                                                             )
+                           , void                  *on_drop_data
+                           );
+
+
+/**
+ * Free resources used by the router array (but not the routers themselves).
+ * The scheduler should not be used after a call to this function.
+ */
+void spinn_router_array_destroy(spinn_router_array_t *routers);
+
 #endif
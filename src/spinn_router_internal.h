@@ -8,29 +8,34 @@
  */
 
 
-/**
- * A value in a pipeline.
- */
-typedef struct spinn_router_pipeline {
-	// Is the value valid (or is it a bubble?)
-	bool valid;
-	
-	// The value in the pipeline
-	void *data;
-} spinn_router_pipeline_t;
-
-
 /**
  * The structure representing a particular router. 
  */
 struct spinn_router {
-	// Ports (expected to supply/accept spinn_packet_t pointers).
+	// Ports (expected to supply/accept handles of packets in the pool).
 	buffer_t *input;
 	buffer_t *outputs[7];
 	
+	// The pool the packets are allocated from (used to resolve handles and to
+	// allocate copies of multicast packets).
+	spinn_packet_pool_t *pool;
+	
 	// Location of the router in the system
 	spinn_coord_t position;
 	
+	// The routing table (indexed by destination node) and its row length or NULL
+	// if packets are dimension order routed.
+	const uint8_t *routing_table;
+	int            routing_table_width;
+	
+	// The multicast routing table (or NULL if all packets are point-to-point)
+	// and counters of how multicast packets have been routed.
+	const spinn_mc_table_t     *mc_table;
+	spinn_router_mc_counters_t  mc_counters;
+	
+	// Counters of packets held up by full outputs and emergency routed
+	spinn_router_stall_counters_t stall_counters;
+	
 	// Enable emergency routing (rather than just dropping out after
 	// first_timeout.
 	bool use_emg_routing;
@@ -61,6 +66,10 @@ struct spinn_router {
 	// of the flag in the packet.
 	spinn_direction_t selected_output_direction;
 	
+	// The outputs (a mask of directions) the next multicast packet forwarded is
+	// being sent to (zero for point-to-point packets).
+	unsigned int selected_mc_route;
+	
 	// The emergency routing state to be assigned to the packet when it is
 	// forwarded
 	spinn_emg_state_t cur_packet_emg_state;
@@ -74,11 +83,52 @@ struct spinn_router {
 	// Should the currrent packet should be dropped in the next tock?
 	bool drop_packet;
 	
-	// Number of stages in the pipeline
+	// Number of stages in the pipeline (at most the number of bits in an
+	// unsigned int)
 	int num_pipeline_stages;
 	
-	// A queue of pipeline stages which is advanced on each clock
-	spinn_router_pipeline_t *pipeline;
+	// A mask of which stages of the pipeline hold a packet (the rest being
+	// bubbles). Bit 0 is the first stage, bit num_pipeline_stages-1 the last.
+	unsigned int pipeline_valid;
+	
+	// The packets in the pipeline, in order. Since packets never overtake each
+	// other, the packet in the last occupied stage is always at the head of this
+	// buffer and advancing the pipeline only requires updating pipeline_valid.
+	buffer_t pipeline;
+	
+	// The router's scheduler event (which sleeps while it has no packets)
+	scheduler_event_t *event;
 };
 
 
+/**
+ * The structure representing a group of routers whose state is held as a
+ * structure of arrays. The per-router arrays are indexed by the order the
+ * routers were added.
+ */
+struct spinn_router_array {
+	// The routers in the array (which hold their configuration but not state)
+	int              num_routers;
+	int              max_routers;
+	spinn_router_t **routers;
+	
+	// Number of stages in every router's pipeline
+	int num_pipeline_stages;
+	
+	// The same as the corresponding fields of a spinn_router_t, one per router
+	unsigned int      *pipeline_valid;
+	int               *time_elapsed;
+	spinn_direction_t *selected_output_direction;
+	unsigned int      *selected_mc_route;
+	spinn_emg_state_t *cur_packet_emg_state;
+	bool              *accept_packet;
+	bool              *forward_packet;
+	bool              *drop_packet;
+	
+	// Storage for the contents of every router's pipeline buffer
+	buffer_value_t *pipeline_storage;
+	
+	// The scheduler event which runs every router in the array (which sleeps
+	// while none of them have any packets)
+	scheduler_event_t *event;
+};
@@ -29,7 +29,7 @@ spinn_sim_init(spinn_sim_t *sim, const char *config_filename, int argc, char *ar
 	spinn_sim_config_init(sim, config_filename, argc, argv);
 	
 	// Seed the simulation (default to the time as a seed)
-	srand(spinn_sim_config_lookup_int64_default(sim, "experiment.seed", time(NULL)));
+	sim->seed = (uint64_t)spinn_sim_config_lookup_int64_default(sim, "experiment.seed", time(NULL));
 	
 	// Set up stat counting resources
 	spinn_sim_stat_open(sim);
@@ -69,8 +69,14 @@ spinn_sim_run_ticks(spinn_sim_t *sim, int num_ticks)
 		fprintf(stderr, "\033[s");
 	
 	// Run the simulation for the requested number of ticks
-	for (ticks_t t = 0; t < num_ticks; t++) {
-		scheduler_tick_tock(&(sim->scheduler));
+	ticks_t start_ticks = scheduler_get_ticks(&(sim->scheduler));
+	ticks_t end_ticks   = start_ticks + num_ticks;
+	while (scheduler_get_ticks(&(sim->scheduler)) < end_ticks) {
+		// Skip over any idle period (but not beyond the end of the run)
+		if (!sim->fast_forward || scheduler_fast_forward(&(sim->scheduler), end_ticks) == 0)
+			scheduler_tick_tock(&(sim->scheduler));
+		
+		ticks_t t = scheduler_get_ticks(&(sim->scheduler)) - start_ticks;
 		
 		// Show the status line once per cycle
 		time_t now = time(NULL);
@@ -16,8 +16,12 @@
 #include "buffer.h"
 #include "arbiter.h"
 #include "delay.h"
+#include "alias_table.h"
+#include "async_file.h"
+#include "histogram.h"
 
 #include "spinn.h"
+#include "spinn_arbiter_tree.h"
 #include "spinn_packet.h"
 #include "spinn_router.h"
 
@@ -40,19 +44,17 @@ struct spinn_node {
 	// Is the node enabled?
 	bool enabled;
 	
+	// The packet pool used by the node's components, a local pool of the
+	// simulation's pool (see spinn_packet_pool_init_local) so that nodes run by
+	// different threads do not contend for packets.
+	spinn_packet_pool_t pool;
+	
 	// The source/sink for packets
 	spinn_packet_gen_t packet_gen;
 	spinn_packet_con_t packet_con;
 	
-	// The arbiters
-	arbiter_t arb_e_s;
-	arbiter_t arb_ne_n;
-	arbiter_t arb_w_sw;
-	
-	arbiter_t arb_e_s_ne_n;
-	arbiter_t arb_w_sw_l;
-	
-	arbiter_t arb_last;
+	// The arbiter tree merging the inputs into the router
+	spinn_arbiter_tree_t arbiter_tree;
 	
 	// Buffers on either side of a delay model which (eventually, via some
 	// arbiters) connect to the inputs of the router
@@ -67,15 +69,19 @@ struct spinn_node {
 	buffer_t gen_buffer;
 	buffer_t con_buffer;
 	
-	// Buffers in the arbiter tree
-	buffer_t arb_e_s_out;
-	buffer_t arb_ne_n_out;
-	buffer_t arb_w_sw_out;
+	// The output of the arbiter tree (the router's input)
+	buffer_t arb_last_out;
 	
-	buffer_t arb_e_s_ne_n_out;
-	buffer_t arb_w_sw_l_out;
+	// When the simulation is multi-threaded, packets dropped by the router are
+	// placed here to be logged and freed by the serial part of the schedule (see
+	// spinn_sim_stat_on_drop_deferred).
+	buffer_t dropped_packets;
 	
-	buffer_t arb_last_out;
+	// Similarly, when multi-threaded, a copy of a packet delivered to the packet
+	// consumer waiting to be logged by the serial part of the schedule (see
+	// spinn_sim_stat_on_packet_con_deferred).
+	spinn_packet_t delivered_packet;
+	bool           delivered_packet_pending;
 	
 	// Stat counters
 	int stat_packets_offered;
@@ -86,6 +92,59 @@ struct spinn_node {
 };
 
 
+// The number of packet details records buffered before being written to the
+// packet details file
+#define SPINN_SIM_STAT_PACKET_BLOCK_RECORDS 4096
+
+/**
+ * Packet details records buffered column-by-column before being written to the
+ * packet details file as a binary block (see spinn_sim_stat.c for the format).
+ */
+typedef struct spinn_sim_stat_packet_columns {
+	int num_records;
+	
+	uint8_t  delivered[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint8_t  source_x[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint8_t  source_y[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint8_t  dest_x[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint8_t  dest_y[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	int32_t  sent_time[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	int32_t  latency[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint16_t num_hops[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+	uint16_t emg_hops[SPINN_SIM_STAT_PACKET_BLOCK_RECORDS];
+} spinn_sim_stat_packet_columns_t;
+
+/**
+ * The properties of delivered packets of which histograms may be kept.
+ */
+typedef enum spinn_sim_stat_histogram_value {
+	SPINN_SIM_STAT_HISTOGRAM_LATENCY = 0,
+	SPINN_SIM_STAT_HISTOGRAM_NUM_HOPS,
+	SPINN_SIM_STAT_HISTOGRAM_EMG_HOPS,
+	
+	// The number of the above
+	SPINN_SIM_STAT_NUM_HISTOGRAMS,
+} spinn_sim_stat_histogram_value_t;
+
+/**
+ * The node by which delivered packets are grouped into per-node histograms.
+ */
+typedef enum spinn_sim_stat_histogram_node {
+	SPINN_SIM_STAT_HISTOGRAM_NODE_NONE,
+	SPINN_SIM_STAT_HISTOGRAM_NODE_SOURCE,
+	SPINN_SIM_STAT_HISTOGRAM_NODE_DESTINATION,
+} spinn_sim_stat_histogram_node_t;
+
+/**
+ * Totals of the per-node packet counters over the whole system.
+ */
+typedef struct spinn_sim_stat_totals {
+	int packets_offered;
+	int packets_accepted;
+	int packets_arrived;
+	int packets_dropped;
+} spinn_sim_stat_totals_t;
+
 /**
  * Resources used by a SpiNNaker system simulation.
  */
@@ -96,12 +155,41 @@ struct spinn_sim {
 	// Scheduler which runs the simulation
 	scheduler_t scheduler;
 	
-	// Packet memory allocation
+	// The number of threads used to run the scheduler
+	int num_threads;
+	
+	// Should the simulation skip over periods where nothing happens?
+	bool fast_forward;
+	
+	// The seed from which every random component's generator is initialised
+	uint64_t seed;
+	
+	// Are the routers of all nodes simulated together by the routers array
+	// (rather than each being scheduled individually)?
+	bool batch_routers;
+	spinn_router_array_t routers;
+	
+	// When routing using tables, a table of output directions for each node
+	// (indexed by node then destination, see spinn_router_set_routing_table),
+	// otherwise NULL and packets carry their own dimension-order routes.
+	uint8_t *routing_tables;
+	
+	// The multicast routing table of each node or NULL if none were given
+	spinn_mc_table_t *mc_tables;
+	
+	// Packet memory allocation. The packets are allocated by each node via its
+	// own local pool.
 	spinn_packet_pool_t pool;
 	
 	// An array of all of the spinnaker nodes
 	spinn_node_t *nodes;
 	
+	// A single allocation holding the values of every node's buffers. Each node's
+	// buffers are carved from a contiguous, cache-line-padded region of
+	// buffer_arena_node_size values.
+	buffer_value_t *buffer_arena;
+	size_t          buffer_arena_node_size;
+	
 	// The size of the simulation. This defines a rectangular array of nodes of
 	// which some may be inactive depending on the network topology selected.
 	spinn_coord_t system_size;
@@ -120,16 +208,72 @@ struct spinn_sim {
 	// spatial distribution
 	spinn_coord_t *node_packet_gen_p2p_target;
 	
-	// Statistic output files
-	FILE *stat_file_global_counters;
-	FILE *stat_file_per_node_counters;
-	FILE *stat_file_packet_details;
-	FILE *stat_file_simulator;
+	// The weighted table of destinations shared by all packet generators when
+	// using a randomly picked spatial distribution, otherwise NULL. If relative,
+	// the destinations are offsets from each generator's position.
+	alias_table_t *packet_gen_dest_table;
+	spinn_coord_t *packet_gen_dests;
+	bool           packet_gen_dests_relative;
+	
+	// Statistic output files (NULL if not being written) which are written by
+	// background threads
+	async_file_t *stat_file_global_counters;
+	async_file_t *stat_file_per_node_counters;
+	async_file_t *stat_file_per_link_counters;
+	async_file_t *stat_file_packet_details;
+	async_file_t *stat_file_simulator;
+	
+	// Are the statistic output files gzip compressed?
+	bool stat_compress;
 	
 	// Flags as to whether packet arrivals will be monitored
 	bool stat_log_delivered_packets;
 	bool stat_log_dropped_packets;
 	
+	// Are packet details written in the binary format rather than as text?
+	// Either way, records not yet written are buffered here (and converted into
+	// text by the file's writer thread if required).
+	bool                             stat_packet_details_binary;
+	spinn_sim_stat_packet_columns_t *stat_packet_columns;
+	
+	// Which histograms of delivered packets (if any) are being kept and the
+	// precision of their buckets
+	bool stat_histograms_enabled;
+	bool stat_histogram_enabled[SPINN_SIM_STAT_NUM_HISTOGRAMS];
+	int  stat_histogram_precision_bits;
+	
+	// The histograms of all packets delivered in the current sample
+	histogram_t stat_histograms[SPINN_SIM_STAT_NUM_HISTOGRAMS];
+	
+	// If per-node histograms are being kept, the node by which packets are
+	// grouped and, during a sample, SPINN_SIM_STAT_NUM_HISTOGRAMS histograms for
+	// each node (indexed in the same way as nodes).
+	spinn_sim_stat_histogram_node_t  stat_histogram_node;
+	histogram_t                     *stat_node_histograms;
+	
+	// The percentiles reported for each histogram
+	double *stat_histogram_percentiles;
+	int     stat_histogram_num_percentiles;
+	
+	// Histogram output files (NULL if not being written)
+	async_file_t *stat_file_histograms;
+	async_file_t *stat_file_per_node_histograms;
+	async_file_t *stat_file_histogram_buckets;
+	
+	// If not zero, a snapshot of the state of the network is written to the
+	// time series file every stat_time_series_interval ticks during a sample.
+	// Each snapshot counts the packets offered/accepted/etc. since the previous
+	// one, whose totals are kept here.
+	int                      stat_time_series_interval;
+	async_file_t            *stat_file_time_series;
+	ticks_t                  stat_time_series_next_time;
+	spinn_sim_stat_totals_t  stat_time_series_last_totals;
+	
+	// The standard fields (group, sample and independent variables) of the
+	// current sample, formatted once at the start of each sample
+	char   *stat_standard_fields;
+	size_t  stat_standard_fields_len;
+	
 	// The time at which the warmup/simulation started
 	struct timeval stat_start_time;
 	
@@ -6,19 +6,22 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <math.h>
 
 #include "scheduler.h"
 #include "buffer.h"
-#include "arbiter.h"
 #include "delay.h"
 
 #include "spinn.h"
+#include "spinn_arbiter_tree.h"
 #include "spinn_topology.h"
 #include "spinn_packet.h"
+#include "spinn_mc_table.h"
 #include "spinn_router.h"
 
 #include "spinn_sim.h"
@@ -26,6 +29,9 @@
 #include "spinn_sim_config.h"
 #include "spinn_sim_stat.h"
 
+// The cache line size to which each node's buffer storage is aligned
+#define SPINN_SIM_CACHE_LINE_BYTES 64
+
 /******************************************************************************
  * Initialisation for values which can be changed mid-simulation (to save
  * duplication in the spinn_node_init and spinn_sim_model_update functions)
@@ -152,6 +158,185 @@ load_packet_gen_p2p_dist(spinn_sim_t *sim)
 }
 
 
+/**
+ * Internal function.
+ *
+ * Load the list of hotspot nodes for the hotspot distribution, adding the
+ * hotspot share of the weight to the corresponding entries of weights (indexed
+ * by node).
+ */
+static void
+load_packet_gen_hotspots(spinn_sim_t *sim, double *node_weights, double hotspot_fraction)
+{
+	config_setting_t *hotspot_list = config_lookup(&(sim->config), "model.packet_generator.spatial.hotspots");
+	if (hotspot_list == NULL ||
+	    config_setting_type(hotspot_list) != CONFIG_TYPE_LIST ||
+	    config_setting_length(hotspot_list) == 0
+	   ) {
+		fprintf(stderr, "Expected a non-empty list of (x,y) nodes in 'model.packet_generator.spatial.hotspots'.\n");
+		exit(-1);
+	}
+	
+	int num_hotspots = config_setting_length(hotspot_list);
+	for (int i = 0; i < num_hotspots; i++) {
+		config_setting_t *x_y = config_setting_get_elem(hotspot_list, i);
+		config_setting_t *x = NULL;
+		config_setting_t *y = NULL;
+		if (x_y != NULL &&
+		    config_setting_type(x_y) == CONFIG_TYPE_LIST &&
+		    config_setting_length(x_y) == 2
+		   ) {
+			x = config_setting_get_elem(x_y, 0);
+			y = config_setting_get_elem(x_y, 1);
+		}
+		if (x == NULL || y == NULL ||
+		    config_setting_type(x) != CONFIG_TYPE_INT ||
+		    config_setting_type(y) != CONFIG_TYPE_INT
+		   ) {
+			fprintf(stderr, "Expected item %d of 'model.packet_generator.spatial.hotspots' to be of the form (x,y) where x and y are integers.\n"
+			              , i);
+			exit(-1);
+		}
+		
+		spinn_coord_t hotspot = { config_setting_get_int(x)
+		                        , config_setting_get_int(y)
+		                        };
+		if (hotspot.x < 0 || hotspot.x >= sim->system_size.x ||
+		    hotspot.y < 0 || hotspot.y >= sim->system_size.y ||
+		    !sim->node_enable_mask[(hotspot.y*sim->system_size.x) + hotspot.x]
+		   ) {
+			fprintf(stderr, "Expected item %d of 'model.packet_generator.spatial.hotspots' to be an enabled node within the size of the machine.\n"
+			              , i);
+			exit(-1);
+		}
+		
+		node_weights[(hotspot.y*sim->system_size.x) + hotspot.x] += hotspot_fraction / num_hotspots;
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Free the packet generators' shared destination table, if any.
+ */
+static void
+free_packet_gen_dest_table(spinn_sim_t *sim)
+{
+	if (sim->packet_gen_dest_table != NULL) {
+		alias_table_destroy(sim->packet_gen_dest_table);
+		free(sim->packet_gen_dest_table);
+		free(sim->packet_gen_dests);
+		sim->packet_gen_dest_table = NULL;
+		sim->packet_gen_dests      = NULL;
+	}
+}
+
+
+/**
+ * Build the weighted table of destinations shared by every packet generator for
+ * the spatial distributions which pick destinations at random:
+ *   uniform: Every enabled node is equally likely.
+ *   hotspot: A given fraction of packets is sent to the hotspot nodes, the rest
+ *            are sent uniformly.
+ *   local: The weight of a node falls by a given factor per hop from the
+ *          source. Since the table holds offsets from the source, this is only
+ *          possible in a torus.
+ * Only enabled nodes are included so no destinations need be rejected except a
+ * generator's own node (when local packets are not allowed).
+ */
+static void
+load_packet_gen_dest_table(spinn_sim_t *sim)
+{
+	free_packet_gen_dest_table(sim);
+	
+	const char *gen_spatial_dist
+		= spinn_sim_config_lookup_string(sim, "model.packet_generator.spatial.dist");
+	bool uniform = strcmp(gen_spatial_dist, "uniform") == 0;
+	bool hotspot = strcmp(gen_spatial_dist, "hotspot") == 0;
+	bool local   = strcmp(gen_spatial_dist, "local") == 0;
+	if (!uniform && !hotspot && !local)
+		return;
+	
+	int num_nodes = sim->system_size.x * sim->system_size.y;
+	double *node_weights = malloc(num_nodes * sizeof(double));
+	assert(node_weights != NULL);
+	
+	if (local) {
+		const char *topology_name = spinn_sim_config_lookup_string(sim, "model.network.topology");
+		if (strcmp(topology_name, "torus") != 0) {
+			fprintf(stderr, "Error: Local spatial distribution only possible for torus topologies!\n");
+			exit(-1);
+		}
+		double decay = spinn_sim_config_lookup_float(sim, "model.packet_generator.spatial.locality_decay");
+		if (decay <= 0.0) {
+			fprintf(stderr, "Error: model.packet_generator.spatial.locality_decay must be greater than zero!\n");
+			exit(-1);
+		}
+		
+		// Node i is the offset of node i from the source. The source itself is
+		// left out if packets may not be sent to it.
+		for (int y = 0; y < sim->system_size.y; y++) {
+			for (int x = 0; x < sim->system_size.x; x++) {
+				spinn_full_coord_t v = spinn_shortest_vector( (spinn_coord_t){0, 0}
+				                                            , (spinn_coord_t){x, y}
+				                                            , sim->system_size
+				                                            );
+				node_weights[(y*sim->system_size.x) + x] = pow(decay, spinn_magnitude(v));
+			}
+		}
+		if (!sim->allow_local_packets)
+			node_weights[0] = 0.0;
+	} else {
+		double hotspot_fraction = 0.0;
+		if (hotspot) {
+			hotspot_fraction = spinn_sim_config_lookup_float(sim, "model.packet_generator.spatial.hotspot_fraction");
+			if (hotspot_fraction < 0.0 || hotspot_fraction > 1.0) {
+				fprintf(stderr, "Error: model.packet_generator.spatial.hotspot_fraction must be between 0.0 and 1.0!\n");
+				exit(-1);
+			}
+		}
+		
+		int num_enabled = 0;
+		for (int i = 0; i < num_nodes; i++)
+			num_enabled += sim->node_enable_mask[i];
+		for (int i = 0; i < num_nodes; i++)
+			node_weights[i] = sim->node_enable_mask[i] ? (1.0 - hotspot_fraction) / num_enabled : 0.0;
+		
+		if (hotspot)
+			load_packet_gen_hotspots(sim, node_weights, hotspot_fraction);
+	}
+	
+	// Only nodes which may be picked are included in the table
+	double *weights = malloc(num_nodes * sizeof(double));
+	assert(weights != NULL);
+	sim->packet_gen_dests = malloc(num_nodes * sizeof(spinn_coord_t));
+	assert(sim->packet_gen_dests != NULL);
+	int num_dests = 0;
+	for (int y = 0; y < sim->system_size.y; y++) {
+		for (int x = 0; x < sim->system_size.x; x++) {
+			if (node_weights[(y*sim->system_size.x) + x] > 0.0) {
+				weights[num_dests] = node_weights[(y*sim->system_size.x) + x];
+				sim->packet_gen_dests[num_dests] = (spinn_coord_t){x, y};
+				num_dests++;
+			}
+		}
+	}
+	if (num_dests == 0) {
+		fprintf(stderr, "Error: model.packet_generator.spatial.dist has no possible destinations!\n");
+		exit(-1);
+	}
+	
+	sim->packet_gen_dest_table = malloc(sizeof(alias_table_t));
+	assert(sim->packet_gen_dest_table != NULL);
+	alias_table_init(sim->packet_gen_dest_table, weights, num_dests);
+	sim->packet_gen_dests_relative = local;
+	
+	free(weights);
+	free(node_weights);
+}
+
+
 static void
 configure_node_packet_gen(spinn_node_t *node)
 {
@@ -174,8 +359,14 @@ configure_node_packet_gen(spinn_node_t *node)
 	// Set spatial distribution
 	const char *gen_spatial_dist
 		= spinn_sim_config_lookup_string(node->sim, "model.packet_generator.spatial.dist");
-	if (strcmp(gen_spatial_dist, "uniform") == 0) {
-		spinn_packet_gen_set_spatial_dist_uniform(&(node->packet_gen));
+	if (strcmp(gen_spatial_dist, "uniform") == 0 ||
+	    strcmp(gen_spatial_dist, "hotspot") == 0 ||
+	    strcmp(gen_spatial_dist, "local") == 0) {
+		spinn_packet_gen_set_spatial_dist_table( &(node->packet_gen)
+		                                       , node->sim->packet_gen_dest_table
+		                                       , node->sim->packet_gen_dests
+		                                       , node->sim->packet_gen_dests_relative
+		                                       );
 	} else if (strcmp(gen_spatial_dist, "cyclic") == 0) {
 		spinn_packet_gen_set_spatial_dist_cyclic(&(node->packet_gen));
 	} else if (strcmp(gen_spatial_dist, "p2p") == 0) {
@@ -209,6 +400,18 @@ configure_node_packet_gen(spinn_node_t *node)
 			exit(-1);
 		}
 		spinn_packet_gen_set_spatial_dist_tornado(&(node->packet_gen));
+	} else if (strcmp(gen_spatial_dist, "multicast") == 0) {
+		if (node->sim->mc_tables == NULL) {
+			fprintf(stderr, "Error: Multicast spatial distribution requires model.router.mc_table_file!\n");
+			exit(-1);
+		}
+		int num_keys = spinn_sim_config_lookup_int_default(node->sim, "model.packet_generator.spatial.multicast_num_keys", 1);
+		if (num_keys < 1 || num_keys > (1 << 16)) {
+			fprintf(stderr, "Error: model.packet_generator.spatial.multicast_num_keys must be between 1 and 65536!\n");
+			exit(-1);
+		}
+		uint32_t base_key = ((uint32_t)node->position.x << 24) | ((uint32_t)node->position.y << 16);
+		spinn_packet_gen_set_spatial_dist_multicast(&(node->packet_gen), base_key, num_keys);
 	} else {
 		fprintf(stderr, "Error: model.packet_generator.spatial.dist not recognised!\n");
 		exit(-1);
@@ -284,6 +487,327 @@ dest_filter(const spinn_coord_t *proposed_destination, void *_node)
  * Node initialisation
  ******************************************************************************/
 
+/**
+ * Number of buffer values to allocate in the buffer arena for each node. This
+ * must account for every buffer created by spinn_node_init and is rounded up
+ * to a whole number of cache lines so that no two nodes' buffers share a line.
+ */
+static size_t
+node_buffer_arena_size(spinn_sim_t *sim)
+{
+	size_t size = 0;
+	
+	// Node-to-node link buffers
+	size += 6 * buffer_storage_size(spinn_sim_config_lookup_int(sim, "model.node_to_node_links.input_buffer_length"));
+	size += 6 * buffer_storage_size(spinn_sim_config_lookup_int(sim, "model.node_to_node_links.output_buffer_length"));
+	
+	// Gen/con buffers
+	size += buffer_storage_size(spinn_sim_config_lookup_int(sim, "model.packet_generator.buffer_length"));
+	size += buffer_storage_size(spinn_sim_config_lookup_int(sim, "model.packet_consumer.buffer_length"));
+	
+	// Arbiter tree buffers
+	size += buffer_storage_size(spinn_sim_config_lookup_int(sim, "model.arbiter_tree.root.buffer_length"));
+	size += spinn_arbiter_tree_storage_size( spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl1.buffer_length")
+	                                       , spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl2.buffer_length")
+	                                       );
+	
+	// Dropped packet buffer
+	size += buffer_storage_size(1);
+	
+	// Round up to a whole number of cache lines
+	size_t values_per_line = SPINN_SIM_CACHE_LINE_BYTES / sizeof(buffer_value_t);
+	return ((size + values_per_line - 1) / values_per_line) * values_per_line;
+}
+
+
+/**
+ * The largest number of packets which may be in a node at once: one per value
+ * in each of its buffers (see node_buffer_arena_size) and router pipeline
+ * stages. Since every packet in the system is always held by one of these, the
+ * total across all nodes bounds the size of the packet pool.
+ */
+static size_t
+node_max_packets(spinn_sim_t *sim)
+{
+	size_t num_packets = 0;
+	
+	// Node-to-node link buffers
+	num_packets += 6 * spinn_sim_config_lookup_int(sim, "model.node_to_node_links.input_buffer_length");
+	num_packets += 6 * spinn_sim_config_lookup_int(sim, "model.node_to_node_links.output_buffer_length");
+	
+	// Gen/con buffers
+	num_packets += spinn_sim_config_lookup_int(sim, "model.packet_generator.buffer_length");
+	num_packets += spinn_sim_config_lookup_int(sim, "model.packet_consumer.buffer_length");
+	
+	// Arbiter tree buffers
+	num_packets += 1 * spinn_sim_config_lookup_int(sim, "model.arbiter_tree.root.buffer_length");
+	num_packets += 2 * spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl1.buffer_length");
+	num_packets += 3 * spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl2.buffer_length");
+	
+	// Dropped packet buffer
+	num_packets += 1;
+	
+	// Router pipeline
+	num_packets += spinn_sim_config_lookup_int(sim, "model.router.pipeline_length");
+	
+	return num_packets;
+}
+
+
+/**
+ * The number of packets each node's local pool takes from (and returns to) the
+ * simulation's packet pool at once.
+ */
+static size_t
+node_packet_pool_batch_size(spinn_sim_t *sim)
+{
+	int batch_size = spinn_sim_config_lookup_int_default(sim, "simulator.packet_pool.local_batch_size", 16);
+	if (batch_size < 1) {
+		fprintf(stderr, "simulator.packet_pool.local_batch_size must be at least 1.\n");
+		exit(-1);
+	}
+	return (size_t)batch_size;
+}
+
+
+/**
+ * Initialise a buffer using the next free values in a node's region of the
+ * buffer arena, advancing *storage past them.
+ */
+static void
+node_buffer_init(buffer_t *buffer, size_t size, buffer_value_t **storage)
+{
+	buffer_init_from(buffer, size, *storage);
+	*storage += buffer_storage_size(size);
+}
+
+
+/**
+ * Internal function. Set up sim->routing_tables according to the
+ * model.router.routing option.
+ */
+static void
+configure_routing(spinn_sim_t *sim, bool use_wrap_around_links)
+{
+	const char *routing = spinn_sim_config_lookup_string_default(sim, "model.router.routing", "dor");
+	if (strcmp(routing, "dor") == 0) {
+		sim->routing_tables = NULL;
+	} else if (strcmp(routing, "dor_table") == 0) {
+		// Every node has a table with an entry for every node: on large systems
+		// this may not fit in memory (or even in a size_t).
+		size_t num_nodes = (size_t)sim->system_size.x * (size_t)sim->system_size.y;
+		if (num_nodes > SIZE_MAX / num_nodes) {
+			fprintf(stderr, "Error: model.router.routing 'dor_table' is too large for a %dx%d system.\n"
+			       , sim->system_size.x, sim->system_size.y);
+			exit(-1);
+		}
+		sim->routing_tables = malloc(num_nodes * num_nodes * sizeof(uint8_t));
+		if (sim->routing_tables == NULL) {
+			fprintf(stderr, "Error: Could not allocate the %zu byte model.router.routing 'dor_table' for a %dx%d system.\n"
+			       , num_nodes * num_nodes * sizeof(uint8_t)
+			       , sim->system_size.x, sim->system_size.y);
+			exit(-1);
+		}
+		
+		for (size_t i = 0; i < num_nodes; i++) {
+			spinn_coord_t position = {(int)(i % sim->system_size.x), (int)(i / sim->system_size.x)};
+			uint8_t *table = sim->routing_tables + (i * num_nodes);
+			for (size_t j = 0; j < num_nodes; j++) {
+				spinn_coord_t destination = {(int)(j % sim->system_size.x), (int)(j / sim->system_size.x)};
+				table[j] = (uint8_t)spinn_dor_direction( position
+				                                       , destination
+				                                       , sim->system_size
+				                                       , use_wrap_around_links
+				                                       );
+			}
+		}
+	} else {
+		fprintf(stderr, "Error: model.router.routing must be either 'dor' or 'dor_table'.\n");
+		exit(-1);
+	}
+}
+
+
+/**
+ * Internal function. Set up sim->mc_tables by loading the multicast routing
+ * tables named by the model.router.mc_table_file option (if any).
+ *
+ * Each line of the file is an entry "x y key mask route" added to the end of
+ * the table of the router at (x,y) where the key, mask and route may be given
+ * in decimal or hexadecimal (prefixed with 0x). Blank lines and lines starting
+ * with a # are ignored.
+ */
+static void
+load_mc_tables(spinn_sim_t *sim)
+{
+	const char *filename = spinn_sim_config_lookup_string_default(sim, "model.router.mc_table_file", "");
+	if (strcmp(filename, "") == 0) {
+		sim->mc_tables = NULL;
+		return;
+	}
+	
+	int num_nodes = sim->system_size.x*sim->system_size.y;
+	sim->mc_tables = calloc(num_nodes, sizeof(spinn_mc_table_t));
+	assert(sim->mc_tables != NULL);
+	for (int i = 0; i < num_nodes; i++)
+		spinn_mc_table_init(&(sim->mc_tables[i]));
+	
+	FILE *f = fopen(filename, "r");
+	if (f == NULL) {
+		fprintf(stderr, "Couldn't open multicast routing table file '%s'.\n", filename);
+		exit(-1);
+	}
+	
+	char line[256];
+	int line_num = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		line_num++;
+		
+		// Skip blank lines and comments
+		char *c = line;
+		while (*c == ' ' || *c == '\t')
+			c++;
+		if (*c == '#' || *c == '\n' || *c == '\r' || *c == '\0')
+			continue;
+		
+		int x, y;
+		long long key, mask, route;
+		if (sscanf(c, "%d %d %lli %lli %lli", &x, &y, &key, &mask, &route) != 5) {
+			fprintf(stderr, "Expected 'x y key mask route' on line %d of '%s'.\n"
+			              , line_num, filename);
+			exit(-1);
+		}
+		
+		if (x < 0 || x >= sim->system_size.x ||
+		    y < 0 || y >= sim->system_size.y ||
+		    !sim->node_enable_mask[(y*sim->system_size.x) + x]) {
+			fprintf(stderr, "Router (%d,%d) on line %d of '%s' is not within the machine.\n"
+			              , x, y, line_num, filename);
+			exit(-1);
+		}
+		
+		if (route < 0 || route >= (1 << 7)) {
+			fprintf(stderr, "Route on line %d of '%s' must be a mask of the 7 router outputs.\n"
+			              , line_num, filename);
+			exit(-1);
+		}
+		
+		spinn_mc_table_add( &(sim->mc_tables[(y*sim->system_size.x) + x])
+		                  , (uint32_t)key
+		                  , (uint32_t)mask
+		                  , (unsigned int)route
+		                  );
+	}
+	
+	fclose(f);
+}
+
+
+/**
+ * Initialise a node's router. If routers are being batched, the router is added
+ * to the simulation's router array, otherwise it is scheduled individually.
+ */
+static void
+spinn_node_router_init(spinn_sim_t *sim, spinn_node_t *node)
+{
+	// Get a pointer to each of the output buffers
+	buffer_t *output_buffers[7];
+	for (int i = 0; i < 6; i++) {
+		output_buffers[i] = &(node->output_buffers[i]);
+	}
+	output_buffers[SPINN_LOCAL] = &(node->con_buffer);
+	
+	// Set up the router
+	int router_period = spinn_sim_config_lookup_int(sim, "model.router.period");
+	int router_pipeline_length = spinn_sim_config_lookup_int(sim, "model.router.pipeline_length");
+	bool use_emg_routing = spinn_sim_config_lookup_bool(sim, "model.router.use_emergency_routing");
+	int first_timeout = spinn_sim_config_lookup_int(sim, "model.router.first_timeout");
+	int final_timeout = spinn_sim_config_lookup_int(sim, "model.router.final_timeout");
+	
+	// Dropped packets are handled by a separate serial event when multi-threaded
+	// or batched (see spinn_node_init).
+	// Note: the spinn_sim_stat_on_drop callback is also responsible for freeing
+	// packets
+	void (*on_drop)(spinn_router_t *, spinn_packet_t *, void *)
+		= (sim->num_threads > 1 || sim->batch_routers) ? spinn_sim_stat_on_drop_deferred
+		                                               : spinn_sim_stat_on_drop;
+	
+	if (sim->batch_routers)
+		spinn_router_array_add( &(sim->routers)
+		                      , &(node->router)
+		                      , &(node->arb_last_out)
+		                      , output_buffers
+		                      , &(node->pool)
+		                      , node->position
+		                      , use_emg_routing
+		                      , first_timeout
+		                      , final_timeout
+		                      , spinn_sim_stat_on_forward, (void *)node
+		                      , on_drop, (void *)node
+		                      );
+	else
+		spinn_router_init( &(node->router)
+		                 , &(sim->scheduler)
+		                 , router_period
+		                 , router_pipeline_length
+		                 , &(node->arb_last_out)
+		                 , output_buffers
+		                 , &(node->pool)
+		                 , node->position
+		                 , use_emg_routing
+		                 , first_timeout
+		                 , final_timeout
+		                 , spinn_sim_stat_on_forward, (void *)node
+		                 , on_drop, (void *)node
+		                 );
+	
+	if (sim->routing_tables != NULL) {
+		size_t num_nodes  = (size_t)sim->system_size.x * (size_t)sim->system_size.y;
+		size_t node_index = ((size_t)node->position.y * sim->system_size.x) + node->position.x;
+		spinn_router_set_routing_table( &(node->router)
+		                              , sim->routing_tables + (node_index * num_nodes)
+		                              , sim->system_size.x
+		                              );
+	}
+	
+	if (sim->mc_tables != NULL) {
+		int node_index = (node->position.y * sim->system_size.x) + node->position.x;
+		spinn_router_set_mc_table(&(node->router), &(sim->mc_tables[node_index]));
+	}
+}
+
+
+/**
+ * The random components of a node, each of which has its own random number
+ * stream.
+ */
+typedef enum spinn_sim_rng_component {
+	SPINN_SIM_RNG_PACKET_GEN,
+	SPINN_SIM_RNG_PACKET_CON,
+} spinn_sim_rng_component_t;
+
+
+/**
+ * Internal function.
+ *
+ * The stream number of the random number generator of one of a node's
+ * components. As well as the node and component, streams are keyed by the group
+ * and sample in which the model is initialised so that cold-started groups and
+ * samples (including those run in separate processes) each draw different
+ * numbers.
+ */
+static uint64_t
+get_rng_stream(spinn_node_t *node, spinn_sim_rng_component_t component)
+{
+	uint64_t node_index = (uint64_t)((node->position.y * node->sim->system_size.x)
+	                                 + node->position.x);
+	return ((uint64_t)(node->sim->cur_group  & 0xFFFF) << 48)
+	     | ((uint64_t)(node->sim->cur_sample & 0xFFFF) << 32)
+	     | (node_index << 8)
+	     | (uint64_t)component;
+}
+
+
 /**
  * Initialise a node (but not the links/delays to neighbours).
  *
@@ -303,125 +827,75 @@ spinn_node_init( spinn_sim_t   *sim
 	node->position = position;
 	node->enabled  = enabled;
 	
+	// All of the node's components are placed in a single partition of the
+	// schedule (except those which must be run serially)
+	int node_index = (position.y * sim->system_size.x) + position.x;
+	scheduler_set_partition(&(sim->scheduler), node_index);
+	
+	// The node's packets are allocated from its own local pool
+	spinn_packet_pool_init_local( &(node->pool), &(sim->pool)
+	                            , node_packet_pool_batch_size(sim)
+	                            );
+	node->delivered_packet_pending = false;
+	
+	// Create the node's buffers, all carved from the node's region of the
+	// buffer arena
+	buffer_value_t *buffer_storage = sim->buffer_arena
+	                                 + (node_index * sim->buffer_arena_node_size);
+	buffer_value_t *buffer_storage_end = buffer_storage + sim->buffer_arena_node_size;
+	
 	// Create node-to-node link buffers
 	int input_buffer_length = spinn_sim_config_lookup_int(sim, "model.node_to_node_links.input_buffer_length");
 	int output_buffer_length = spinn_sim_config_lookup_int(sim, "model.node_to_node_links.output_buffer_length");
 	for (int i = 0; i < 6; i++) {
-		buffer_init(&(node->input_buffers[i]), input_buffer_length);
-		buffer_init(&(node->output_buffers[i]), output_buffer_length);
+		node_buffer_init(&(node->input_buffers[i]), input_buffer_length, &buffer_storage);
+		node_buffer_init(&(node->output_buffers[i]), output_buffer_length, &buffer_storage);
 	}
 	
 	// Create buffer for the local gen/con links
 	int gen_buffer_length = spinn_sim_config_lookup_int(sim, "model.packet_generator.buffer_length");
 	int con_buffer_length = spinn_sim_config_lookup_int(sim, "model.packet_consumer.buffer_length");
-	buffer_init(&(node->gen_buffer), gen_buffer_length);
-	buffer_init(&(node->con_buffer), con_buffer_length);
+	node_buffer_init(&(node->gen_buffer), gen_buffer_length, &buffer_storage);
+	node_buffer_init(&(node->con_buffer), con_buffer_length, &buffer_storage);
 	
-	// Create buffers for the arbiter tree
+	// Create the output buffer of the arbiter tree and space for the buffers
+	// within it
 	int root_buffer_length = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.root.buffer_length");
 	int lvl1_buffer_length = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl1.buffer_length");
 	int lvl2_buffer_length = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl2.buffer_length");
-	buffer_init(&(node->arb_last_out), root_buffer_length);
-	buffer_init(&(node->arb_e_s_ne_n_out), lvl1_buffer_length);
-	buffer_init(&(node->arb_w_sw_l_out), lvl1_buffer_length);
-	buffer_init(&(node->arb_e_s_out), lvl2_buffer_length);
-	buffer_init(&(node->arb_ne_n_out), lvl2_buffer_length);
-	buffer_init(&(node->arb_w_sw_out), lvl2_buffer_length);
-	
-	// Create arbiter tree which looks like this (with the levels indicated
-	// below):
-	//
-	//        |\                                         ,------ KEY --------,
-	//     E--| |_,--,_                                  |                   |
-	//     S--| | '--' |    |\                           |             |\    |
-	//        |/       `----| |_,--,_                    | Merger:  ---| |__ |
-	//                 ,----| | '--' |                   |          ---| |   |
-	//        |\       |    |/       |   |\              |             |/    |
-	//    NE--| |_,--,_|             '---| |_,--,___     |                   |
-	//     N--| | '--'               ,---| | '--'        | Buffer:  __,--,__ |
-	//        |/            |\       |   |/              |            '--'   |
-	//                 ,----| |_,--,_|                   '-------------------'
-	//        |\       | ,--| | '--'
-	//     W--| |_,--,_| |  |/
-	//    SW--| | '--'   |
-	//        |/         |
-	//                   |
-	//     L-------------'
-	//
-	//      `----v----'   `----v----'    `----v----'
-	//         Lvl2           Lvl1           Root
+	node_buffer_init(&(node->arb_last_out), root_buffer_length, &buffer_storage);
+	buffer_value_t *arbiter_tree_storage = buffer_storage;
+	buffer_storage += spinn_arbiter_tree_storage_size(lvl1_buffer_length, lvl2_buffer_length);
+	
+	// The router drops at most one packet per period
+	node_buffer_init(&(node->dropped_packets), 1, &buffer_storage);
+	
+	// The arena must have been sized for exactly these buffers (see
+	// node_buffer_arena_size)
+	assert(buffer_storage <= buffer_storage_end);
+	
+	// Create the arbiter tree (see spinn_arbiter_tree.h) which merges the link
+	// inputs and the local packet generator into the router's input
 	int root_period = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.root.period");
 	int lvl1_period = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl1.period");
 	int lvl2_period = spinn_sim_config_lookup_int(sim, "model.arbiter_tree.lvl2.period");
 	
-	// Root
-	buffer_t *arb_last_inputs[] = { &(node->arb_e_s_ne_n_out) 
-	                              , &(node->arb_w_sw_l_out)
-	                              };
-	if (node->enabled)
-		arbiter_init( &(node->arb_last)
-		            , &(sim->scheduler)
-		            , root_period
-		            , arb_last_inputs, 2
-		            , &(node->arb_last_out)
-		            );
-	
-	// Lvl 1
-	buffer_t *arb_e_s_ne_n_inputs[] = { &(node->arb_e_s_out) 
-	                                  , &(node->arb_ne_n_out)
-	                                  };
-	if (node->enabled)
-		arbiter_init( &(node->arb_e_s_ne_n)
-		            , &(sim->scheduler)
-		            , lvl1_period
-		            , arb_e_s_ne_n_inputs, 2
-		            , &(node->arb_e_s_ne_n_out)
-		            );
-	
-	buffer_t *arb_w_sw_l_inputs[] = { &(node->arb_w_sw_out) 
-	                                , &(node->gen_buffer)
-	                                };
-	if (node->enabled)
-		arbiter_init( &(node->arb_w_sw_l)
-		            , &(sim->scheduler)
-		            , lvl1_period
-		            , arb_w_sw_l_inputs, 2
-		            , &(node->arb_w_sw_l_out)
-		            );
-	
-	// Lvl 2
-	buffer_t *arb_e_s_inputs[] = { &(node->input_buffers[SPINN_EAST]) 
-	                             , &(node->input_buffers[SPINN_SOUTH])
-	                             };
-	if (node->enabled)
-		arbiter_init( &(node->arb_e_s)
-		            , &(sim->scheduler)
-		            , lvl2_period
-		            , arb_e_s_inputs, 2
-		            , &(node->arb_e_s_out)
-		            );
-	
-	buffer_t *arb_ne_n_inputs[] = { &(node->input_buffers[SPINN_NORTH_EAST]) 
-	                             , &(node->input_buffers[SPINN_NORTH])
-	                             };
-	if (node->enabled)
-		arbiter_init( &(node->arb_ne_n)
-		            , &(sim->scheduler)
-		            , lvl2_period
-		            , arb_ne_n_inputs, 2
-		            , &(node->arb_ne_n_out)
-		            );
-	
-	buffer_t *arb_w_sw_inputs[] = { &(node->input_buffers[SPINN_WEST]) 
-	                              , &(node->input_buffers[SPINN_SOUTH_WEST])
-	                              };
+	buffer_t *arbiter_tree_inputs[7];
+	for (int i = 0; i < 6; i++)
+		arbiter_tree_inputs[i] = &(node->input_buffers[i]);
+	arbiter_tree_inputs[SPINN_LOCAL] = &(node->gen_buffer);
 	if (node->enabled)
-		arbiter_init( &(node->arb_w_sw)
-		            , &(sim->scheduler)
-		            , lvl2_period
-		            , arb_w_sw_inputs, 2
-		            , &(node->arb_w_sw_out)
-		            );
+		spinn_arbiter_tree_init( &(node->arbiter_tree)
+		                       , &(sim->scheduler)
+		                       , arbiter_tree_inputs
+		                       , &(node->arb_last_out)
+		                       , root_period
+		                       , lvl1_period
+		                       , lvl2_period
+		                       , lvl1_buffer_length
+		                       , lvl2_buffer_length
+		                       , arbiter_tree_storage
+		                       );
 	
 	
 	// Packet generator
@@ -430,7 +904,7 @@ spinn_node_init( spinn_sim_t   *sim
 		spinn_packet_gen_init( &(node->packet_gen)
 		                     , &(sim->scheduler)
 		                     , &(node->gen_buffer)
-		                     , &(sim->pool)
+		                     , &(node->pool)
 		                     , node->position
 		                     , sim->system_size
 		                     , gen_period
@@ -438,51 +912,81 @@ spinn_node_init( spinn_sim_t   *sim
 		                     , dest_filter, (void *)node
 		                     , spinn_sim_stat_on_packet_gen, (void *)node
 		                     );
-
-	configure_node_packet_gen(node);
 	
-	// Packet consumer
+	// Packets routed by routing tables need not carry their own route
+	if (node->enabled)
+		spinn_packet_gen_set_dor_routing(&(node->packet_gen), sim->routing_tables == NULL);
+	
+	if (node->enabled)
+		spinn_packet_gen_set_seed( &(node->packet_gen), sim->seed
+		                         , get_rng_stream(node, SPINN_SIM_RNG_PACKET_GEN)
+		                         );
+	
+	if (node->enabled)
+		configure_node_packet_gen(node);
+	
+	// Packet consumer. When multi-threaded, the logging of delivered packets is
+	// deferred in the same way as for dropped packets (see below).
 	int con_period = spinn_sim_config_lookup_int(sim, "model.packet_consumer.period");
 	if (node->enabled)
 		spinn_packet_con_init( &(node->packet_con)
 		                     , &(sim->scheduler)
 		                     , &(node->con_buffer)
-		                     , &(sim->pool)
+		                     , &(node->pool)
 		                     , con_period
-		                     , spinn_sim_stat_on_packet_con, (void *)node
+		                     , (sim->num_threads > 1) ? spinn_sim_stat_on_packet_con_deferred
+		                                              : spinn_sim_stat_on_packet_con
+		                     , (void *)node
 		                     );
 	
-	configure_node_packet_con(node);
+	if (node->enabled)
+		spinn_packet_con_set_seed( &(node->packet_con), sim->seed
+		                         , get_rng_stream(node, SPINN_SIM_RNG_PACKET_CON)
+		                         );
 	
-	// Get a pointer to each of the output buffers
-	buffer_t *output_buffers[7];
-	for (int i = 0; i < 6; i++) {
-		output_buffers[i] = &(node->output_buffers[i]);
+	if (node->enabled)
+		configure_node_packet_con(node);
+	
+	scheduler_set_partition(&(sim->scheduler), SCHEDULER_PARTITION_SERIAL);
+	
+	// The deferred logging of delivered packets is scheduled immediately after
+	// the consumer, keeping the order of packet logging identical to a
+	// single-threaded simulation. The event only exists when delivered packets
+	// are being logged.
+	if (node->enabled && sim->num_threads > 1
+	    && (sim->stat_log_delivered_packets || sim->stat_histograms_enabled)) {
+		scheduler_event_t *event = scheduler_schedule( &(sim->scheduler), con_period
+		                                             , NULL, NULL
+		                                             , spinn_sim_stat_process_delivered_packets, (void *)node
+		                                             );
+		scheduler_set_next_activity( &(sim->scheduler), event
+		                           , spinn_sim_stat_delivered_packets_next_activity, (void *)node
+		                           );
 	}
-	output_buffers[SPINN_LOCAL] = &(node->con_buffer);
 	
-	// Set up the router
+	// When multi-threaded or when the routers are batched together, the logging
+	// and freeing of dropped packets is deferred to a serial event. This is
+	// scheduled before the router so that it is run immediately after it (or, for
+	// batched routers, where the router would have been), keeping the order of
+	// packet logging and allocation identical to a single-threaded simulation.
 	int router_period = spinn_sim_config_lookup_int(sim, "model.router.period");
-	int router_pipeline_length = spinn_sim_config_lookup_int(sim, "model.router.pipeline_length");
-	bool use_emg_routing = spinn_sim_config_lookup_bool(sim, "model.router.use_emergency_routing");
-	int first_timeout = spinn_sim_config_lookup_int(sim, "model.router.first_timeout");
-	int final_timeout = spinn_sim_config_lookup_int(sim, "model.router.final_timeout");
-	if (node->enabled)
-		// Note: the spinn_sim_stat_on_drop callback is also responsible for freeing
-		// packets
-		spinn_router_init( &(node->router)
-		                 , &(sim->scheduler)
-		                 , router_period
-		                 , router_pipeline_length
-		                 , &(node->arb_last_out)
-		                 , output_buffers
-		                 , node->position
-		                 , use_emg_routing
-		                 , first_timeout
-		                 , final_timeout
-		                 , spinn_sim_stat_on_forward, (void *)node
-		                 , spinn_sim_stat_on_drop, (void *)node
-		                 );
+	if (node->enabled && (sim->num_threads > 1 || sim->batch_routers)) {
+		scheduler_event_t *event = scheduler_schedule( &(sim->scheduler), router_period
+		                                             , NULL, NULL
+		                                             , spinn_sim_stat_process_dropped_packets, (void *)node
+		                                             );
+		scheduler_set_next_activity( &(sim->scheduler), event
+		                           , spinn_sim_stat_dropped_packets_next_activity, (void *)node
+		                           );
+	}
+	
+	// Batched routers are added once all nodes have been created (see
+	// spinn_sim_model_init)
+	scheduler_set_partition(&(sim->scheduler), node_index);
+	if (node->enabled && !sim->batch_routers)
+		spinn_node_router_init(sim, node);
+	
+	scheduler_set_partition(&(sim->scheduler), SCHEDULER_PARTITION_SERIAL);
 }
 
 
@@ -495,12 +999,7 @@ spinn_node_destroy(spinn_node_t *node)
 		spinn_packet_gen_destroy(&(node->packet_gen));
 		spinn_packet_con_destroy(&(node->packet_con));
 		
-		arbiter_destroy(&(node->arb_e_s));
-		arbiter_destroy(&(node->arb_ne_n));
-		arbiter_destroy(&(node->arb_w_sw));
-		arbiter_destroy(&(node->arb_e_s_ne_n));
-		arbiter_destroy(&(node->arb_w_sw_l));
-		arbiter_destroy(&(node->arb_last));
+		spinn_arbiter_tree_destroy(&(node->arbiter_tree));
 	}
 	
 	for (int i = 0; i < 6; i++) {
@@ -509,12 +1008,10 @@ spinn_node_destroy(spinn_node_t *node)
 	}
 	buffer_destroy(&(node->gen_buffer));
 	buffer_destroy(&(node->con_buffer));
-	buffer_destroy(&(node->arb_e_s_out));
-	buffer_destroy(&(node->arb_ne_n_out));
-	buffer_destroy(&(node->arb_w_sw_out));
-	buffer_destroy(&(node->arb_e_s_ne_n_out));
-	buffer_destroy(&(node->arb_w_sw_l_out));
 	buffer_destroy(&(node->arb_last_out));
+	buffer_destroy(&(node->dropped_packets));
+	
+	spinn_packet_pool_destroy(&(node->pool));
 }
 
 
@@ -528,6 +1025,26 @@ spinn_sim_model_init(spinn_sim_t *sim)
 	scheduler_init(&(sim->scheduler));
 	spinn_packet_pool_init(&(sim->pool));
 	
+	// Execution of the simulation may be split between several threads
+	bool compile_schedule = spinn_sim_config_lookup_bool_default(sim, "simulator.compile_schedule", true);
+	sim->num_threads = spinn_sim_config_lookup_int_default(sim, "simulator.num_threads", 1);
+	if (sim->num_threads < 1 || (sim->num_threads > 1 && !compile_schedule)) {
+		fprintf(stderr, "simulator.num_threads must be at least 1 and may only be more than 1 when simulator.compile_schedule is True.\n");
+		exit(-1);
+	}
+	scheduler_set_num_threads(&(sim->scheduler), sim->num_threads);
+	
+	// Components with nothing to do may be skipped by the compiled schedule
+	scheduler_set_activity_tracking( &(sim->scheduler)
+	                               , spinn_sim_config_lookup_bool_default(sim, "simulator.activity_tracking", true)
+	                               );
+	
+	// Idle periods may be skipped over entirely
+	sim->fast_forward = spinn_sim_config_lookup_bool_default(sim, "simulator.fast_forward", true);
+	
+	// All routers may be simulated together by a single event
+	sim->batch_routers = spinn_sim_config_lookup_bool_default(sim, "simulator.batch_routers", false);
+	
 	bool use_wrap_around_links;
 	
 	// Get the network topology information
@@ -566,9 +1083,20 @@ spinn_sim_model_init(spinn_sim_t *sim)
 		exit(-1);
 	}
 	
+	// Packets store coordinates in a single byte
+	if (sim->system_size.x > SPINN_PACKET_MAX_COORD + 1 ||
+	    sim->system_size.y > SPINN_PACKET_MAX_COORD + 1) {
+		fprintf( stderr
+		       , "Systems larger than %dx%d nodes are not supported.\n"
+		       , SPINN_PACKET_MAX_COORD + 1, SPINN_PACKET_MAX_COORD + 1
+		       );
+		exit(-1);
+	}
+	
 	// Should it be possible for a node to send a packet to itself?
 	configure_allow_local_packets(sim);
 	
+	
 	// Set up the mask of which nodes should be enabled (specifically, when using
 	// a board_mesh topology, disable the nodes not in the mesh
 	sim->node_enable_mask = calloc( sim->system_size.x*sim->system_size.y
@@ -603,11 +1131,35 @@ spinn_sim_model_init(spinn_sim_t *sim)
 	assert(sim->node_packet_gen_p2p_target != NULL);
 	load_packet_gen_p2p_dist(sim);
 	
+	// Set up the table of destinations for randomly picked destinations
+	sim->packet_gen_dest_table = NULL;
+	sim->packet_gen_dests      = NULL;
+	load_packet_gen_dest_table(sim);
+	
+	// Are packets routed by precomputed routing tables?
+	configure_routing(sim, use_wrap_around_links);
+	
+	// Load any multicast routing tables
+	load_mc_tables(sim);
+	
 	// Create the required number of nodes
 	sim->nodes = calloc( sim->system_size.x*sim->system_size.y
 	                   , sizeof(spinn_node_t)
 	                   );
 	assert(sim->nodes != NULL);
+	
+	// Allocate the storage for every node's buffers in one go so that each
+	// node's buffers are contiguous in memory
+	sim->buffer_arena_node_size = node_buffer_arena_size(sim);
+	size_t buffer_arena_bytes = sim->system_size.x*sim->system_size.y
+	                            * sim->buffer_arena_node_size
+	                            * sizeof(buffer_value_t);
+	int error = posix_memalign( (void **)&(sim->buffer_arena)
+	                          , SPINN_SIM_CACHE_LINE_BYTES
+	                          , buffer_arena_bytes
+	                          );
+	assert(error == 0);
+	memset(sim->buffer_arena, 0, buffer_arena_bytes);
 	for (int y = 0; y < sim->system_size.y; y++) {
 		for (int x = 0; x < sim->system_size.x; x++) {
 			int i = (y * sim->system_size.x) + x;
@@ -649,7 +1201,8 @@ spinn_sim_model_init(spinn_sim_t *sim)
 				buffer_t *input_buffer = &(neighbour->input_buffers[spinn_opposite(directions[i])]);
 				buffer_t *output_buffer = &(node->output_buffers[i]);
 				
-				// Set up the delay
+				// Set up the delay (in the partition of the node it takes packets from)
+				scheduler_set_partition(&(sim->scheduler), (y * sim->system_size.x) + x);
 				delay_init( &(node->delays[i])
 				          , &(sim->scheduler)
 				          , 1
@@ -660,6 +1213,64 @@ spinn_sim_model_init(spinn_sim_t *sim)
 			}
 		}
 	}
+	
+	scheduler_set_partition(&(sim->scheduler), SCHEDULER_PARTITION_SERIAL);
+	
+	// Snapshots of the network's state look at every node and so must be taken
+	// serially. The event only exists when a time series is being recorded.
+	if (sim->stat_time_series_interval > 0) {
+		scheduler_event_t *event = scheduler_schedule( &(sim->scheduler), 1
+		                                             , spinn_sim_stat_time_series_tick, (void *)sim
+		                                             , NULL, NULL
+		                                             );
+		scheduler_set_next_activity( &(sim->scheduler), event
+		                           , spinn_sim_stat_time_series_next_activity, (void *)sim
+		                           );
+	}
+	
+	// Batched routers are advanced by a single event which must be run serially.
+	// Scheduling it last causes it to run before each node's dropped-packet
+	// handling event (see spinn_node_init).
+	if (sim->batch_routers) {
+		spinn_router_array_init( &(sim->routers)
+		                       , &(sim->scheduler)
+		                       , spinn_sim_config_lookup_int(sim, "model.router.period")
+		                       , spinn_sim_config_lookup_int(sim, "model.router.pipeline_length")
+		                       , sim->system_size.x*sim->system_size.y
+		                       );
+		for (int i = 0; i < sim->system_size.x*sim->system_size.y; i++)
+			if (sim->nodes[i].enabled)
+				spinn_node_router_init(sim, &(sim->nodes[i]));
+	}
+	
+	// Allocate the packet pool up-front, if required, rather than letting it
+	// grow while the simulation runs. A value of -1 selects the most packets the
+	// system can hold at once plus those which may be cached by the nodes' local
+	// pools (up to two batches each).
+	size_t max_system_packets = sim->system_size.x*sim->system_size.y
+	                            * (node_max_packets(sim)
+	                               + (2 * node_packet_pool_batch_size(sim)));
+	int pool_preallocate = spinn_sim_config_lookup_int_default(sim, "simulator.packet_pool.preallocate", 0);
+	int pool_max_packets = spinn_sim_config_lookup_int_default(sim, "simulator.packet_pool.max_packets", 0);
+	if (pool_preallocate < -1 || pool_max_packets < -1) {
+		fprintf(stderr, "simulator.packet_pool.preallocate and simulator.packet_pool.max_packets must be at least -1.\n");
+		exit(-1);
+	}
+	spinn_packet_pool_set_use_huge_pages( &(sim->pool)
+	                                    , spinn_sim_config_lookup_bool_default(sim, "simulator.packet_pool.huge_pages", false)
+	                                    );
+	spinn_packet_pool_set_max_packets( &(sim->pool)
+	                                 , (pool_max_packets == -1) ? max_system_packets
+	                                                            : (size_t)pool_max_packets
+	                                 );
+	spinn_packet_pool_reserve( &(sim->pool)
+	                         , (pool_preallocate == -1) ? max_system_packets
+	                                                    : (size_t)pool_preallocate
+	                         );
+	
+	// The model is now complete, freeze the schedule for faster execution
+	if (compile_schedule)
+		scheduler_compile(&(sim->scheduler));
 }
 
 
@@ -668,16 +1279,29 @@ void
 spinn_sim_model_destroy(spinn_sim_t *sim)
 {
 	scheduler_destroy(&(sim->scheduler));
-	spinn_packet_pool_destroy(&(sim->pool));
 	
+	// The nodes' local pools return their packets to the simulation's pool
 	for (int i = 0; i < sim->system_size.x*sim->system_size.y; i++) {
 		spinn_node_destroy(&(sim->nodes[i]));
 		for (int j = 0; j < 6; j++)
 			delay_destroy(&(sim->nodes[i].delays[j]));
 	}
+	spinn_packet_pool_destroy(&(sim->pool));
 	free(sim->node_enable_mask);
 	free(sim->node_packet_gen_p2p_target);
+	free_packet_gen_dest_table(sim);
 	free(sim->nodes);
+	free(sim->buffer_arena);
+	free(sim->routing_tables);
+	
+	if (sim->mc_tables != NULL) {
+		for (int i = 0; i < sim->system_size.x*sim->system_size.y; i++)
+			spinn_mc_table_destroy(&(sim->mc_tables[i]));
+		free(sim->mc_tables);
+	}
+	
+	if (sim->batch_routers)
+		spinn_router_array_destroy(&(sim->routers));
 }
 
 
@@ -688,6 +1312,9 @@ spinn_sim_model_destroy(spinn_sim_t *sim)
 void
 spinn_sim_model_update(spinn_sim_t *sim)
 {
+	configure_allow_local_packets(sim);
+	load_packet_gen_dest_table(sim);
+	
 	for (int y = 0; y < sim->system_size.y; y++) {
 		for (int x = 0; x < sim->system_size.x; x++) {
 			spinn_node_t *node = &(sim->nodes[(y * sim->system_size.x) + x]);
@@ -696,8 +1323,10 @@ spinn_sim_model_update(spinn_sim_t *sim)
 			
 			load_packet_gen_p2p_dist(sim);
 			
-			configure_node_packet_gen(node);
-			configure_node_packet_con(node);
+			if (node->enabled) {
+				configure_node_packet_gen(node);
+				configure_node_packet_con(node);
+			}
 			configure_node_to_node_links(node);
 		}
 	}
@@ -8,6 +8,8 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <string.h>
@@ -76,6 +78,581 @@ fprint_standard_fields(spinn_sim_t *sim, FILE *file)
 }
 
 
+/**
+ * Format the standard fields of the current sample into
+ * sim->stat_standard_fields.
+ */
+void
+format_standard_fields(spinn_sim_t *sim)
+{
+	free(sim->stat_standard_fields);
+	
+	FILE *file = open_memstream( &(sim->stat_standard_fields)
+	                           , &(sim->stat_standard_fields_len)
+	                           );
+	assert(file != NULL);
+	fprint_standard_fields(sim, file);
+	fclose(file);
+}
+
+
+/******************************************************************************
+ * Output files
+ ******************************************************************************/
+
+// The size of each of the two buffers of every statistic output file
+#define SPINN_SIM_STAT_BUFFER_SIZE (1024 * 1024)
+
+
+/**
+ * Internal function. Open a statistic output file in the results directory,
+ * exiting on failure. The file is compressed (and ".gz" appended to its name)
+ * if required. The format function and its data are passed to async_file_init.
+ */
+static async_file_t *
+open_stat_file( spinn_sim_t         *sim
+              , const char          *basename
+              , async_file_format_t  format
+              , void                *format_data
+              )
+{
+	const char *result_dir = spinn_sim_config_lookup_string(sim, "measurements.results_directory");
+	const char *suffix     = sim->stat_compress ? ".gz" : "";
+	
+	// A string long enough for the filename
+	char *filename = calloc( strlen(result_dir) + strlen(basename) + strlen(suffix) + 1
+	                       , sizeof(char)
+	                       );
+	assert(filename != NULL);
+	strcpy(filename, result_dir);
+	strcat(filename, basename);
+	strcat(filename, suffix);
+	
+	FILE *stream = fopen(filename, "w");
+	if (stream == NULL) {
+		fprintf(stderr, "Couldn't open %s for writing!\n", filename);
+		exit(-1);
+	}
+	
+	async_file_t *file = malloc(sizeof(async_file_t));
+	assert(file != NULL);
+	async_file_init( file, stream
+	               , SPINN_SIM_STAT_BUFFER_SIZE
+	               , sim->stat_compress
+	               , format, format_data
+	               );
+	
+	// Clean up
+	free(filename);
+	
+	return file;
+}
+
+
+/**
+ * Internal function. Close a statistic output file opened by open_stat_file (if
+ * it was opened), writing out any remaining data.
+ */
+static void
+close_stat_file(async_file_t *file, const char *name)
+{
+	if (file == NULL)
+		return;
+	
+	if (!async_file_destroy(file))
+		fprintf(stderr, "Error closing %s data file.\n", name);
+	free(file);
+}
+
+
+/**
+ * Internal function. Write the header columns (without terminating \t) for all
+ * common fields to a statistic output file.
+ */
+static void
+write_standard_fields_headers(spinn_sim_t *sim, async_file_t *file)
+{
+	char *header;
+	size_t header_len;
+	FILE *header_file = open_memstream(&header, &header_len);
+	assert(header_file != NULL);
+	fprint_standard_fields_headers(sim, header_file);
+	fclose(header_file);
+	
+	async_file_write(file, header, header_len);
+	free(header);
+}
+
+
+/**
+ * Internal function. Write the columns (without terminating \t) for all common
+ * fields of the current sample to a statistic output file.
+ */
+static void
+write_standard_fields(spinn_sim_t *sim, async_file_t *file)
+{
+	async_file_write(file, sim->stat_standard_fields, sim->stat_standard_fields_len);
+}
+
+
+/******************************************************************************
+ * Packet details
+ ******************************************************************************/
+
+/*
+ * Packet details may be written as text or in a binary format. Either way,
+ * records are buffered and appended to the file's buffer as a block, one column
+ * at a time, with the standard fields (which are the same for every record of a
+ * sample) appended once per block. For text files, the file's writer thread
+ * converts these blocks into text (see format_packet_details_text), otherwise
+ * they are written out verbatim.
+ *
+ * All values are in the simulator's native byte order which can be determined
+ * from the version number. The binary format consists of:
+ *
+ *   "TSPD"                         -- Magic number
+ *   uint32 version                 -- SPINN_SIM_STAT_PACKET_DETAILS_VERSION
+ *   uint32 length, char[length]    -- The text format's header line
+ *   uint32 num_cols, char[num_cols]-- The type of each of the packet columns
+ *                                     (the last num_cols columns of the
+ *                                     header) as a Python struct character
+ *
+ * followed by any number of blocks of the form:
+ *
+ *   uint32 num_records
+ *   uint32 length, char[length]    -- The standard fields of every record in
+ *                                     the block, formatted as in text files
+ *   For each column in turn, num_records values of the column's type
+ *
+ * The utility util/packet_details_to_tsv.py converts such files into the text
+ * format.
+ */
+
+#define SPINN_SIM_STAT_PACKET_DETAILS_VERSION 1u
+
+// The names and types of the packet details columns
+#define SPINN_SIM_STAT_PACKET_DETAILS_COLUMNS \
+	"\tdelivered\t" \
+	"source_x\tsource_y\tdest_x\tdest_y\t" \
+	"sent_time\tlatency\tnum_hops\temg_hops"
+#define SPINN_SIM_STAT_PACKET_DETAILS_TYPES "BBBBBiiHH"
+
+
+/**
+ * Internal function. Copy len bytes into a buffer, returning a pointer to the
+ * end of the copied bytes.
+ */
+static char *
+put_bytes(char *buffer, const void *data, size_t len)
+{
+	memcpy(buffer, data, len);
+	return buffer + len;
+}
+
+
+/**
+ * Internal function. Copy len bytes out of a buffer, returning a pointer to the
+ * end of the copied bytes.
+ */
+static const char *
+get_bytes(const char *buffer, void *data, size_t len)
+{
+	memcpy(data, buffer, len);
+	return buffer + len;
+}
+
+
+/**
+ * Internal function. Append a length-prefixed string to a buffer.
+ */
+static char *
+put_string(char *buffer, const char *string, size_t len)
+{
+	uint32_t len32 = (uint32_t)len;
+	buffer = put_bytes(buffer, &len32, sizeof(uint32_t));
+	return put_bytes(buffer, string, len);
+}
+
+
+/**
+ * Internal function. Append the header of the packet details to the packet
+ * details file.
+ */
+static void
+write_packet_details_header(spinn_sim_t *sim)
+{
+	// The header line
+	char *header;
+	size_t header_len;
+	FILE *header_file = open_memstream(&header, &header_len);
+	assert(header_file != NULL);
+	fprint_standard_fields_headers(sim, header_file);
+	fprintf(header_file, "%s", SPINN_SIM_STAT_PACKET_DETAILS_COLUMNS);
+	fclose(header_file);
+	
+	const char *types = SPINN_SIM_STAT_PACKET_DETAILS_TYPES;
+	uint32_t version = SPINN_SIM_STAT_PACKET_DETAILS_VERSION;
+	
+	char *p = async_file_reserve( sim->stat_file_packet_details
+	                            , 4 + sizeof(uint32_t)
+	                              + sizeof(uint32_t) + header_len
+	                              + sizeof(uint32_t) + strlen(types)
+	                            );
+	p = put_bytes(p, "TSPD", 4);
+	p = put_bytes(p, &version, sizeof(uint32_t));
+	p = put_string(p, header, header_len);
+	p = put_string(p, types, strlen(types));
+	
+	free(header);
+}
+
+
+/**
+ * Internal function. Append any buffered packet details records to the packet
+ * details file as a block.
+ */
+static void
+write_packet_details_block(spinn_sim_t *sim)
+{
+	spinn_sim_stat_packet_columns_t *c = sim->stat_packet_columns;
+	size_t n = c->num_records;
+	
+	if (n == 0)
+		return;
+	
+	size_t record_size = sizeof(c->delivered[0])
+	                   + sizeof(c->source_x[0]) + sizeof(c->source_y[0])
+	                   + sizeof(c->dest_x[0])   + sizeof(c->dest_y[0])
+	                   + sizeof(c->sent_time[0]) + sizeof(c->latency[0])
+	                   + sizeof(c->num_hops[0]) + sizeof(c->emg_hops[0]);
+	
+	char *p = async_file_reserve( sim->stat_file_packet_details
+	                            , sizeof(uint32_t)
+	                              + sizeof(uint32_t) + sim->stat_standard_fields_len
+	                              + n * record_size
+	                            );
+	
+	uint32_t n32 = (uint32_t)n;
+	p = put_bytes(p, &n32, sizeof(uint32_t));
+	p = put_string(p, sim->stat_standard_fields, sim->stat_standard_fields_len);
+	
+	p = put_bytes(p, c->delivered, sizeof(c->delivered[0]) * n);
+	p = put_bytes(p, c->source_x,  sizeof(c->source_x[0])  * n);
+	p = put_bytes(p, c->source_y,  sizeof(c->source_y[0])  * n);
+	p = put_bytes(p, c->dest_x,    sizeof(c->dest_x[0])    * n);
+	p = put_bytes(p, c->dest_y,    sizeof(c->dest_y[0])    * n);
+	p = put_bytes(p, c->sent_time, sizeof(c->sent_time[0]) * n);
+	p = put_bytes(p, c->latency,   sizeof(c->latency[0])   * n);
+	p = put_bytes(p, c->num_hops,  sizeof(c->num_hops[0])  * n);
+	p = put_bytes(p, c->emg_hops,  sizeof(c->emg_hops[0])  * n);
+	
+	c->num_records = 0;
+}
+
+
+/**
+ * Internal function. The format function of text packet details files (run on
+ * the file's writer thread) which converts the header and blocks appended by
+ * write_packet_details_header and write_packet_details_block into text.
+ *
+ * The header is distinguished from blocks by its magic number: a block's
+ * record count (at most SPINN_SIM_STAT_PACKET_BLOCK_RECORDS) never matches.
+ */
+static void
+format_packet_details_text(async_file_t *file, const void *buffer, size_t len, void *data)
+{
+	const char *p   = buffer;
+	const char *end = p + len;
+	
+	while (p < end) {
+		uint32_t n;
+		
+		if (memcmp(p, "TSPD", 4) == 0) {
+			// Header: output the header line only
+			p += 4 + sizeof(uint32_t);
+			p = get_bytes(p, &n, sizeof(uint32_t));
+			async_file_output(file, p, n);
+			async_file_output(file, "\n", 1);
+			p += n;
+			p = get_bytes(p, &n, sizeof(uint32_t));
+			p += n;
+			continue;
+		}
+		
+		p = get_bytes(p, &n, sizeof(uint32_t));
+		
+		uint32_t standard_fields_len;
+		p = get_bytes(p, &standard_fields_len, sizeof(uint32_t));
+		const char *standard_fields = p;
+		p += standard_fields_len;
+		
+		// Pointers to the start of each column
+		const uint8_t *delivered = (const uint8_t *)p;
+		const uint8_t *source_x  = delivered + n;
+		const uint8_t *source_y  = source_x + n;
+		const uint8_t *dest_x    = source_y + n;
+		const uint8_t *dest_y    = dest_x + n;
+		const char    *sent_time = (const char *)(dest_y + n);
+		const char    *latency   = sent_time + sizeof(int32_t) * n;
+		const char    *num_hops  = latency + sizeof(int32_t) * n;
+		const char    *emg_hops  = num_hops + sizeof(uint16_t) * n;
+		p = emg_hops + sizeof(uint16_t) * n;
+		
+		for (uint32_t i = 0; i < n; i++) {
+			// The wider columns may not be aligned
+			int32_t  record_sent_time, record_latency;
+			uint16_t record_num_hops,  record_emg_hops;
+			get_bytes(sent_time + sizeof(int32_t) * i,  &record_sent_time, sizeof(int32_t));
+			get_bytes(latency   + sizeof(int32_t) * i,  &record_latency,   sizeof(int32_t));
+			get_bytes(num_hops  + sizeof(uint16_t) * i, &record_num_hops,  sizeof(uint16_t));
+			get_bytes(emg_hops  + sizeof(uint16_t) * i, &record_emg_hops,  sizeof(uint16_t));
+			
+			char line[128];
+			int line_len = snprintf( line, sizeof(line)
+			                       , "\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n"
+			                       , delivered[i]
+			                       , source_x[i], source_y[i]
+			                       , dest_x[i],   dest_y[i]
+			                       , record_sent_time
+			                       , record_latency
+			                       , record_num_hops
+			                       , record_emg_hops
+			                       );
+			async_file_output(file, standard_fields, standard_fields_len);
+			async_file_output(file, line, line_len);
+		}
+	}
+}
+
+
+/******************************************************************************
+ * Histograms
+ ******************************************************************************/
+
+// The column name of each spinn_sim_stat_histogram_value_t
+static const char *histogram_names[SPINN_SIM_STAT_NUM_HISTOGRAMS] = {
+	"latency",
+	"num_hops",
+	"emg_hops",
+};
+
+
+/**
+ * Internal function. Add a delivered packet to the histograms being kept.
+ */
+static void
+add_packet_to_histograms(spinn_packet_t *packet, spinn_node_t *node)
+{
+	spinn_sim_t *sim = node->sim;
+	
+	uint32_t values[SPINN_SIM_STAT_NUM_HISTOGRAMS];
+	values[SPINN_SIM_STAT_HISTOGRAM_LATENCY]  = scheduler_get_ticks(&(sim->scheduler)) - packet->sent_time;
+	values[SPINN_SIM_STAT_HISTOGRAM_NUM_HOPS] = packet->num_hops;
+	values[SPINN_SIM_STAT_HISTOGRAM_EMG_HOPS] = packet->num_emg_hops;
+	
+	// The histograms of the node the packet is grouped by (if any)
+	histogram_t *node_histograms = NULL;
+	if (sim->stat_node_histograms != NULL) {
+		spinn_coord_t position = (sim->stat_histogram_node == SPINN_SIM_STAT_HISTOGRAM_NODE_SOURCE)
+		                         ? spinn_packet_get_source(packet)
+		                         : node->position;
+		node_histograms = sim->stat_node_histograms
+		                  + ((position.x + (sim->system_size.x * position.y))
+		                     * SPINN_SIM_STAT_NUM_HISTOGRAMS);
+	}
+	
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++) {
+		if (!sim->stat_histogram_enabled[i])
+			continue;
+		
+		histogram_add(&(sim->stat_histograms[i]), values[i]);
+		if (node_histograms != NULL)
+			histogram_add(&(node_histograms[i]), values[i]);
+	}
+}
+
+
+/**
+ * Internal function. Write the header columns (with a leading \t) summarising a
+ * histogram (see write_histogram_summary).
+ */
+static void
+write_histogram_summary_headers(spinn_sim_t *sim, async_file_t *file)
+{
+	async_file_printf(file, "\tvalue\tcount\tmin\tmean\tmax");
+	for (int i = 0; i < sim->stat_histogram_num_percentiles; i++)
+		async_file_printf(file, "\tp%g", sim->stat_histogram_percentiles[i]);
+}
+
+
+/**
+ * Internal function. Write the columns (with a leading \t) summarising a
+ * histogram: the name of the value, the number of values, their min, mean and
+ * max and each percentile. All but the count are NaN for empty histograms.
+ */
+static void
+write_histogram_summary( spinn_sim_t                      *sim
+                       , async_file_t                     *file
+                       , spinn_sim_stat_histogram_value_t  value
+                       , const histogram_t                *histogram
+                       )
+{
+	uint64_t count = histogram_get_count(histogram);
+	async_file_printf( file, "\t%s\t%llu"
+	                 , histogram_names[value]
+	                 , (unsigned long long)count
+	                 );
+	
+	if (count == 0) {
+		async_file_printf(file, "\tNaN\tNaN\tNaN");
+		for (int i = 0; i < sim->stat_histogram_num_percentiles; i++)
+			async_file_printf(file, "\tNaN");
+		return;
+	}
+	
+	async_file_printf( file, "\t%u\t%f\t%u"
+	                 , histogram_get_min(histogram)
+	                 , histogram_get_mean(histogram)
+	                 , histogram_get_max(histogram)
+	                 );
+	for (int i = 0; i < sim->stat_histogram_num_percentiles; i++)
+		async_file_printf( file, "\t%u"
+		                 , histogram_get_percentile(histogram, sim->stat_histogram_percentiles[i])
+		                 );
+}
+
+
+/**
+ * Internal function. Load the list of percentiles to report from the config
+ * file.
+ */
+static void
+load_histogram_percentiles(spinn_sim_t *sim)
+{
+	const char *path = "measurements.histograms.percentiles";
+	config_setting_t *list = config_lookup(&(sim->config), path);
+	
+	// Default to the median and a few tail percentiles
+	if (list == NULL) {
+		const double defaults[] = {50.0, 90.0, 99.0, 99.9};
+		sim->stat_histogram_num_percentiles = sizeof(defaults) / sizeof(defaults[0]);
+		sim->stat_histogram_percentiles = malloc(sizeof(defaults));
+		assert(sim->stat_histogram_percentiles != NULL);
+		memcpy(sim->stat_histogram_percentiles, defaults, sizeof(defaults));
+		return;
+	}
+	
+	if (config_setting_type(list) != CONFIG_TYPE_ARRAY &&
+	    config_setting_type(list) != CONFIG_TYPE_LIST) {
+		fprintf(stderr, "Error: Expected a list of percentiles in '%s'.\n", path);
+		exit(-1);
+	}
+	
+	sim->stat_histogram_num_percentiles = config_setting_length(list);
+	sim->stat_histogram_percentiles = malloc( sim->stat_histogram_num_percentiles
+	                                          * sizeof(double)
+	                                        );
+	assert(sim->stat_histogram_num_percentiles == 0 || sim->stat_histogram_percentiles != NULL);
+	
+	for (int i = 0; i < sim->stat_histogram_num_percentiles; i++) {
+		config_setting_t *elem = config_setting_get_elem(list, i);
+		double percentile;
+		switch (config_setting_type(elem)) {
+			case CONFIG_TYPE_FLOAT: percentile = config_setting_get_float(elem); break;
+			case CONFIG_TYPE_INT:   percentile = config_setting_get_int(elem);   break;
+			default:                percentile = -1.0;                           break;
+		}
+		
+		if (percentile < 0.0 || percentile > 100.0) {
+			fprintf(stderr, "Error: Item %d of '%s' is not a percentile (0.0 to 100.0).\n"
+			              , i, path);
+			exit(-1);
+		}
+		sim->stat_histogram_percentiles[i] = percentile;
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Sum the per-node packet counters over the whole system.
+ */
+static spinn_sim_stat_totals_t
+get_totals(spinn_sim_t *sim)
+{
+	spinn_sim_stat_totals_t totals = {0, 0, 0, 0};
+	for (size_t i = 0; i < sim->system_size.x*sim->system_size.y; i++) {
+		totals.packets_offered  += sim->nodes[i].stat_packets_offered;
+		totals.packets_accepted += sim->nodes[i].stat_packets_accepted;
+		totals.packets_arrived  += sim->nodes[i].stat_packets_arrived;
+		totals.packets_dropped  += sim->nodes[i].stat_packets_dropped;
+	}
+	return totals;
+}
+
+
+/**
+ * Internal function.
+ *
+ * The occupancy of the packet pool: the packets in use, those free in the
+ * simulation's pool and those cached by the nodes' local pools. Packets may be
+ * freed by a node other than the one which allocated them so only the total in
+ * use over every pool is meaningful.
+ */
+static void
+get_pool_occupancy(spinn_sim_t *sim, int *num_in_use, int *num_free, int *num_local_free)
+{
+	*num_in_use     = spinn_packet_pool_get_num_in_use(&(sim->pool));
+	*num_free       = spinn_packet_pool_get_num_free(&(sim->pool));
+	*num_local_free = 0;
+	for (size_t i = 0; i < sim->system_size.x*sim->system_size.y; i++) {
+		*num_in_use     += spinn_packet_pool_get_num_in_use(&(sim->nodes[i].pool));
+		*num_local_free += spinn_packet_pool_get_num_free(&(sim->nodes[i].pool));
+	}
+}
+
+
+/**
+ * Internal function.
+ *
+ * Write a snapshot of the current state of the network to the time series
+ * file. Must not be called while buffers may be pushed or popped (i.e. only in
+ * a tick or between runs).
+ */
+static void
+write_time_series_snapshot(spinn_sim_t *sim)
+{
+	// Packets waiting in the buffers at either end of every link
+	unsigned int packets_buffered = 0;
+	for (size_t i = 0; i < sim->system_size.x*sim->system_size.y; i++) {
+		for (int j = 0; j < 6; j++) {
+			packets_buffered += buffer_get_count(&(sim->nodes[i].input_buffers[j]));
+			packets_buffered += buffer_get_count(&(sim->nodes[i].output_buffers[j]));
+		}
+	}
+	
+	int num_in_use, num_free, num_local_free;
+	get_pool_occupancy(sim, &num_in_use, &num_free, &num_local_free);
+	
+	spinn_sim_stat_totals_t totals = get_totals(sim);
+	spinn_sim_stat_totals_t *last  = &(sim->stat_time_series_last_totals);
+	
+	write_standard_fields(sim, sim->stat_file_time_series);
+	async_file_printf( sim->stat_file_time_series, "\t%u\t%u\t%d\t%d\t%d\t%d\t%d\n"
+	                 , scheduler_get_ticks(&(sim->scheduler)) - sim->stat_start_ticks
+	                 , packets_buffered
+	                 , num_in_use
+	                 , totals.packets_offered  - last->packets_offered
+	                 , totals.packets_accepted - last->packets_accepted
+	                 , totals.packets_arrived  - last->packets_arrived
+	                 , totals.packets_dropped  - last->packets_dropped
+	                 );
+	
+	*last = totals;
+}
+
+
 /******************************************************************************
  * Callback functions
  ******************************************************************************/
@@ -93,21 +670,27 @@ spinn_sim_stat_log_packet( bool delivered
 	if (!node->sim->stat_started)
 		return;
 	
-	fprint_standard_fields(node->sim, node->sim->stat_file_packet_details);
-	fprintf( node->sim->stat_file_packet_details
-	       , "\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n"
-	       , delivered
-	       , packet->source.x,      packet->source.y
-	       , packet->destination.x, packet->destination.y
-	       , packet->sent_time - node->sim->stat_start_ticks
-	       , scheduler_get_ticks(&(node->sim->scheduler)) - packet->sent_time
-	       , packet->num_hops
-	       , packet->num_emg_hops
-	       );
+	spinn_coord_t source      = spinn_packet_get_source(packet);
+	spinn_coord_t destination = spinn_packet_get_destination(packet);
+	
+	spinn_sim_stat_packet_columns_t *c = node->sim->stat_packet_columns;
+	int i = c->num_records++;
+	c->delivered[i] = delivered;
+	c->source_x[i]  = (uint8_t)source.x;
+	c->source_y[i]  = (uint8_t)source.y;
+	c->dest_x[i]    = (uint8_t)destination.x;
+	c->dest_y[i]    = (uint8_t)destination.y;
+	c->sent_time[i] = (int32_t)(packet->sent_time - node->sim->stat_start_ticks);
+	c->latency[i]   = (int32_t)(scheduler_get_ticks(&(node->sim->scheduler)) - packet->sent_time);
+	c->num_hops[i]  = packet->num_hops;
+	c->emg_hops[i]  = packet->num_emg_hops;
+	
+	if (c->num_records == SPINN_SIM_STAT_PACKET_BLOCK_RECORDS)
+		write_packet_details_block(node->sim);
 }
 
 
-void *
+void
 spinn_sim_stat_on_packet_gen(spinn_packet_t *packet, void *node_)
 {
 	spinn_node_t *node = (spinn_node_t *)node_;
@@ -118,8 +701,6 @@ spinn_sim_stat_on_packet_gen(spinn_packet_t *packet, void *node_)
 	// a NULL packet.
 	if (packet != NULL)
 		node->stat_packets_accepted++;
-	
-	return NULL;
 }
 
 
@@ -132,6 +713,55 @@ spinn_sim_stat_on_packet_con(spinn_packet_t *packet, void *node_)
 	
 	if (node->sim->stat_log_delivered_packets)
 		spinn_sim_stat_log_packet(true, packet, node);
+	
+	if (node->sim->stat_histograms_enabled && node->sim->stat_started)
+		add_packet_to_histograms(packet, node);
+}
+
+
+void
+spinn_sim_stat_on_packet_con_deferred(spinn_packet_t *packet, void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	node->stat_packets_arrived++;
+	
+	// The consumer takes at most one packet per period and so there is never
+	// more than one waiting
+	if (node->sim->stat_started
+	    && (node->sim->stat_log_delivered_packets || node->sim->stat_histograms_enabled)) {
+		node->delivered_packet         = *packet;
+		node->delivered_packet_pending = true;
+	}
+}
+
+
+void
+spinn_sim_stat_process_delivered_packets(void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	if (!node->delivered_packet_pending)
+		return;
+	node->delivered_packet_pending = false;
+	
+	if (node->sim->stat_log_delivered_packets)
+		spinn_sim_stat_log_packet(true, &(node->delivered_packet), node);
+	
+	if (node->sim->stat_histograms_enabled)
+		add_packet_to_histograms(&(node->delivered_packet), node);
+}
+
+
+ticks_t
+spinn_sim_stat_delivered_packets_next_activity(void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	if (!node->delivered_packet_pending)
+		return SCHEDULER_NEVER;
+	else
+		return scheduler_get_ticks(&(node->sim->scheduler));
 }
 
 
@@ -146,7 +776,50 @@ spinn_sim_stat_on_drop(spinn_router_t *router, spinn_packet_t *packet, void *nod
 		spinn_sim_stat_log_packet(false, packet, node);
 	
 	// Free the packet now we're done with it
-	spinn_packet_pool_pfree(&(node->sim->pool), packet);
+	spinn_packet_pool_pfree(&(node->pool), packet);
+}
+
+
+void
+spinn_sim_stat_on_drop_deferred(spinn_router_t *router, spinn_packet_t *packet, void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	node->stat_packets_dropped++;
+	
+	buffer_push( &(node->dropped_packets)
+	           , spinn_packet_pool_get_handle(&(node->pool), packet)
+	           );
+}
+
+
+void
+spinn_sim_stat_process_dropped_packets(void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	while (!buffer_is_empty(&(node->dropped_packets))) {
+		spinn_packet_t *packet = spinn_packet_pool_get_packet( &(node->pool)
+		                                                     , buffer_pop(&(node->dropped_packets))
+		                                                     );
+		
+		if (node->sim->stat_log_dropped_packets)
+			spinn_sim_stat_log_packet(false, packet, node);
+		
+		spinn_packet_pool_pfree(&(node->pool), packet);
+	}
+}
+
+
+ticks_t
+spinn_sim_stat_dropped_packets_next_activity(void *node_)
+{
+	spinn_node_t *node = (spinn_node_t *)node_;
+	
+	if (buffer_is_empty(&(node->dropped_packets)))
+		return SCHEDULER_NEVER;
+	else
+		return scheduler_get_ticks(&(node->sim->scheduler));
 }
 
 
@@ -159,6 +832,32 @@ spinn_sim_stat_on_forward(spinn_router_t *router, spinn_packet_t *packet, void *
 }
 
 
+void
+spinn_sim_stat_time_series_tick(void *sim_)
+{
+	spinn_sim_t *sim = (spinn_sim_t *)sim_;
+	
+	ticks_t now = scheduler_get_ticks(&(sim->scheduler));
+	if (!sim->stat_started || now < sim->stat_time_series_next_time)
+		return;
+	sim->stat_time_series_next_time += sim->stat_time_series_interval;
+	
+	write_time_series_snapshot(sim);
+}
+
+
+ticks_t
+spinn_sim_stat_time_series_next_activity(void *sim_)
+{
+	spinn_sim_t *sim = (spinn_sim_t *)sim_;
+	
+	if (!sim->stat_started)
+		return SCHEDULER_NEVER;
+	else
+		return sim->stat_time_series_next_time;
+}
+
+
 /******************************************************************************
  * Initialisation Functions
  ******************************************************************************/
@@ -166,15 +865,6 @@ spinn_sim_stat_on_forward(spinn_router_t *router, spinn_packet_t *packet, void *
 void
 spinn_sim_stat_open_global_counters(spinn_sim_t *sim)
 {
-	const char *basename   = "global_counters.dat";
-	const char *result_dir = spinn_sim_config_lookup_string(sim, "measurements.results_directory");
-	
-	// A string long enough for the filename
-	char *filename = calloc(strlen(result_dir) + strlen(basename) + 1, sizeof(char));
-	assert(filename != NULL);
-	strcpy(filename, result_dir);
-	strcat(filename, basename);
-	
 	// What global stats are being counted?
 	bool glbl_packets_offered = spinn_sim_config_lookup_bool(sim,
 		"measurements.global_counters.packets_offered");
@@ -186,46 +876,44 @@ spinn_sim_stat_open_global_counters(spinn_sim_t *sim)
 		"measurements.global_counters.packets_dropped");
 	bool glbl_packets_forwarded = spinn_sim_config_lookup_bool(sim,
 		"measurements.global_counters.packets_forwarded");
+	bool glbl_mc_table_hits = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_table_hits", false);
+	bool glbl_mc_default_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_default_routed", false);
+	bool glbl_mc_copies = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_copies", false);
+	bool glbl_mc_copies_lost = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_copies_lost", false);
 	
 	sim->stat_file_global_counters = NULL;
 	
 	// Open the global counters file if some are being kept
 	if (glbl_packets_offered || glbl_packets_accepted ||
 	    glbl_packets_arrived || glbl_packets_dropped ||
-	    glbl_packets_forwarded) {
-		sim->stat_file_global_counters = fopen(filename, "w");
-		if (sim->stat_file_global_counters == NULL) {
-			fprintf(stderr, "Couldn't open %s for writing!\n", filename);
-			exit(-1);
-		}
+	    glbl_packets_forwarded || glbl_mc_table_hits ||
+	    glbl_mc_default_routed || glbl_mc_copies ||
+	    glbl_mc_copies_lost) {
+		sim->stat_file_global_counters = open_stat_file(sim, "global_counters.dat", NULL, NULL);
 		
 		// Add the header
-		fprint_standard_fields_headers(sim, sim->stat_file_global_counters);
-		if (glbl_packets_offered)  fprintf(sim->stat_file_global_counters, "\tpackets_offered");
-		if (glbl_packets_accepted) fprintf(sim->stat_file_global_counters, "\tpackets_accepted");
-		if (glbl_packets_arrived)  fprintf(sim->stat_file_global_counters, "\tpackets_arrived");
-		if (glbl_packets_dropped)  fprintf(sim->stat_file_global_counters, "\tpackets_dropped");
-		if (glbl_packets_forwarded)fprintf(sim->stat_file_global_counters, "\tpackets_forwarded");
-		fprintf(sim->stat_file_global_counters, "\n");
+		write_standard_fields_headers(sim, sim->stat_file_global_counters);
+		if (glbl_packets_offered)  async_file_printf(sim->stat_file_global_counters, "\tpackets_offered");
+		if (glbl_packets_accepted) async_file_printf(sim->stat_file_global_counters, "\tpackets_accepted");
+		if (glbl_packets_arrived)  async_file_printf(sim->stat_file_global_counters, "\tpackets_arrived");
+		if (glbl_packets_dropped)  async_file_printf(sim->stat_file_global_counters, "\tpackets_dropped");
+		if (glbl_packets_forwarded)async_file_printf(sim->stat_file_global_counters, "\tpackets_forwarded");
+		if (glbl_mc_table_hits)    async_file_printf(sim->stat_file_global_counters, "\tmc_table_hits");
+		if (glbl_mc_default_routed)async_file_printf(sim->stat_file_global_counters, "\tmc_default_routed");
+		if (glbl_mc_copies)        async_file_printf(sim->stat_file_global_counters, "\tmc_copies");
+		if (glbl_mc_copies_lost)   async_file_printf(sim->stat_file_global_counters, "\tmc_copies_lost");
+		async_file_printf(sim->stat_file_global_counters, "\n");
 	}
-	
-	// Clean up
-	free(filename);
 }
 
 
 void
 spinn_sim_stat_open_per_node_counters(spinn_sim_t *sim)
 {
-	const char *basename   = "per_node_counters.dat";
-	const char *result_dir = spinn_sim_config_lookup_string(sim, "measurements.results_directory");
-	
-	// A string long enough for the filename
-	char *filename = calloc(strlen(result_dir) + strlen(basename) + 1, sizeof(char));
-	assert(filename != NULL);
-	strcpy(filename, result_dir);
-	strcat(filename, basename);
-	
 	// What global stats are being counted?
 	bool per_node_packets_offered = spinn_sim_config_lookup_bool(sim,
 		"measurements.per_node_counters.packets_offered");
@@ -237,46 +925,99 @@ spinn_sim_stat_open_per_node_counters(spinn_sim_t *sim)
 		"measurements.per_node_counters.packets_dropped");
 	bool per_node_packets_forwarded = spinn_sim_config_lookup_bool(sim,
 		"measurements.per_node_counters.packets_forwarded");
+	bool per_node_mc_table_hits = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_table_hits", false);
+	bool per_node_mc_default_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_default_routed", false);
+	bool per_node_mc_copies = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_copies", false);
+	bool per_node_mc_copies_lost = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_copies_lost", false);
+	bool per_node_router_stalls = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.router_stalls", false);
+	bool per_node_emg_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.emg_routed", false);
+	bool per_node_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.packet_pool_in_use", false);
+	bool per_node_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.packet_pool_free", false);
 	
 	sim->stat_file_per_node_counters = NULL;
 	
 	// Open the per-node counters file if some are being kept
 	if (per_node_packets_offered || per_node_packets_accepted ||
 	    per_node_packets_arrived || per_node_packets_dropped ||
-	    per_node_packets_forwarded) {
-		sim->stat_file_per_node_counters = fopen(filename, "w");
-		if (sim->stat_file_per_node_counters == NULL) {
-			fprintf(stderr, "Couldn't open %s for writing!\n", filename);
-			exit(-1);
-		}
+	    per_node_packets_forwarded || per_node_mc_table_hits ||
+	    per_node_mc_default_routed || per_node_mc_copies ||
+	    per_node_mc_copies_lost || per_node_router_stalls ||
+	    per_node_emg_routed ||
+	    per_node_packet_pool_in_use || per_node_packet_pool_free) {
+		sim->stat_file_per_node_counters = open_stat_file(sim, "per_node_counters.dat", NULL, NULL);
 		
 		// Add the header
-		fprint_standard_fields_headers(sim, sim->stat_file_per_node_counters);
-		fprintf(sim->stat_file_per_node_counters, "\tnode_x\tnode_y");
-		if (per_node_packets_offered)  fprintf(sim->stat_file_per_node_counters, "\tpackets_offered");
-		if (per_node_packets_accepted) fprintf(sim->stat_file_per_node_counters, "\tpackets_accepted");
-		if (per_node_packets_arrived)  fprintf(sim->stat_file_per_node_counters, "\tpackets_arrived");
-		if (per_node_packets_dropped)  fprintf(sim->stat_file_per_node_counters, "\tpackets_dropped");
-		if (per_node_packets_forwarded)fprintf(sim->stat_file_per_node_counters, "\tpackets_forwarded");
-		fprintf(sim->stat_file_per_node_counters, "\n");
+		write_standard_fields_headers(sim, sim->stat_file_per_node_counters);
+		async_file_printf(sim->stat_file_per_node_counters, "\tnode_x\tnode_y");
+		if (per_node_packets_offered)  async_file_printf(sim->stat_file_per_node_counters, "\tpackets_offered");
+		if (per_node_packets_accepted) async_file_printf(sim->stat_file_per_node_counters, "\tpackets_accepted");
+		if (per_node_packets_arrived)  async_file_printf(sim->stat_file_per_node_counters, "\tpackets_arrived");
+		if (per_node_packets_dropped)  async_file_printf(sim->stat_file_per_node_counters, "\tpackets_dropped");
+		if (per_node_packets_forwarded)async_file_printf(sim->stat_file_per_node_counters, "\tpackets_forwarded");
+		if (per_node_mc_table_hits)    async_file_printf(sim->stat_file_per_node_counters, "\tmc_table_hits");
+		if (per_node_mc_default_routed)async_file_printf(sim->stat_file_per_node_counters, "\tmc_default_routed");
+		if (per_node_mc_copies)        async_file_printf(sim->stat_file_per_node_counters, "\tmc_copies");
+		if (per_node_mc_copies_lost)   async_file_printf(sim->stat_file_per_node_counters, "\tmc_copies_lost");
+		if (per_node_router_stalls)    async_file_printf(sim->stat_file_per_node_counters, "\trouter_stalls");
+		if (per_node_emg_routed)       async_file_printf(sim->stat_file_per_node_counters, "\temg_routed");
+		if (per_node_packet_pool_in_use)async_file_printf(sim->stat_file_per_node_counters, "\tpacket_pool_in_use");
+		if (per_node_packet_pool_free) async_file_printf(sim->stat_file_per_node_counters, "\tpacket_pool_free");
+		async_file_printf(sim->stat_file_per_node_counters, "\n");
 	}
+}
+
+
+void
+spinn_sim_stat_open_per_link_counters(spinn_sim_t *sim)
+{
+	// What per-link stats are being counted?
+	bool per_link_packets_carried = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.packets_carried", false);
+	bool per_link_ticks_blocked = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.ticks_blocked", false);
+	bool per_link_ticks_output_full = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.ticks_output_full", false);
 	
-	// Clean up
-	free(filename);
+	sim->stat_file_per_link_counters = NULL;
+	
+	// Open the per-link counters file if some are being kept
+	if (per_link_packets_carried || per_link_ticks_blocked ||
+	    per_link_ticks_output_full) {
+		sim->stat_file_per_link_counters = open_stat_file(sim, "per_link_counters.dat", NULL, NULL);
+		
+		// Add the header
+		write_standard_fields_headers(sim, sim->stat_file_per_link_counters);
+		async_file_printf(sim->stat_file_per_link_counters, "\tnode_x\tnode_y\tdirection");
+		if (per_link_packets_carried)  async_file_printf(sim->stat_file_per_link_counters, "\tpackets_carried");
+		if (per_link_ticks_blocked)    async_file_printf(sim->stat_file_per_link_counters, "\tticks_blocked");
+		if (per_link_ticks_output_full)async_file_printf(sim->stat_file_per_link_counters, "\tticks_output_full");
+		async_file_printf(sim->stat_file_per_link_counters, "\n");
+	}
 }
 
 
 void
 spinn_sim_stat_open_packet_details(spinn_sim_t *sim)
 {
-	const char *basename   = "packet_details.dat";
-	const char *result_dir = spinn_sim_config_lookup_string(sim, "measurements.results_directory");
-	
-	// A string long enough for the filename
-	char *filename = calloc(strlen(result_dir) + strlen(basename) + 1, sizeof(char));
-	assert(filename != NULL);
-	strcpy(filename, result_dir);
-	strcat(filename, basename);
+	// Should the details be written as text or in the binary format?
+	const char *format = spinn_sim_config_lookup_string_default(sim,
+		"measurements.packet_details.format", "text");
+	if (strcmp(format, "text") == 0) {
+		sim->stat_packet_details_binary = false;
+	} else if (strcmp(format, "binary") == 0) {
+		sim->stat_packet_details_binary = true;
+	} else {
+		fprintf(stderr, "Error: measurements.packet_details.format not recognised!\n");
+		exit(-1);
+	}
 	
 	// What global stats are being counted?
 	sim->stat_log_delivered_packets = spinn_sim_config_lookup_bool(sim,
@@ -285,41 +1026,128 @@ spinn_sim_stat_open_packet_details(spinn_sim_t *sim)
 		"measurements.packet_details.dropped_packets");
 	
 	sim->stat_file_packet_details = NULL;
+	sim->stat_packet_columns      = NULL;
 	
-	// Open the per-node counters file if some are being kept
+	// Open the packet details file if some are being kept
 	if (sim->stat_log_delivered_packets || sim->stat_log_dropped_packets) {
-		sim->stat_file_packet_details = fopen(filename, "w");
-		if (sim->stat_file_packet_details == NULL) {
-			fprintf(stderr, "Couldn't open %s for writing!\n", filename);
-			exit(-1);
-		}
+		if (sim->stat_packet_details_binary)
+			sim->stat_file_packet_details = open_stat_file(sim, "packet_details.bin", NULL, NULL);
+		else
+			sim->stat_file_packet_details = open_stat_file( sim, "packet_details.dat"
+			                                              , format_packet_details_text, NULL
+			                                              );
+		
+		sim->stat_packet_columns = malloc(sizeof(spinn_sim_stat_packet_columns_t));
+		assert(sim->stat_packet_columns != NULL);
+		sim->stat_packet_columns->num_records = 0;
 		
 		// Add the header
-		fprint_standard_fields_headers(sim, sim->stat_file_packet_details);
-		fprintf(sim->stat_file_packet_details,
-		        "\tdelivered\t"
-		        "source_x\tsource_y\tdest_x\tdest_y\t"
-		        "sent_time\tlatency\tnum_hops\temg_hops\n"
-		        );
+		write_packet_details_header(sim);
 	}
+}
+
+
+void
+spinn_sim_stat_open_histograms(spinn_sim_t *sim)
+{
+	// Which histograms are being kept?
+	sim->stat_histogram_enabled[SPINN_SIM_STAT_HISTOGRAM_LATENCY] = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.histograms.latency", false);
+	sim->stat_histogram_enabled[SPINN_SIM_STAT_HISTOGRAM_NUM_HOPS] = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.histograms.num_hops", false);
+	sim->stat_histogram_enabled[SPINN_SIM_STAT_HISTOGRAM_EMG_HOPS] = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.histograms.emg_hops", false);
 	
-	// Clean up
-	free(filename);
+	sim->stat_histograms_enabled = false;
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++)
+		sim->stat_histograms_enabled |= sim->stat_histogram_enabled[i];
+	
+	// Should per-node histograms be kept?
+	const char *per_node = spinn_sim_config_lookup_string_default(sim,
+		"measurements.histograms.per_node", "none");
+	if (strcmp(per_node, "none") == 0) {
+		sim->stat_histogram_node = SPINN_SIM_STAT_HISTOGRAM_NODE_NONE;
+	} else if (strcmp(per_node, "source") == 0) {
+		sim->stat_histogram_node = SPINN_SIM_STAT_HISTOGRAM_NODE_SOURCE;
+	} else if (strcmp(per_node, "destination") == 0) {
+		sim->stat_histogram_node = SPINN_SIM_STAT_HISTOGRAM_NODE_DESTINATION;
+	} else {
+		fprintf(stderr, "Error: measurements.histograms.per_node not recognised!\n");
+		exit(-1);
+	}
+	
+	sim->stat_histogram_precision_bits = spinn_sim_config_lookup_int_default(sim,
+		"measurements.histograms.precision_bits", 7);
+	if (sim->stat_histogram_precision_bits < 1 || sim->stat_histogram_precision_bits > 16) {
+		fprintf(stderr, "Error: measurements.histograms.precision_bits must be between 1 and 16.\n");
+		exit(-1);
+	}
+	
+	bool buckets = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.histograms.buckets", false);
+	
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++)
+		histogram_init(&(sim->stat_histograms[i]), sim->stat_histogram_precision_bits);
+	sim->stat_node_histograms = NULL;
+	
+	load_histogram_percentiles(sim);
+	
+	sim->stat_file_histograms          = NULL;
+	sim->stat_file_per_node_histograms = NULL;
+	sim->stat_file_histogram_buckets   = NULL;
+	
+	// Open the histogram files if any are being kept
+	if (sim->stat_histograms_enabled) {
+		sim->stat_file_histograms = open_stat_file(sim, "histograms.dat", NULL, NULL);
+		write_standard_fields_headers(sim, sim->stat_file_histograms);
+		write_histogram_summary_headers(sim, sim->stat_file_histograms);
+		async_file_printf(sim->stat_file_histograms, "\n");
+		
+		if (sim->stat_histogram_node != SPINN_SIM_STAT_HISTOGRAM_NODE_NONE) {
+			sim->stat_file_per_node_histograms = open_stat_file(sim, "per_node_histograms.dat", NULL, NULL);
+			write_standard_fields_headers(sim, sim->stat_file_per_node_histograms);
+			async_file_printf(sim->stat_file_per_node_histograms, "\tnode_x\tnode_y");
+			write_histogram_summary_headers(sim, sim->stat_file_per_node_histograms);
+			async_file_printf(sim->stat_file_per_node_histograms, "\n");
+		}
+		
+		if (buckets) {
+			sim->stat_file_histogram_buckets = open_stat_file(sim, "histogram_buckets.dat", NULL, NULL);
+			write_standard_fields_headers(sim, sim->stat_file_histogram_buckets);
+			async_file_printf(sim->stat_file_histogram_buckets, "\tvalue\tlowest\thighest\tcount\n");
+		}
+	}
 }
 
 
 void
-spinn_sim_stat_open_simulator(spinn_sim_t *sim)
+spinn_sim_stat_open_time_series(spinn_sim_t *sim)
 {
-	const char *basename   = "simulator.dat";
-	const char *result_dir = spinn_sim_config_lookup_string(sim, "measurements.results_directory");
+	sim->stat_time_series_interval = spinn_sim_config_lookup_int_default(sim,
+		"measurements.time_series.interval", 0);
+	if (sim->stat_time_series_interval < 0) {
+		fprintf(stderr, "Error: measurements.time_series.interval must not be negative.\n");
+		exit(-1);
+	}
 	
-	// A string long enough for the filename
-	char *filename = calloc(strlen(result_dir) + strlen(basename) + 1, sizeof(char));
-	assert(filename != NULL);
-	strcpy(filename, result_dir);
-	strcat(filename, basename);
+	sim->stat_file_time_series = NULL;
 	
+	if (sim->stat_time_series_interval > 0) {
+		sim->stat_file_time_series = open_stat_file(sim, "time_series.dat", NULL, NULL);
+		
+		// Add the header
+		write_standard_fields_headers(sim, sim->stat_file_time_series);
+		async_file_printf( sim->stat_file_time_series
+		                 , "\ttime\tpackets_buffered\tpackets_in_flight"
+		                   "\tpackets_offered\tpackets_accepted\tpackets_arrived\tpackets_dropped\n"
+		                 );
+	}
+}
+
+
+void
+spinn_sim_stat_open_simulator(spinn_sim_t *sim)
+{
 	// What global stats are being counted?
 	bool warmup_ticks = spinn_sim_config_lookup_bool(sim,
 		"measurements.simulator.warmup_ticks");
@@ -333,32 +1161,67 @@ spinn_sim_stat_open_simulator(spinn_sim_t *sim)
 		"measurements.simulator.sample_duration");
 	bool sample_packet_pool_size = spinn_sim_config_lookup_bool(sim,
 		"measurements.simulator.sample_packet_pool_size");
+	bool warmup_packet_pool_bytes = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_bytes", false);
+	bool warmup_packet_pool_growths = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_growths", false);
+	bool warmup_packet_pool_exhausted = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_exhausted", false);
+	bool warmup_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_in_use", false);
+	bool warmup_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_free", false);
+	bool warmup_packet_pool_local_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_local_free", false);
+	bool sample_packet_pool_bytes = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_bytes", false);
+	bool sample_packet_pool_growths = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_growths", false);
+	bool sample_packet_pool_exhausted = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_exhausted", false);
+	bool sample_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_in_use", false);
+	bool sample_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_free", false);
+	bool sample_packet_pool_local_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_local_free", false);
 	
 	sim->stat_file_simulator = NULL;
 	
 	// Open the per-node counters file if some are being kept
 	if (warmup_duration || sample_duration ||
 			warmup_packet_pool_size || sample_packet_pool_size ||
+			warmup_packet_pool_bytes || sample_packet_pool_bytes ||
+			warmup_packet_pool_growths || sample_packet_pool_growths ||
+			warmup_packet_pool_exhausted || sample_packet_pool_exhausted ||
+			warmup_packet_pool_in_use || sample_packet_pool_in_use ||
+			warmup_packet_pool_free || sample_packet_pool_free ||
+			warmup_packet_pool_local_free || sample_packet_pool_local_free ||
 			warmup_ticks || sample_ticks) {
-		sim->stat_file_simulator = fopen(filename, "w");
-		if (sim->stat_file_simulator == NULL) {
-			fprintf(stderr, "Couldn't open %s for writing!\n", filename);
-			exit(-1);
-		}
+		sim->stat_file_simulator = open_stat_file(sim, "simulator.dat", NULL, NULL);
 		
 		// Add the header
-		fprint_standard_fields_headers(sim, sim->stat_file_simulator);
-		if (warmup_ticks)            fprintf(sim->stat_file_simulator, "\twarmup_ticks");
-		if (warmup_duration)         fprintf(sim->stat_file_simulator, "\twarmup_duration");
-		if (warmup_packet_pool_size) fprintf(sim->stat_file_simulator, "\twarmup_packet_pool_size");
-		if (sample_ticks)            fprintf(sim->stat_file_simulator, "\tsample_ticks");
-		if (sample_duration)         fprintf(sim->stat_file_simulator, "\tsample_duration");
-		if (sample_packet_pool_size) fprintf(sim->stat_file_simulator, "\tsample_packet_pool_size");
-		fprintf(sim->stat_file_simulator, "\n");
+		write_standard_fields_headers(sim, sim->stat_file_simulator);
+		if (warmup_ticks)                 async_file_printf(sim->stat_file_simulator, "\twarmup_ticks");
+		if (warmup_duration)              async_file_printf(sim->stat_file_simulator, "\twarmup_duration");
+		if (warmup_packet_pool_size)      async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_size");
+		if (warmup_packet_pool_bytes)     async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_bytes");
+		if (warmup_packet_pool_growths)   async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_growths");
+		if (warmup_packet_pool_exhausted) async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_exhausted");
+		if (warmup_packet_pool_in_use)    async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_in_use");
+		if (warmup_packet_pool_free)      async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_free");
+		if (warmup_packet_pool_local_free)async_file_printf(sim->stat_file_simulator, "\twarmup_packet_pool_local_free");
+		if (sample_ticks)                 async_file_printf(sim->stat_file_simulator, "\tsample_ticks");
+		if (sample_duration)              async_file_printf(sim->stat_file_simulator, "\tsample_duration");
+		if (sample_packet_pool_size)      async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_size");
+		if (sample_packet_pool_bytes)     async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_bytes");
+		if (sample_packet_pool_growths)   async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_growths");
+		if (sample_packet_pool_exhausted) async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_exhausted");
+		if (sample_packet_pool_in_use)    async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_in_use");
+		if (sample_packet_pool_free)      async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_free");
+		if (sample_packet_pool_local_free)async_file_printf(sim->stat_file_simulator, "\tsample_packet_pool_local_free");
+		async_file_printf(sim->stat_file_simulator, "\n");
 	}
-	
-	// Clean up
-	free(filename);
 }
 
 
@@ -370,36 +1233,57 @@ spinn_sim_stat_open_simulator(spinn_sim_t *sim)
 void
 spinn_sim_stat_close_global_counters(spinn_sim_t *sim)
 {
-	if (sim->stat_file_global_counters != NULL)
-		if (fclose(sim->stat_file_global_counters) != 0)
-			fprintf(stderr, "Error closing global counters data file.\n");
+	close_stat_file(sim->stat_file_global_counters, "global counters");
 }
 
 
 void
 spinn_sim_stat_close_per_node_counters(spinn_sim_t *sim)
 {
-	if (sim->stat_file_per_node_counters != NULL)
-		if (fclose(sim->stat_file_per_node_counters) != 0)
-			fprintf(stderr, "Error closing per-node counters data file.\n");
+	close_stat_file(sim->stat_file_per_node_counters, "per-node counters");
+}
+
+
+void
+spinn_sim_stat_close_per_link_counters(spinn_sim_t *sim)
+{
+	close_stat_file(sim->stat_file_per_link_counters, "per-link counters");
 }
 
 
 void
 spinn_sim_stat_close_packet_details(spinn_sim_t *sim)
 {
-	if (sim->stat_file_packet_details != NULL)
-		if (fclose(sim->stat_file_packet_details) != 0)
-			fprintf(stderr, "Error closing packet details data file.\n");
+	close_stat_file(sim->stat_file_packet_details, "packet details");
+	
+	free(sim->stat_packet_columns);
+}
+
+
+void
+spinn_sim_stat_close_histograms(spinn_sim_t *sim)
+{
+	close_stat_file(sim->stat_file_histograms, "histograms");
+	close_stat_file(sim->stat_file_per_node_histograms, "per-node histograms");
+	close_stat_file(sim->stat_file_histogram_buckets, "histogram buckets");
+	
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++)
+		histogram_destroy(&(sim->stat_histograms[i]));
+	free(sim->stat_histogram_percentiles);
+}
+
+
+void
+spinn_sim_stat_close_time_series(spinn_sim_t *sim)
+{
+	close_stat_file(sim->stat_file_time_series, "time series");
 }
 
 
 void
 spinn_sim_stat_close_simulator(spinn_sim_t *sim)
 {
-	if (sim->stat_file_simulator != NULL)
-		if (fclose(sim->stat_file_simulator) != 0)
-			fprintf(stderr, "Error closing simulator data file.\n");
+	close_stat_file(sim->stat_file_simulator, "simulator");
 }
 
 
@@ -428,32 +1312,71 @@ spinn_sim_stat_end_warmup_simulator(spinn_sim_t *sim)
 		"measurements.simulator.warmup_duration");
 	bool warmup_packet_pool_size = spinn_sim_config_lookup_bool(sim,
 		"measurements.simulator.warmup_packet_pool_size");
+	bool warmup_packet_pool_bytes = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_bytes", false);
+	bool warmup_packet_pool_growths = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_growths", false);
+	bool warmup_packet_pool_exhausted = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_exhausted", false);
+	bool warmup_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_in_use", false);
+	bool warmup_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_free", false);
+	bool warmup_packet_pool_local_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.warmup_packet_pool_local_free", false);
 	
 	
 	
 	// Add standard fields, if required
 	if (sim->stat_file_simulator != NULL)
-		fprint_standard_fields(sim, sim->stat_file_simulator);
+		write_standard_fields(sim, sim->stat_file_simulator);
 	
 	// Produce warmup stats
-	if (warmup_ticks || warmup_duration || warmup_packet_pool_size) {
+	if (warmup_ticks || warmup_duration || warmup_packet_pool_size ||
+	    warmup_packet_pool_bytes || warmup_packet_pool_growths ||
+	    warmup_packet_pool_exhausted || warmup_packet_pool_in_use ||
+	    warmup_packet_pool_free || warmup_packet_pool_local_free) {
 		if (warmup_ticks)
-			fprintf(sim->stat_file_simulator, "\t%d",
-			        scheduler_get_ticks(&(sim->scheduler)) - sim->stat_start_ticks);
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  scheduler_get_ticks(&(sim->scheduler)) - sim->stat_start_ticks);
 		
 		if (warmup_duration) {
 			struct timeval now;
 			gettimeofday(&now, NULL);
-			fprintf(sim->stat_file_simulator, "\t%0.3f",
-			        (double)(((now.tv_sec - sim->stat_start_time.tv_sec)*1000000L)
-			                + now.tv_usec - sim->stat_start_time.tv_usec)
-			        / 1000000.0);
+			async_file_printf(sim->stat_file_simulator, "\t%0.3f",
+			                  (double)(((now.tv_sec - sim->stat_start_time.tv_sec)*1000000L)
+			                          + now.tv_usec - sim->stat_start_time.tv_usec)
+			                  / 1000000.0);
 		}
 		
 		if (warmup_packet_pool_size) {
-			fprintf(sim->stat_file_simulator, "\t%d",
-			        spinn_packet_pool_get_num_packets(&(sim->pool)));
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_packets(&(sim->pool)));
+		}
+		
+		if (warmup_packet_pool_bytes) {
+			async_file_printf(sim->stat_file_simulator, "\t%zu",
+			                  spinn_packet_pool_get_num_bytes(&(sim->pool)));
 		}
+		
+		if (warmup_packet_pool_growths) {
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_growths(&(sim->pool)));
+		}
+		
+		if (warmup_packet_pool_exhausted) {
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_exhausted(&(sim->pool)));
+		}
+		
+		int num_in_use, num_free, num_local_free;
+		get_pool_occupancy(sim, &num_in_use, &num_free, &num_local_free);
+		if (warmup_packet_pool_in_use)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_in_use);
+		if (warmup_packet_pool_free)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_free);
+		if (warmup_packet_pool_local_free)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_local_free);
 	}
 }
 
@@ -478,10 +1401,26 @@ spinn_sim_stat_start_sample_per_node_counters(spinn_sim_t *sim)
 		sim->nodes[i].stat_packets_arrived   = 0;
 		sim->nodes[i].stat_packets_dropped   = 0;
 		sim->nodes[i].stat_packets_forwarded = 0;
+		
+		if (sim->nodes[i].enabled) {
+			spinn_router_reset_mc_counters(&(sim->nodes[i].router));
+			spinn_router_reset_stall_counters(&(sim->nodes[i].router));
+		}
 	}
 }
 
 
+void
+spinn_sim_stat_start_sample_per_link_counters(spinn_sim_t *sim)
+{
+	// Reset the counters of every link (the router counters are reset with the
+	// per-node counters)
+	for (size_t i = 0; i < sim->system_size.x*sim->system_size.y; i++)
+		for (int j = 0; j < 6; j++)
+			delay_reset_counters(&(sim->nodes[i].delays[j]));
+}
+
+
 void
 spinn_sim_stat_start_sample_packet_details(spinn_sim_t *sim)
 {
@@ -489,6 +1428,38 @@ spinn_sim_stat_start_sample_packet_details(spinn_sim_t *sim)
 }
 
 
+void
+spinn_sim_stat_start_sample_histograms(spinn_sim_t *sim)
+{
+	if (!sim->stat_histograms_enabled)
+		return;
+	
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++)
+		histogram_reset(&(sim->stat_histograms[i]));
+	
+	// The per-node histograms are allocated for each sample since the system's
+	// size may change between samples
+	if (sim->stat_histogram_node != SPINN_SIM_STAT_HISTOGRAM_NODE_NONE) {
+		size_t num_histograms = sim->system_size.x * sim->system_size.y
+		                        * SPINN_SIM_STAT_NUM_HISTOGRAMS;
+		sim->stat_node_histograms = malloc(num_histograms * sizeof(histogram_t));
+		assert(sim->stat_node_histograms != NULL);
+		for (size_t i = 0; i < num_histograms; i++)
+			histogram_init(&(sim->stat_node_histograms[i]), sim->stat_histogram_precision_bits);
+	}
+}
+
+
+void
+spinn_sim_stat_start_sample_time_series(spinn_sim_t *sim)
+{
+	// The first snapshot is taken one interval into the sample and counts the
+	// packets since the per-node counters were reset
+	sim->stat_time_series_next_time = sim->stat_start_ticks + sim->stat_time_series_interval;
+	sim->stat_time_series_last_totals = get_totals(sim);
+}
+
+
 void
 spinn_sim_stat_start_sample_simulator(spinn_sim_t *sim)
 {
@@ -514,16 +1485,27 @@ spinn_sim_stat_end_sample_global_counters(spinn_sim_t *sim)
 		"measurements.global_counters.packets_dropped");
 	bool glbl_packets_forwarded = spinn_sim_config_lookup_bool(sim,
 		"measurements.global_counters.packets_forwarded");
+	bool glbl_mc_table_hits = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_table_hits", false);
+	bool glbl_mc_default_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_default_routed", false);
+	bool glbl_mc_copies = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_copies", false);
+	bool glbl_mc_copies_lost = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.global_counters.mc_copies_lost", false);
 	
 	// Dump into file
 	if (glbl_packets_offered || glbl_packets_accepted ||
 	    glbl_packets_arrived || glbl_packets_dropped ||
-	    glbl_packets_forwarded) {
+	    glbl_packets_forwarded || glbl_mc_table_hits ||
+	    glbl_mc_default_routed || glbl_mc_copies ||
+	    glbl_mc_copies_lost) {
 		int stat_packets_offered  = 0;
 		int stat_packets_accepted = 0;
 		int stat_packets_arrived  = 0;
 		int stat_packets_dropped  = 0;
 		int stat_packets_forwarded  = 0;
+		spinn_router_mc_counters_t stat_mc = {0, 0, 0, 0};
 		
 		// Sum up all values
 		for (size_t i = 0; i < sim->system_size.x*sim->system_size.y; i++) {
@@ -532,23 +1514,39 @@ spinn_sim_stat_end_sample_global_counters(spinn_sim_t *sim)
 			stat_packets_arrived   += sim->nodes[i].stat_packets_arrived;
 			stat_packets_dropped   += sim->nodes[i].stat_packets_dropped;
 			stat_packets_forwarded += sim->nodes[i].stat_packets_forwarded;
+			
+			if (sim->nodes[i].enabled) {
+				spinn_router_mc_counters_t mc = spinn_router_get_mc_counters(&(sim->nodes[i].router));
+				stat_mc.table_hits     += mc.table_hits;
+				stat_mc.default_routed += mc.default_routed;
+				stat_mc.copies         += mc.copies;
+				stat_mc.copies_lost    += mc.copies_lost;
+			}
 		}
-	
-		fprint_standard_fields(sim, sim->stat_file_global_counters);
+		
+		write_standard_fields(sim, sim->stat_file_global_counters);
 		if (glbl_packets_offered)
-			fprintf(sim->stat_file_global_counters, "\t%d", stat_packets_offered);
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_packets_offered);
 		if (glbl_packets_accepted)
-			fprintf(sim->stat_file_global_counters, "\t%d", stat_packets_accepted);
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_packets_accepted);
 		if (glbl_packets_arrived)
-			fprintf(sim->stat_file_global_counters, "\t%d", stat_packets_arrived);
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_packets_arrived);
 		if (glbl_packets_dropped)
-			fprintf(sim->stat_file_global_counters, "\t%d", stat_packets_dropped);
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_packets_dropped);
 		if (glbl_packets_forwarded)
-			fprintf(sim->stat_file_global_counters, "\t%d", stat_packets_forwarded);
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_packets_forwarded);
+		if (glbl_mc_table_hits)
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_mc.table_hits);
+		if (glbl_mc_default_routed)
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_mc.default_routed);
+		if (glbl_mc_copies)
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_mc.copies);
+		if (glbl_mc_copies_lost)
+			async_file_printf(sim->stat_file_global_counters, "\t%d", stat_mc.copies_lost);
 		
-		fprintf(sim->stat_file_global_counters, "\n");
+		async_file_printf(sim->stat_file_global_counters, "\n");
 		
-		fflush(sim->stat_file_global_counters);
+		async_file_flush(sim->stat_file_global_counters);
 	}
 }
 
@@ -567,11 +1565,31 @@ spinn_sim_stat_end_sample_per_node_counters(spinn_sim_t *sim)
 		"measurements.per_node_counters.packets_dropped");
 	bool per_node_packets_forwarded = spinn_sim_config_lookup_bool(sim,
 		"measurements.per_node_counters.packets_forwarded");
+	bool per_node_mc_table_hits = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_table_hits", false);
+	bool per_node_mc_default_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_default_routed", false);
+	bool per_node_mc_copies = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_copies", false);
+	bool per_node_mc_copies_lost = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.mc_copies_lost", false);
+	bool per_node_router_stalls = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.router_stalls", false);
+	bool per_node_emg_routed = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.emg_routed", false);
+	bool per_node_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.packet_pool_in_use", false);
+	bool per_node_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_node_counters.packet_pool_free", false);
 	
 	// Dump into file
 	if (per_node_packets_offered || per_node_packets_accepted ||
 	    per_node_packets_arrived || per_node_packets_dropped ||
-	    per_node_packets_forwarded) {
+	    per_node_packets_forwarded || per_node_mc_table_hits ||
+	    per_node_mc_default_routed || per_node_mc_copies ||
+	    per_node_mc_copies_lost || per_node_router_stalls ||
+	    per_node_emg_routed ||
+	    per_node_packet_pool_in_use || per_node_packet_pool_free) {
 		
 		// Iterate over all nodes
 		for (int y = 0; y < sim->system_size.y; y++) {
@@ -582,36 +1600,198 @@ spinn_sim_stat_end_sample_per_node_counters(spinn_sim_t *sim)
 				if (!node->enabled)
 					continue;
 				
-				fprint_standard_fields(sim, sim->stat_file_per_node_counters);
-				fprintf(sim->stat_file_per_node_counters, "\t%d\t%d"
-				       , x, y
-				       );
+				write_standard_fields(sim, sim->stat_file_per_node_counters);
+				async_file_printf(sim->stat_file_per_node_counters, "\t%d\t%d"
+				                 , x, y
+				                 );
 				
 				if (per_node_packets_offered)
-					fprintf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_offered);
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_offered);
 				if (per_node_packets_accepted)
-					fprintf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_accepted);
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_accepted);
 				if (per_node_packets_arrived)
-					fprintf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_arrived);
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_arrived);
 				if (per_node_packets_dropped)
-					fprintf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_dropped);
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_dropped);
 				if (per_node_packets_forwarded)
-					fprintf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_forwarded);
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", node->stat_packets_forwarded);
 				
-				fprintf(sim->stat_file_per_node_counters, "\n");
+				spinn_router_mc_counters_t mc = spinn_router_get_mc_counters(&(node->router));
+				if (per_node_mc_table_hits)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", mc.table_hits);
+				if (per_node_mc_default_routed)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", mc.default_routed);
+				if (per_node_mc_copies)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", mc.copies);
+				if (per_node_mc_copies_lost)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", mc.copies_lost);
+				
+				spinn_router_stall_counters_t stall = spinn_router_get_stall_counters(&(node->router));
+				if (per_node_router_stalls)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", stall.stalled);
+				if (per_node_emg_routed)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", stall.emg_routed);
+				
+				if (per_node_packet_pool_in_use)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", spinn_packet_pool_get_num_in_use(&(node->pool)));
+				if (per_node_packet_pool_free)
+					async_file_printf(sim->stat_file_per_node_counters, "\t%d", spinn_packet_pool_get_num_free(&(node->pool)));
+				
+				async_file_printf(sim->stat_file_per_node_counters, "\n");
 			}
 		}
 		
-		fflush(sim->stat_file_per_node_counters);
+		async_file_flush(sim->stat_file_per_node_counters);
+	}
+}
+
+
+void
+spinn_sim_stat_end_sample_per_link_counters(spinn_sim_t *sim)
+{
+	if (sim->stat_file_per_link_counters == NULL)
+		return;
+	
+	// What per-link stats are being counted?
+	bool per_link_packets_carried = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.packets_carried", false);
+	bool per_link_ticks_blocked = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.ticks_blocked", false);
+	bool per_link_ticks_output_full = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.per_link_counters.ticks_output_full", false);
+	
+	// Iterate over the outgoing links of all nodes
+	for (int y = 0; y < sim->system_size.y; y++) {
+		for (int x = 0; x < sim->system_size.x; x++) {
+			spinn_node_t *node = sim->nodes + (x + (sim->system_size.x * y));
+			
+			// Skip disabled nodes
+			if (!node->enabled)
+				continue;
+			
+			spinn_router_stall_counters_t stall = spinn_router_get_stall_counters(&(node->router));
+			
+			for (int d = 0; d < 6; d++) {
+				delay_counters_t link = delay_get_counters(&(node->delays[d]));
+				
+				write_standard_fields(sim, sim->stat_file_per_link_counters);
+				async_file_printf(sim->stat_file_per_link_counters, "\t%d\t%d\t%d"
+				                 , x, y, d
+				                 );
+				
+				if (per_link_packets_carried)
+					async_file_printf(sim->stat_file_per_link_counters, "\t%d", link.forwarded);
+				if (per_link_ticks_blocked)
+					async_file_printf(sim->stat_file_per_link_counters, "\t%d", link.blocked);
+				if (per_link_ticks_output_full)
+					async_file_printf(sim->stat_file_per_link_counters, "\t%d", stall.output_full[d]);
+				
+				async_file_printf(sim->stat_file_per_link_counters, "\n");
+			}
+		}
 	}
+	
+	async_file_flush(sim->stat_file_per_link_counters);
 }
 
 
 void
 spinn_sim_stat_end_sample_packet_details(spinn_sim_t *sim)
 {
-	// Nothing to do
-	fflush(sim->stat_file_packet_details);
+	if (sim->stat_file_packet_details != NULL) {
+		write_packet_details_block(sim);
+		async_file_flush(sim->stat_file_packet_details);
+	}
+}
+
+
+void
+spinn_sim_stat_end_sample_histograms(spinn_sim_t *sim)
+{
+	if (!sim->stat_histograms_enabled)
+		return;
+	
+	// Global histograms
+	for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++) {
+		if (!sim->stat_histogram_enabled[i])
+			continue;
+		
+		write_standard_fields(sim, sim->stat_file_histograms);
+		write_histogram_summary(sim, sim->stat_file_histograms, i, &(sim->stat_histograms[i]));
+		async_file_printf(sim->stat_file_histograms, "\n");
+		
+		// Non-empty buckets
+		if (sim->stat_file_histogram_buckets != NULL) {
+			for (int j = 0; j < histogram_get_num_buckets(&(sim->stat_histograms[i])); j++) {
+				uint32_t lowest, highest;
+				uint64_t count = histogram_get_bucket_count( &(sim->stat_histograms[i]), j
+				                                           , &lowest, &highest
+				                                           );
+				if (count == 0)
+					continue;
+				
+				write_standard_fields(sim, sim->stat_file_histogram_buckets);
+				async_file_printf( sim->stat_file_histogram_buckets, "\t%s\t%u\t%u\t%llu\n"
+				                 , histogram_names[i]
+				                 , lowest, highest
+				                 , (unsigned long long)count
+				                 );
+			}
+		}
+	}
+	async_file_flush(sim->stat_file_histograms);
+	if (sim->stat_file_histogram_buckets != NULL)
+		async_file_flush(sim->stat_file_histogram_buckets);
+	
+	// Per-node histograms
+	if (sim->stat_node_histograms != NULL) {
+		for (int y = 0; y < sim->system_size.y; y++) {
+			for (int x = 0; x < sim->system_size.x; x++) {
+				int node_index = x + (sim->system_size.x * y);
+				
+				// Skip disabled nodes
+				if (!sim->nodes[node_index].enabled)
+					continue;
+				
+				for (int i = 0; i < SPINN_SIM_STAT_NUM_HISTOGRAMS; i++) {
+					if (!sim->stat_histogram_enabled[i])
+						continue;
+					
+					write_standard_fields(sim, sim->stat_file_per_node_histograms);
+					async_file_printf(sim->stat_file_per_node_histograms, "\t%d\t%d", x, y);
+					write_histogram_summary( sim, sim->stat_file_per_node_histograms, i
+					                       , &(sim->stat_node_histograms[(node_index * SPINN_SIM_STAT_NUM_HISTOGRAMS) + i])
+					                       );
+					async_file_printf(sim->stat_file_per_node_histograms, "\n");
+				}
+			}
+		}
+		async_file_flush(sim->stat_file_per_node_histograms);
+		
+		size_t num_histograms = sim->system_size.x * sim->system_size.y
+		                        * SPINN_SIM_STAT_NUM_HISTOGRAMS;
+		for (size_t i = 0; i < num_histograms; i++)
+			histogram_destroy(&(sim->stat_node_histograms[i]));
+		free(sim->stat_node_histograms);
+		sim->stat_node_histograms = NULL;
+	}
+}
+
+
+void
+spinn_sim_stat_end_sample_time_series(spinn_sim_t *sim)
+{
+	if (sim->stat_file_time_series == NULL)
+		return;
+	
+	// Finish with a (possibly shorter) interval up to the end of the sample so
+	// that the snapshots account for every packet in the sample
+	ticks_t last_snapshot_time = sim->stat_time_series_next_time
+	                             - sim->stat_time_series_interval;
+	if (scheduler_get_ticks(&(sim->scheduler)) > last_snapshot_time)
+		write_time_series_snapshot(sim);
+	
+	async_file_flush(sim->stat_file_time_series);
 }
 
 
@@ -625,34 +1805,73 @@ spinn_sim_stat_end_sample_simulator(spinn_sim_t *sim)
 		"measurements.simulator.sample_duration");
 	bool sample_packet_pool_size = spinn_sim_config_lookup_bool(sim,
 		"measurements.simulator.sample_packet_pool_size");
+	bool sample_packet_pool_bytes = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_bytes", false);
+	bool sample_packet_pool_growths = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_growths", false);
+	bool sample_packet_pool_exhausted = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_exhausted", false);
+	bool sample_packet_pool_in_use = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_in_use", false);
+	bool sample_packet_pool_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_free", false);
+	bool sample_packet_pool_local_free = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.simulator.sample_packet_pool_local_free", false);
 	
 	
 	// Produce sample stats
-	if (sample_ticks || sample_duration || sample_packet_pool_size) {
+	if (sample_ticks || sample_duration || sample_packet_pool_size ||
+	    sample_packet_pool_bytes || sample_packet_pool_growths ||
+	    sample_packet_pool_exhausted || sample_packet_pool_in_use ||
+	    sample_packet_pool_free || sample_packet_pool_local_free) {
 		if (sample_ticks)
-			fprintf(sim->stat_file_simulator, "\t%d",
-			        scheduler_get_ticks(&(sim->scheduler)) - sim->stat_start_ticks);
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  scheduler_get_ticks(&(sim->scheduler)) - sim->stat_start_ticks);
 		
 		if (sample_duration) {
 			struct timeval now;
 			gettimeofday(&now, NULL);
-			fprintf(sim->stat_file_simulator, "\t%0.3f",
-			        (double)(((now.tv_sec - sim->stat_start_time.tv_sec)*1000000L)
-			                + now.tv_usec - sim->stat_start_time.tv_usec)
-			        / 1000000.0);
+			async_file_printf(sim->stat_file_simulator, "\t%0.3f",
+			                  (double)(((now.tv_sec - sim->stat_start_time.tv_sec)*1000000L)
+			                          + now.tv_usec - sim->stat_start_time.tv_usec)
+			                  / 1000000.0);
 		}
 		
 		if (sample_packet_pool_size) {
-			fprintf(sim->stat_file_simulator, "\t%d",
-			        spinn_packet_pool_get_num_packets(&(sim->pool)));
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_packets(&(sim->pool)));
+		}
+		
+		if (sample_packet_pool_bytes) {
+			async_file_printf(sim->stat_file_simulator, "\t%zu",
+			                  spinn_packet_pool_get_num_bytes(&(sim->pool)));
+		}
+		
+		if (sample_packet_pool_growths) {
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_growths(&(sim->pool)));
+		}
+		
+		if (sample_packet_pool_exhausted) {
+			async_file_printf(sim->stat_file_simulator, "\t%d",
+			                  spinn_packet_pool_get_num_exhausted(&(sim->pool)));
 		}
+		
+		int num_in_use, num_free, num_local_free;
+		get_pool_occupancy(sim, &num_in_use, &num_free, &num_local_free);
+		if (sample_packet_pool_in_use)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_in_use);
+		if (sample_packet_pool_free)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_free);
+		if (sample_packet_pool_local_free)
+			async_file_printf(sim->stat_file_simulator, "\t%d", num_local_free);
 	}
 	
 	
 	// Terminate with a newline if any field was enabled
 	if (sim->stat_file_simulator != NULL) {
-		fprintf(sim->stat_file_simulator, "\n");
-		fflush(sim->stat_file_simulator);
+		async_file_printf(sim->stat_file_simulator, "\n");
+		async_file_flush(sim->stat_file_simulator);
 	}
 }
 
@@ -667,9 +1886,23 @@ spinn_sim_stat_open(spinn_sim_t *sim)
 {
 	sim->stat_started = false;
 	
+	sim->stat_standard_fields     = NULL;
+	sim->stat_standard_fields_len = 0;
+	
+	// Should the output files be compressed?
+	sim->stat_compress = spinn_sim_config_lookup_bool_default(sim,
+		"measurements.compress", false);
+	if (sim->stat_compress && !async_file_can_compress()) {
+		fprintf(stderr, "Error: measurements.compress requires zlib which was not available at compile time!\n");
+		exit(-1);
+	}
+	
 	spinn_sim_stat_open_global_counters(sim);
 	spinn_sim_stat_open_per_node_counters(sim);
+	spinn_sim_stat_open_per_link_counters(sim);
 	spinn_sim_stat_open_packet_details(sim);
+	spinn_sim_stat_open_histograms(sim);
+	spinn_sim_stat_open_time_series(sim);
 	spinn_sim_stat_open_simulator(sim);
 }
 
@@ -679,8 +1912,13 @@ spinn_sim_stat_close(spinn_sim_t *sim)
 {
 	spinn_sim_stat_close_global_counters(sim);
 	spinn_sim_stat_close_per_node_counters(sim);
+	spinn_sim_stat_close_per_link_counters(sim);
 	spinn_sim_stat_close_packet_details(sim);
+	spinn_sim_stat_close_histograms(sim);
+	spinn_sim_stat_close_time_series(sim);
 	spinn_sim_stat_close_simulator(sim);
+	
+	free(sim->stat_standard_fields);
 }
 
 
@@ -691,9 +1929,15 @@ spinn_sim_stat_start_sample(spinn_sim_t *sim)
 	gettimeofday(&(sim->stat_start_time), NULL);
 	sim->stat_start_ticks = scheduler_get_ticks(&(sim->scheduler));
 	
+	// The standard fields are the same for every record written in the sample
+	format_standard_fields(sim);
+	
 	spinn_sim_stat_start_sample_global_counters(sim);
 	spinn_sim_stat_start_sample_per_node_counters(sim);
+	spinn_sim_stat_start_sample_per_link_counters(sim);
 	spinn_sim_stat_start_sample_packet_details(sim);
+	spinn_sim_stat_start_sample_histograms(sim);
+	spinn_sim_stat_start_sample_time_series(sim);
 	spinn_sim_stat_start_sample_simulator(sim);
 }
 
@@ -705,7 +1949,10 @@ spinn_sim_stat_end_sample(spinn_sim_t *sim)
 	
 	spinn_sim_stat_end_sample_global_counters(sim);
 	spinn_sim_stat_end_sample_per_node_counters(sim);
+	spinn_sim_stat_end_sample_per_link_counters(sim);
 	spinn_sim_stat_end_sample_packet_details(sim);
+	spinn_sim_stat_end_sample_histograms(sim);
+	spinn_sim_stat_end_sample_time_series(sim);
 	spinn_sim_stat_end_sample_simulator(sim);
 }
 
@@ -716,6 +1963,8 @@ spinn_sim_stat_start_warmup(spinn_sim_t *sim)
 	gettimeofday(&(sim->stat_start_time), NULL);
 	sim->stat_start_ticks = scheduler_get_ticks(&(sim->scheduler));
 	
+	format_standard_fields(sim);
+	
 	spinn_sim_stat_start_warmup_simulator(sim);
 }
 
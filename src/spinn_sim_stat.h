@@ -17,7 +17,7 @@
  * Callback for the packet generators. Expects a reference to the simulation
  * node as the data argument.
  */
-void *spinn_sim_stat_on_packet_gen(spinn_packet_t *packet, void *node);
+void spinn_sim_stat_on_packet_gen(spinn_packet_t *packet, void *node);
 
 /**
  * Callback for the packet consumers. Expects a reference to the simulation node
@@ -25,12 +25,73 @@ void *spinn_sim_stat_on_packet_gen(spinn_packet_t *packet, void *node);
  */
 void spinn_sim_stat_on_packet_con(spinn_packet_t *packet, void *node);
 
+/**
+ * Alternative to spinn_sim_stat_on_packet_con for multi-threaded simulations
+ * which counts the arrival but defers logging the packet (which touches state
+ * shared between nodes) to spinn_sim_stat_process_delivered_packets. A copy of
+ * the packet is kept in the node since the consumer frees the packet.
+ */
+void spinn_sim_stat_on_packet_con_deferred(spinn_packet_t *packet, void *node);
+
+/**
+ * A tock function to be scheduled in the serial partition immediately after the
+ * node's packet consumer (and with the same period) which logs the packets left
+ * by spinn_sim_stat_on_packet_con_deferred. Expects a reference to the
+ * simulation node as the data argument.
+ */
+void spinn_sim_stat_process_delivered_packets(void *node);
+
+/**
+ * The next activity function of spinn_sim_stat_process_delivered_packets: there
+ * is nothing to do until a packet is delivered. Expects a reference to the
+ * simulation node as the data argument.
+ */
+ticks_t spinn_sim_stat_delivered_packets_next_activity(void *node);
+
 /**
  * Callback for the router's on-drop event. Expects a reference to the
  * simulation node as the data argument.
  */
 void spinn_sim_stat_on_drop(spinn_router_t *router, spinn_packet_t *packet, void *node);
 
+/**
+ * Alternative to spinn_sim_stat_on_drop for multi-threaded simulations which
+ * counts the drop but defers logging and freeing the packet (which touch state
+ * shared between nodes) to spinn_sim_stat_process_dropped_packets. The packet
+ * is placed in the node's dropped_packets buffer.
+ */
+void spinn_sim_stat_on_drop_deferred(spinn_router_t *router, spinn_packet_t *packet, void *node);
+
+/**
+ * A tock function to be scheduled in the serial partition immediately after the
+ * node's router which logs and frees the packets left by
+ * spinn_sim_stat_on_drop_deferred. Expects a reference to the simulation node
+ * as the data argument.
+ */
+void spinn_sim_stat_process_dropped_packets(void *node);
+
+/**
+ * The next activity function of spinn_sim_stat_process_dropped_packets: there is
+ * nothing to do until a packet is dropped. Expects a reference to the
+ * simulation node as the data argument.
+ */
+ticks_t spinn_sim_stat_dropped_packets_next_activity(void *node);
+
+/**
+ * A tick function to be scheduled in the serial partition with a period of one
+ * which writes a snapshot of the network's state to the time series file every
+ * measurements.time_series.interval ticks of a sample. Expects a reference to
+ * the simulation as the data argument.
+ */
+void spinn_sim_stat_time_series_tick(void *sim);
+
+/**
+ * The next activity function of spinn_sim_stat_time_series_tick: the time of
+ * the next snapshot (or never, outside of a sample). Expects a reference to
+ * the simulation as the data argument.
+ */
+ticks_t spinn_sim_stat_time_series_next_activity(void *sim);
+
 /**
  * Callback for the router's on-forward event. Expects a reference to the
  * simulation node as the data argument.
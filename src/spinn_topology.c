@@ -97,6 +97,34 @@ spinn_shortest_vector( spinn_coord_t s
 }
 
 
+spinn_direction_t
+spinn_dor_direction( spinn_coord_t position
+                   , spinn_coord_t destination
+                   , spinn_coord_t system_size
+                   , bool          use_wrap_around_links
+                   )
+{
+	// Find the remaining vector to travel along
+	spinn_full_coord_t v;
+	if (use_wrap_around_links)
+		v = spinn_shortest_vector(position, destination, system_size);
+	else
+		v = spinn_full_coord_minimise((spinn_full_coord_t){ destination.x - position.x
+		                                                  , destination.y - position.y
+		                                                  , 0
+		                                                  });
+	
+	// Travel along each dimension in turn
+	     if (v.x < 0) return SPINN_WEST;
+	else if (v.x > 0) return SPINN_EAST;
+	else if (v.y < 0) return SPINN_SOUTH;
+	else if (v.y > 0) return SPINN_NORTH;
+	else if (v.z < 0) return SPINN_NORTH_EAST;
+	else if (v.z > 0) return SPINN_SOUTH_WEST;
+	else              return SPINN_LOCAL;
+}
+
+
 void
 spinn_hexagon_init(spinn_hexagon_state_t *h, int num_layers)
 {
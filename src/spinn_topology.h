@@ -95,6 +95,20 @@ spinn_full_coord_t spinn_shortest_vector( spinn_coord_t source
                                         , spinn_coord_t system_size
                                         );
 
+/**
+ * Get the direction in which a dimension-order routed packet at the given
+ * position should be sent to reach its destination (SPINN_LOCAL if it has
+ * arrived). Following this direction from every node along the way gives the
+ * same route as spinn_packet_init_dor except that where a torus has several
+ * equally short routes, the same one is always chosen rather than one picked at
+ * random.
+ */
+spinn_direction_t spinn_dor_direction( spinn_coord_t position
+                                     , spinn_coord_t destination
+                                     , spinn_coord_t system_size
+                                     , bool          use_wrap_around_links
+                                     );
+
 /**
  * Initialise the data structure used by spinn_hexagon() to construct a hexagon
  * of the given number of layers. For example, the figure below shows what layer
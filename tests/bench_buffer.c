@@ -0,0 +1,177 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * bench_buffer.c -- Microbenchmark comparing the inline power-of-two buffer
+ * against the original out-of-line modulo buffer.
+ *
+ * Not run as part of "make check", build with "make bench_buffer" and run by
+ * hand. Reports the mean time per operation for a mixture of pushes, peeks and
+ * pops on buffers of a few sizes typical of those used in models.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../src/buffer.h"
+
+// Number of times each buffer is filled and emptied
+#define NUM_ROUNDS 2000000
+
+
+/******************************************************************************
+ * The original buffer implementation, kept out-of-line as it was when compiled
+ * in its own translation unit.
+ ******************************************************************************/
+
+typedef struct old_buffer {
+	buffer_value_t *values;
+	size_t   size;
+	int      head;
+	int      tail;
+	
+	scheduler_event_t *consumer;
+} old_buffer_t;
+
+__attribute__((noinline)) void
+old_buffer_init(old_buffer_t *b, size_t size)
+{
+	b->values = calloc(size+1, sizeof(buffer_value_t));
+	assert(b->values != NULL);
+	b->size = size;
+	b->head = 0;
+	b->tail = 0;
+	
+	b->consumer = NULL;
+}
+
+__attribute__((noinline)) void
+old_buffer_destroy(old_buffer_t *b)
+{
+	free(b->values);
+}
+
+__attribute__((noinline)) bool
+old_buffer_is_full(old_buffer_t *b)
+{
+	return (b->head+1)%(b->size+1) == (b->tail);
+}
+
+__attribute__((noinline)) bool
+old_buffer_is_empty(old_buffer_t *b)
+{
+	return b->head == b->tail;
+}
+
+__attribute__((noinline)) void
+old_buffer_push(old_buffer_t *b, buffer_value_t value)
+{
+	assert(!old_buffer_is_full(b));
+	
+	b->values[b->head] = value;
+	b->head = (b->head+1)%(b->size + 1);
+	
+	if (b->consumer != NULL)
+		scheduler_wake(b->consumer);
+}
+
+__attribute__((noinline)) buffer_value_t
+old_buffer_pop(old_buffer_t *b)
+{
+	assert(!old_buffer_is_empty(b));
+	
+	buffer_value_t value = b->values[b->tail];
+	b->tail = (b->tail+1)%(b->size + 1);
+	
+	return value;
+}
+
+__attribute__((noinline)) buffer_value_t
+old_buffer_peek(old_buffer_t *b)
+{
+	assert(!old_buffer_is_empty(b));
+	
+	return b->values[b->tail];
+}
+
+
+/******************************************************************************
+ * Benchmark
+ ******************************************************************************/
+
+/**
+ * Internal function. Time in seconds since some arbitrary point.
+ */
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+
+/**
+ * Generate a function which repeatedly fills and empties a buffer, peeking at
+ * each value before it is popped, and returns the ns per operation (where a
+ * push, an is_full/is_empty test, a peek and a pop each count as one).
+ */
+#define BENCH(prefix) \
+	static double \
+	bench_##prefix(size_t size, uintptr_t *checksum) \
+	{ \
+		prefix##_t b; \
+		prefix##_init(&b, size); \
+		\
+		long ops = 0; \
+		double start = now(); \
+		for (int r = 0; r < NUM_ROUNDS; r++) { \
+			uintptr_t i = r; \
+			while (!prefix##_is_full(&b)) { \
+				prefix##_push(&b, (buffer_value_t)(i++)); \
+				ops += 2; \
+			} \
+			while (!prefix##_is_empty(&b)) { \
+				*checksum += (uintptr_t)prefix##_peek(&b); \
+				*checksum ^= (uintptr_t)prefix##_pop(&b); \
+				ops += 3; \
+			} \
+		} \
+		double end = now(); \
+		\
+		prefix##_destroy(&b); \
+		return ((end - start) * 1e9) / (double)ops; \
+	}
+
+BENCH(old_buffer)
+BENCH(buffer)
+
+
+int
+main(int argc, char *argv[])
+{
+	size_t sizes[] = {1, 4, 8, 16, 64};
+	
+	printf("size  old ns/op  new ns/op  speedup\n");
+	for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+		uintptr_t old_checksum = 0;
+		uintptr_t new_checksum = 0;
+		double old_ns = bench_old_buffer(sizes[i], &old_checksum);
+		double new_ns = bench_buffer(sizes[i], &new_checksum);
+	
+		// Both implementations must produce the same sequence of values
+		assert(old_checksum == new_checksum);
+	
+		printf("%4zu  %9.3f  %9.3f  %6.2fx\n"
+		      , sizes[i]
+		      , old_ns
+		      , new_ns
+		      , old_ns / new_ns
+		      );
+	}
+	
+	return 0;
+}
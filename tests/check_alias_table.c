@@ -0,0 +1,143 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_alias_table.c -- Unit tests for weighted sampling with alias tables.
+ */
+
+#include <check.h>
+
+#include <stdlib.h>
+
+#include "config.h"
+
+#include "check_check.h"
+#include "../src/rng.h"
+#include "../src/alias_table.h"
+
+#define NUM_SAMPLES 200000
+
+alias_table_t t;
+rng_t rng;
+
+
+void
+check_alias_table_setup(void)
+{
+	rng_init(&rng, 0u, 0u);
+}
+
+
+/**
+ * Check that the entries of the table are sampled in proportion to the given
+ * weights (to within a few percent of the total).
+ */
+static void
+check_distribution(const double *weights, int num_entries)
+{
+	alias_table_init(&t, weights, num_entries);
+	ck_assert_int_eq(alias_table_get_num_entries(&t), num_entries);
+	
+	int *counts = calloc(num_entries, sizeof(int));
+	ck_assert(counts != NULL);
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		int e = alias_table_sample(&t, &rng);
+		ck_assert(e >= 0);
+		ck_assert(e < num_entries);
+		counts[e]++;
+	}
+	
+	double total = 0.0;
+	for (int i = 0; i < num_entries; i++)
+		total += weights[i];
+	for (int i = 0; i < num_entries; i++) {
+		double expected = NUM_SAMPLES * (weights[i] / total);
+		
+		// Entries with no weight are never picked
+		if (weights[i] == 0.0)
+			ck_assert_int_eq(counts[i], 0);
+		
+		ck_assert(counts[i] > expected - (NUM_SAMPLES * 0.01));
+		ck_assert(counts[i] < expected + (NUM_SAMPLES * 0.01));
+	}
+	
+	free(counts);
+	alias_table_destroy(&t);
+}
+
+
+/**
+ * A single entry is always picked.
+ */
+START_TEST (test_single)
+{
+	double weights[] = {3.0};
+	alias_table_init(&t, weights, 1);
+	for (int i = 0; i < 1000; i++)
+		ck_assert_int_eq(alias_table_sample(&t, &rng), 0);
+	alias_table_destroy(&t);
+}
+END_TEST
+
+
+/**
+ * Equal weights give a uniform distribution.
+ */
+START_TEST (test_uniform)
+{
+	double weights[10];
+	for (int i = 0; i < 10; i++)
+		weights[i] = 1.0;
+	check_distribution(weights, 10);
+}
+END_TEST
+
+
+/**
+ * Uneven weights, including zero weights and one dominating entry.
+ */
+START_TEST (test_weighted)
+{
+	double weights[] = {0.0, 1.0, 3.0, 0.0, 0.5, 10.0, 0.25};
+	check_distribution(weights, sizeof(weights) / sizeof(weights[0]));
+}
+END_TEST
+
+
+/**
+ * Randomly weighted tables of various sizes.
+ */
+START_TEST (test_random)
+{
+	srand(_i);
+	int num_entries = 1 + (rand() % 50);
+	double *weights = malloc(num_entries * sizeof(double));
+	ck_assert(weights != NULL);
+	for (int i = 0; i < num_entries; i++)
+		weights[i] = (rand() % 4 == 0) ? 0.0 : ((double)rand() / RAND_MAX);
+	weights[rand() % num_entries] = 1.0;
+	
+	check_distribution(weights, num_entries);
+	free(weights);
+}
+END_TEST
+
+
+Suite *
+make_alias_table_suite(void)
+{
+	Suite *s = suite_create("alias_table");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, check_alias_table_setup, NULL);
+	tcase_add_test(tc_core, test_single);
+	tcase_add_test(tc_core, test_uniform);
+	tcase_add_test(tc_core, test_weighted);
+	tcase_add_loop_test(tc_core, test_random, 0, 8);
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
+
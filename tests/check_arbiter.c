@@ -77,7 +77,7 @@ START_TEST (test_single_period_forwarding)
 {
 	// Fill up the first input buffer (don't care about the others here)
 	for (int i = 0; i < buf_len; i++) {
-		buffer_push(&(inputs[0]), NULL);
+		buffer_push(&(inputs[0]), INT_TO_BUFFER_VALUE(0));
 	}
 	
 	// Run the simulation for exactly the correct number of cycles (it should not
@@ -111,8 +111,8 @@ START_TEST (test_round_robbin)
 	// item out of each buffer the buffer is still not empty. As a bodge, identify
 	// each input by casting the input number as the void pointer to send...
 	for (int i = 0; i < NUM_INPUTS; i++) {
-		buffer_push(&(inputs[i]), (void *)i);
-		buffer_push(&(inputs[i]), (void *)i);
+		buffer_push(&(inputs[i]), INT_TO_BUFFER_VALUE(i));
+		buffer_push(&(inputs[i]), INT_TO_BUFFER_VALUE(i));
 	}
 	
 	// Run the simulation for exactly the correct number of cycles
@@ -123,7 +123,7 @@ START_TEST (test_round_robbin)
 	// Check the values in the output buffer correspond to each input in turn.
 	for (int i = 0; i < NUM_INPUTS; i++) {
 		ck_assert(!buffer_is_empty(&output));
-		ck_assert((int)buffer_pop(&output) == i);
+		ck_assert(BUFFER_VALUE_TO_INT(buffer_pop(&output)) == i);
 	}
 	
 	// We should have grabbed everything there was to grab!
@@ -139,11 +139,11 @@ START_TEST (test_output_blocked)
 {
 	// Place some value in the first input buffer which will not be able to
 	// progress
-	buffer_push(&(inputs[0]), NULL);
+	buffer_push(&(inputs[0]), INT_TO_BUFFER_VALUE(0));
 	
 	// Fill up the output buffer to make it block
 	for (int i = 0; i < buf_len; i++) {
-		buffer_push(&output, (void *)i);
+		buffer_push(&output, INT_TO_BUFFER_VALUE(i));
 	}
 	ck_assert(buffer_is_full(&output));
 	
@@ -174,6 +174,70 @@ START_TEST (test_output_blocked)
 END_TEST
 
 
+/**
+ * Check that wide arbiters (up to the maximum number of inputs) select inputs
+ * in round-robbin order when inputs are filled and emptied at random.
+ */
+START_TEST (test_wide)
+{
+	size_t num_inputs = (_i == 0) ? 18 : ARBITER_MAX_INPUTS;
+	
+	scheduler_t ws;
+	scheduler_init(&ws);
+	
+	buffer_t wide_inputs[ARBITER_MAX_INPUTS];
+	buffer_t *wide_inputs_p[ARBITER_MAX_INPUTS];
+	for (int i = 0; i < num_inputs; i++) {
+		buffer_init(&(wide_inputs[i]), buf_len);
+		wide_inputs_p[i] = &(wide_inputs[i]);
+	}
+	buffer_t wide_output;
+	buffer_init(&wide_output, 1);
+	
+	arbiter_t wa;
+	arbiter_init(&wa, &ws, 1, wide_inputs_p, num_inputs, &wide_output);
+	
+	// The input the arbiter is expected to choose next is the first non-empty one
+	// after the last one chosen.
+	int last_input = num_inputs - 1;
+	srand(_i);
+	for (int cycle = 0; cycle < 10000; cycle++) {
+		// Randomly add values to a few inputs
+		for (int j = 0; j < 2; j++) {
+			int i = rand() % num_inputs;
+			if (!buffer_is_full(&(wide_inputs[i])))
+				buffer_push(&(wide_inputs[i]), INT_TO_BUFFER_VALUE(i));
+		}
+		
+		int expected = -1;
+		for (int i_ = 1; i_ <= num_inputs; i_++) {
+			int i = (last_input + i_) % num_inputs;
+			if (!buffer_is_empty(&(wide_inputs[i]))) {
+				expected = i;
+				break;
+			}
+		}
+		
+		scheduler_tick_tock(&ws);
+		
+		if (expected >= 0) {
+			ck_assert(!buffer_is_empty(&wide_output));
+			ck_assert_int_eq(BUFFER_VALUE_TO_INT(buffer_pop(&wide_output)), expected);
+			last_input = expected;
+		} else {
+			ck_assert(buffer_is_empty(&wide_output));
+		}
+	}
+	
+	for (int i = 0; i < num_inputs; i++)
+		buffer_destroy(&(wide_inputs[i]));
+	buffer_destroy(&wide_output);
+	arbiter_destroy(&wa);
+	scheduler_destroy(&ws);
+}
+END_TEST
+
+
 Suite *
 make_arbiter_suite(void)
 {
@@ -185,6 +249,7 @@ make_arbiter_suite(void)
 	tcase_add_test(tc_core, test_single_period_forwarding);
 	tcase_add_test(tc_core, test_round_robbin);
 	tcase_add_test(tc_core, test_output_blocked);
+	tcase_add_loop_test(tc_core, test_wide, 0, 2);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
@@ -0,0 +1,251 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_async_file.c -- Unit tests for asynchronously written files.
+ */
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "check_check.h"
+
+#include "../src/async_file.h"
+
+async_file_t f;
+
+// A temporary file to write to
+char filename[] = "/tmp/check_async_file_XXXXXX";
+
+
+/**
+ * Open the temporary file for use with async_file_init.
+ */
+FILE *
+open_temp_file(void)
+{
+	strcpy(filename, "/tmp/check_async_file_XXXXXX");
+	int fd = mkstemp(filename);
+	ck_assert(fd >= 0);
+	FILE *stream = fdopen(fd, "w");
+	ck_assert(stream != NULL);
+	return stream;
+}
+
+
+/**
+ * Read the contents of the temporary file (which is then deleted) into a newly
+ * allocated, null-terminated string and record its length.
+ */
+char *
+read_temp_file(size_t *len)
+{
+	FILE *stream = fopen(filename, "rb");
+	ck_assert(stream != NULL);
+	
+	fseek(stream, 0, SEEK_END);
+	*len = ftell(stream);
+	rewind(stream);
+	
+	char *data = malloc(*len + 1);
+	ck_assert(data != NULL);
+	ck_assert_int_eq(fread(data, 1, *len, stream), *len);
+	data[*len] = '\0';
+	
+	fclose(stream);
+	unlink(filename);
+	
+	return data;
+}
+
+
+/**
+ * A format function which outputs each (uint32_t) record as a line of decimal
+ * text, counting the number of calls.
+ */
+void
+format_decimal(async_file_t *file, const void *buffer, size_t len, void *num_calls)
+{
+	ck_assert_int_eq(len % sizeof(uint32_t), 0);
+	
+	for (size_t i = 0; i < len; i += sizeof(uint32_t)) {
+		uint32_t value;
+		memcpy(&value, (const char *)buffer + i, sizeof(uint32_t));
+		
+		char line[16];
+		int line_len = snprintf(line, sizeof(line), "%u\n", value);
+		async_file_output(file, line, line_len);
+	}
+	
+	(*(int *)num_calls)++;
+}
+
+
+/**
+ * Nothing written produces an empty file.
+ */
+START_TEST (test_empty)
+{
+	async_file_init(&f, open_temp_file(), 16, false, NULL, NULL);
+	ck_assert(async_file_destroy(&f));
+	
+	size_t len;
+	char *data = read_temp_file(&len);
+	ck_assert_int_eq(len, 0);
+	free(data);
+}
+END_TEST
+
+
+/**
+ * Data is written verbatim and in order across many buffer swaps, including
+ * writes and printfs which exactly fill or don't fit in the remaining space.
+ */
+START_TEST (test_verbatim)
+{
+	async_file_init(&f, open_temp_file(), 16, false, NULL, NULL);
+	
+	char expected[4096];
+	size_t expected_len = 0;
+	for (int i = 0; i < 200; i++) {
+		char chunk[16];
+		int chunk_len = snprintf(chunk, sizeof(chunk), "<%d>", i);
+		if (i % 2) {
+			async_file_write(&f, chunk, chunk_len);
+		} else {
+			async_file_printf(&f, "<%d>", i);
+		}
+		memcpy(expected + expected_len, chunk, chunk_len);
+		expected_len += chunk_len;
+		
+		// A printf using the whole buffer
+		if (i % 50 == 0) {
+			async_file_printf(&f, "%015d", i);
+			expected_len += sprintf(expected + expected_len, "%015d", i);
+		}
+		
+		if (i % 7 == 0)
+			async_file_flush(&f);
+	}
+	
+	ck_assert(async_file_destroy(&f));
+	
+	size_t len;
+	char *data = read_temp_file(&len);
+	ck_assert_int_eq(len, expected_len);
+	ck_assert(memcmp(data, expected, len) == 0);
+	free(data);
+}
+END_TEST
+
+
+/**
+ * Data is passed through the format function, which only ever sees whole
+ * reservations.
+ */
+START_TEST (test_format)
+{
+	int num_calls = 0;
+	async_file_init( &f, open_temp_file()
+	               , 10 * sizeof(uint32_t)
+	               , false
+	               , format_decimal, &num_calls
+	               );
+	
+	static char expected[65536];
+	size_t expected_len = 0;
+	uint32_t value = 0;
+	for (int i = 0; i < 500; i++) {
+		// Reserve between 1 and 10 records at a time
+		int num_records = (i % 10) + 1;
+		char *space = async_file_reserve(&f, num_records * sizeof(uint32_t));
+		for (int j = 0; j < num_records; j++) {
+			memcpy(space + j * sizeof(uint32_t), &value, sizeof(uint32_t));
+			expected_len += sprintf(expected + expected_len, "%u\n", value);
+			value += 12345;
+		}
+	}
+	
+	ck_assert(async_file_destroy(&f));
+	
+	// Every buffer should have been written separately and was at least half full
+	ck_assert(num_calls > 1);
+	ck_assert(num_calls <= (value / 12345) / 5);
+	
+	size_t len;
+	char *data = read_temp_file(&len);
+	ck_assert_int_eq(len, expected_len);
+	ck_assert(memcmp(data, expected, len) == 0);
+	free(data);
+}
+END_TEST
+
+
+#ifdef HAVE_LIBZ
+/**
+ * Compressed files decompress to the data written.
+ */
+START_TEST (test_compress)
+{
+	ck_assert(async_file_can_compress());
+	
+	async_file_init(&f, open_temp_file(), 64, true, NULL, NULL);
+	for (int i = 0; i < 1000; i++)
+		async_file_printf(&f, "%d\n", i % 10);
+	ck_assert(async_file_destroy(&f));
+	
+	// Should have been compressed (the data is very repetitive)
+	size_t len;
+	char *data = read_temp_file(&len);
+	ck_assert(len < 2000 / 2);
+	
+	// Decompress it again
+	strcpy(filename, "/tmp/check_async_file_XXXXXX");
+	int fd = mkstemp(filename);
+	ck_assert(fd >= 0);
+	ck_assert_int_eq(write(fd, data, len), len);
+	lseek(fd, 0, SEEK_SET);
+	gzFile gz = gzdopen(fd, "rb");
+	ck_assert(gz != NULL);
+	char decompressed[4096];
+	int decompressed_len = gzread(gz, decompressed, sizeof(decompressed));
+	gzclose(gz);
+	unlink(filename);
+	
+	ck_assert_int_eq(decompressed_len, 2000);
+	for (int i = 0; i < 1000; i++) {
+		ck_assert_int_eq(decompressed[i * 2], '0' + (i % 10));
+		ck_assert_int_eq(decompressed[(i * 2) + 1], '\n');
+	}
+	
+	free(data);
+}
+END_TEST
+#endif
+
+
+Suite *
+make_async_file_suite(void)
+{
+	Suite *s = suite_create("async_file");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_empty);
+	tcase_add_test(tc_core, test_verbatim);
+	tcase_add_test(tc_core, test_format);
+#ifdef HAVE_LIBZ
+	tcase_add_test(tc_core, test_compress);
+#endif
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
@@ -13,11 +13,8 @@
 
 START_TEST (test_buffer_push_pop)
 {
-	// A set of chars which can be pointed at
-	char *pointables = "ABCD";
-	
 	// Length of the buffer to use in tests
-	const int buf_len = strlen(pointables);
+	const int buf_len = 4;
 	
 	// Create a buffer exactly long enough to fit pointers to all the pointables
 	// in.
@@ -30,10 +27,12 @@ START_TEST (test_buffer_push_pop)
 		// Initially the buffer is empty
 		ck_assert(buffer_is_empty(&b));
 		ck_assert(!buffer_is_full(&b));
+		ck_assert_int_eq(buffer_get_count(&b), 0);
 		
 		// Fill the buffer up
 		for (int i = 0; i < buf_len; i++) {
-			buffer_push(&b, (void *)(pointables + i));
+			buffer_push(&b, INT_TO_BUFFER_VALUE(i));
+			ck_assert_int_eq(buffer_get_count(&b), i + 1);
 			// Until the last element is inserted the list should not be full
 			if (i < buf_len-1) {
 				ck_assert(!buffer_is_empty(&b));
@@ -46,13 +45,14 @@ START_TEST (test_buffer_push_pop)
 		
 		// Pop a few items
 		for (int i = 0; i < buf_len; i++) {
-			char *c_peeked = buffer_peek(&b);
+			int peeked = BUFFER_VALUE_TO_INT(buffer_peek(&b));
 			
-			char *c = buffer_pop(&b);
+			int popped = BUFFER_VALUE_TO_INT(buffer_pop(&b));
+			ck_assert_int_eq(buffer_get_count(&b), buf_len - i - 1);
 			
 			// Check the value popped was the one put in...
-			ck_assert_int_eq((int)*c,        (int)pointables[i]);
-			ck_assert_int_eq((int)*c_peeked, (int)pointables[i]);
+			ck_assert_int_eq(popped, i);
+			ck_assert_int_eq(peeked, i);
 			
 			// Until the last element is popped the list should not be empty
 			if (i < buf_len-1) {
@@ -70,6 +70,140 @@ START_TEST (test_buffer_push_pop)
 END_TEST
 
 
+/**
+ * A tick function which counts its calls and then goes to sleep.
+ */
+typedef struct {
+	scheduler_event_t *event;
+	int num_calls;
+} sleepy_counter_t;
+
+void
+sleepy_counter(void *_c)
+{
+	sleepy_counter_t *c = (sleepy_counter_t *)_c;
+	c->num_calls++;
+	scheduler_sleep(c->event);
+}
+
+
+/**
+ * Ensure that pushing into a buffer wakes its consumer.
+ */
+START_TEST (test_buffer_consumer)
+{
+	scheduler_t s;
+	scheduler_init(&s);
+	scheduler_set_activity_tracking(&s, true);
+	
+	sleepy_counter_t c;
+	c.num_calls = 0;
+	c.event = scheduler_schedule(&s, 1, sleepy_counter, &c, NULL, NULL);
+	scheduler_compile(&s);
+	
+	buffer_t b;
+	buffer_init(&b, 2);
+	buffer_set_consumer(&b, c.event);
+	
+	// The consumer starts awake and then goes to sleep
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(c.num_calls, 1);
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(c.num_calls, 1);
+	
+	// Pushing a value wakes the consumer which then goes back to sleep. Popping
+	// doesn't.
+	buffer_push(&b, INT_TO_BUFFER_VALUE(1234));
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(c.num_calls, 2);
+	buffer_pop(&b);
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(c.num_calls, 2);
+	
+	buffer_destroy(&b);
+	scheduler_destroy(&s);
+}
+END_TEST
+
+
+/**
+ * Ensure that buffers initialised from shared storage use exactly their own
+ * slice of it and leave it in place when destroyed.
+ */
+START_TEST (test_buffer_init_from)
+{
+	// Two buffers (of non-power-of-two lengths) packed into one allocation
+	size_t storage_size = buffer_storage_size(3) + buffer_storage_size(5);
+	ck_assert_int_eq(storage_size, 4 + 8);
+	buffer_value_t *storage = calloc(storage_size, sizeof(buffer_value_t));
+	
+	buffer_t a;
+	buffer_t b;
+	buffer_init_from(&a, 3, storage);
+	buffer_init_from(&b, 5, storage + buffer_storage_size(3));
+	
+	// Fill both buffers and then empty them, checking neither disturbs the other
+	for (int i = 0; i < 3; i++)
+		buffer_push(&a, INT_TO_BUFFER_VALUE(i));
+	for (int i = 0; i < 5; i++)
+		buffer_push(&b, INT_TO_BUFFER_VALUE(3 + i));
+	ck_assert(buffer_is_full(&a));
+	ck_assert(buffer_is_full(&b));
+	
+	for (int i = 0; i < 3; i++)
+		ck_assert_int_eq(BUFFER_VALUE_TO_INT(buffer_pop(&a)), i);
+	for (int i = 0; i < 5; i++)
+		ck_assert_int_eq(BUFFER_VALUE_TO_INT(buffer_pop(&b)), 3 + i);
+	ck_assert(buffer_is_empty(&a));
+	ck_assert(buffer_is_empty(&b));
+	
+	// Destroying the buffers must not free the storage (valgrind will complain
+	// about the double-free otherwise)
+	buffer_destroy(&a);
+	buffer_destroy(&b);
+	free(storage);
+}
+END_TEST
+
+
+/**
+ * Ensure that a buffer's bit in its non-empty mask tracks its occupancy and
+ * that buffers sharing a mask don't disturb each other's bits, with and without
+ * atomic updates.
+ */
+START_TEST (test_buffer_nonempty_mask)
+{
+	uint64_t mask = 0;
+	
+	buffer_t a;
+	buffer_t b;
+	buffer_init(&a, 2);
+	buffer_init(&b, 2);
+	
+	// A value already present sets the bit straight away
+	buffer_push(&b, INT_TO_BUFFER_VALUE(1));
+	buffer_set_nonempty_mask(&a, &mask, 0, _i == 1);
+	buffer_set_nonempty_mask(&b, &mask, 63, _i == 1);
+	ck_assert(mask == UINT64_C(1) << 63);
+	
+	buffer_push(&a, INT_TO_BUFFER_VALUE(2));
+	buffer_push(&a, INT_TO_BUFFER_VALUE(3));
+	ck_assert(mask == ((UINT64_C(1) << 63) | 1));
+	
+	// The bit is only cleared once the buffer is empty
+	buffer_pop(&a);
+	ck_assert(mask == ((UINT64_C(1) << 63) | 1));
+	buffer_pop(&a);
+	ck_assert(mask == UINT64_C(1) << 63);
+	buffer_pop(&b);
+	ck_assert(mask == 0);
+	
+	buffer_destroy(&a);
+	buffer_destroy(&b);
+}
+END_TEST
+
+
 Suite *
 make_buffer_suite(void)
 {
@@ -78,6 +212,9 @@ make_buffer_suite(void)
 	// Add tests to the test case
 	TCase *tc_core = tcase_create("Core");
 	tcase_add_test(tc_core, test_buffer_push_pop);
+	tcase_add_test(tc_core, test_buffer_consumer);
+	tcase_add_test(tc_core, test_buffer_init_from);
+	tcase_add_loop_test(tc_core, test_buffer_nonempty_mask, 0, 2);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
@@ -25,8 +25,14 @@ main(int argc, char *argv[])
 	srunner_add_suite(sr, make_buffer_suite());
 	srunner_add_suite(sr, make_scheduler_suite());
 	srunner_add_suite(sr, make_delay_suite());
+	srunner_add_suite(sr, make_rng_suite());
+	srunner_add_suite(sr, make_alias_table_suite());
+	srunner_add_suite(sr, make_async_file_suite());
+	srunner_add_suite(sr, make_histogram_suite());
+	srunner_add_suite(sr, make_spinn_arbiter_tree_suite());
 	srunner_add_suite(sr, make_spinn_topology_suite());
 	srunner_add_suite(sr, make_spinn_router_suite());
+	srunner_add_suite(sr, make_spinn_mc_table_suite());
 	srunner_add_suite(sr, make_spinn_packet_init_dor());
 	srunner_add_suite(sr, make_spinn_packet_pool_suite());
 	srunner_add_suite(sr, make_spinn_packet_gen_suite());
@@ -8,16 +8,33 @@
 #define CHECK_CHECK_H
 
 #include <check.h>
+#include <stdint.h>
 
 #include "config.h"
 
+#include "../src/buffer.h"
+
+/**
+ * Convert between integers and buffer values (pointers or, when configured
+ * with --enable-packet-handles, 32-bit handles) for tests which pass arbitrary
+ * integers through buffers.
+ */
+#define INT_TO_BUFFER_VALUE(i) ((buffer_value_t)(uintptr_t)(i))
+#define BUFFER_VALUE_TO_INT(v) ((int)(uintptr_t)(v))
+
 
 Suite *make_arbiter_suite(void);
 Suite *make_buffer_suite(void);
 Suite *make_scheduler_suite(void);
 Suite *make_delay_suite(void);
+Suite *make_rng_suite(void);
+Suite *make_alias_table_suite(void);
+Suite *make_async_file_suite(void);
+Suite *make_histogram_suite(void);
+Suite *make_spinn_arbiter_tree_suite(void);
 Suite *make_spinn_topology_suite(void);
 Suite *make_spinn_router_suite(void);
+Suite *make_spinn_mc_table_suite(void);
 Suite *make_spinn_packet_init_dor(void);
 Suite *make_spinn_packet_pool_suite(void);
 Suite *make_spinn_packet_gen_suite(void);
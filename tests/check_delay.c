@@ -52,7 +52,7 @@ START_TEST (test_unblocked_forwarding)
 {
 	// Fill the input buffer with things to send
 	for (int i = 0; i < BUFF_SIZE; i++)
-		buffer_push(&input, (void *)i);
+		buffer_push(&input, INT_TO_BUFFER_VALUE(i));
 	
 	// Run the simulation to see if things arrive at the correct time
 	for (int i = 0; i < BUFF_SIZE; i++) {
@@ -61,7 +61,53 @@ START_TEST (test_unblocked_forwarding)
 		
 		// Check that the correct value was forwarded (and nothing more)
 		ck_assert(!buffer_is_empty(&output));
-		ck_assert((int)buffer_pop(&output) == i);
+		ck_assert(BUFFER_VALUE_TO_INT(buffer_pop(&output)) == i);
+		ck_assert(buffer_is_empty(&output));
+	}
+	
+	// Everything was forwarded without being blocked
+	delay_counters_t counters = delay_get_counters(&d);
+	ck_assert_int_eq(counters.forwarded, BUFF_SIZE);
+	ck_assert_int_eq(counters.blocked, 0);
+	
+	delay_reset_counters(&d);
+	counters = delay_get_counters(&d);
+	ck_assert_int_eq(counters.forwarded, 0);
+	ck_assert_int_eq(counters.blocked, 0);
+}
+END_TEST
+
+
+/**
+ * Test to see if packets are delayed appropriately when the output is not
+ * blocked and the scheduler skips the delay while it is sleeping.
+ */
+START_TEST (test_sleeping_forwarding)
+{
+	scheduler_set_activity_tracking(&s, true);
+	scheduler_compile(&s);
+	
+	// Nothing should happen while the input is empty
+	for (int j = 0; j < PERIOD*DELAY*2; j++)
+		scheduler_tick_tock(&s);
+	ck_assert(buffer_is_empty(&output));
+	
+	// Fill the input buffer with things to send
+	for (int i = 0; i < BUFF_SIZE; i++)
+		buffer_push(&input, INT_TO_BUFFER_VALUE(i));
+	
+	// Run the simulation to see if things arrive at the correct time
+	for (int i = 0; i < BUFF_SIZE; i++) {
+		for (int j = 0; j < PERIOD*DELAY; j++) {
+			// Must not arrive before the last period of the delay
+			if (j <= PERIOD*(DELAY-1))
+				ck_assert(buffer_is_empty(&output));
+			scheduler_tick_tock(&s);
+		}
+		
+		// Check that the correct value was forwarded (and nothing more)
+		ck_assert(!buffer_is_empty(&output));
+		ck_assert(BUFFER_VALUE_TO_INT(buffer_pop(&output)) == i);
 		ck_assert(buffer_is_empty(&output));
 	}
 }
@@ -74,11 +120,11 @@ END_TEST
 START_TEST (test_blocked_forwarding)
 {
 	// Place a single thing to forward in the input buffer
-	buffer_push(&input, (void *)1234);
+	buffer_push(&input, INT_TO_BUFFER_VALUE(1234));
 	
 	// Fill the output buffer to block it up
 	for (int i = 0; i < BUFF_SIZE; i++)
-		buffer_push(&output, NULL);
+		buffer_push(&output, INT_TO_BUFFER_VALUE(0));
 	
 	// Run the simulation to see nothing happens
 	for (int j = 0; j < PERIOD*DELAY; j++)
@@ -96,6 +142,11 @@ START_TEST (test_blocked_forwarding)
 	}
 	ck_assert(buffer_is_empty(&input));
 	ck_assert(buffer_is_full(&output));
+	
+	// The value was blocked for every period until the output was freed
+	delay_counters_t counters = delay_get_counters(&d);
+	ck_assert_int_eq(counters.forwarded, 1);
+	ck_assert_int_eq(counters.blocked, DELAY);
 }
 END_TEST
 
@@ -109,6 +160,7 @@ make_delay_suite(void)
 	TCase *tc_core = tcase_create("Core");
 	tcase_add_checked_fixture(tc_core, check_delay_setup, check_delay_teardown);
 	tcase_add_test(tc_core, test_unblocked_forwarding);
+	tcase_add_test(tc_core, test_sleeping_forwarding);
 	tcase_add_test(tc_core, test_blocked_forwarding);
 	
 	// Add each test case to the suite
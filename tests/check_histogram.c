@@ -0,0 +1,211 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_histogram.c -- Unit tests for log-bucketed histograms.
+ */
+
+#include <check.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "check_check.h"
+
+#include "../src/histogram.h"
+
+histogram_t h;
+
+
+void
+check_histogram_setup(void)
+{
+	histogram_init(&h, 7);
+}
+
+
+void
+check_histogram_teardown(void)
+{
+	histogram_destroy(&h);
+}
+
+
+/**
+ * Compare two uint32_ts for qsort.
+ */
+static int
+compare_uint32(const void *a, const void *b)
+{
+	uint32_t va = *(const uint32_t *)a;
+	uint32_t vb = *(const uint32_t *)b;
+	return (va > vb) - (va < vb);
+}
+
+
+/**
+ * Empty histograms have no values.
+ */
+START_TEST (test_empty)
+{
+	ck_assert_int_eq(histogram_get_count(&h), 0);
+	
+	for (int i = 0; i < histogram_get_num_buckets(&h); i++) {
+		uint32_t lowest, highest;
+		ck_assert_int_eq(histogram_get_bucket_count(&h, i, &lowest, &highest), 0);
+	}
+}
+END_TEST
+
+
+/**
+ * Values below 2^precision_bits are counted exactly.
+ */
+START_TEST (test_exact)
+{
+	for (uint32_t v = 1; v <= 100; v++)
+		histogram_add(&h, v);
+	
+	ck_assert_int_eq(histogram_get_count(&h), 100);
+	ck_assert_int_eq(histogram_get_min(&h), 1);
+	ck_assert_int_eq(histogram_get_max(&h), 100);
+	ck_assert(histogram_get_mean(&h) == 50.5);
+	
+	ck_assert_int_eq(histogram_get_percentile(&h, 0.0), 1);
+	ck_assert_int_eq(histogram_get_percentile(&h, 1.0), 1);
+	ck_assert_int_eq(histogram_get_percentile(&h, 50.0), 50);
+	ck_assert_int_eq(histogram_get_percentile(&h, 50.5), 51);
+	ck_assert_int_eq(histogram_get_percentile(&h, 99.0), 99);
+	ck_assert_int_eq(histogram_get_percentile(&h, 100.0), 100);
+	
+	for (uint32_t v = 0; v < 128; v++) {
+		uint32_t lowest, highest;
+		uint64_t count = histogram_get_bucket_count(&h, histogram_get_bucket(&h, v), &lowest, &highest);
+		ck_assert_int_eq(lowest, v);
+		ck_assert_int_eq(highest, v);
+		ck_assert_int_eq(count, (v >= 1 && v <= 100) ? 1 : 0);
+	}
+	
+	// Resetting empties the histogram
+	histogram_reset(&h);
+	ck_assert_int_eq(histogram_get_count(&h), 0);
+	histogram_add(&h, 7);
+	ck_assert_int_eq(histogram_get_min(&h), 7);
+	ck_assert_int_eq(histogram_get_max(&h), 7);
+	ck_assert_int_eq(histogram_get_percentile(&h, 50.0), 7);
+	for (int i = 0; i < histogram_get_num_buckets(&h); i++) {
+		uint32_t lowest, highest;
+		ck_assert_int_eq(histogram_get_bucket_count(&h, i, &lowest, &highest), i == 7);
+	}
+}
+END_TEST
+
+
+/**
+ * For every precision, the buckets are contiguous, cover every 32-bit value and
+ * are no wider than the precision allows.
+ */
+START_TEST (test_buckets)
+{
+	histogram_t hp;
+	int bits = _i;
+	histogram_init(&hp, bits);
+	
+	// Allocates every bucket (but no more, even when growing from nearly all of
+	// them)
+	histogram_add(&hp, 1u << 31);
+	histogram_add(&hp, UINT32_MAX);
+	int last_bucket = histogram_get_bucket(&hp, UINT32_MAX);
+	ck_assert_int_eq(histogram_get_num_buckets(&hp), last_bucket + 1);
+	
+	uint32_t expected_lowest = 0;
+	for (int i = 0; i <= last_bucket; i++) {
+		uint32_t lowest, highest;
+		histogram_get_bucket_count(&hp, i, &lowest, &highest);
+		ck_assert_int_eq(lowest, expected_lowest);
+		ck_assert(highest >= lowest);
+		ck_assert(highest - lowest <= (lowest >> (bits - 1)));
+		
+		// The ends of the bucket are counted by it
+		ck_assert_int_eq(histogram_get_bucket(&hp, lowest), i);
+		ck_assert_int_eq(histogram_get_bucket(&hp, highest), i);
+		
+		expected_lowest = highest + 1u;
+	}
+	
+	// Wrapped around having covered every value
+	ck_assert_int_eq(expected_lowest, 0);
+	
+	histogram_destroy(&hp);
+}
+END_TEST
+
+
+/**
+ * Percentiles of random values lie within the precision of the exact
+ * percentile.
+ */
+#define NUM_RANDOM_VALUES 10000
+START_TEST (test_random)
+{
+	static uint32_t values[NUM_RANDOM_VALUES];
+	
+	srand(_i);
+	uint64_t sum = 0;
+	for (int i = 0; i < NUM_RANDOM_VALUES; i++) {
+		// Roughly log-distributed values
+		values[i] = (uint32_t)rand() >> (rand() % 31);
+		sum += values[i];
+		histogram_add(&h, values[i]);
+	}
+	qsort(values, NUM_RANDOM_VALUES, sizeof(uint32_t), compare_uint32);
+	
+	ck_assert_int_eq(histogram_get_count(&h), NUM_RANDOM_VALUES);
+	ck_assert_int_eq(histogram_get_min(&h), values[0]);
+	ck_assert_int_eq(histogram_get_max(&h), values[NUM_RANDOM_VALUES - 1]);
+	ck_assert(histogram_get_mean(&h) == (double)sum / NUM_RANDOM_VALUES);
+	
+	const double percentiles[] = {0.0, 0.01, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+	for (int i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+		// The (1-based) rank of the percentile's value
+		double exact_rank = (percentiles[i] / 100.0) * NUM_RANDOM_VALUES;
+		int rank = (int)exact_rank;
+		if (rank < exact_rank || rank < 1)
+			rank++;
+		uint32_t exact = values[rank - 1];
+		uint32_t value = histogram_get_percentile(&h, percentiles[i]);
+		ck_assert(value >= exact);
+		ck_assert(value - exact <= (exact >> 6));
+		ck_assert(value <= histogram_get_max(&h));
+	}
+	
+	// Every value is counted in exactly one bucket
+	uint64_t total = 0;
+	for (int i = 0; i < histogram_get_num_buckets(&h); i++) {
+		uint32_t lowest, highest;
+		total += histogram_get_bucket_count(&h, i, &lowest, &highest);
+	}
+	ck_assert_int_eq(total, NUM_RANDOM_VALUES);
+}
+END_TEST
+
+
+Suite *
+make_histogram_suite(void)
+{
+	Suite *s = suite_create("histogram");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, check_histogram_setup, check_histogram_teardown);
+	tcase_add_test(tc_core, test_empty);
+	tcase_add_test(tc_core, test_exact);
+	tcase_add_loop_test(tc_core, test_buckets, 1, 17);
+	tcase_add_loop_test(tc_core, test_random, 0, 4);
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
@@ -0,0 +1,138 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_rng.c -- Unit tests for the pseudo-random number generator.
+ */
+
+#include <check.h>
+
+#include <stdint.h>
+
+#include "config.h"
+
+#include "check_check.h"
+#include "../src/rng.h"
+
+#define NUM_SAMPLES 100000
+
+
+/**
+ * The generator produces the reference xoshiro256** sequence for a known
+ * state.
+ */
+START_TEST (test_reference)
+{
+	rng_t r;
+	r.state[0] = 1u;
+	r.state[1] = 2u;
+	r.state[2] = 3u;
+	r.state[3] = 4u;
+	
+	ck_assert(rng_next(&r) == UINT64_C(0x0000000000002d00));
+	ck_assert(rng_next(&r) == UINT64_C(0x0000000000000000));
+	ck_assert(rng_next(&r) == UINT64_C(0x000000005a007080));
+	ck_assert(rng_next(&r) == UINT64_C(0x10e0000000009d80));
+	ck_assert(rng_next(&r) == UINT64_C(0x10e0b61ce1009d80));
+}
+END_TEST
+
+
+/**
+ * Generators with the same seed and stream give the same sequence while those
+ * differing in either give different ones.
+ */
+START_TEST (test_streams)
+{
+	rng_t a, b, c, d;
+	rng_init(&a, 1234u, 0u);
+	rng_init(&b, 1234u, 0u);
+	rng_init(&c, 1234u, 1u);
+	rng_init(&d, 1235u, 0u);
+	
+	int num_c_same = 0;
+	int num_d_same = 0;
+	for (int i = 0; i < 100; i++) {
+		uint64_t va = rng_next(&a);
+		ck_assert(va == rng_next(&b));
+		num_c_same += va == rng_next(&c);
+		num_d_same += va == rng_next(&d);
+	}
+	ck_assert_int_eq(num_c_same, 0);
+	ck_assert_int_eq(num_d_same, 0);
+}
+END_TEST
+
+
+/**
+ * Uniform doubles are in [0.0, 1.0) with a mean of about a half.
+ */
+START_TEST (test_uniform)
+{
+	rng_t r;
+	rng_init(&r, _i, 0u);
+	
+	double sum = 0.0;
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		double u = rng_uniform(&r);
+		ck_assert(u >= 0.0);
+		ck_assert(u < 1.0);
+		sum += u;
+	}
+	
+	// The bounds are many standard deviations from the mean
+	ck_assert(sum / NUM_SAMPLES > 0.49);
+	ck_assert(sum / NUM_SAMPLES < 0.51);
+}
+END_TEST
+
+
+/**
+ * Integers drawn from a range are always in range and each value turns up
+ * about as often as the others. Coin flips come up heads about half the time.
+ */
+START_TEST (test_below_and_bool)
+{
+	rng_t r;
+	rng_init(&r, _i, 0u);
+	
+	const uint32_t n = 7u;
+	int counts[7] = {0};
+	int num_true = 0;
+	for (int i = 0; i < NUM_SAMPLES; i++) {
+		uint32_t v = rng_below(&r, n);
+		ck_assert(v < n);
+		counts[v]++;
+		num_true += rng_bool(&r);
+	}
+	
+	for (uint32_t v = 0; v < n; v++) {
+		ck_assert(counts[v] > (NUM_SAMPLES / n) * 0.95);
+		ck_assert(counts[v] < (NUM_SAMPLES / n) * 1.05);
+	}
+	ck_assert(num_true > NUM_SAMPLES * 0.49);
+	ck_assert(num_true < NUM_SAMPLES * 0.51);
+	
+	// A range of one is always zero
+	ck_assert_int_eq(rng_below(&r, 1u), 0);
+}
+END_TEST
+
+
+Suite *
+make_rng_suite(void)
+{
+	Suite *s = suite_create("rng");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_reference);
+	tcase_add_test(tc_core, test_streams);
+	tcase_add_loop_test(tc_core, test_uniform, 0, 4);
+	tcase_add_loop_test(tc_core, test_below_and_bool, 0, 4);
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
+
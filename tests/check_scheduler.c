@@ -109,6 +109,489 @@ START_TEST (test_schedule)
 END_TEST
 
 
+/**
+ * A log of callbacks made by the scheduler for use by the compiled schedule
+ * tests.
+ */
+#define CALL_LOG_LENGTH 10000
+typedef struct {
+	int calls[CALL_LOG_LENGTH];
+	int num_calls;
+} call_log_t;
+
+typedef struct {
+	call_log_t *log;
+	int id;
+} logger_t;
+
+void
+logger(void *_logger)
+{
+	logger_t *l = (logger_t *)_logger;
+	ck_assert(l->log->num_calls < CALL_LOG_LENGTH);
+	l->log->calls[l->log->num_calls++] = l->id;
+}
+
+
+/**
+ * Ensure that a compiled schedule calls exactly the same functions in exactly
+ * the same order as the uncompiled schedule. Tested with a set of periods with
+ * a short hyperperiod and also a set whose hyperperiod is too long to be
+ * tabulated.
+ */
+START_TEST (test_compiled_schedule)
+{
+	const int num_ticks = 600;
+	
+	// The schedules are compiled after this many ticks
+	const int compile_after = 3;
+	
+	const int num_periods = 4;
+	ticks_t periods[2][4] = { {1, 2, 4, 3}
+	                        , {1, 61, 67, 71}
+	                        };
+	ticks_t *period = periods[_i];
+	
+	const int num_processes = 3;
+	
+	static call_log_t logs[2];
+	logger_t loggers[2][4*3*2];
+	scheduler_t s[2];
+	
+	// s[0] is left uncompiled, s[1] is compiled
+	for (int j = 0; j < 2; j++) {
+		logs[j].num_calls = 0;
+		scheduler_init(&(s[j]));
+		
+		for (int p = 0; p < num_periods; p++) {
+			for (int process = 0; process < num_processes; process++) {
+				logger_t *tick = &(loggers[j][(((p*num_processes) + process) * 2) + 0]);
+				logger_t *tock = &(loggers[j][(((p*num_processes) + process) * 2) + 1]);
+				tick->log = &(logs[j]);
+				tock->log = &(logs[j]);
+				tick->id = (((p*num_processes) + process) * 2) + 0;
+				tock->id = (((p*num_processes) + process) * 2) + 1;
+				
+				// Leave some tick/tock functions out
+				scheduler_schedule( &(s[j]), period[p]
+				                  , (process == 1) ? NULL : logger, tick
+				                  , (process == 2) ? NULL : logger, tock
+				                  );
+			}
+		}
+	}
+	
+	for (int i = 0; i < num_ticks; i++) {
+		if (i == compile_after)
+			scheduler_compile(&(s[1]));
+		
+		scheduler_tick_tock(&(s[0]));
+		scheduler_tick_tock(&(s[1]));
+		ck_assert_int_eq(scheduler_get_ticks(&(s[0])), scheduler_get_ticks(&(s[1])));
+	}
+	
+	// The same calls should have been made in the same order
+	ck_assert_int_eq(logs[0].num_calls, logs[1].num_calls);
+	for (int i = 0; i < logs[0].num_calls; i++)
+		ck_assert_int_eq(logs[0].calls[i], logs[1].calls[i]);
+	
+	scheduler_destroy(&(s[0]));
+	scheduler_destroy(&(s[1]));
+}
+END_TEST
+
+
+/**
+ * Ensure that a multi-threaded schedule runs every parallel event the correct
+ * number of times and runs the serial events in exactly the same order as a
+ * single-threaded schedule. Tested with differing numbers of threads.
+ */
+START_TEST (test_threaded_schedule)
+{
+	const int num_ticks = 200;
+	const int num_threads = _i;
+	
+	const int num_periods = 3;
+	ticks_t periods[] = {1, 2, 3};
+	
+	// Number of partitions (the last "partition" is the serial one)
+	const int num_partitions = 7;
+	
+	static call_log_t logs[2];
+	logger_t loggers[2][3*2];
+	int tick_cnt[3][7];
+	int tock_cnt[3][7];
+	scheduler_t s[2];
+	
+	// s[0] is left single threaded, s[1] is multi-threaded
+	for (int j = 0; j < 2; j++) {
+		logs[j].num_calls = 0;
+		scheduler_init(&(s[j]));
+		
+		for (int p = 0; p < num_periods; p++) {
+			// Serial events log their calls
+			logger_t *tick = &(loggers[j][(p*2) + 0]);
+			logger_t *tock = &(loggers[j][(p*2) + 1]);
+			tick->log = &(logs[j]);
+			tock->log = &(logs[j]);
+			tick->id  = (p*2) + 0;
+			tock->id  = (p*2) + 1;
+			scheduler_set_partition(&(s[j]), SCHEDULER_PARTITION_SERIAL);
+			scheduler_schedule( &(s[j]), periods[p]
+			                  , logger, tick
+			                  , logger, tock
+			                  );
+			
+			// Parallel events count their calls
+			if (j == 1) {
+				for (int partition = 0; partition < num_partitions; partition++) {
+					tick_cnt[p][partition] = 0;
+					tock_cnt[p][partition] = 0;
+					scheduler_set_partition(&(s[j]), partition);
+					scheduler_schedule( &(s[j]), periods[p]
+					                  , incrementer, &(tick_cnt[p][partition])
+					                  , incrementer, &(tock_cnt[p][partition])
+					                  );
+				}
+			}
+		}
+	}
+	
+	scheduler_set_num_threads(&(s[1]), num_threads);
+	scheduler_compile(&(s[1]));
+	
+	for (int i = 0; i < num_ticks; i++) {
+		scheduler_tick_tock(&(s[0]));
+		scheduler_tick_tock(&(s[1]));
+	}
+	ck_assert_int_eq(scheduler_get_ticks(&(s[1])), num_ticks);
+	
+	// The serial calls should have been made in the same order
+	ck_assert_int_eq(logs[0].num_calls, logs[1].num_calls);
+	for (int i = 0; i < logs[0].num_calls; i++)
+		ck_assert_int_eq(logs[0].calls[i], logs[1].calls[i]);
+	
+	// The parallel calls should all have been made
+	for (int p = 0; p < num_periods; p++) {
+		for (int partition = 0; partition < num_partitions; partition++) {
+			ck_assert_int_eq(tick_cnt[p][partition], (num_ticks+periods[p]-1) / periods[p]);
+			ck_assert_int_eq(tock_cnt[p][partition], (num_ticks+periods[p]-1) / periods[p]);
+		}
+	}
+	
+	scheduler_destroy(&(s[0]));
+	scheduler_destroy(&(s[1]));
+}
+END_TEST
+
+
+/**
+ * For use by test_activity_tracking. A sleeper consumes "values" made available
+ * to it by a waker, sleeping when none are waiting.
+ */
+typedef struct {
+	scheduler_event_t *event;
+	
+	// Number of values waiting to be consumed
+	int waiting;
+	
+	// Should a value be consumed in the tock phase?
+	bool take;
+	
+	// Number of tick calls made and values consumed
+	int num_ticks;
+	int num_taken;
+} sleeper_t;
+
+void
+sleeper_tick(void *_sleeper)
+{
+	sleeper_t *sl = (sleeper_t *)_sleeper;
+	sl->num_ticks++;
+	sl->take = sl->waiting > 0;
+	if (!sl->take)
+		scheduler_sleep(sl->event);
+}
+
+void
+sleeper_tock(void *_sleeper)
+{
+	sleeper_t *sl = (sleeper_t *)_sleeper;
+	if (sl->take) {
+		sl->waiting--;
+		sl->num_taken++;
+	}
+}
+
+typedef struct {
+	sleeper_t *sleeper;
+	int interval;
+	int count;
+} waker_t;
+
+void
+waker_tock(void *_waker)
+{
+	waker_t *w = (waker_t *)_waker;
+	if (w->count++ % w->interval == 0) {
+		w->sleeper->waiting++;
+		scheduler_wake(w->sleeper->event);
+	}
+}
+
+
+/**
+ * Ensure that sleeping events are skipped when (and only when) activity
+ * tracking is enabled in a compiled schedule and that doing so does not change
+ * the result. Tested uncompiled, compiled, compiled with activity tracking and
+ * compiled with activity tracking and two threads.
+ */
+START_TEST (test_activity_tracking)
+{
+	const int num_ticks = 300;
+	
+	// Sleepers with differing periods are woken at differing intervals
+	const int num_sleepers = 3;
+	ticks_t sleeper_periods[] = {1, 2, 3};
+	ticks_t waker_periods[]   = {1, 3, 2};
+	int     waker_intervals[] = {7, 2, 6};
+	
+	sleeper_t sleepers[2][3];
+	waker_t   wakers[2][3];
+	scheduler_t s[2];
+	
+	// s[0] is the reference uncompiled schedule
+	for (int j = 0; j < 2; j++) {
+		scheduler_init(&(s[j]));
+		for (int i = 0; i < num_sleepers; i++) {
+			sleeper_t *sl = &(sleepers[j][i]);
+			waker_t   *w  = &(wakers[j][i]);
+			sl->waiting   = 0;
+			sl->take      = false;
+			sl->num_ticks = 0;
+			sl->num_taken = 0;
+			w->sleeper  = sl;
+			w->interval = waker_intervals[i];
+			w->count    = 0;
+			
+			scheduler_set_partition(&(s[j]), SCHEDULER_PARTITION_SERIAL);
+			scheduler_schedule( &(s[j]), waker_periods[i]
+			                  , NULL, NULL
+			                  , waker_tock, w
+			                  );
+			scheduler_set_partition(&(s[j]), i);
+			sl->event = scheduler_schedule( &(s[j]), sleeper_periods[i]
+			                              , sleeper_tick, sl
+			                              , sleeper_tock, sl
+			                              );
+		}
+	}
+	
+	if (_i == 3)
+		scheduler_set_num_threads(&(s[1]), 2);
+	if (_i >= 2)
+		scheduler_set_activity_tracking(&(s[1]), true);
+	if (_i >= 1)
+		scheduler_compile(&(s[1]));
+	
+	for (int t = 0; t < num_ticks; t++) {
+		scheduler_tick_tock(&(s[0]));
+		scheduler_tick_tock(&(s[1]));
+		
+		// The sleepers should behave identically
+		for (int i = 0; i < num_sleepers; i++) {
+			ck_assert_int_eq(sleepers[0][i].waiting, sleepers[1][i].waiting);
+			ck_assert_int_eq(sleepers[0][i].num_taken, sleepers[1][i].num_taken);
+		}
+	}
+	
+	for (int i = 0; i < num_sleepers; i++) {
+		// Check values were actually consumed
+		ck_assert_int_gt(sleepers[0][i].num_taken, 0);
+		
+		// Ticks should only be skipped when tracking activity
+		ck_assert_int_eq(sleepers[0][i].num_ticks, (num_ticks + sleeper_periods[i] - 1) / sleeper_periods[i]);
+		if (_i >= 2)
+			ck_assert_int_lt(sleepers[1][i].num_ticks, sleepers[0][i].num_ticks);
+		else
+			ck_assert_int_eq(sleepers[1][i].num_ticks, sleepers[0][i].num_ticks);
+	}
+	
+	scheduler_destroy(&(s[0]));
+	scheduler_destroy(&(s[1]));
+}
+END_TEST
+
+
+
+/**
+ * For use by test_fast_forward. Reports the time pointed to by the argument as
+ * the next activity time.
+ */
+ticks_t
+next_activity_getter(void *_next)
+{
+	return *((ticks_t *)_next);
+}
+
+
+/**
+ * For use by test_fast_forward. Puts the event pointed to by the argument to
+ * sleep.
+ */
+void
+sleep_tick(void *_event)
+{
+	scheduler_sleep(*((scheduler_event_t **)_event));
+}
+
+
+/**
+ * Ensure that time is only fast-forwarded when no events are busy and only up
+ * to the earliest next activity or limit. Tested uncompiled, compiled with
+ * activity tracking and with two threads.
+ */
+START_TEST (test_fast_forward)
+{
+	scheduler_t s;
+	scheduler_init(&s);
+	
+	// Two events which report their next activity time
+	ticks_t next[2] = {0, 0};
+	for (int i = 0; i < 2; i++) {
+		scheduler_event_t *event = scheduler_schedule(&s, 1, NULL, NULL, NULL, NULL);
+		scheduler_set_next_activity(&s, event, next_activity_getter, &(next[i]));
+	}
+	
+	// An event which goes to sleep whenever it is called
+	scheduler_event_t *sleeper;
+	scheduler_set_partition(&s, 0);
+	sleeper = scheduler_schedule(&s, 1, sleep_tick, &sleeper, NULL, NULL);
+	
+	if (_i >= 1) {
+		scheduler_set_activity_tracking(&s, true);
+		scheduler_set_num_threads(&s, _i);
+		scheduler_compile(&s);
+	}
+	
+	// The sleeper starts off busy
+	next[0] = 10;
+	next[1] = 20;
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 0);
+	ck_assert_int_eq(scheduler_get_ticks(&s), 0);
+	
+	// Once it sleeps, time skips to the earliest activity
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 9);
+	ck_assert_int_eq(scheduler_get_ticks(&s), 10);
+	
+	// An activity due now prevents skipping
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 0);
+	
+	// Time does not skip beyond the limit
+	next[0] = SCHEDULER_NEVER;
+	ck_assert_int_eq(scheduler_fast_forward(&s, 15), 5);
+	ck_assert_int_eq(scheduler_get_ticks(&s), 15);
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 5);
+	ck_assert_int_eq(scheduler_get_ticks(&s), 20);
+	
+	// Waking the sleeper prevents skipping
+	next[1] = 50;
+	scheduler_wake(sleeper);
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 0);
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(scheduler_fast_forward(&s, 100), 29);
+	ck_assert_int_eq(scheduler_get_ticks(&s), 50);
+	
+	scheduler_destroy(&s);
+}
+END_TEST
+
+
+/**
+ * For use by test_sleep_until. Records the time of each call in the array
+ * pointed to by the argument and then sleeps until the next time listed in
+ * wake_times.
+ */
+typedef struct {
+	scheduler_t *scheduler;
+	scheduler_event_t *event;
+	
+	ticks_t *wake_times;
+	int num_wake_times;
+	
+	ticks_t calls[100];
+	int num_calls;
+} timed_sleeper_t;
+
+void
+timed_sleeper_tick(void *_ts)
+{
+	timed_sleeper_t *ts = (timed_sleeper_t *)_ts;
+	ts->calls[ts->num_calls++] = scheduler_get_ticks(ts->scheduler);
+	
+	if (ts->num_calls <= ts->num_wake_times)
+		scheduler_sleep_until(ts->scheduler, ts->event, ts->wake_times[ts->num_calls - 1]);
+	else
+		scheduler_sleep(ts->event);
+}
+
+
+/**
+ * Ensure that events sleeping until a given time are woken at that time,
+ * including times more than one revolution of the timing wheel away, and that
+ * fast-forwarding stops at these times. Tested with one and two threads.
+ */
+START_TEST (test_sleep_until)
+{
+	ticks_t wake_times[] = { 3
+	                       , 4
+	                       , 4 + SCHEDULER_WHEEL_SLOTS
+	                       , 10 + (3 * SCHEDULER_WHEEL_SLOTS)
+	                       };
+	const int num_wake_times = 4;
+	
+	scheduler_t s;
+	scheduler_init(&s);
+	
+	timed_sleeper_t ts;
+	ts.scheduler      = &s;
+	ts.wake_times     = wake_times;
+	ts.num_wake_times = num_wake_times;
+	ts.num_calls      = 0;
+	scheduler_set_partition(&s, 0);
+	ts.event = scheduler_schedule(&s, 1, timed_sleeper_tick, &ts, NULL, NULL);
+	
+	// Sleep once before compiling to ensure timers survive compilation
+	scheduler_tick_tock(&s);
+	
+	scheduler_set_activity_tracking(&s, true);
+	scheduler_set_num_threads(&s, _i);
+	scheduler_compile(&s);
+	
+	// Alternate between fast-forwarding and ticking
+	ticks_t limit = 20 + (3 * SCHEDULER_WHEEL_SLOTS);
+	for (int i = 0; i < 2 * num_wake_times; i++) {
+		if (i % 2 == 0)
+			scheduler_fast_forward(&s, limit);
+		else
+			scheduler_tick_tock(&s);
+	}
+	
+	// Once all timers have expired, time runs to the limit
+	scheduler_fast_forward(&s, limit);
+	ck_assert_int_eq(scheduler_get_ticks(&s), limit);
+	
+	// Should have been called initially and at each wake time
+	ck_assert_int_eq(ts.num_calls, num_wake_times + 1);
+	ck_assert_int_eq(ts.calls[0], 0);
+	for (int i = 0; i < num_wake_times; i++)
+		ck_assert_int_eq(ts.calls[i + 1], wake_times[i]);
+	
+	scheduler_destroy(&s);
+}
+END_TEST
+
 Suite *
 make_scheduler_suite(void)
 {
@@ -118,6 +601,11 @@ make_scheduler_suite(void)
 	TCase *tc_core = tcase_create("Core");
 	tcase_add_test(tc_core, test_time_progresses);
 	tcase_add_test(tc_core, test_schedule);
+	tcase_add_loop_test(tc_core, test_compiled_schedule, 0, 2);
+	tcase_add_loop_test(tc_core, test_threaded_schedule, 1, 5);
+	tcase_add_loop_test(tc_core, test_activity_tracking, 0, 4);
+	tcase_add_loop_test(tc_core, test_fast_forward, 0, 3);
+	tcase_add_loop_test(tc_core, test_sleep_until, 1, 3);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
@@ -0,0 +1,209 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_spinn_arbiter_tree.c -- Unit tests for the SpiNNaker arbiter tree.
+ */
+
+#include <check.h>
+
+#include <stdlib.h>
+
+#include "config.h"
+
+#include "check_check.h"
+
+#include "../src/scheduler.h"
+#include "../src/buffer.h"
+#include "../src/arbiter.h"
+#include "../src/spinn.h"
+#include "../src/spinn_arbiter_tree.h"
+
+#define INPUT_BUFFER_LENGTH 2
+#define ROOT_BUFFER_LENGTH 4
+#define LVL1_BUFFER_LENGTH 1
+#define LVL2_BUFFER_LENGTH 2
+
+scheduler_t s;
+
+// The arbiter tree under test along with its inputs and output
+spinn_arbiter_tree_t tree;
+buffer_t tree_inputs[7];
+buffer_t tree_output;
+buffer_value_t *tree_storage;
+
+// A reference tree built from six separately scheduled arbiters (as
+// spinn_arbiter_tree.h), fed with the same values
+arbiter_t ref_arbiters[6];
+buffer_t ref_inputs[7];
+buffer_t ref_buffers[5];
+buffer_t ref_output;
+
+// Periods (root, lvl1, lvl2) to test with
+const ticks_t periods[][3] = { {1, 2, 4}
+                             , {1, 1, 1}
+                             , {4, 2, 1}
+                             , {2, 3, 5}
+                             };
+
+
+/**
+ * Build the tree under test and the reference tree with the periods selected by
+ * the loop test index.
+ */
+static void
+make_trees(int periods_index)
+{
+	ticks_t root_period = periods[periods_index][0];
+	ticks_t lvl1_period = periods[periods_index][1];
+	ticks_t lvl2_period = periods[periods_index][2];
+	
+	scheduler_init(&s);
+	scheduler_set_activity_tracking(&s, true);
+	
+	buffer_t *tree_inputs_p[7];
+	for (int i = 0; i < 7; i++) {
+		buffer_init(&(tree_inputs[i]), INPUT_BUFFER_LENGTH);
+		buffer_init(&(ref_inputs[i]), INPUT_BUFFER_LENGTH);
+		tree_inputs_p[i] = &(tree_inputs[i]);
+	}
+	buffer_init(&tree_output, ROOT_BUFFER_LENGTH);
+	buffer_init(&ref_output, ROOT_BUFFER_LENGTH);
+	
+	tree_storage = calloc( spinn_arbiter_tree_storage_size(LVL1_BUFFER_LENGTH, LVL2_BUFFER_LENGTH)
+	                     , sizeof(buffer_value_t)
+	                     );
+	spinn_arbiter_tree_init( &tree, &s
+	                       , tree_inputs_p, &tree_output
+	                       , root_period, lvl1_period, lvl2_period
+	                       , LVL1_BUFFER_LENGTH, LVL2_BUFFER_LENGTH
+	                       , tree_storage
+	                       );
+	
+	// Lvl2
+	for (int i = 0; i < 3; i++)
+		buffer_init(&(ref_buffers[i]), LVL2_BUFFER_LENGTH);
+	buffer_t *e_s[]   = {&(ref_inputs[SPINN_EAST]), &(ref_inputs[SPINN_SOUTH])};
+	buffer_t *ne_n[]  = {&(ref_inputs[SPINN_NORTH_EAST]), &(ref_inputs[SPINN_NORTH])};
+	buffer_t *w_sw[]  = {&(ref_inputs[SPINN_WEST]), &(ref_inputs[SPINN_SOUTH_WEST])};
+	arbiter_init(&(ref_arbiters[0]), &s, lvl2_period, e_s, 2, &(ref_buffers[0]));
+	arbiter_init(&(ref_arbiters[1]), &s, lvl2_period, ne_n, 2, &(ref_buffers[1]));
+	arbiter_init(&(ref_arbiters[2]), &s, lvl2_period, w_sw, 2, &(ref_buffers[2]));
+	
+	// Lvl1
+	for (int i = 3; i < 5; i++)
+		buffer_init(&(ref_buffers[i]), LVL1_BUFFER_LENGTH);
+	buffer_t *e_s_ne_n[] = {&(ref_buffers[0]), &(ref_buffers[1])};
+	buffer_t *w_sw_l[]   = {&(ref_buffers[2]), &(ref_inputs[SPINN_LOCAL])};
+	arbiter_init(&(ref_arbiters[3]), &s, lvl1_period, e_s_ne_n, 2, &(ref_buffers[3]));
+	arbiter_init(&(ref_arbiters[4]), &s, lvl1_period, w_sw_l, 2, &(ref_buffers[4]));
+	
+	// Root
+	buffer_t *root[] = {&(ref_buffers[3]), &(ref_buffers[4])};
+	arbiter_init(&(ref_arbiters[5]), &s, root_period, root, 2, &ref_output);
+	
+	scheduler_compile(&s);
+}
+
+
+void
+check_spinn_arbiter_tree_teardown(void)
+{
+	spinn_arbiter_tree_destroy(&tree);
+	free(tree_storage);
+	for (int i = 0; i < 6; i++)
+		arbiter_destroy(&(ref_arbiters[i]));
+	for (int i = 0; i < 5; i++)
+		buffer_destroy(&(ref_buffers[i]));
+	for (int i = 0; i < 7; i++) {
+		buffer_destroy(&(tree_inputs[i]));
+		buffer_destroy(&(ref_inputs[i]));
+	}
+	buffer_destroy(&tree_output);
+	buffer_destroy(&ref_output);
+	scheduler_destroy(&s);
+}
+
+
+/**
+ * Values pushed into a single input come out of the root in order.
+ */
+START_TEST (test_single_input)
+{
+	make_trees(_i);
+	
+	for (int direction = 0; direction < 7; direction++) {
+		for (int i = 0; i < INPUT_BUFFER_LENGTH; i++)
+			buffer_push(&(tree_inputs[direction]), INT_TO_BUFFER_VALUE(i));
+		
+		// Allow plenty of time for the values to pass through
+		for (int t = 0; t < 100; t++)
+			scheduler_tick_tock(&s);
+		
+		for (int i = 0; i < INPUT_BUFFER_LENGTH; i++) {
+			ck_assert(!buffer_is_empty(&tree_output));
+			ck_assert_int_eq(BUFFER_VALUE_TO_INT(buffer_pop(&tree_output)), i);
+		}
+		ck_assert(buffer_is_empty(&tree_output));
+	}
+}
+END_TEST
+
+
+/**
+ * With random traffic and a randomly blocked output, the tree behaves exactly
+ * as six separate arbiters do.
+ */
+START_TEST (test_matches_arbiters)
+{
+	make_trees(_i);
+	
+	srand(_i);
+	int next_value = 0;
+	int num_values_out = 0;
+	for (int t = 0; t < 20000; t++) {
+		// Occasionally add values (identifying their input) to the inputs
+		for (int direction = 0; direction < 7; direction++) {
+			if (rand() % 8 == 0 && !buffer_is_full(&(tree_inputs[direction]))) {
+				ck_assert(!buffer_is_full(&(ref_inputs[direction])));
+				buffer_push(&(tree_inputs[direction]), INT_TO_BUFFER_VALUE(next_value));
+				buffer_push(&(ref_inputs[direction]), INT_TO_BUFFER_VALUE(next_value));
+				next_value++;
+			}
+		}
+		
+		scheduler_tick_tock(&s);
+		
+		// Drain the outputs at a limited rate
+		if (rand() % 2 == 0) {
+			ck_assert(buffer_is_empty(&tree_output) == buffer_is_empty(&ref_output));
+			if (!buffer_is_empty(&tree_output)) {
+				ck_assert_int_eq( BUFFER_VALUE_TO_INT(buffer_pop(&tree_output))
+				                , BUFFER_VALUE_TO_INT(buffer_pop(&ref_output))
+				                );
+				num_values_out++;
+			}
+		}
+	}
+	
+	// Make sure plenty of values made it through
+	ck_assert(num_values_out > 1000);
+}
+END_TEST
+
+
+Suite *
+make_spinn_arbiter_tree_suite(void)
+{
+	Suite *s = suite_create("spinn_arbiter_tree");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, NULL, check_spinn_arbiter_tree_teardown);
+	tcase_add_loop_test(tc_core, test_single_input, 0, 4);
+	tcase_add_loop_test(tc_core, test_matches_arbiters, 0, 4);
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
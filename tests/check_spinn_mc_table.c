@@ -0,0 +1,182 @@
+/**
+ * TickySim -- A timing based interconnection network simulator.
+ *
+ * check_spinn_mc_table.c -- Unit tests for multicast routing tables.
+ */
+
+#include <check.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#include "check_check.h"
+
+#include "../src/spinn_mc_table.h"
+
+spinn_mc_table_t t;
+
+
+void
+check_spinn_mc_table_setup(void)
+{
+	spinn_mc_table_init(&t);
+}
+
+
+void
+check_spinn_mc_table_teardown(void)
+{
+	spinn_mc_table_destroy(&t);
+}
+
+
+/**
+ * Reference implementation: the route of the first matching entry found by
+ * scanning every entry in turn.
+ */
+static bool
+linear_lookup( const uint32_t *keys, const uint32_t *masks, const unsigned int *routes
+             , int num_entries
+             , uint32_t key
+             , unsigned int *route
+             )
+{
+	for (int i = 0; i < num_entries; i++) {
+		if ((key & masks[i]) == keys[i]) {
+			*route = routes[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**
+ * An empty table matches nothing.
+ */
+START_TEST (test_empty)
+{
+	unsigned int route = 123u;
+	ck_assert_int_eq(spinn_mc_table_get_num_entries(&t), 0);
+	ck_assert(!spinn_mc_table_lookup(&t, 0x00000000u, &route));
+	ck_assert(!spinn_mc_table_lookup(&t, 0xFFFFFFFFu, &route));
+	ck_assert_int_eq(route, 123u);
+}
+END_TEST
+
+
+/**
+ * Exact and masked matches.
+ */
+START_TEST (test_match)
+{
+	spinn_mc_table_add(&t, 0x12340000u, 0xFFFF0000u, 0x01u);
+	spinn_mc_table_add(&t, 0xABCD0001u, 0xFFFFFFFFu, 0x42u);
+	ck_assert_int_eq(spinn_mc_table_get_num_entries(&t), 2);
+	
+	unsigned int route;
+	ck_assert(spinn_mc_table_lookup(&t, 0x12340000u, &route));
+	ck_assert_int_eq(route, 0x01u);
+	ck_assert(spinn_mc_table_lookup(&t, 0x1234FFFFu, &route));
+	ck_assert_int_eq(route, 0x01u);
+	ck_assert(spinn_mc_table_lookup(&t, 0xABCD0001u, &route));
+	ck_assert_int_eq(route, 0x42u);
+	
+	ck_assert(!spinn_mc_table_lookup(&t, 0x12350000u, &route));
+	ck_assert(!spinn_mc_table_lookup(&t, 0xABCD0000u, &route));
+}
+END_TEST
+
+
+/**
+ * Where several entries match, the first added is used regardless of the order
+ * in which their masks were first seen.
+ */
+START_TEST (test_priority)
+{
+	spinn_mc_table_add(&t, 0x00000000u, 0xF0000000u, 0x01u);
+	spinn_mc_table_add(&t, 0x10000000u, 0xFF000000u, 0x02u);
+	spinn_mc_table_add(&t, 0x11000000u, 0xF0000000u, 0x03u); // Never matches
+	spinn_mc_table_add(&t, 0x10000000u, 0xF0000000u, 0x04u);
+	spinn_mc_table_add(&t, 0x10000000u, 0xF0000000u, 0x05u); // Duplicate
+	spinn_mc_table_add(&t, 0x00000000u, 0x00000000u, 0x06u); // Catch-all
+	
+	unsigned int route;
+	ck_assert(spinn_mc_table_lookup(&t, 0x0ABCDEF0u, &route));
+	ck_assert_int_eq(route, 0x01u);
+	ck_assert(spinn_mc_table_lookup(&t, 0x10ABCDEFu, &route));
+	ck_assert_int_eq(route, 0x02u);
+	ck_assert(spinn_mc_table_lookup(&t, 0x11ABCDEFu, &route));
+	ck_assert_int_eq(route, 0x04u);
+	ck_assert(spinn_mc_table_lookup(&t, 0xFFFFFFFFu, &route));
+	ck_assert_int_eq(route, 0x06u);
+}
+END_TEST
+
+
+/**
+ * Large random tables (with a handful of masks, as in real tables) give the
+ * same results as a linear scan.
+ */
+#define NUM_RANDOM_ENTRIES 1000
+START_TEST (test_random)
+{
+	static uint32_t     keys[NUM_RANDOM_ENTRIES];
+	static uint32_t     masks[NUM_RANDOM_ENTRIES];
+	static unsigned int routes[NUM_RANDOM_ENTRIES];
+	
+	const uint32_t mask_choices[] = { 0xFFFFFFFFu, 0xFFFFFF00u, 0xFFFFF800u
+	                                , 0xFFFF0000u, 0xFF000000u, 0xFFFFFFF0u
+	                                };
+	int num_mask_choices = sizeof(mask_choices) / sizeof(mask_choices[0]);
+	
+	srand(_i);
+	for (int i = 0; i < NUM_RANDOM_ENTRIES; i++) {
+		// Keys are drawn from a small space so that entries often overlap
+		masks[i]  = mask_choices[rand() % num_mask_choices];
+		keys[i]   = ((uint32_t)(rand() % 4) << 24 | (uint32_t)(rand() % 16) << 8 | (uint32_t)(rand() % 4));
+		keys[i]  &= masks[i];
+		routes[i] = rand() % (1 << 7);
+		spinn_mc_table_add(&t, keys[i], masks[i], routes[i]);
+	}
+	ck_assert_int_eq(spinn_mc_table_get_num_entries(&t), NUM_RANDOM_ENTRIES);
+	
+	int num_hits = 0;
+	for (int i = 0; i < 10000; i++) {
+		uint32_t key = ((uint32_t)(rand() % 5) << 24 | (uint32_t)(rand() % 17) << 8 | (uint32_t)(rand() % 5));
+		unsigned int expected_route = 0xFFu;
+		unsigned int route = 0xFFu;
+		bool expected_hit = linear_lookup(keys, masks, routes, NUM_RANDOM_ENTRIES, key, &expected_route);
+		bool hit = spinn_mc_table_lookup(&t, key, &route);
+		ck_assert(hit == expected_hit);
+		ck_assert_int_eq(route, expected_route);
+		num_hits += hit;
+	}
+	
+	// Make sure both hits and misses were tested
+	ck_assert(num_hits > 0);
+	ck_assert(num_hits < 10000);
+}
+END_TEST
+
+
+Suite *
+make_spinn_mc_table_suite(void)
+{
+	Suite *s = suite_create("spinn_mc_table");
+	
+	// Add tests to the test case
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(tc_core, check_spinn_mc_table_setup, check_spinn_mc_table_teardown);
+	tcase_add_test(tc_core, test_empty);
+	tcase_add_test(tc_core, test_match);
+	tcase_add_test(tc_core, test_priority);
+	tcase_add_loop_test(tc_core, test_random, 0, 4);
+	
+	// Add each test case to the suite
+	suite_add_tcase(s, tc_core);
+	
+	return s;
+}
@@ -87,7 +87,7 @@ START_TEST (test_idle)
 	
 	// Fill the buffer with packets which are not to be accepted
 	for (int i = 0; i < BUFFER_SIZE; i++)
-		buffer_push(&b, spinn_packet_pool_palloc(&pool));
+		buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
 	
 	for (int i = 0; i < PERIOD * 10; i++)
 		scheduler_tick_tock(&s);
@@ -109,7 +109,7 @@ START_TEST (test_active)
 	
 	// Fill the buffer with packets which will all be accepted
 	for (int i = 0; i < BUFFER_SIZE; i++)
-		buffer_push(&b, spinn_packet_pool_palloc(&pool));
+		buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
 	
 	// Make sure all packets are accepted in the expected timeframe
 	for (int i = 0; i < PERIOD * BUFFER_SIZE; i++)
@@ -140,7 +140,7 @@ START_TEST (test_50_50)
 	
 	// Fill the buffer with packets, some of which will be accepted
 	for (int i = 0; i < BUFFER_SIZE; i++)
-		buffer_push(&b, spinn_packet_pool_palloc(&pool));
+		buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
 	
 	for (int i = 0; i < PERIOD * BUFFER_SIZE; i++)
 		scheduler_tick_tock(&s);
@@ -166,7 +166,7 @@ START_TEST (test_periodic_free)
 	
 	// Fill the buffer with packets
 	for (int i = 0; i < BUFFER_SIZE; i++)
-		buffer_push(&b, spinn_packet_pool_palloc(&pool));
+		buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
 	
 	// Run for long enough that the buffer ends up empty
 	for (int i = 0; i < BUFFER_SIZE; i++) {
@@ -211,8 +211,8 @@ START_TEST (test_periodic_blocked)
 	
 	// If a couple of packets are added to the buffer, the consumer should
 	// immediately consume a packet.
-	buffer_push(&b, spinn_packet_pool_palloc(&pool));
-	buffer_push(&b, spinn_packet_pool_palloc(&pool));
+	buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
+	buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
 	for (int k = 0; k < PERIOD; k++)
 		scheduler_tick_tock(&s);
 	ck_assert_int_eq(packets_received, 1);
@@ -234,6 +234,46 @@ START_TEST (test_periodic_blocked)
 END_TEST
 
 
+
+/**
+ * Ensure that a periodic consumer allows the scheduler to fast-forward
+ * indefinitely when it has nothing to consume and otherwise to exactly the time
+ * the next packet is due to be consumed.
+ */
+START_TEST (test_periodic_fast_forward)
+{
+	INIT_CON();
+	SET_CON_PERIODIC(INTERVAL);
+	
+	ticks_t limit = PERIOD * INTERVAL * 10;
+	
+	// With nothing to consume, skip straight to the limit
+	ck_assert_int_eq(scheduler_fast_forward(&s, limit), limit);
+	ck_assert_int_eq(scheduler_get_ticks(&s), limit);
+	limit *= 2;
+	
+	// Once a packet arrives it is consumed immediately
+	buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
+	buffer_push(&b, spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool)));
+	ck_assert_int_eq(scheduler_fast_forward(&s, limit), 0);
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(packets_received, 1);
+	
+	// The next packet is not due for another interval
+	ticks_t consumed_at = scheduler_get_ticks(&s) - 1;
+	scheduler_fast_forward(&s, limit);
+	ck_assert_int_eq(scheduler_get_ticks(&s), consumed_at + (PERIOD * INTERVAL));
+	ck_assert_int_eq(packets_received, 1);
+	scheduler_tick_tock(&s);
+	ck_assert_int_eq(packets_received, 2);
+	
+	// Nothing left to consume
+	ticks_t remaining = limit - scheduler_get_ticks(&s);
+	ck_assert_int_eq(scheduler_fast_forward(&s, limit), remaining);
+	ck_assert_int_eq(scheduler_get_ticks(&s), limit);
+}
+END_TEST
+
 Suite *
 make_spinn_packet_con_suite(void)
 {
@@ -247,6 +287,7 @@ make_spinn_packet_con_suite(void)
 	tcase_add_test(tc_core, test_50_50);
 	tcase_add_test(tc_core, test_periodic_free);
 	tcase_add_test(tc_core, test_periodic_blocked);
+	tcase_add_test(tc_core, test_periodic_fast_forward);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
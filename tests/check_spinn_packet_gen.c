@@ -41,6 +41,9 @@ spinn_packet_gen_t g;
 int packets_blocked;
 int packets_sent;
 
+// The last (non-NULL) packet passed to the on_packet_gen callback
+spinn_packet_t *last_packet_gen;
+
 void
 check_spinn_packet_gen_setup(void)
 {
@@ -49,6 +52,7 @@ check_spinn_packet_gen_setup(void)
 	spinn_packet_pool_init(&pool);
 	packets_blocked = 0;
 	packets_sent = 0;
+	last_packet_gen = NULL;
 }
 
 
@@ -62,17 +66,17 @@ check_spinn_packet_gen_teardown(void)
 }
 
 
-void *
+void
 on_packet_gen(spinn_packet_t *p, void *data)
 {
 	ck_assert_int_eq((int)data, 1234);
 	
-	if (p == NULL)
+	if (p == NULL) {
 		packets_blocked++;
-	else
+	} else {
 		packets_sent++;
-	
-	return (void *)4321;
+		last_packet_gen = p;
+	}
 }
 
 bool
@@ -191,6 +195,39 @@ START_TEST (test_50_50)
 }
 END_TEST
 
+
+/**
+ * Ensure that a Bernoulli generator sends packets at roughly the requested rate
+ * and that it allows the scheduler to fast-forward to exactly the time the next
+ * packet is due.
+ */
+#define NUM_BERNOULLI_PACKETS 1000
+START_TEST (test_bernoulli_fast_forward)
+{
+	INIT_GEN(true);
+	spinn_packet_gen_set_seed(&g, _i, 0u);
+	SET_GEN_BERNOULLI(0.1); SET_GEN_CYCLIC();
+	
+	for (int i = 0; i < NUM_BERNOULLI_PACKETS; i++) {
+		// Should skip straight to the tick when the next packet is sent
+		scheduler_fast_forward(&s, SCHEDULER_NEVER - 1);
+		ck_assert_int_eq(packets_sent, i);
+		scheduler_tick_tock(&s);
+		ck_assert_int_eq(packets_sent, i + 1);
+		
+		// Keep the output free
+		buffer_pop(&b);
+	}
+	
+	// On average a packet should be sent every ten periods (the bounds are many
+	// standard deviations away)
+	ticks_t mean_period = scheduler_get_ticks(&s) / NUM_BERNOULLI_PACKETS;
+	ck_assert(mean_period > PERIOD * 8);
+	ck_assert(mean_period < PERIOD * 12);
+	ck_assert_int_eq(packets_blocked, 0);
+}
+END_TEST
+
 /**
  * Ensure that the cyclic distribution sends a packet to each node exactly twice
  * given a number of iterations equal to the number of nodes. Also tests the
@@ -211,11 +248,11 @@ START_TEST (test_cyclic_dist)
 		
 		// A packet should have arrived, note its position
 		ck_assert(!buffer_is_empty(&b));
-		spinn_packet_t *p = (spinn_packet_t *)buffer_pop(&b);
-		visited_nodes[p->destination.x][p->destination.y]++;
+		spinn_packet_t *p = spinn_packet_pool_get_packet(&pool, buffer_pop(&b));
+		visited_nodes[spinn_packet_get_destination(p).x][spinn_packet_get_destination(p).y]++;
 		
-		// Check the payload added by the callback is correct
-		ck_assert_int_eq((int)p->payload, 4321);
+		// Check the callback was given the packet
+		ck_assert(p == last_packet_gen);
 		
 		// Free the packet resource
 		spinn_packet_pool_pfree(&pool, p);
@@ -237,6 +274,69 @@ START_TEST (test_cyclic_dist)
 }
 END_TEST
 
+/**
+ * Ensure that the table distribution only sends packets to the listed
+ * destinations in proportion to their weights, offsetting relative
+ * destinations from the generator's position (wrapping around the system) and
+ * picking again when a destination is filtered out.
+ */
+#define NUM_TABLE_PACKETS 3000
+START_TEST (test_table_dist)
+{
+	bool relative = _i != 0;
+	const spinn_coord_t destinations[] = { {0,0}, {1,5}, {3,6}, {2,2} };
+	const double weights[] = { 1.0, 2.0, 0.0, 1.0 };
+	alias_table_t table;
+	alias_table_init(&table, weights, 4);
+	
+	// Local packets are filtered out and so destination (0,0) should never be
+	// used when relative
+	INIT_GEN(false); SET_GEN_BERNOULLI(1.0);
+	spinn_packet_gen_set_spatial_dist_table(&g, &table, destinations, relative);
+	
+	int counts[4] = {0};
+	for (int i = 0; i < NUM_TABLE_PACKETS; i++) {
+		for (int j = 0; j < PERIOD; j++)
+			scheduler_tick_tock(&s);
+		
+		ck_assert(!buffer_is_empty(&b));
+		spinn_packet_t *p = spinn_packet_pool_get_packet(&pool, buffer_pop(&b));
+		spinn_coord_t dest = spinn_packet_get_destination(p);
+		spinn_packet_pool_pfree(&pool, p);
+		
+		int found = -1;
+		for (int d = 0; d < 4; d++) {
+			spinn_coord_t expected = destinations[d];
+			if (relative) {
+				expected.x = (POSITION.x + expected.x) % SYSTEM_SIZE_X;
+				expected.y = (POSITION.y + expected.y) % SYSTEM_SIZE_Y;
+			}
+			if (dest.x == expected.x && dest.y == expected.y)
+				found = d;
+		}
+		ck_assert(found >= 0);
+		counts[found]++;
+	}
+	
+	// Destination 1 is twice as likely as the remaining allowed destinations
+	// (the bounds are many standard deviations from the expected counts)
+	ck_assert_int_eq(counts[2], 0);
+	if (relative) {
+		ck_assert_int_eq(counts[0], 0);
+		ck_assert(counts[1] > (NUM_TABLE_PACKETS * 2) / 3 - 200);
+		ck_assert(counts[1] < (NUM_TABLE_PACKETS * 2) / 3 + 200);
+	} else {
+		ck_assert(counts[1] > NUM_TABLE_PACKETS / 2 - 200);
+		ck_assert(counts[1] < NUM_TABLE_PACKETS / 2 + 200);
+		ck_assert(counts[0] > NUM_TABLE_PACKETS / 4 - 200);
+		ck_assert(counts[0] < NUM_TABLE_PACKETS / 4 + 200);
+	}
+	ck_assert_int_eq(packets_sent, NUM_TABLE_PACKETS);
+	
+	alias_table_destroy(&table);
+}
+END_TEST
+
 /**
  * Ensure that the p2p distribution sends a packets to only the specified node
  * or none at all if the specified node is (-1,-1).
@@ -258,12 +358,12 @@ START_TEST (test_p2p_dist)
 		if (!null_destination) {
 			// A packet should have arrived, note its position
 			ck_assert(!buffer_is_empty(&b));
-			spinn_packet_t *p = (spinn_packet_t *)buffer_pop(&b);
-			ck_assert_int_eq(p->destination.x, 0);
-			ck_assert_int_eq(p->destination.y, 0);
+			spinn_packet_t *p = spinn_packet_pool_get_packet(&pool, buffer_pop(&b));
+			ck_assert_int_eq(spinn_packet_get_destination(p).x, 0);
+			ck_assert_int_eq(spinn_packet_get_destination(p).y, 0);
 			
-			// Check the payload added by the callback is correct
-			ck_assert_int_eq((int)p->payload, 4321);
+			// Check the callback was given the packet
+			ck_assert(p == last_packet_gen);
 			
 			// Free the packet resource
 			spinn_packet_pool_pfree(&pool, p);
@@ -298,12 +398,12 @@ END_TEST
 			 \
 			/* A packet should have arrived, check its position */ \
 			ck_assert(!buffer_is_empty(&b)); \
-			spinn_packet_t *p = (spinn_packet_t *)buffer_pop(&b); \
-			ck_assert_int_eq(p->destination.x, (expected_x)); \
-			ck_assert_int_eq(p->destination.y, (expected_y)); \
+			spinn_packet_t *p = spinn_packet_pool_get_packet(&pool, buffer_pop(&b)); \
+			ck_assert_int_eq(spinn_packet_get_destination(p).x, (expected_x)); \
+			ck_assert_int_eq(spinn_packet_get_destination(p).y, (expected_y)); \
 			 \
-			/* Check the payload added by the callback is correct */ \
-			ck_assert_int_eq((int)p->payload, 4321); \
+			/* Check the callback was given the packet */ \
+			ck_assert(p == last_packet_gen); \
 			 \
 			/* Free the packet resource */ \
 			spinn_packet_pool_pfree(&pool, p); \
@@ -386,7 +486,7 @@ START_TEST (test_periodic_blocked)
 	
 	// Fill the buffer
 	for (int i = 0; i < BUFFER_SIZE; i++)
-		buffer_push(&b, NULL);
+		buffer_push(&b, INT_TO_BUFFER_VALUE(0));
 	
 	// Run the generator for one and a half intervals, during which time nothing
 	// should be sent and we end up at what would be mid-interval had the packet
@@ -422,6 +522,68 @@ START_TEST (test_periodic_blocked)
 END_TEST
 
 
+
+/**
+ * Ensure that packets are treated as blocked when the packet pool is exhausted
+ * and that generation resumes once packets are freed.
+ */
+START_TEST (test_pool_exhausted)
+{
+	INIT_GEN(true); SET_GEN_BERNOULLI(1.0); SET_GEN_CYCLIC();
+	
+	// Only allow a single packet to exist
+	spinn_packet_pool_set_max_packets(&pool, 1);
+	
+	for (int j = 0; j < PERIOD * 3; j++)
+		scheduler_tick_tock(&s);
+	ck_assert_int_eq(packets_sent, 1);
+	ck_assert_int_eq(packets_blocked, 2);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&pool), 2);
+	
+	// Once the packet is freed, another may be generated
+	spinn_packet_pool_pfree(&pool, spinn_packet_pool_get_packet(&pool, buffer_pop(&b)));
+	for (int j = 0; j < PERIOD; j++)
+		scheduler_tick_tock(&s);
+	ck_assert_int_eq(packets_sent, 2);
+	ck_assert_int_eq(packets_blocked, 2);
+	
+	spinn_packet_pool_pfree(&pool, spinn_packet_pool_get_packet(&pool, buffer_pop(&b)));
+}
+END_TEST
+
+
+/**
+ * Ensure that a periodic generator allows the scheduler to fast-forward to
+ * exactly the time the next packet is due.
+ */
+START_TEST (test_periodic_fast_forward)
+{
+	INIT_GEN(true); SET_GEN_PERIODIC(INTERVAL); SET_GEN_CYCLIC();
+	
+	ticks_t limit = PERIOD * INTERVAL * REPEATS;
+	
+	for (int i = 0; i < REPEATS - 1; i++) {
+		// Should skip straight to the tick when the packet is sent
+		scheduler_fast_forward(&s, limit);
+		ck_assert_int_eq(scheduler_get_ticks(&s), PERIOD * ((INTERVAL * (i + 1)) - 1));
+		ck_assert_int_eq(packets_sent, i);
+		
+		// Should not skip while a packet is due
+		ck_assert_int_eq(scheduler_fast_forward(&s, limit), 0);
+		scheduler_tick_tock(&s);
+		ck_assert_int_eq(packets_sent, i + 1);
+		
+		// Keep the output free
+		buffer_pop(&b);
+	}
+	
+	// Should not skip beyond the limit
+	ck_assert_int_eq(scheduler_fast_forward(&s, scheduler_get_ticks(&s) + 1), 1);
+	ck_assert_int_eq(packets_sent, REPEATS - 1);
+	ck_assert_int_eq(packets_blocked, 0);
+}
+END_TEST
+
 Suite *
 make_spinn_packet_gen_suite(void)
 {
@@ -433,10 +595,14 @@ make_spinn_packet_gen_suite(void)
 	tcase_add_loop_test(tc_core, test_idle, 0, 2);
 	tcase_add_loop_test(tc_core, test_certain, 0, 2);
 	tcase_add_loop_test(tc_core, test_50_50, 0, 2);
+	tcase_add_loop_test(tc_core, test_bernoulli_fast_forward, 0, 4);
 	tcase_add_loop_test(tc_core, test_periodic_free, 0, 2);
 	tcase_add_loop_test(tc_core, test_periodic_blocked, 0, 2);
+	tcase_add_test(tc_core, test_periodic_fast_forward);
+	tcase_add_test(tc_core, test_pool_exhausted);
 	tcase_add_loop_test(tc_core, test_cyclic_dist, 0, 2);
 	tcase_add_loop_test(tc_core, test_p2p_dist, 0, 2);
+	tcase_add_loop_test(tc_core, test_table_dist, 0, 2);
 	tcase_add_loop_test(tc_core, test_complement_dist, 0, SYSTEM_SIZE_X*SYSTEM_SIZE_Y);
 	tcase_add_loop_test(tc_core, test_transpose_dist, 0, SYSTEM_SIZE_X*SYSTEM_SIZE_Y);
 	tcase_add_loop_test(tc_core, test_tornado_dist, 0, SYSTEM_SIZE_X*SYSTEM_SIZE_Y);
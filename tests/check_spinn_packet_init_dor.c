@@ -8,11 +8,13 @@
 
 #include <check.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 #include "config.h"
 
 #include "check_check.h"
 
+#include "../src/rng.h"
 #include "../src/spinn.h"
 #include "../src/spinn_packet.h"
 #include "../src/spinn_topology.h"
@@ -24,29 +26,31 @@
 START_TEST (test_manual)
 {
 	spinn_packet_t p;
+	rng_t rng;
+	rng_init(&rng, 0u, 0u);
 	
 	// Set it to something inappropriate (to make sure it is overwritten)
-	p.emg_state = SPINN_EMG_FIRST_LEG;
+	p.state = 0xFFu;
 	
 	spinn_packet_init_dor( &p
 	                     , (spinn_coord_t){0,0}
 	                     , (spinn_coord_t){2,1}
 	                     , (spinn_coord_t){5,5}
 	                     , true
-	                     , (void *)1024
+	                     , &rng
 	                     );
-	ck_assert_int_eq(p.direction, SPINN_EAST);
+	ck_assert_int_eq(spinn_packet_get_direction(&p), SPINN_EAST);
 	
-	ck_assert_int_eq(p.destination.x, 2);
-	ck_assert_int_eq(p.destination.y, 1);
+	ck_assert_int_eq(spinn_packet_get_destination(&p).x, 2);
+	ck_assert_int_eq(spinn_packet_get_destination(&p).y, 1);
 	
-	ck_assert_int_eq(p.inflection_point.x, 1);
-	ck_assert_int_eq(p.inflection_point.y, 0);
-	ck_assert_int_eq(p.inflection_direction, SPINN_NORTH_EAST);
+	ck_assert_int_eq(spinn_packet_get_inflection_point(&p).x, 1);
+	ck_assert_int_eq(spinn_packet_get_inflection_point(&p).y, 0);
+	ck_assert_int_eq(spinn_packet_get_inflection_direction(&p), SPINN_NORTH_EAST);
 	
-	ck_assert_int_eq(p.emg_state, SPINN_EMG_NORMAL);
+	ck_assert_int_eq(spinn_packet_get_emg_state(&p), SPINN_EMG_NORMAL);
 	
-	ck_assert_int_eq((int)p.payload, 1024);
+	ck_assert_int_eq(spinn_packet_get_type(&p), SPINN_PACKET_P2P);
 }
 END_TEST
 
@@ -66,6 +70,9 @@ START_TEST (test_exhaustive)
 	};
 	const int num_tests = sizeof(test_sizes)/sizeof(spinn_coord_t);
 	
+	rng_t rng;
+	rng_init(&rng, 0u, 0u);
+	
 	// For various sizes, exhaustively test the algorithm
 	for (int i = 0; i < num_tests; i++) {
 		for (int use_wrap_around_links = 0; use_wrap_around_links < 2; use_wrap_around_links++) {
@@ -75,27 +82,28 @@ START_TEST (test_exhaustive)
 						for (int x2 = 0; x2 < test_sizes[i].x; x2++) {
 							spinn_packet_t p;
 							// Set it to something inappropriate (to make sure it is overwritten)
-							p.emg_state = SPINN_EMG_FIRST_LEG;
+							p.state = 0xFFu;
 							spinn_packet_init_dor( &p
 							                     , (spinn_coord_t){x1,y1}
 							                     , (spinn_coord_t){x2,y2}
 							                     , test_sizes[i]
 							                     , use_wrap_around_links
-							                     , (void *)1024
+							                     , &rng
 							                     );
 							
 							// Check the basic essentials
-							ck_assert_int_eq(p.destination.x, x2);
-							ck_assert_int_eq(p.destination.y, y2);
-							ck_assert_int_eq(p.emg_state, SPINN_EMG_NORMAL);
-							ck_assert_int_eq((int)p.payload, 1024);
+							ck_assert_int_eq(spinn_packet_get_destination(&p).x, x2);
+							ck_assert_int_eq(spinn_packet_get_destination(&p).y, y2);
+							ck_assert_int_eq(spinn_packet_get_source(&p).x, x1);
+							ck_assert_int_eq(spinn_packet_get_source(&p).y, y1);
+							ck_assert_int_eq(spinn_packet_get_emg_state(&p), SPINN_EMG_NORMAL);
 							
 							// Test an assumption made by this test: if path does not have an
 							// inflection point, the inflection point will be set to the
 							// destination.
-							if (p.inflection_direction == SPINN_LOCAL) {
-								ck_assert_int_eq(p.inflection_point.x, x2);
-								ck_assert_int_eq(p.inflection_point.y, y2);
+							if (spinn_packet_get_inflection_direction(&p) == SPINN_LOCAL) {
+								ck_assert_int_eq(spinn_packet_get_inflection_point(&p).x, x2);
+								ck_assert_int_eq(spinn_packet_get_inflection_point(&p).y, y2);
 							}
 							
 							// Find the shortest path
@@ -107,23 +115,23 @@ START_TEST (test_exhaustive)
 								                         );
 								// Find the vector to and from the inflection point.
 								v1 = spinn_shortest_vector( (spinn_coord_t){x1, y1}
-								                          , p.inflection_point
+								                          , spinn_packet_get_inflection_point(&p)
 								                          , test_sizes[i]
 								                          );
-								v2 = spinn_shortest_vector( p.inflection_point
+								v2 = spinn_shortest_vector( spinn_packet_get_inflection_point(&p)
 								                          , (spinn_coord_t){x2, y2}
 								                          , test_sizes[i]
 								                          );
 							} else {
 								v = spinn_full_coord_minimise((spinn_full_coord_t){x2-x1, y2-y1, 0});
 								v1 = spinn_full_coord_minimise((spinn_full_coord_t){
-									p.inflection_point.x-x1,
-									p.inflection_point.y-y1,
+									spinn_packet_get_inflection_point(&p).x-x1,
+									spinn_packet_get_inflection_point(&p).y-y1,
 									0
 								});
 								v2 = spinn_full_coord_minimise((spinn_full_coord_t){
-									x2-p.inflection_point.x,
-									y2-p.inflection_point.y,
+									x2-spinn_packet_get_inflection_point(&p).x,
+									y2-spinn_packet_get_inflection_point(&p).y,
 									0
 								});
 							}
@@ -148,8 +156,8 @@ START_TEST (test_exhaustive)
 							                );
 							
 							// Directions before and after the inflection point
-							spinn_direction_t d1 = p.direction;
-							spinn_direction_t d2 = p.inflection_direction;
+							spinn_direction_t d1 = spinn_packet_get_direction(&p);
+							spinn_direction_t d2 = spinn_packet_get_inflection_direction(&p);
 							
 							// The direction should initially be set to the vector to the
 							// inflection point (or if the vector is 0s, the direction should be
@@ -194,6 +202,129 @@ START_TEST (test_exhaustive)
 END_TEST
 
 
+/**
+ * On meshes and tori with odd dimensions (where there is only one dimension-order
+ * route), spinn_dor_direction should give the same direction at every hop as
+ * following the route set up by spinn_packet_init_dor, as a router would.
+ */
+START_TEST (test_matches_dor_direction)
+{
+	const struct {
+		spinn_coord_t size;
+		bool          use_wrap_around_links;
+	} test_systems[] = {
+		// Meshes
+		{{1,1}, false}, {{2,2}, false}, {{3,3}, false}, {{8,8}, false}, {{9,9}, false},
+		{{1,3}, false}, {{4,5}, false}, {{4,6}, false}, {{7,4}, false}, {{8,4}, false},
+		// Tori with odd dimensions
+		{{1,1}, true}, {{3,3}, true}, {{9,9}, true},
+		{{1,3}, true}, {{3,1}, true}, {{5,7}, true}, {{7,5}, true}, {{3,9}, true},
+	};
+	const int num_tests = sizeof(test_systems)/sizeof(test_systems[0]);
+	
+	rng_t rng;
+	rng_init(&rng, 0u, 0u);
+	
+	for (int i = 0; i < num_tests; i++) {
+		spinn_coord_t size = test_systems[i].size;
+		bool use_wrap_around_links = test_systems[i].use_wrap_around_links;
+		for (int y1 = 0; y1 < size.y; y1++) {
+			for (int x1 = 0; x1 < size.x; x1++) {
+				for (int y2 = 0; y2 < size.y; y2++) {
+					for (int x2 = 0; x2 < size.x; x2++) {
+						spinn_packet_t p;
+						spinn_packet_init_dor( &p
+						                     , (spinn_coord_t){x1,y1}
+						                     , (spinn_coord_t){x2,y2}
+						                     , size
+						                     , use_wrap_around_links
+						                     , &rng
+						                     );
+						spinn_coord_t inflection_point = spinn_packet_get_inflection_point(&p);
+						
+						// Follow the packet's route, hop by hop, as a router would
+						spinn_coord_t pos = {x1, y1};
+						spinn_direction_t d = spinn_packet_get_direction(&p);
+						int num_hops = 0;
+						for (;;) {
+							if (pos.x == x2 && pos.y == y2)
+								d = SPINN_LOCAL;
+							else if (pos.x == inflection_point.x && pos.y == inflection_point.y)
+								d = spinn_packet_get_inflection_direction(&p);
+							
+							ck_assert_int_eq(spinn_dor_direction( pos
+							                                    , (spinn_coord_t){x2,y2}
+							                                    , size
+							                                    , use_wrap_around_links
+							                                    )
+							                , d
+							                );
+							if (d == SPINN_LOCAL)
+								break;
+							
+							spinn_coord_t delta = spinn_dir_to_vector(d);
+							pos.x = (pos.x + delta.x + size.x) % size.x;
+							pos.y = (pos.y + delta.y + size.y) % size.y;
+							num_hops++;
+							ck_assert(num_hops <= size.x + size.y);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+END_TEST
+
+
+/**
+ * Packets are packed into 16 bytes and the packed fields may be set
+ * independently of each other.
+ */
+START_TEST (test_packed_fields)
+{
+	ck_assert_int_eq(sizeof(spinn_packet_t), 16);
+	
+	spinn_packet_t p;
+	spinn_packet_init( &p
+	                 , (spinn_coord_t){SPINN_PACKET_MAX_COORD, 0}
+	                 , (spinn_coord_t){0, SPINN_PACKET_MAX_COORD}
+	                 );
+	
+	for (int d = 0; d < 7; d++) {
+		for (int id = 0; id < 7; id++) {
+			for (int e = 0; e < 3; e++) {
+				spinn_packet_set_direction(&p, (spinn_direction_t)d);
+				spinn_packet_set_inflection_direction(&p, (spinn_direction_t)id);
+				spinn_packet_set_emg_state(&p, (spinn_emg_state_t)e);
+				spinn_packet_set_inflection_point(&p, (spinn_coord_t){d, id});
+				
+				ck_assert_int_eq(spinn_packet_get_direction(&p), d);
+				ck_assert_int_eq(spinn_packet_get_inflection_direction(&p), id);
+				ck_assert_int_eq(spinn_packet_get_emg_state(&p), e);
+				ck_assert_int_eq(spinn_packet_get_inflection_point(&p).x, d);
+				ck_assert_int_eq(spinn_packet_get_inflection_point(&p).y, id);
+				
+				ck_assert_int_eq(spinn_packet_get_type(&p), SPINN_PACKET_P2P);
+				ck_assert_int_eq(spinn_packet_get_source(&p).x, SPINN_PACKET_MAX_COORD);
+				ck_assert_int_eq(spinn_packet_get_source(&p).y, 0);
+				ck_assert_int_eq(spinn_packet_get_destination(&p).x, 0);
+				ck_assert_int_eq(spinn_packet_get_destination(&p).y, SPINN_PACKET_MAX_COORD);
+			}
+		}
+	}
+	
+	// Multicast packets report their source as their destination
+	spinn_packet_init_mc(&p, (spinn_coord_t){3, 4}, 0xDEADBEEFu);
+	ck_assert_int_eq(spinn_packet_get_type(&p), SPINN_PACKET_MC);
+	ck_assert_int_eq(spinn_packet_get_key(&p), 0xDEADBEEFu);
+	ck_assert_int_eq(spinn_packet_get_destination(&p).x, 3);
+	ck_assert_int_eq(spinn_packet_get_destination(&p).y, 4);
+	ck_assert_int_eq(spinn_packet_get_direction(&p), SPINN_LOCAL);
+}
+END_TEST
+
+
 Suite *
 make_spinn_packet_init_dor(void)
 {
@@ -203,6 +334,8 @@ make_spinn_packet_init_dor(void)
 	TCase *tc_core = tcase_create("Core");
 	tcase_add_test(tc_core, test_manual);
 	tcase_add_test(tc_core, test_exhaustive);
+	tcase_add_test(tc_core, test_matches_dor_direction);
+	tcase_add_test(tc_core, test_packed_fields);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
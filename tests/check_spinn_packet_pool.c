@@ -6,6 +6,8 @@
 
 #include <check.h>
 
+#include <pthread.h>
+
 #include "config.h"
 
 #include "check_check.h"
@@ -81,12 +83,13 @@ END_TEST
  */
 START_TEST (test_many_packets)
 {
-	spinn_packet_t *ps[NUM_PACKETS];
+	// Packets are held by handle (exercising the handle conversions)
+	spinn_packet_handle_t ps[NUM_PACKETS];
 	
 	for (int _ = 0; _ < NUM_REPEATS; _++) {
 		// Create some packets
 		for (int i = 0; i < NUM_PACKETS; i++) {
-			ps[i] = spinn_packet_pool_palloc(&pool);
+			ps[i] = spinn_packet_pool_get_handle(&pool, spinn_packet_pool_palloc(&pool));
 			// Make sure the packet isn't equal to any requested before.
 			for (int j = 0; j < i; j++) {
 				ck_assert(ps[i] != ps[j]);
@@ -97,9 +100,319 @@ START_TEST (test_many_packets)
 		// recently just to mix things up a bit.
 		for (int i_ = 0; i_ < NUM_PACKETS; i_++) {
 			int i = (i_%2) ? (i_) : ((NUM_PACKETS - i_) - 2);
-			spinn_packet_pool_pfree(&pool, ps[i]);
+			spinn_packet_pool_pfree(&pool, spinn_packet_pool_get_packet(&pool, ps[i]));
+		}
+	}
+}
+END_TEST
+
+
+/**
+ * Test that the size and growth of the pool are reported.
+ */
+START_TEST (test_stats)
+{
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 0);
+	ck_assert_int_eq(spinn_packet_pool_get_num_bytes(&pool), 0);
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 0);
+	
+	// The pool grows to 1, 3, 7, ... packets
+	int expected_growths = 0;
+	for (int i = 0; i < NUM_PACKETS; i++) {
+		if (i == spinn_packet_pool_get_num_packets(&pool))
+			expected_growths++;
+		spinn_packet_pool_palloc(&pool);
+		ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), expected_growths);
+	}
+	
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 255);
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 8);
+	ck_assert_int_eq( spinn_packet_pool_get_num_bytes(&pool)
+	                , 255 * (sizeof(spinn_packet_t) + sizeof(spinn_packet_handle_t))
+	                );
+}
+END_TEST
+
+
+/**
+ * Test that reserving packets grows the pool in one step and that no further
+ * growth is needed until they are used up. Runs with and without huge pages.
+ */
+START_TEST (test_reserve)
+{
+	spinn_packet_pool_set_use_huge_pages(&pool, _i == 1);
+	
+	spinn_packet_pool_reserve(&pool, NUM_PACKETS);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), NUM_PACKETS);
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 1);
+	
+	// Reserving fewer packets than are present does nothing
+	spinn_packet_pool_reserve(&pool, NUM_PACKETS / 2);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), NUM_PACKETS);
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 1);
+	
+	// The packets must be usable
+	for (int i = 0; i < NUM_PACKETS; i++) {
+		spinn_packet_t *p = spinn_packet_pool_palloc(&pool);
+		p->sent_time = i;
+		p->num_hops  = i;
+	}
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 1);
+	
+	// Further packets cause the pool to grow as usual
+	spinn_packet_pool_palloc(&pool);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), (NUM_PACKETS * 2) + 1);
+	ck_assert_int_eq(spinn_packet_pool_get_num_growths(&pool), 2);
+}
+END_TEST
+
+
+/**
+ * Test that the pool does not grow beyond its maximum size and that refused
+ * allocations are counted.
+ */
+START_TEST (test_max_packets)
+{
+	spinn_packet_pool_set_max_packets(&pool, 10);
+	
+	// The pool would grow to 1, 3, 7 and then 15 packets but stops at 10
+	spinn_packet_handle_t ps[10];
+	for (int i = 0; i < 10; i++) {
+		spinn_packet_t *p = spinn_packet_pool_palloc(&pool);
+		ck_assert(p != NULL);
+		ps[i] = spinn_packet_pool_get_handle(&pool, p);
+	}
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 10);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&pool), 0);
+	
+	ck_assert(spinn_packet_pool_palloc(&pool) == NULL);
+	ck_assert(spinn_packet_pool_palloc(&pool) == NULL);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 10);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&pool), 2);
+	
+	// Freed packets may be allocated again
+	spinn_packet_pool_pfree(&pool, spinn_packet_pool_get_packet(&pool, ps[3]));
+	ck_assert(spinn_packet_pool_palloc(&pool) == spinn_packet_pool_get_packet(&pool, ps[3]));
+	ck_assert(spinn_packet_pool_palloc(&pool) == NULL);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&pool), 3);
+}
+END_TEST
+
+
+/**
+ * Test that local pools take packets from and return packets to their owner in
+ * batches and that their statistics are reported.
+ */
+START_TEST (test_local)
+{
+	spinn_packet_pool_t local;
+	spinn_packet_pool_init_local(&local, &pool, 4);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&local), 0);
+	ck_assert_int_eq(spinn_packet_pool_get_num_free(&local), 0);
+	
+	// The first allocation takes a batch from the owner (which grows to 1, 3
+	// and then 7 packets to provide it)
+	spinn_packet_handle_t ps[NUM_PACKETS];
+	ps[0] = spinn_packet_pool_get_handle(&local, spinn_packet_pool_palloc(&local));
+	ck_assert_int_eq(spinn_packet_pool_get_num_free(&local), 0);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 1);
+	
+	for (int i = 1; i < NUM_PACKETS; i++) {
+		spinn_packet_t *p = spinn_packet_pool_palloc(&local);
+		ck_assert(p != NULL);
+		p->sent_time = i;
+		ps[i] = spinn_packet_pool_get_handle(&local, p);
+		ck_assert_int_eq(spinn_packet_pool_get_num_in_use(&local), i + 1);
+	}
+	ck_assert_int_eq(spinn_packet_pool_get_num_in_use(&pool), 0);
+	ck_assert_int_eq( spinn_packet_pool_get_num_packets(&pool)
+	                , spinn_packet_pool_get_num_free(&pool)
+	                  + spinn_packet_pool_get_num_free(&local)
+	                  + NUM_PACKETS
+	                );
+	
+	// Freeing packets never leaves more than two batches in the local pool
+	for (int i = 0; i < NUM_PACKETS; i++) {
+		spinn_packet_pool_pfree(&local, spinn_packet_pool_get_packet(&local, ps[i]));
+		ck_assert(spinn_packet_pool_get_num_free(&local) <= 8);
+	}
+	ck_assert_int_eq(spinn_packet_pool_get_num_in_use(&local), 0);
+	ck_assert_int_eq( spinn_packet_pool_get_num_free(&pool)
+	                , spinn_packet_pool_get_num_packets(&pool)
+	                  - spinn_packet_pool_get_num_free(&local)
+	                );
+	
+	// Destroying the local pool returns its packets
+	spinn_packet_pool_destroy(&local);
+	ck_assert_int_eq( spinn_packet_pool_get_num_free(&pool)
+	                , spinn_packet_pool_get_num_packets(&pool)
+	                );
+}
+END_TEST
+
+
+/**
+ * Test that packets stay put when a local pool is refilled from an owner which
+ * must grow.
+ */
+START_TEST (test_local_growth)
+{
+	spinn_packet_pool_t local;
+	spinn_packet_pool_init_local(&local, &pool, 4);
+	
+	spinn_packet_t *ps[NUM_PACKETS];
+	for (int i = 0; i < NUM_PACKETS; i++) {
+		ps[i] = spinn_packet_pool_palloc(&local);
+		ck_assert(ps[i] != NULL);
+		ps[i]->sent_time = i;
+	}
+	ck_assert(spinn_packet_pool_get_num_growths(&pool) > 1);
+	
+	// Packets allocated before the owner grew are unchanged and their handles
+	// still refer to them
+	for (int i = 0; i < NUM_PACKETS; i++) {
+		ck_assert_int_eq(ps[i]->sent_time, i);
+		ck_assert(spinn_packet_pool_get_packet( &local
+		                                      , spinn_packet_pool_get_handle(&local, ps[i])
+		                                      ) == ps[i]);
+		spinn_packet_pool_pfree(&local, ps[i]);
+	}
+	
+	spinn_packet_pool_destroy(&local);
+	ck_assert_int_eq( spinn_packet_pool_get_num_free(&pool)
+	                , spinn_packet_pool_get_num_packets(&pool)
+	                );
+}
+END_TEST
+
+
+/**
+ * Test that local pools share their owner's maximum size.
+ */
+START_TEST (test_local_max_packets)
+{
+	spinn_packet_pool_set_max_packets(&pool, 10);
+	
+	spinn_packet_pool_t local_a;
+	spinn_packet_pool_t local_b;
+	spinn_packet_pool_init_local(&local_a, &pool, 8);
+	spinn_packet_pool_init_local(&local_b, &pool, 8);
+	
+	// The owner can provide 10 packets in total, with the local pools taking
+	// whatever is available when less than a full batch remains
+	int num_allocated = 0;
+	while (spinn_packet_pool_palloc(&local_a) != NULL)
+		num_allocated++;
+	while (spinn_packet_pool_palloc(&local_b) != NULL)
+		num_allocated++;
+	ck_assert_int_eq(num_allocated, 10);
+	ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), 10);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&local_a), 1);
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&local_b), 1);
+	
+	spinn_packet_pool_destroy(&local_a);
+	spinn_packet_pool_destroy(&local_b);
+}
+END_TEST
+
+
+/**
+ * Arguments for local_pool_thread.
+ */
+typedef struct {
+	spinn_packet_pool_t   *local;
+	spinn_packet_handle_t *ps;
+	int                    num_packets;
+	bool                   palloc;
+} local_pool_thread_args_t;
+
+
+static void *
+local_pool_thread(void *arg)
+{
+	local_pool_thread_args_t *args = (local_pool_thread_args_t *)arg;
+	for (int i = 0; i < args->num_packets; i++) {
+		if (args->palloc) {
+			spinn_packet_t *p = spinn_packet_pool_palloc(args->local);
+			p->sent_time = i;
+			args->ps[i] = spinn_packet_pool_get_handle(args->local, p);
+		} else {
+			spinn_packet_t *p = spinn_packet_pool_get_packet(args->local, args->ps[i]);
+			if (p->sent_time != (ticks_t)i)
+				return NULL;
+			spinn_packet_pool_pfree(args->local, p);
 		}
 	}
+	return args;
+}
+
+
+/**
+ * Test that packets allocated by one thread may be freed by others, with the
+ * threads running concurrently. The owner is preallocated (_i == 0) or grows
+ * while other threads use its packets (_i == 1).
+ */
+#define NUM_THREADS 4
+#define NUM_THREAD_PACKETS 1000
+#define THREAD_BATCH_SIZE 16
+#define NUM_TOTAL_PACKETS (NUM_THREADS * (NUM_THREAD_PACKETS + (2 * THREAD_BATCH_SIZE)))
+START_TEST (test_local_threads)
+{
+	// Each local pool may cache up to two batches of free packets in addition
+	// to those its thread is using.
+	if (_i == 0)
+		spinn_packet_pool_reserve(&pool, NUM_TOTAL_PACKETS);
+	spinn_packet_pool_set_max_packets(&pool, NUM_TOTAL_PACKETS);
+	
+	spinn_packet_pool_t locals[NUM_THREADS];
+	static spinn_packet_handle_t ps[NUM_THREADS][NUM_THREAD_PACKETS];
+	local_pool_thread_args_t args[NUM_THREADS];
+	pthread_t threads[NUM_THREADS];
+	for (int t = 0; t < NUM_THREADS; t++) {
+		spinn_packet_pool_init_local(&(locals[t]), &pool, THREAD_BATCH_SIZE);
+		args[t].local       = &(locals[t]);
+		args[t].num_packets = NUM_THREAD_PACKETS;
+	}
+	
+	for (int r = 0; r < NUM_REPEATS; r++) {
+		// Each thread allocates some packets...
+		for (int t = 0; t < NUM_THREADS; t++) {
+			args[t].ps     = ps[t];
+			args[t].palloc = true;
+			ck_assert_int_eq(pthread_create(&(threads[t]), NULL, local_pool_thread, &(args[t])), 0);
+		}
+		for (int t = 0; t < NUM_THREADS; t++) {
+			void *result;
+			pthread_join(threads[t], &result);
+			ck_assert(result != NULL);
+		}
+		
+		// ...which are freed by its neighbour
+		for (int t = 0; t < NUM_THREADS; t++) {
+			args[t].ps     = ps[(t + 1) % NUM_THREADS];
+			args[t].palloc = false;
+			ck_assert_int_eq(pthread_create(&(threads[t]), NULL, local_pool_thread, &(args[t])), 0);
+		}
+		for (int t = 0; t < NUM_THREADS; t++) {
+			void *result;
+			pthread_join(threads[t], &result);
+			ck_assert(result != NULL);
+		}
+	}
+	
+	// No packets were lost or duplicated
+	for (int t = 0; t < NUM_THREADS; t++) {
+		ck_assert_int_eq(spinn_packet_pool_get_num_in_use(&(locals[t])), 0);
+		spinn_packet_pool_destroy(&(locals[t]));
+	}
+	ck_assert_int_eq( spinn_packet_pool_get_num_free(&pool)
+	                , spinn_packet_pool_get_num_packets(&pool)
+	                );
+	ck_assert_int_eq(spinn_packet_pool_get_num_exhausted(&pool), 0);
+	if (_i == 0)
+		ck_assert_int_eq(spinn_packet_pool_get_num_packets(&pool), NUM_TOTAL_PACKETS);
+	else
+		ck_assert(spinn_packet_pool_get_num_growths(&pool) > 1);
 }
 END_TEST
 
@@ -116,6 +429,13 @@ make_spinn_packet_pool_suite(void)
 	tcase_add_test(tc_core, test_no_pfree);
 	tcase_add_test(tc_core, test_single_packet);
 	tcase_add_test(tc_core, test_many_packets);
+	tcase_add_test(tc_core, test_stats);
+	tcase_add_loop_test(tc_core, test_reserve, 0, 2);
+	tcase_add_test(tc_core, test_max_packets);
+	tcase_add_test(tc_core, test_local);
+	tcase_add_test(tc_core, test_local_growth);
+	tcase_add_test(tc_core, test_local_max_packets);
+	tcase_add_loop_test(tc_core, test_local_threads, 0, 2);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
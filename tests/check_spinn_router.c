@@ -16,6 +16,7 @@
 #include "../src/spinn.h"
 #include "../src/spinn_topology.h"
 #include "../src/spinn_packet.h"
+#include "../src/spinn_mc_table.h"
 #include "../src/spinn_router.h"
 
 /******************************************************************************
@@ -37,12 +38,24 @@ buffer_t input;
 buffer_t outputs[7];
 buffer_t *outputs_p[7];
 
-// A number of packets sufficient to fill all the buffers
+// A number of packets sufficient to fill all the buffers, allocated from a pool
+// with room for at least as many again (e.g. multicast copies) so that it never
+// grows during a test.
 #define NUM_PACKETS ((7*OUT_BUFFER_SIZE*2) + 1)
-spinn_packet_t packets[NUM_PACKETS];
+spinn_packet_pool_t pool;
+spinn_packet_t *packets[NUM_PACKETS];
+
+// Buffers carry packet handles rather than pointers
+#define HANDLE(p) spinn_packet_pool_get_handle(&pool, (p))
+#define PACKET(h) spinn_packet_pool_get_packet(&pool, (h))
 
 spinn_router_t r;
 
+// When true, the router under test is added to a single-router array rather than
+// being scheduled on its own
+bool batched;
+spinn_router_array_t ra;
+
 
 // A record of a call to on_forward
 typedef struct on_forward_debug_data {
@@ -97,6 +110,24 @@ check_spinn_router_setup(void)
 	
 	last_on_forward.packet = NULL;
 	last_on_drop.packet = NULL;
+	
+	spinn_packet_pool_init(&pool);
+	spinn_packet_pool_reserve(&pool, NUM_PACKETS * 2);
+	for (int i = 0; i < NUM_PACKETS; i++)
+		packets[i] = spinn_packet_pool_palloc(&pool);
+	
+	batched = false;
+}
+
+
+/**
+ * As check_spinn_router_setup but testing a router in a spinn_router_array_t.
+ */
+void
+check_spinn_router_batched_setup(void)
+{
+	check_spinn_router_setup();
+	batched = true;
 }
 
 
@@ -108,6 +139,9 @@ check_spinn_router_teardown(void)
 	for (int i = 0; i < 7; i++)
 		buffer_destroy(&(outputs[i]));
 	spinn_router_destroy(&r);
+	if (batched)
+		spinn_router_array_destroy(&ra);
+	spinn_packet_pool_destroy(&pool);
 }
 
 /**
@@ -130,7 +164,7 @@ on_forward( spinn_router_t    *router
 	ck_assert_int_eq(packet->num_hops, 1);
 	
 	// Make sure the number of emergency hops is correct
-	if (packet->emg_state == SPINN_EMG_FIRST_LEG)
+	if (spinn_packet_get_emg_state(packet) == SPINN_EMG_FIRST_LEG)
 		ck_assert_int_eq(packet->num_emg_hops, 1);
 	else
 		ck_assert_int_eq(packet->num_emg_hops, 0);
@@ -169,16 +203,34 @@ on_drop( spinn_router_t *router
  * Tests
  ******************************************************************************/
 
-// Create a router with most arguments set to sensible defaults.
+// Create a router with most arguments set to sensible defaults (either on its
+// own or in an array, depending on the fixture).
 #define INIT_ROUTER(use_emg_routing, on_forward, on_drop) \
-	spinn_router_init( &r, &s, ROUTER_PERIOD, ROUTER_PIPELINE \
-	                 , &input, outputs_p \
-	                 , ((spinn_coord_t){0,0}) \
-	                 , (use_emg_routing) \
-	                 , FIRST_TIMEOUT, FINAL_TIMEOUT \
-	                 , (on_forward), (void *)&last_on_forward \
-	                 , (on_drop),    (void *)&last_on_drop \
-	                 )
+	INIT_ROUTER_WITH_PIPELINE(ROUTER_PERIOD, ROUTER_PIPELINE, use_emg_routing, on_forward, on_drop)
+
+#define INIT_ROUTER_WITH_PIPELINE(period, pipeline, use_emg_routing, on_forward, on_drop) \
+	do { \
+		if (batched) { \
+			spinn_router_array_init(&ra, &s, (period), (pipeline), 1); \
+			spinn_router_array_add( &ra, &r \
+			                      , &input, outputs_p, &pool \
+			                      , ((spinn_coord_t){0,0}) \
+			                      , (use_emg_routing) \
+			                      , FIRST_TIMEOUT, FINAL_TIMEOUT \
+			                      , (on_forward), (void *)&last_on_forward \
+			                      , (on_drop),    (void *)&last_on_drop \
+			                      ); \
+		} else { \
+			spinn_router_init( &r, &s, (period), (pipeline) \
+			                 , &input, outputs_p, &pool \
+			                 , ((spinn_coord_t){0,0}) \
+			                 , (use_emg_routing) \
+			                 , FIRST_TIMEOUT, FINAL_TIMEOUT \
+			                 , (on_forward), (void *)&last_on_forward \
+			                 , (on_drop),    (void *)&last_on_drop \
+			                 ); \
+		} \
+	} while (0)
 
 
 /**
@@ -212,18 +264,14 @@ START_TEST (test_single_normal_packet)
 	const spinn_direction_t direction = (spinn_direction_t)_i;
 	
 	// Create a packet going in the given direction
-	spinn_packet_t p;
-	p.inflection_point     = (spinn_coord_t){-1,-1};
-	p.inflection_direction = SPINN_NORTH;
-	p.source               = (spinn_coord_t){-1,-1};
-	p.destination          = (spinn_coord_t){-1,-1};
-	p.direction            = direction;
-	p.emg_state            = SPINN_EMG_NORMAL;
-	p.num_hops             = 0;
-	p.num_emg_hops         = 0;
-	p.payload              = NULL;
-	
-	buffer_push(&input, (void *)&p);
+	spinn_packet_t *p = packets[0];
+	spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+	spinn_packet_set_direction(p, direction);
+	spinn_packet_set_emg_state(p, SPINN_EMG_NORMAL);
+	
+	buffer_push(&input, HANDLE(p));
 	
 	// Make sure nothing is routed before the packet is due at the end of the
 	// pipeline.
@@ -249,21 +297,20 @@ START_TEST (test_single_normal_packet)
 	
 	// Remove the packet from the output, it should be the one we put into the
 	// input and should be unchanged.
-	ck_assert(buffer_pop(&(outputs[direction])) == (void *)&p);
-	ck_assert(p.inflection_point.x == -1);
-	ck_assert(p.inflection_point.y == -1);
-	ck_assert(p.inflection_direction == SPINN_NORTH);
-	ck_assert(p.destination.x == -1);
-	ck_assert(p.destination.y == -1);
-	ck_assert(p.direction == direction);
-	ck_assert(p.emg_state == SPINN_EMG_NORMAL);
-	ck_assert(p.payload == NULL);
+	ck_assert(PACKET(buffer_pop(&(outputs[direction]))) == p);
+	ck_assert(spinn_packet_get_inflection_point(p).x == 1);
+	ck_assert(spinn_packet_get_inflection_point(p).y == 1);
+	ck_assert(spinn_packet_get_inflection_direction(p) == SPINN_NORTH);
+	ck_assert(spinn_packet_get_destination(p).x == 1);
+	ck_assert(spinn_packet_get_destination(p).y == 1);
+	ck_assert(spinn_packet_get_direction(p) == direction);
+	ck_assert(spinn_packet_get_emg_state(p) == SPINN_EMG_NORMAL);
 	
 	// Make sure the callback happend as you'd hope.
 	ck_assert_int_eq(last_on_drop.num_calls,    0);
 	ck_assert_int_eq(last_on_forward.num_calls, 1);
 	ck_assert_int_eq(last_on_forward.time, ROUTER_PERIOD*ROUTER_PIPELINE);
-	ck_assert_int_eq(last_on_forward.packet, &p);
+	ck_assert(last_on_forward.packet == p);
 	
 	// Make sure nothing else happens
 	for (int i = 0; i < ROUTER_PERIOD*(FIRST_TIMEOUT + FINAL_TIMEOUT)*2; i++)
@@ -290,23 +337,16 @@ START_TEST (test_multiple_normal_packet)
 	INIT_ROUTER(true, on_forward, on_drop);
 	
 	// Set up a series of packets going in all directions
-	spinn_packet_t *p = packets;
 	for (int i = 0; i < OUT_BUFFER_SIZE; i++) {
 		for (int direction = 0; direction < 6; direction++) {
-			p->inflection_point     = (spinn_coord_t){-1,-1};
-			p->inflection_direction = SPINN_NORTH;
-			p->source               = (spinn_coord_t){-1,-1};
-			p->destination          = (spinn_coord_t){-1,-1};
-			p->direction            = (spinn_direction_t)direction;
-			p->emg_state            = SPINN_EMG_NORMAL;
-			p->num_hops             = 0;
-			p->num_emg_hops         = 0;
-			p->payload              = NULL;
+			spinn_packet_t *p = packets[(i*6) + direction];
+			spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){1,1});
+			spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+			spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+			spinn_packet_set_direction(p, (spinn_direction_t)direction);
+			spinn_packet_set_emg_state(p, SPINN_EMG_NORMAL);
 			
-			buffer_push(&input, (void *)p);
-			
-			// Advance to the next packet
-			p++;
+			buffer_push(&input, HANDLE(p));
 		}
 	}
 	
@@ -316,9 +356,10 @@ START_TEST (test_multiple_normal_packet)
 	
 	// Ensure that the packets appear at the outputs in the correct order and at
 	// the correct rate
-	p = packets;
 	for (int i = 0; i < OUT_BUFFER_SIZE; i++) {
 		for (int direction = 0; direction < 6; direction++) {
+			spinn_packet_t *p = packets[(i*6) + direction];
+			
 			// Run the simulation for a router cycle 
 			for (int j = 0; j < ROUTER_PERIOD; j++)
 				scheduler_tick_tock(&s);
@@ -328,20 +369,15 @@ START_TEST (test_multiple_normal_packet)
 			
 			// Did the packet get sent?
 			ck_assert_msg(last_on_forward.packet == p,
-				"Expected Packet %d to arrive but packet %d arrived instead.",
-				(packets - p) / sizeof(spinn_packet_t),
-				(packets - last_on_forward.packet) / sizeof(spinn_packet_t)
+				"Expected Packet %d to arrive.", (i*6) + direction
 				);
 			
 			// Have the correct number of packets been sent?
 			ck_assert_int_eq(last_on_forward.num_calls, 1 + (i*6) + direction);
 			
 			// Did the packet remain in the correct state/direction?
-			ck_assert_int_eq((int)p->direction, (int)direction);
-			ck_assert_int_eq((int)p->emg_state, (int)SPINN_EMG_NORMAL);
-			
-			// Advance to the next packet
-			p++;
+			ck_assert_int_eq((int)spinn_packet_get_direction(p), (int)direction);
+			ck_assert_int_eq((int)spinn_packet_get_emg_state(p), (int)SPINN_EMG_NORMAL);
 		}
 	}
 }
@@ -361,23 +397,16 @@ START_TEST (test_normal_packet_arrival)
 	
 	// Set up a series of packets going in all directions and of all emergency
 	// types which don't change the packet's destination.
-	spinn_packet_t *p = packets;
 	for (int i = 0; i < emg_types_len; i++) {
 		for (int direction = 0; direction < 7; direction++) {
-			p->inflection_point     = (spinn_coord_t){-1,-1};
-			p->inflection_direction = SPINN_NORTH;
-			p->source               = (spinn_coord_t){-1,-1};
-			p->destination          = (spinn_coord_t){0,0};
-			p->direction            = (spinn_direction_t)direction;
-			p->emg_state            = emg_types[i];
-			p->num_hops             = 0;
-			p->num_emg_hops         = 0;
-			p->payload              = NULL;
+			spinn_packet_t *p = packets[(i*7) + direction];
+			spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){0,0});
+			spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+			spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+			spinn_packet_set_direction(p, (spinn_direction_t)direction);
+			spinn_packet_set_emg_state(p, emg_types[i]);
 			
-			buffer_push(&input, (void *)p);
-			
-			// Advance to the next packet
-			p++;
+			buffer_push(&input, HANDLE(p));
 		}
 	}
 	
@@ -387,9 +416,10 @@ START_TEST (test_normal_packet_arrival)
 	
 	// Ensure that the packets appear at the outputs in the correct order and at
 	// the correct rate.
-	p = packets;
 	for (int i = 0; i < emg_types_len; i++) {
 		for (int direction = 0; direction < 7; direction++) {
+			spinn_packet_t *p = packets[(i*7) + direction];
+			
 			// Run the simulation for a router cycle 
 			for (int j = 0; j < ROUTER_PERIOD; j++)
 				scheduler_tick_tock(&s);
@@ -399,24 +429,19 @@ START_TEST (test_normal_packet_arrival)
 			
 			// Did the packet get sent?
 			ck_assert_msg(last_on_forward.packet == p,
-				"Expected Packet %d to arrive but packet %d arrived instead.",
-				(packets - p) / sizeof(spinn_packet_t),
-				(packets - last_on_forward.packet) / sizeof(spinn_packet_t)
+				"Expected Packet %d to arrive.", (i*7) + direction
 				);
 			
 			// Should have arrived in the local buffer too
 			ck_assert(!buffer_is_empty(&(outputs[SPINN_LOCAL])));
-			ck_assert(p == buffer_pop(&(outputs[SPINN_LOCAL])));
+			ck_assert(p == PACKET(buffer_pop(&(outputs[SPINN_LOCAL]))));
 			
 			// Have the correct number of packets been sent?
 			ck_assert_int_eq(last_on_forward.num_calls, 1 + (i*7) + direction);
 			
 			// Did the packet end up at the local node in a non-emergency state?
-			ck_assert_int_eq((int)p->direction, (int)SPINN_LOCAL);
-			ck_assert_int_eq((int)p->emg_state, (int)SPINN_EMG_NORMAL);
-			
-			// Advance to the next packet
-			p++;
+			ck_assert_int_eq((int)spinn_packet_get_direction(p), (int)SPINN_LOCAL);
+			ck_assert_int_eq((int)spinn_packet_get_emg_state(p), (int)SPINN_EMG_NORMAL);
 		}
 	}
 }
@@ -439,30 +464,23 @@ START_TEST (test_normal_packet_drop)
 	
 	// Set up a series of packets going in all directions and of all emergency
 	// types which don't change the packet's destination.
-	spinn_packet_t *p = packets;
 	for (int i = 0; i < emg_types_len; i++) {
 		for (int direction = 0; direction < 7; direction++) {
-			p->inflection_point     = (spinn_coord_t){-1,-1};
-			p->inflection_direction = SPINN_NORTH;
-			p->source               = (spinn_coord_t){-1,-1};
-			p->destination          = (spinn_coord_t){0,0};
-			p->direction            = (spinn_direction_t)direction;
-			p->emg_state            = emg_types[i];
-			p->num_hops             = 0;
-			p->num_emg_hops         = 0;
-			p->payload              = NULL;
+			spinn_packet_t *p = packets[(i*7) + direction];
+			spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){0,0});
+			spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+			spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+			spinn_packet_set_direction(p, (spinn_direction_t)direction);
+			spinn_packet_set_emg_state(p, emg_types[i]);
 			
-			buffer_push(&input, (void *)p);
-			
-			// Advance to the next packet
-			p++;
+			buffer_push(&input, HANDLE(p));
 		}
 	}
 	
 	// Fill up all the output buffers to ensure that all packets will be dropped
 	for (int i = 0; i < 7; i++) {
 		for (int j = 0; j < OUT_BUFFER_SIZE; j++) {
-			buffer_push(&(outputs[i]), NULL);
+			buffer_push(&(outputs[i]), INT_TO_BUFFER_VALUE(0));
 		}
 	}
 	
@@ -475,9 +493,10 @@ START_TEST (test_normal_packet_drop)
 		scheduler_tick_tock(&s);
 	
 	// See that the packets are duly dropped
-	p = packets;
 	for (int i = 0; i < emg_types_len; i++) {
 		for (int direction = 0; direction < 7; direction++) {
+			spinn_packet_t *p = packets[(i*7) + direction];
+			
 			// Run the simulation for as long as it should take to time out
 			for (int j = 0; j < (ROUTER_PERIOD * (drop_cycles + 1)); j++)
 				scheduler_tick_tock(&s);
@@ -488,9 +507,6 @@ START_TEST (test_normal_packet_drop)
 			
 			// And that it got dropped on exactly this router cycle
 			ck_assert_int_eq(last_on_drop.time, scheduler_get_ticks(&s) - ROUTER_PERIOD);
-			
-			// Advance to the next packet
-			p++;
 		}
 	}
 }
@@ -512,18 +528,14 @@ START_TEST (test_emg_first_leg)
 	spinn_direction_t direction = (spinn_direction_t)_i/2;
 	
 	// Place the packet in the input buffer
-	spinn_packet_t *p = packets;
-	p->inflection_point     = (spinn_coord_t){-1,-1};
-	p->inflection_direction = SPINN_NORTH;
-	p->source               = (spinn_coord_t){-1,-1};
-	p->destination          = (spinn_coord_t){-1,-1};
-	p->direction            = direction;
-	p->emg_state            = emg_type;
-	p->num_hops             = 0;
-	p->num_emg_hops         = 0;
-	p->payload              = NULL;
-	
-	buffer_push(&input, (void *)p);
+	spinn_packet_t *p = packets[0];
+	spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+	spinn_packet_set_direction(p, direction);
+	spinn_packet_set_emg_state(p, emg_type);
+	
+	buffer_push(&input, HANDLE(p));
 	
 	// The direction the packet would normally go
 	spinn_direction_t normal_direction = (emg_type==SPINN_EMG_NORMAL) ? direction
@@ -531,7 +543,7 @@ START_TEST (test_emg_first_leg)
 	
 	// Fill up the expected output buffer
 	for (int j = 0; j < OUT_BUFFER_SIZE; j++) {
-		buffer_push(&(outputs[normal_direction]), NULL);
+		buffer_push(&(outputs[normal_direction]), INT_TO_BUFFER_VALUE(0));
 	}
 	
 	// Allow the pipeline to fill up
@@ -548,12 +560,26 @@ START_TEST (test_emg_first_leg)
 	
 	// Check the packet got emergency routed
 	ck_assert(last_on_forward.packet == p);
-	ck_assert_int_eq(p->emg_state, SPINN_EMG_FIRST_LEG);
-	ck_assert_int_eq(p->direction, spinn_next_cw(normal_direction));
+	ck_assert_int_eq(spinn_packet_get_emg_state(p), SPINN_EMG_FIRST_LEG);
+	ck_assert_int_eq(spinn_packet_get_direction(p), spinn_next_cw(normal_direction));
 	
 	// And that it got forwarded on exactly this router cycle (when it was
 	// expected)
 	ck_assert_int_eq(last_on_forward.time, scheduler_get_ticks(&s) - ROUTER_PERIOD);
+	
+	// The packet stalled on the full output until it timed out
+	spinn_router_stall_counters_t counters = spinn_router_get_stall_counters(&r);
+	ck_assert_int_eq(counters.stalled, FIRST_TIMEOUT);
+	ck_assert_int_eq(counters.emg_routed, 1);
+	for (int i = 0; i < 7; i++)
+		ck_assert_int_eq(counters.output_full[i], (i == normal_direction) ? FIRST_TIMEOUT : 0);
+	
+	spinn_router_reset_stall_counters(&r);
+	counters = spinn_router_get_stall_counters(&r);
+	ck_assert_int_eq(counters.stalled, 0);
+	ck_assert_int_eq(counters.emg_routed, 0);
+	for (int i = 0; i < 7; i++)
+		ck_assert_int_eq(counters.output_full[i], 0);
 }
 END_TEST
 
@@ -569,18 +595,14 @@ START_TEST (test_emg_second_leg)
 	spinn_direction_t direction = (spinn_direction_t)_i;
 	
 	// Place the packet in the input buffer
-	spinn_packet_t *p = packets;
-	p->inflection_point     = (spinn_coord_t){-1,-1};
-	p->inflection_direction = SPINN_NORTH;
-	p->source               = (spinn_coord_t){-1,-1};
-	p->destination          = (spinn_coord_t){-1,-1};
-	p->direction            = direction;
-	p->emg_state            = SPINN_EMG_FIRST_LEG;
-	p->num_hops             = 0;
-	p->num_emg_hops         = 0;
-	p->payload              = NULL;
-	
-	buffer_push(&input, (void *)p);
+	spinn_packet_t *p = packets[0];
+	spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+	spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+	spinn_packet_set_direction(p, direction);
+	spinn_packet_set_emg_state(p, SPINN_EMG_FIRST_LEG);
+	
+	buffer_push(&input, HANDLE(p));
 	
 	// Allow the pipeline to fill up
 	for (int j = 0; j < ROUTER_PERIOD*ROUTER_PIPELINE; j++)
@@ -596,8 +618,8 @@ START_TEST (test_emg_second_leg)
 	
 	// Check the packet got emergency routed
 	ck_assert(last_on_forward.packet == p);
-	ck_assert_int_eq(p->emg_state, SPINN_EMG_SECOND_LEG);
-	ck_assert_int_eq(p->direction, spinn_next_cw(spinn_opposite(direction)));
+	ck_assert_int_eq(spinn_packet_get_emg_state(p), SPINN_EMG_SECOND_LEG);
+	ck_assert_int_eq(spinn_packet_get_direction(p), spinn_next_cw(spinn_opposite(direction)));
 }
 END_TEST
 
@@ -618,31 +640,24 @@ START_TEST (test_bubbles)
 	
 	// Initialise up a series of packets destined for the router's local buffer
 	// (which will later be put into the input buffer)
-	spinn_packet_t *p = packets;
 	for (int i = 0; i < _i; i++) {
-		p->inflection_point     = (spinn_coord_t){-1,-1};
-		p->inflection_direction = SPINN_NORTH;
-		p->source               = (spinn_coord_t){-1,-1};
-		p->destination          = (spinn_coord_t){0,0};
-		p->direction            = SPINN_NORTH;
-		p->emg_state            = SPINN_EMG_NORMAL;
-		p->num_hops             = 0;
-		p->num_emg_hops         = 0;
-		p->payload              = NULL;
-		// Advance to the next packet
-		p++;
+		spinn_packet_t *p = packets[i];
+		spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){0,0});
+		spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+		spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+		spinn_packet_set_direction(p, SPINN_NORTH);
+		spinn_packet_set_emg_state(p, SPINN_EMG_NORMAL);
 	}
 	
 	// Fill up all the output buffers to ensure that all packets will be dropped
 	for (int j = 0; j < OUT_BUFFER_SIZE; j++) {
-		buffer_push(&(outputs[SPINN_LOCAL]), NULL);
+		buffer_push(&(outputs[SPINN_LOCAL]), INT_TO_BUFFER_VALUE(0));
 	}
 	
 	// Add things to the input port every other cycle, all the while nothing
 	// should get sent.
-	p = packets;
 	for (int i = 0; i < _i; i++) {
-		buffer_push(&input, p++);
+		buffer_push(&input, HANDLE(packets[i]));
 		
 		for (int j = 0; j < ROUTER_PERIOD*2; j++) {
 			scheduler_tick_tock(&s);
@@ -667,7 +682,6 @@ START_TEST (test_bubbles)
 	}
 	
 	// See that the packets are received at the correct rate
-	p = packets;
 	for (int i = 0; i < _i; i++) {
 		for (int j = 0; j < ROUTER_PERIOD; j++)
 			scheduler_tick_tock(&s);
@@ -678,13 +692,10 @@ START_TEST (test_bubbles)
 		
 		// Check the packet was the correct one
 		ck_assert(last_on_forward.packet != NULL);
-		ck_assert(last_on_forward.packet == p);
+		ck_assert(last_on_forward.packet == packets[i]);
 		
 		// And that it got dropped on exactly this router cycle
 		ck_assert_int_eq(last_on_forward.time, scheduler_get_ticks(&s) - ROUTER_PERIOD);
-		
-		// Advance to the next packet
-		p++;
 	}
 	
 	// See that nothing more comes through
@@ -696,6 +707,485 @@ START_TEST (test_bubbles)
 END_TEST
 
 
+/**
+ * Test the timing of packets through pipelines of every length, with bubbles in
+ * every possible pattern of stages. Packets are offered and the output drained
+ * at random and every arrival is checked against a reference model which moves
+ * packets along an array of stages one at a time.
+ */
+#define PIPELINE_TEST_TICKS 20000
+#define PIPELINE_MAX_STAGES 10
+START_TEST (test_pipeline_timing)
+{
+	int num_stages = _i;
+	
+	INIT_ROUTER_WITH_PIPELINE(1, num_stages, false, on_forward, on_drop);
+	
+	// The packet number in each stage of the reference pipeline (or -1 if empty)
+	// and the number of packets in its input and output buffers
+	int stages[PIPELINE_MAX_STAGES];
+	for (int i = 0; i < num_stages; i++)
+		stages[i] = -1;
+	int ref_input  = 0;
+	int ref_output = 0;
+	
+	// The occupancy patterns of the reference pipeline which have been seen
+	static bool seen[1 << PIPELINE_MAX_STAGES];
+	for (int i = 0; i < (1 << num_stages); i++)
+		seen[i] = false;
+	
+	int num_offered  = 0;
+	int num_accepted = 0;
+	int num_arrived  = 0;
+	int num_full_ticks = 0;
+	srand(num_stages);
+	for (int tick = 0; tick < PIPELINE_TEST_TICKS; tick++) {
+		// Offer packets at a varying rate so that the pipeline is sometimes sparse
+		// and sometimes full
+		int load = 1 + ((tick / 1000) % 4);
+		if (!buffer_is_full(&input) && (rand() % 5) < load) {
+			spinn_packet_t *p = spinn_packet_pool_palloc(&pool);
+			spinn_packet_init(p, (spinn_coord_t){1,1}, (spinn_coord_t){0,0});
+			spinn_packet_set_inflection_point(p, (spinn_coord_t){1,1});
+			spinn_packet_set_inflection_direction(p, SPINN_NORTH);
+			spinn_packet_set_direction(p, SPINN_NORTH);
+			p->sent_time = num_offered++;
+			buffer_push(&input, HANDLE(p));
+			ref_input++;
+		}
+		
+		// Drain the output at random (but before a blocked packet times out)
+		num_full_ticks = buffer_is_full(&(outputs[SPINN_LOCAL])) ? num_full_ticks + 1 : 0;
+		if (!buffer_is_empty(&(outputs[SPINN_LOCAL]))
+		    && ((rand() % 2) == 0 || num_full_ticks >= FIRST_TIMEOUT / 2)) {
+			spinn_packet_pool_pfree(&pool, PACKET(buffer_pop(&(outputs[SPINN_LOCAL]))));
+			ref_output--;
+		}
+		
+		// Reference tick: decide whether to forward and accept packets
+		bool forward = stages[num_stages-1] >= 0 && ref_output < OUT_BUFFER_SIZE;
+		bool accept  = ref_input > 0;
+		
+		// Reference tock: forward, advance the pipeline and accept
+		int arrived = -1;
+		if (forward) {
+			arrived = stages[num_stages-1];
+			stages[num_stages-1] = -1;
+			ref_output++;
+		}
+		for (int i = num_stages-1; i >= 1; i--) {
+			if (stages[i] < 0) {
+				stages[i]   = stages[i-1];
+				stages[i-1] = -1;
+			}
+		}
+		if (accept && stages[0] < 0) {
+			stages[0] = num_accepted++;
+			ref_input--;
+		}
+		
+		unsigned int occupancy = 0u;
+		for (int i = 0; i < num_stages; i++)
+			if (stages[i] >= 0)
+				occupancy |= 1u << i;
+		seen[occupancy] = true;
+		
+		// The router should forward the same packet in the same tick
+		scheduler_tick_tock(&s);
+		if (arrived >= 0) {
+			num_arrived++;
+			ck_assert_int_eq(last_on_forward.packet->sent_time, arrived);
+		}
+		ck_assert_int_eq(last_on_forward.num_calls, num_arrived);
+		ck_assert_int_eq(buffer_get_count(&input), ref_input);
+		ck_assert_int_eq(buffer_get_count(&(outputs[SPINN_LOCAL])), ref_output);
+	}
+	ck_assert_int_eq(last_on_drop.num_calls, 0);
+	
+	// Every pattern of bubbles should have been exercised
+	for (int i = 0; i < (1 << num_stages); i++)
+		ck_assert_msg(seen[i], "occupancy 0x%x of %d stages not seen", i, num_stages);
+}
+END_TEST
+
+
+/**
+ * Test that multicast packets are replicated to every output in their route,
+ * default routed when they match no entry and dropped when locally injected
+ * packets match no entry.
+ */
+START_TEST (test_mc_packet)
+{
+	INIT_ROUTER(true, on_forward, on_drop);
+	
+	spinn_mc_table_t table;
+	spinn_mc_table_init(&table);
+	spinn_mc_table_add( &table, 0x00000100u, 0xFFFFFF00u
+	                  , (1u << SPINN_EAST) | (1u << SPINN_NORTH) | (1u << SPINN_LOCAL)
+	                  );
+	
+	spinn_router_set_mc_table(&r, &table);
+	
+	// A packet matching the table, a packet travelling north east which matches
+	// nothing and a locally injected packet which matches nothing.
+	spinn_packet_init_mc(packets[0], (spinn_coord_t){0,0}, 0x00000155u);
+	spinn_packet_init_mc(packets[1], (spinn_coord_t){0,0}, 0x00000999u);
+	spinn_packet_set_direction(packets[1], SPINN_NORTH_EAST);
+	spinn_packet_init_mc(packets[2], (spinn_coord_t){0,0}, 0x00000999u);
+	for (int i = 0; i < 3; i++)
+		buffer_push(&input, HANDLE(packets[i]));
+	
+	for (int i = 0; i < ROUTER_PERIOD*(ROUTER_PIPELINE+3); i++)
+		scheduler_tick_tock(&s);
+	
+	// The first packet should have been sent to three outputs, one of which is
+	// the original and the others copies.
+	int num_originals = 0;
+	spinn_direction_t route[] = {SPINN_EAST, SPINN_NORTH, SPINN_LOCAL};
+	for (int i = 0; i < 3; i++) {
+		ck_assert(!buffer_is_empty(&(outputs[route[i]])));
+		spinn_packet_t *p = PACKET(buffer_pop(&(outputs[route[i]])));
+		ck_assert(spinn_packet_get_type(p) == SPINN_PACKET_MC);
+		ck_assert_int_eq(spinn_packet_get_key(p), 0x00000155u);
+		ck_assert_int_eq(spinn_packet_get_direction(p), route[i]);
+		ck_assert_int_eq(p->num_hops, 1);
+		if (p == packets[0])
+			num_originals++;
+		else
+			spinn_packet_pool_pfree(&pool, p);
+	}
+	ck_assert_int_eq(num_originals, 1);
+	
+	// The second should continue north east
+	ck_assert(PACKET(buffer_pop(&(outputs[SPINN_NORTH_EAST]))) == packets[1]);
+	ck_assert_int_eq(spinn_packet_get_direction(packets[1]), SPINN_NORTH_EAST);
+	
+	// The third should be dropped
+	ck_assert_int_eq(last_on_drop.num_calls, 1);
+	ck_assert(last_on_drop.packet == packets[2]);
+	
+	for (int i = 0; i < 7; i++)
+		ck_assert(buffer_is_empty(&(outputs[i])));
+	ck_assert_int_eq(last_on_forward.num_calls, 4);
+	
+	spinn_router_mc_counters_t counters = spinn_router_get_mc_counters(&r);
+	ck_assert_int_eq(counters.table_hits, 1);
+	ck_assert_int_eq(counters.default_routed, 1);
+	ck_assert_int_eq(counters.copies, 2);
+	ck_assert_int_eq(counters.copies_lost, 0);
+	
+	spinn_router_reset_mc_counters(&r);
+	counters = spinn_router_get_mc_counters(&r);
+	ck_assert_int_eq(counters.table_hits, 0);
+	ck_assert_int_eq(counters.default_routed, 0);
+	ck_assert_int_eq(counters.copies, 0);
+	
+	spinn_mc_table_destroy(&table);
+}
+END_TEST
+
+
+/**
+ * Test that copies of multicast packets which cannot be allocated because the
+ * pool is exhausted are counted.
+ */
+START_TEST (test_mc_packet_pool_exhausted)
+{
+	INIT_ROUTER(true, on_forward, on_drop);
+	
+	spinn_mc_table_t table;
+	spinn_mc_table_init(&table);
+	spinn_mc_table_add( &table, 0x00000100u, 0xFFFFFF00u
+	                  , (1u << SPINN_EAST) | (1u << SPINN_NORTH) | (1u << SPINN_LOCAL)
+	                  );
+	spinn_router_set_mc_table(&r, &table);
+	
+	// Use up every packet the pool may hold
+	spinn_packet_pool_set_max_packets(&pool, spinn_packet_pool_get_num_packets(&pool));
+	while (spinn_packet_pool_palloc(&pool) != NULL)
+		;
+	
+	spinn_packet_init_mc(packets[0], (spinn_coord_t){0,0}, 0x00000155u);
+	buffer_push(&input, HANDLE(packets[0]));
+	
+	for (int i = 0; i < ROUTER_PERIOD*(ROUTER_PIPELINE+1); i++)
+		scheduler_tick_tock(&s);
+	
+	// Only the last output in the route receives the packet (the original)
+	ck_assert(buffer_is_empty(&(outputs[SPINN_EAST])));
+	ck_assert(buffer_is_empty(&(outputs[SPINN_NORTH])));
+	ck_assert(PACKET(buffer_pop(&(outputs[SPINN_LOCAL]))) == packets[0]);
+	ck_assert_int_eq(last_on_forward.num_calls, 1);
+	ck_assert_int_eq(last_on_drop.num_calls, 0);
+	
+	spinn_router_mc_counters_t counters = spinn_router_get_mc_counters(&r);
+	ck_assert_int_eq(counters.table_hits, 1);
+	ck_assert_int_eq(counters.copies, 0);
+	ck_assert_int_eq(counters.copies_lost, 2);
+	
+	spinn_router_reset_mc_counters(&r);
+	counters = spinn_router_get_mc_counters(&r);
+	ck_assert_int_eq(counters.copies_lost, 0);
+	
+	spinn_mc_table_destroy(&table);
+}
+END_TEST
+
+
+/**
+ * Test that a multicast packet waits for all outputs in its route to become
+ * free, being dropped after the first timeout if they do not.
+ */
+START_TEST (test_mc_packet_blocked)
+{
+	bool unblock = _i == 1;
+	
+	INIT_ROUTER(true, on_forward, on_drop);
+	
+	spinn_mc_table_t table;
+	spinn_mc_table_init(&table);
+	spinn_mc_table_add(&table, 0x1u, 0xFFFFFFFFu, (1u << SPINN_WEST) | (1u << SPINN_SOUTH));
+	
+	spinn_router_set_mc_table(&r, &table);
+	
+	// Block one of the outputs
+	for (int i = 0; i < OUT_BUFFER_SIZE; i++)
+		buffer_push(&(outputs[SPINN_SOUTH]), INT_TO_BUFFER_VALUE(0));
+	
+	spinn_packet_init_mc(packets[0], (spinn_coord_t){0,0}, 0x1u);
+	buffer_push(&input, HANDLE(packets[0]));
+	
+	// Wait until just before the packet would time out
+	for (int i = 0; i < ROUTER_PERIOD*(ROUTER_PIPELINE+FIRST_TIMEOUT); i++)
+		scheduler_tick_tock(&s);
+	ck_assert(buffer_is_empty(&(outputs[SPINN_WEST])));
+	ck_assert_int_eq(last_on_forward.num_calls, 0);
+	ck_assert_int_eq(last_on_drop.num_calls, 0);
+	
+	if (unblock)
+		buffer_pop(&(outputs[SPINN_SOUTH]));
+	
+	for (int i = 0; i < ROUTER_PERIOD; i++)
+		scheduler_tick_tock(&s);
+	
+	if (unblock) {
+		// Both outputs should be sent the packet
+		ck_assert_int_eq(last_on_forward.num_calls, 2);
+		ck_assert_int_eq(last_on_drop.num_calls, 0);
+		ck_assert(!buffer_is_empty(&(outputs[SPINN_WEST])));
+		ck_assert(buffer_is_full(&(outputs[SPINN_SOUTH])));
+		spinn_packet_t *p = PACKET(buffer_pop(&(outputs[SPINN_WEST])));
+		if (p != packets[0])
+			spinn_packet_pool_pfree(&pool, p);
+	} else {
+		// The packet should be dropped without being sent anywhere
+		ck_assert_int_eq(last_on_forward.num_calls, 0);
+		ck_assert_int_eq(last_on_drop.num_calls, 1);
+		ck_assert(last_on_drop.packet == packets[0]);
+		ck_assert(buffer_is_empty(&(outputs[SPINN_WEST])));
+	}
+	
+	spinn_mc_table_destroy(&table);
+}
+END_TEST
+
+
+/******************************************************************************
+ * Router array equivalence test
+ ******************************************************************************/
+
+#define NUM_ARRAY_ROUTERS 5
+#define NUM_ARRAY_PACKETS 200
+#define ARRAY_TEST_TICKS 3000
+
+// A record of a single on_forward/on_drop call
+typedef struct callback_record {
+	bool            forwarded;
+	int             router;
+	ticks_t         time;
+	spinn_packet_t *packet;
+} callback_record_t;
+
+// The routers, buffers, packets and callback records for one of the two
+// simulations compared by test_array_matches_routers. Packets are numbered by
+// their sent_time.
+typedef struct array_testbench {
+	scheduler_t          s;
+	spinn_router_t       routers[NUM_ARRAY_ROUTERS];
+	buffer_t             inputs[NUM_ARRAY_ROUTERS];
+	buffer_t             outputs[NUM_ARRAY_ROUTERS][7];
+	spinn_packet_pool_t  pool;
+	spinn_packet_t      *packets[NUM_ARRAY_PACKETS];
+	
+	int               num_records;
+	callback_record_t records[NUM_ARRAY_PACKETS];
+} array_testbench_t;
+
+
+/**
+ * Record a callback in the testbench.
+ */
+void
+array_record( array_testbench_t *tb
+            , bool forwarded
+            , spinn_router_t *router
+            , spinn_packet_t *packet
+            )
+{
+	ck_assert(tb->num_records < NUM_ARRAY_PACKETS);
+	tb->records[tb->num_records].forwarded = forwarded;
+	tb->records[tb->num_records].router    = router - tb->routers;
+	tb->records[tb->num_records].time      = scheduler_get_ticks(&(tb->s));
+	tb->records[tb->num_records].packet    = packet;
+	tb->num_records++;
+}
+
+void
+array_on_forward(spinn_router_t *router, spinn_packet_t *packet, void *tb)
+{
+	array_record((array_testbench_t *)tb, true, router, packet);
+}
+
+void
+array_on_drop(spinn_router_t *router, spinn_packet_t *packet, void *tb)
+{
+	array_record((array_testbench_t *)tb, false, router, packet);
+}
+
+
+/**
+ * Ensure that an array of routers produces exactly the same sequence of
+ * forwards and drops as the same routers scheduled individually when presented
+ * with a random stream of packets and randomly blocked outputs. Runs with and
+ * without emergency routing.
+ */
+START_TEST (test_array_matches_routers)
+{
+	bool use_emg_routing = _i == 0;
+	
+	// Testbench 0 uses individual routers, testbench 1 an array
+	static array_testbench_t tbs[2];
+	scheduler_init(&(tbs[0].s));
+	scheduler_init(&(tbs[1].s));
+	
+	spinn_router_array_t a;
+	spinn_router_array_init(&a, &(tbs[1].s), ROUTER_PERIOD, ROUTER_PIPELINE, NUM_ARRAY_ROUTERS);
+	
+	for (int t = 0; t < 2; t++) {
+		array_testbench_t *tb = &(tbs[t]);
+		tb->num_records = 0;
+		
+		spinn_packet_pool_init(&(tb->pool));
+		spinn_packet_handle_t handles[NUM_ARRAY_PACKETS];
+		for (int i = 0; i < NUM_ARRAY_PACKETS; i++)
+			handles[i] = spinn_packet_pool_get_handle( &(tb->pool)
+			                                         , spinn_packet_pool_palloc(&(tb->pool))
+			                                         );
+		for (int i = 0; i < NUM_ARRAY_PACKETS; i++)
+			tb->packets[i] = spinn_packet_pool_get_packet(&(tb->pool), handles[i]);
+		
+		for (int i = 0; i < NUM_ARRAY_ROUTERS; i++) {
+			buffer_init(&(tb->inputs[i]), 2);
+			buffer_t *outputs_p[7];
+			for (int j = 0; j < 7; j++) {
+				buffer_init(&(tb->outputs[i][j]), 2);
+				outputs_p[j] = &(tb->outputs[i][j]);
+			}
+			
+			if (t == 0)
+				spinn_router_init( &(tb->routers[i]), &(tb->s)
+				                 , ROUTER_PERIOD, ROUTER_PIPELINE
+				                 , &(tb->inputs[i]), outputs_p, &(tb->pool)
+				                 , (spinn_coord_t){i,0}
+				                 , use_emg_routing
+				                 , 2, 4
+				                 , array_on_forward, (void *)tb
+				                 , array_on_drop, (void *)tb
+				                 );
+			else
+				spinn_router_array_add( &a, &(tb->routers[i])
+				                      , &(tb->inputs[i]), outputs_p, &(tb->pool)
+				                      , (spinn_coord_t){i,0}
+				                      , use_emg_routing
+				                      , 2, 4
+				                      , array_on_forward, (void *)tb
+				                      , array_on_drop, (void *)tb
+				                      );
+		}
+	}
+	
+	// Run both simulations with the same random stimulus
+	int num_packets = 0;
+	for (int tick = 0; tick < ARRAY_TEST_TICKS; tick++) {
+		// Randomly offer packets to the routers' inputs
+		int router = rand() % NUM_ARRAY_ROUTERS;
+		if ( num_packets < NUM_ARRAY_PACKETS
+		     && !buffer_is_full(&(tbs[0].inputs[router]))
+		     && rand() % 2 == 0) {
+			spinn_packet_t p;
+			spinn_packet_init(&p, (spinn_coord_t){1,1}, (spinn_coord_t){rand() % NUM_ARRAY_ROUTERS, 0});
+			spinn_packet_set_inflection_point(&p, (spinn_coord_t){rand() % NUM_ARRAY_ROUTERS, 0});
+			spinn_packet_set_inflection_direction(&p, (spinn_direction_t)(rand() % 6));
+			spinn_packet_set_direction(&p, (spinn_direction_t)(rand() % 6));
+			spinn_packet_set_emg_state(&p, (spinn_emg_state_t)(rand() % 3));
+			p.sent_time = num_packets;
+			
+			for (int t = 0; t < 2; t++) {
+				*(tbs[t].packets[num_packets]) = p;
+				buffer_push( &(tbs[t].inputs[router])
+				           , spinn_packet_pool_get_handle(&(tbs[t].pool), tbs[t].packets[num_packets])
+				           );
+			}
+			num_packets++;
+		}
+		
+		// Randomly drain the outputs (slowly enough that they often block)
+		router = rand() % NUM_ARRAY_ROUTERS;
+		int output = rand() % 7;
+		if (!buffer_is_empty(&(tbs[0].outputs[router][output]))) {
+			for (int t = 0; t < 2; t++)
+				buffer_pop(&(tbs[t].outputs[router][output]));
+		}
+		
+		for (int t = 0; t < 2; t++)
+			scheduler_tick_tock(&(tbs[t].s));
+	}
+	
+	// Some packets should have been both forwarded and dropped
+	ck_assert_int_eq(tbs[0].num_records, tbs[1].num_records);
+	bool any_forwarded = false;
+	bool any_dropped = false;
+	for (int i = 0; i < tbs[0].num_records; i++) {
+		callback_record_t *r0 = &(tbs[0].records[i]);
+		callback_record_t *r1 = &(tbs[1].records[i]);
+		ck_assert(r0->forwarded == r1->forwarded);
+		ck_assert_int_eq(r0->router, r1->router);
+		ck_assert_int_eq(r0->time, r1->time);
+		ck_assert_int_eq(r0->packet->sent_time, r1->packet->sent_time);
+		ck_assert_int_eq(spinn_packet_get_direction(r0->packet), spinn_packet_get_direction(r1->packet));
+		ck_assert_int_eq(spinn_packet_get_emg_state(r0->packet), spinn_packet_get_emg_state(r1->packet));
+		ck_assert_int_eq(r0->packet->num_emg_hops, r1->packet->num_emg_hops);
+		any_forwarded |= r0->forwarded;
+		any_dropped |= !r0->forwarded;
+	}
+	ck_assert(any_forwarded);
+	ck_assert(any_dropped);
+	
+	for (int t = 0; t < 2; t++) {
+		for (int i = 0; i < NUM_ARRAY_ROUTERS; i++) {
+			spinn_router_destroy(&(tbs[t].routers[i]));
+			buffer_destroy(&(tbs[t].inputs[i]));
+			for (int j = 0; j < 7; j++)
+				buffer_destroy(&(tbs[t].outputs[i][j]));
+		}
+		spinn_packet_pool_destroy(&(tbs[t].pool));
+		scheduler_destroy(&(tbs[t].s));
+	}
+	spinn_router_array_destroy(&a);
+}
+END_TEST
+
+
 Suite *
 make_spinn_router_suite(void)
 {
@@ -712,9 +1202,34 @@ make_spinn_router_suite(void)
 	tcase_add_loop_test(tc_core, test_emg_first_leg, 0, 6*2);
 	tcase_add_loop_test(tc_core, test_emg_second_leg, 0, 6);
 	tcase_add_loop_test(tc_core, test_bubbles, 1, ROUTER_PIPELINE+1);
+	tcase_add_loop_test(tc_core, test_pipeline_timing, 1, PIPELINE_MAX_STAGES+1);
+	tcase_add_test(tc_core, test_mc_packet);
+	tcase_add_test(tc_core, test_mc_packet_pool_exhausted);
+	tcase_add_loop_test(tc_core, test_mc_packet_blocked, 0, 2);
+	
+	// The same tests for a router in a spinn_router_array_t
+	TCase *tc_batched = tcase_create("Batched");
+	tcase_add_checked_fixture(tc_batched, check_spinn_router_batched_setup, check_spinn_router_teardown);
+	tcase_add_test(tc_batched, test_idle);
+	tcase_add_loop_test(tc_batched, test_single_normal_packet, 0, 6);
+	tcase_add_test(tc_batched, test_multiple_normal_packet);
+	tcase_add_test(tc_batched, test_normal_packet_arrival);
+	tcase_add_loop_test(tc_batched, test_normal_packet_drop, 0, 2);
+	tcase_add_loop_test(tc_batched, test_emg_first_leg, 0, 6*2);
+	tcase_add_loop_test(tc_batched, test_emg_second_leg, 0, 6);
+	tcase_add_loop_test(tc_batched, test_bubbles, 1, ROUTER_PIPELINE+1);
+	tcase_add_loop_test(tc_batched, test_pipeline_timing, 1, PIPELINE_MAX_STAGES+1);
+	tcase_add_test(tc_batched, test_mc_packet);
+	tcase_add_test(tc_batched, test_mc_packet_pool_exhausted);
+	tcase_add_loop_test(tc_batched, test_mc_packet_blocked, 0, 2);
+	
+	TCase *tc_array = tcase_create("Array");
+	tcase_add_loop_test(tc_array, test_array_matches_routers, 0, 2);
 	
 	// Add each test case to the suite
 	suite_add_tcase(s, tc_core);
+	suite_add_tcase(s, tc_batched);
+	suite_add_tcase(s, tc_array);
 	
 	return s;
 }
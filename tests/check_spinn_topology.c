@@ -169,6 +169,59 @@ START_TEST (test_dir_to_vector)
 }
 END_TEST
 
+/**
+ * Make sure that following spinn_dor_direction from node to node reaches every
+ * destination by a shortest route, with and without wrap-around links.
+ */
+START_TEST (test_dor_direction)
+{
+	const spinn_coord_t test_sizes[] = {
+		{1,1}, {2,2}, {3,3}, {8,8}, {9,9},
+		{1,2}, {4,5}, {4,6}, {6,4}, {7,4},
+	};
+	const int num_tests = sizeof(test_sizes)/sizeof(spinn_coord_t);
+	
+	for (int wrap = 0; wrap < 2; wrap++) {
+		for (int i = 0; i < num_tests; i++) {
+			spinn_coord_t size = test_sizes[i];
+			for (int y1 = 0; y1 < size.y; y1++) {
+				for (int x1 = 0; x1 < size.x; x1++) {
+					for (int y2 = 0; y2 < size.y; y2++) {
+						for (int x2 = 0; x2 < size.x; x2++) {
+							spinn_coord_t source = {x1, y1};
+							spinn_coord_t destination = {x2, y2};
+							
+							// The length of the shortest route
+							spinn_full_coord_t v;
+							if (wrap)
+								v = spinn_shortest_vector(source, destination, size);
+							else
+								v = spinn_full_coord_minimise((spinn_full_coord_t){x2-x1, y2-y1, 0});
+							
+							// Follow the route, hop by hop
+							spinn_coord_t pos = source;
+							int num_hops = 0;
+							spinn_direction_t d;
+							while ((d = spinn_dor_direction(pos, destination, size, wrap)) != SPINN_LOCAL) {
+								spinn_coord_t delta = spinn_dir_to_vector(d);
+								pos.x = (pos.x + delta.x + size.x) % size.x;
+								pos.y = (pos.y + delta.y + size.y) % size.y;
+								num_hops++;
+								ck_assert(num_hops <= spinn_magnitude(v));
+							}
+							
+							ck_assert_int_eq(pos.x, x2);
+							ck_assert_int_eq(pos.y, y2);
+							ck_assert_int_eq(num_hops, spinn_magnitude(v));
+						}
+					}
+				}
+			}
+		}
+	}
+}
+END_TEST
+
 #include<stdio.h>
 #define _ 0
 START_TEST (test_hexagon)
@@ -225,6 +278,7 @@ make_spinn_topology_suite(void)
 	tcase_add_test(tc_core, test_full_coord_minimise);
 	tcase_add_test(tc_core, test_shortest_vector);
 	tcase_add_test(tc_core, test_dir_to_vector);
+	tcase_add_test(tc_core, test_dor_direction);
 	tcase_add_test(tc_core, test_hexagon);
 	
 	// Add each test case to the suite
@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+"""
+Convert a binary packet details file (produced when
+measurements.packet_details.format is "binary") into the text format produced
+otherwise.
+
+Usage::
+
+	python packet_details_to_tsv.py packet_details.bin > packet_details.dat
+
+Compressed files (packet_details.bin.gz) are decompressed automatically.
+
+See spinn_sim_stat.c for a description of the binary format.
+"""
+
+import gzip
+import struct
+import sys
+
+
+MAGIC = b"TSPD"
+
+GZIP_MAGIC = b"\x1f\x8b"
+
+VERSION = 1
+
+
+def read_exactly(in_file, num_bytes):
+	"""
+	Read exactly num_bytes from the file, raising an exception if the file ends
+	early.
+	"""
+	data = in_file.read(num_bytes)
+	if len(data) != num_bytes:
+		raise ValueError("Unexpected end of file.")
+	return data
+
+
+def convert(in_file, out_file):
+	"""
+	Convert the binary packet details in in_file into text, writing it to
+	out_file.
+	"""
+	if in_file.read(len(MAGIC)) != MAGIC:
+		raise ValueError("Not a binary packet details file.")
+	
+	# The file is in the byte order of the simulator which wrote it
+	version = read_exactly(in_file, 4)
+	for byte_order in "<>":
+		if struct.unpack(byte_order + "I", version)[0] == VERSION:
+			break
+	else:
+		raise ValueError("Unsupported binary packet details version.")
+	
+	def read_uint32():
+		return struct.unpack(byte_order + "I", read_exactly(in_file, 4))[0]
+	
+	def read_string():
+		return read_exactly(in_file, read_uint32()).decode("utf-8")
+	
+	out_file.write(read_string() + "\n")
+	types = read_string()
+	
+	while True:
+		num_records = in_file.read(4)
+		if len(num_records) == 0:
+			break
+		elif len(num_records) != 4:
+			raise ValueError("Unexpected end of file.")
+		num_records = struct.unpack(byte_order + "I", num_records)[0]
+		
+		standard_fields = read_string()
+		
+		columns = []
+		for column_type in types:
+			column_format = "%s%d%s"%(byte_order, num_records, column_type)
+			columns.append(struct.unpack( column_format
+			                            , read_exactly( in_file
+			                                          , struct.calcsize(column_format)
+			                                          )
+			                            ))
+		
+		for record in zip(*columns):
+			out_file.write(standard_fields
+			               + "".join("\t%d"%value for value in record)
+			               + "\n")
+
+
+if __name__=="__main__":
+	if len(sys.argv) != 2:
+		sys.stderr.write(__doc__)
+		sys.exit(1)
+	
+	with open(sys.argv[1], "rb") as in_file:
+		is_compressed = in_file.read(len(GZIP_MAGIC)) == GZIP_MAGIC
+	
+	with (gzip.open if is_compressed else open)(sys.argv[1], "rb") as in_file:
+		convert(in_file, sys.stdout)